@@ -1,4 +1,17 @@
 #include "sgjw.h"
+#include "sgjw_internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 
 #ifndef SGJW_DEBUG
 #define SGJW_DEBUG 1
@@ -8,27 +21,18 @@
 /* ======================================== Constants Definition ========================================= */
 /* ====================================================================================================== */
 
-// Field sizes
-#define SGJW_EOF_BYTES 16
-#define SGJW_OFFSET_BYTES 4
-#define SGJW_VERSION_BYTES 2
-#define SGJW_WIDTH_BYTES 2
-#define SGJW_HEIGHT_BYTES 2
-#define SGJW_DATE_BYTES 14
-#define SGJW_FLOAT32_BYTES 4
-#define SGJW_EMISSIVITY_BYTES 4
-#define SGJW_AMBIENT_TEMP_BYTES 4
-#define SGJW_FOV_BYTES 1
-#define SGJW_DISTANCE_BYTES 4
-#define SGJW_HUMIDITY_BYTES 1
-#define SGJW_REFLECTIVE_TEMP_BYTES 4
-#define SGJW_MANUFACTURER_BYTES 32
-#define SGJW_PRODUCT_BYTES 32
-#define SGJW_SN_BYTES 32
-#define SGJW_LONGITUDE_BYTES 8
-#define SGJW_LATITUDE_BYTES 8
-#define SGJW_ALTITUDE_BYTES 4
-#define SGJW_APPENDIX_LENGTH_BYTES 4
+// Stack buffer region reads use to fetch several neighbouring rows at once
+#define SGJW_REGION_BATCH_BYTES 16384
+
+// Statistics fold the matrix in chunks of this many floats, small enough to stay in L1 between decode and fold
+#define SGJW_STATS_CHUNK_FLOATS 4096
+
+// Chunk Copy_Range moves between two files
+#define SGJW_COPY_CHUNK_BYTES (64 * 1024)
+
+// Radiometric compensation only spreads over threads when each gets at least this many pixels
+#define SGJW_RADIOMETRY_THREAD_PIXELS 65536
+#define SGJW_KELVIN 273.15
 
 // clang-format off
 static const uint8_t SGJW_EOF_SIGNATURE[] = {
@@ -37,6 +41,12 @@ static const uint8_t SGJW_EOF_SIGNATURE[] = {
 };
 // clang-format on
 
+// Bytes read from disk by all read paths, see State_Grid_JPEG_Get_Bytes_Read
+static uint64_t sgjw_bytes_read = 0;
+
+// Allocator used for every heap allocation of the library, see State_Grid_JPEG_Set_Allocator
+static SGJWAllocator sgjw_allocator = {NULL, NULL, NULL};
+
 /* ====================================================================================================== */
 /* ======================================== Debug Function ============================================== */
 /* ====================================================================================================== */
@@ -70,8 +80,8 @@ typedef enum
 // Field information structure
 typedef struct
 {
-    // Pointer to the field in StateGridJPEG
-    void** field_ptr;
+    // Pointer to the field in StateGridJPEGV2
+    void* field;
     // Size of the field
     size_t size;
     // Number of elements (1 for scalar, >1 for arrays)
@@ -82,13 +92,55 @@ typedef struct
     const char* name;
 } FieldInfo;
 
+// Number of fixed fields in a trailer, matrix included, appendix excluded
+#define SGJW_FIELD_COUNT 18
+
+// Mapping between a StateGridJPEG pointer and its StateGridJPEGV2 value, for the v1 compatibility shim
+typedef struct
+{
+    // Pointer to the field in StateGridJPEG
+    void** field_ptr;
+    // Pointer to the value in StateGridJPEGV2
+    void* value;
+    // Size of the value, without the null terminator for texts
+    size_t size;
+    // 1 if the value is a null terminated text
+    uint8_t is_text;
+} ShimField;
+
+// Number of StateGridJPEG fields besides matrix and appendix
+#define SGJW_SHIM_FIELD_COUNT 17
+
 /* ====================================================================================================== */
 /* ======================================== Helper Functions ============================================ */
 /* ====================================================================================================== */
 
+void* SGJW_Malloc(size_t size, size_t align)
+{
+    if (sgjw_allocator.alloc)
+        return sgjw_allocator.alloc(size, align, sgjw_allocator.user);
+
+    if (align <= sizeof(void*))
+        return malloc(size);
+
+    void* ptr = NULL;
+    return posix_memalign(&ptr, align, size) == 0 ? ptr : NULL;
+}
+
+void SGJW_Free(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    if (sgjw_allocator.release)
+        sgjw_allocator.release(ptr, sgjw_allocator.user);
+    else
+        free(ptr);
+}
+
 static void* Malloc_Field(void** field, size_t size, const char* field_name, int8_t* retval)
 {
-    *field = malloc(size);
+    *field = SGJW_Malloc(size, sizeof(void*));
     if (*field == NULL)
     {
         *retval = SGJW_ERROR_MALLOC_FAILED;
@@ -190,513 +242,2533 @@ static void Binary_Set_Float64_B2L(uint8_t* buffer, size_t offset, double data)
 }
 
 /* ====================================================================================================== */
-/* ======================================== File Operations ============================================= */
+/* ======================================== Matrix Codec ================================================ */
 /* ====================================================================================================== */
 
-static size_t Open_File_In_Binary(const char* filepath, uint8_t** buffer)
+typedef void (*Bswap32_Kernel)(const uint8_t* src, size_t count, uint8_t* dst);
+
+// Resolved SGJW_KERNEL_AUTO, -1 until the first call
+static int sgjw_kernel = -1;
+
+// Reference kernel, every SIMD kernel must be bit-exact against it
+static void Bswap32_Scalar(const uint8_t* src, size_t count, uint8_t* dst)
 {
-    FILE* file = fopen(filepath, "rb");
-    if (file == NULL)
+    for (size_t i = 0; i < count; i++)
     {
-        Debug("No such file: [%s]\n", filepath);
-        return 0;
+        uint8_t b0 = src[i * 4 + 0];
+        uint8_t b1 = src[i * 4 + 1];
+        uint8_t b2 = src[i * 4 + 2];
+        uint8_t b3 = src[i * 4 + 3];
+        dst[i * 4 + 0] = b3;
+        dst[i * 4 + 1] = b2;
+        dst[i * 4 + 2] = b1;
+        dst[i * 4 + 3] = b0;
     }
+}
 
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    rewind(file);
+#if SGJW_HAVE_X86
+static void Bswap32_SSE2(const uint8_t* src, size_t count, uint8_t* dst)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        // Swap the bytes of each 16-bit lane, then the 16-bit lanes of each 32-bit word
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+        _mm_storeu_si128((__m128i*)(dst + i * 4), v);
+    }
+    Bswap32_Scalar(src + i * 4, count - i, dst + i * 4);
+}
 
-    *buffer = (uint8_t*)malloc(file_size);
-    if (*buffer == NULL)
+__attribute__((target("avx2"))) static void Bswap32_AVX2(const uint8_t* src, size_t count, uint8_t* dst)
+{
+    // clang-format off
+    const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    // clang-format on
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
     {
-        Debug("Malloc buffer fail.\n");
-        fclose(file);
-        return 0;
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_shuffle_epi8(v, mask));
     }
+    Bswap32_SSE2(src + i * 4, count - i, dst + i * 4);
+}
+#endif
 
-    size_t read_size = fread(*buffer, 1, file_size, file);
-    if (read_size != file_size)
+#if SGJW_HAVE_NEON
+static void Bswap32_NEON(const uint8_t* src, size_t count, uint8_t* dst)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
     {
-        Debug("Buffer size not equal file size.\n");
-        free(*buffer);
-        fclose(file);
-        return 0;
+        uint8x16_t v0 = vld1q_u8(src + i * 4);
+        uint8x16_t v1 = vld1q_u8(src + i * 4 + 16);
+        vst1q_u8(dst + i * 4, vrev32q_u8(v0));
+        vst1q_u8(dst + i * 4 + 16, vrev32q_u8(v1));
     }
+    Bswap32_Scalar(src + i * 4, count - i, dst + i * 4);
+}
+#endif
 
-    fclose(file);
-    return read_size;
+static Bswap32_Kernel Bswap32_Get_Kernel(SGJW_KERNEL kernel)
+{
+    switch (kernel)
+    {
+        case SGJW_KERNEL_AUTO:
+            return Bswap32_Get_Kernel(State_Grid_JPEG_Matrix_Kernel());
+        case SGJW_KERNEL_SCALAR:
+            return Bswap32_Scalar;
+#if SGJW_HAVE_X86
+        case SGJW_KERNEL_SSE2:
+            return Bswap32_SSE2;
+        case SGJW_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2") ? Bswap32_AVX2 : NULL;
+#endif
+#if SGJW_HAVE_NEON
+        case SGJW_KERNEL_NEON:
+            return Bswap32_NEON;
+#endif
+        default:
+            return NULL;
+    }
 }
 
-static int8_t Binary_Verification_EOF(uint8_t* buffer, size_t buffer_size)
+SGJW_KERNEL State_Grid_JPEG_Matrix_Kernel(void)
 {
-    if (buffer_size < SGJW_EOF_BYTES)
-        return SGJW_ERROR_INVALID_EOF;
+    int kernel = __atomic_load_n(&sgjw_kernel, __ATOMIC_RELAXED);
+    if (kernel >= 0)
+        return (SGJW_KERNEL)kernel;
+
+#if SGJW_HAVE_NEON
+    kernel = SGJW_KERNEL_NEON;
+#elif SGJW_HAVE_X86
+    __builtin_cpu_init();
+    kernel = __builtin_cpu_supports("avx2") ? SGJW_KERNEL_AVX2 : SGJW_KERNEL_SSE2;
+#else
+    kernel = SGJW_KERNEL_SCALAR;
+#endif
 
-    size_t offset = buffer_size - SGJW_EOF_BYTES;
-    return (memcmp(buffer + offset, SGJW_EOF_SIGNATURE, SGJW_EOF_BYTES) == 0) ? SGJW_SUCCESS : SGJW_ERROR_INVALID_EOF;
+    Debug("Matrix kernel: [%d]\n", kernel);
+    __atomic_store_n(&sgjw_kernel, kernel, __ATOMIC_RELAXED);
+    return (SGJW_KERNEL)kernel;
 }
 
-static size_t Binary_Get_Offsite(uint8_t* buffer, size_t buffer_size)
+int8_t State_Grid_JPEG_Matrix_Bswap32(const void* src, size_t count, void* dst, SGJW_KERNEL kernel)
 {
-    if (buffer_size < SGJW_EOF_BYTES + SGJW_OFFSET_BYTES)
-        return 0;
+    Bswap32_Kernel func = Bswap32_Get_Kernel(kernel);
+    if (!func || !src || !dst)
+        return SGJW_ERROR_INVALID_PARAMS;
 
-    size_t offset_start = buffer_size - SGJW_EOF_BYTES - SGJW_OFFSET_BYTES;
-    return Binary_Get_Uint_L2B(buffer, offset_start, SGJW_OFFSET_BYTES);
+    func((const uint8_t*)src, count, (uint8_t*)dst);
+    return SGJW_SUCCESS;
+}
+
+void State_Grid_JPEG_Matrix_Decode(const uint8_t* src, size_t count, float* dst)
+{
+#if SGJW_HOST_LITTLE_ENDIAN
+    // The file layout is already the host layout
+    if ((const void*)src != (const void*)dst)
+        memcpy(dst, src, count * sizeof(float));
+#else
+    State_Grid_JPEG_Matrix_Bswap32(src, count, dst, SGJW_KERNEL_AUTO);
+#endif
+}
+
+void State_Grid_JPEG_Matrix_Encode(const float* src, size_t count, uint8_t* dst)
+{
+#if SGJW_HOST_LITTLE_ENDIAN
+    if ((const void*)src != (const void*)dst)
+        memcpy(dst, src, count * sizeof(float));
+#else
+    State_Grid_JPEG_Matrix_Bswap32(src, count, dst, SGJW_KERNEL_AUTO);
+#endif
 }
 
 /* ====================================================================================================== */
-/* ======================================== Field Operations ============================================ */
+/* ======================================== Matrix Statistics =========================================== */
 /* ====================================================================================================== */
 
-static int8_t Read_Field_Value(uint8_t* buffer, size_t offset, FieldInfo* info, void* field)
+// Running statistics across chunks, sums are taken around pivot to keep the variance free of cancellation
+typedef struct
 {
-    switch (info->type)
+    double sum;
+    double sum_squares;
+    double pivot;
+    // Pixels folded so far, NaN included, i.e. the matrix position of the next chunk
+    uint64_t pixels;
+    // Pixels that are not NaN
+    uint64_t count;
+    uint64_t max_index;
+    float min;
+    float max;
+    // Neighbouring pixels mostly share a bin, spreading them over 4 copies breaks the increment dependency chain.
+    // The extra bin at SGJW_HISTOGRAM_BINS collects NaN pixels and is dropped.
+    uint32_t histogram[4][SGJW_HISTOGRAM_BINS + 1];
+} StatsAccumulator;
+
+// Fold count values into acc, index is the position of values[0] in the matrix
+typedef void (*Stats_Kernel)(const float* values, size_t count, uint64_t index, StatsAccumulator* acc);
+
+// Reference kernel, every SIMD kernel must match its count / min / max / hottest pixel exactly. NaN pixels are skipped.
+static void Stats_Scalar(const float* values, size_t count, uint64_t index, StatsAccumulator* acc)
+{
+    for (size_t i = 0; i < count; i++)
     {
-        case FIELD_UINT8:
-            *(uint8_t*)field = (uint8_t)Binary_Get_Uint_L2B(buffer, offset, 1);
-            break;
-        case FIELD_UINT16:
-            *(uint16_t*)field = (uint16_t)Binary_Get_Uint_L2B(buffer, offset, 2);
-            break;
-        case FIELD_UINT32:
-            *(uint32_t*)field = (uint32_t)Binary_Get_Uint_L2B(buffer, offset, 4);
-            break;
-        case FIELD_FLOAT32:
-            *(float*)field = Binary_Get_Float32_L2B(buffer, offset);
-            break;
-        case FIELD_FLOAT64:
-            *(double*)field = Binary_Get_Float64_L2B(buffer, offset);
-            break;
-        case FIELD_CHAR_ARRAY:
-            Binary_Get_Char(buffer, offset, info->size, (char*)field);
-            break;
-        case FIELD_FLOAT_MATRIX:
-            for (size_t i = 0; i < info->count; i++)
-            {
-                ((float*)field)[i] = Binary_Get_Float32_L2B(buffer, offset + i * 4);
-            }
-            break;
-        default:
-            return SGJW_ERROR_FIELD_READ_FAILED;
+        float value = values[i];
+        if (value != value)
+            continue;
+
+        double delta = value - acc->pivot;
+        acc->count++;
+        acc->sum += delta;
+        acc->sum_squares += delta * delta;
+        if (value < acc->min)
+            acc->min = value;
+        if (value > acc->max)
+        {
+            acc->max = value;
+            acc->max_index = index + i;
+        }
     }
+}
 
-    return SGJW_SUCCESS;
+/**
+ * @brief Fold the per-lane results of a SIMD kernel into acc.
+ *
+ * @note On equal maxima the lowest index wins, the result does not depend on the lane count.
+ */
+static void Stats_Merge_Lanes(const float* mins, const float* maxs, const int32_t* indices, size_t lanes, uint64_t index, StatsAccumulator* acc)
+{
+    for (size_t l = 0; l < lanes; l++)
+    {
+        uint64_t lane_index = index + (uint32_t)indices[l];
+        if (mins[l] < acc->min)
+            acc->min = mins[l];
+        if (maxs[l] > acc->max || (maxs[l] == acc->max && lane_index < acc->max_index))
+        {
+            acc->max = maxs[l];
+            acc->max_index = lane_index;
+        }
+    }
 }
 
-static int8_t Read_Field(uint8_t* buffer, size_t* offset, FieldInfo* info)
+#if SGJW_HAVE_X86
+static void Stats_SSE2(const float* values, size_t count, uint64_t index, StatsAccumulator* acc)
 {
-    int8_t retval = SGJW_SUCCESS;
-    size_t alloc_size = info->size * (info->count ? info->count : 1);
+    const __m128d pivot = _mm_set1_pd(acc->pivot);
+    const __m128 pivot_ps = _mm_set1_ps((float)acc->pivot);
+    __m128 min = _mm_set1_ps(INFINITY);
+    __m128 max = _mm_set1_ps(-INFINITY);
+    __m128i max_index = _mm_setzero_si128();
+    __m128i lane_index = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i valid = _mm_setzero_si128();
+    __m128d sum = _mm_setzero_pd();
+    __m128d sum_squares = _mm_setzero_pd();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 v = _mm_loadu_ps(values + i);
+        __m128i greater = _mm_castps_si128(_mm_cmpgt_ps(v, max));
+        max_index = _mm_or_si128(_mm_and_si128(greater, lane_index), _mm_andnot_si128(greater, max_index));
+        lane_index = _mm_add_epi32(lane_index, _mm_set1_epi32(4));
+        // v first: minps / maxps return the second operand on NaN, so NaN pixels are skipped as in Stats_Scalar
+        min = _mm_min_ps(v, min);
+        max = _mm_max_ps(v, max);
+
+        // NaN lanes are replaced by the pivot, which adds nothing to the sums, and left out of the count
+        __m128 ordered = _mm_cmpord_ps(v, v);
+        valid = _mm_sub_epi32(valid, _mm_castps_si128(ordered));
+        v = _mm_or_ps(_mm_and_ps(ordered, v), _mm_andnot_ps(ordered, pivot_ps));
+
+        __m128d lo = _mm_sub_pd(_mm_cvtps_pd(v), pivot);
+        __m128d hi = _mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), pivot);
+        sum = _mm_add_pd(sum, _mm_add_pd(lo, hi));
+        sum_squares = _mm_add_pd(sum_squares, _mm_add_pd(_mm_mul_pd(lo, lo), _mm_mul_pd(hi, hi)));
+    }
 
-    // Allocate memory for the field
-    if (!Malloc_Field(info->field_ptr, alloc_size, info->name, &retval))
-        return retval;
+    float mins[4], maxs[4];
+    int32_t indices[4], counts[4];
+    double sums[2], squares[2];
+    _mm_storeu_ps(mins, min);
+    _mm_storeu_ps(maxs, max);
+    _mm_storeu_si128((__m128i*)indices, max_index);
+    _mm_storeu_si128((__m128i*)counts, valid);
+    _mm_storeu_pd(sums, sum);
+    _mm_storeu_pd(squares, sum_squares);
+
+    acc->count += (uint64_t)counts[0] + counts[1] + counts[2] + counts[3];
+    acc->sum += sums[0] + sums[1];
+    acc->sum_squares += squares[0] + squares[1];
+    Stats_Merge_Lanes(mins, maxs, indices, i ? 4 : 0, index, acc);
+    Stats_Scalar(values + i, count - i, index + i, acc);
+}
 
-    // Read the field value
-    retval = Read_Field_Value(buffer, *offset, info, *info->field_ptr);
-    if (retval != SGJW_SUCCESS)
+__attribute__((target("avx2"))) static void Stats_AVX2(const float* values, size_t count, uint64_t index, StatsAccumulator* acc)
+{
+    const __m256d pivot = _mm256_set1_pd(acc->pivot);
+    const __m256 pivot_ps = _mm256_set1_ps((float)acc->pivot);
+    __m256 min = _mm256_set1_ps(INFINITY);
+    __m256 max = _mm256_set1_ps(-INFINITY);
+    __m256i max_index = _mm256_setzero_si256();
+    __m256i lane_index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i valid = _mm256_setzero_si256();
+    __m256d sum = _mm256_setzero_pd();
+    __m256d sum_squares = _mm256_setzero_pd();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
     {
-        free(*info->field_ptr);
-        *info->field_ptr = NULL;
-        return retval;
+        __m256 v = _mm256_loadu_ps(values + i);
+        __m256i greater = _mm256_castps_si256(_mm256_cmp_ps(v, max, _CMP_GT_OQ));
+        max_index = _mm256_blendv_epi8(max_index, lane_index, greater);
+        lane_index = _mm256_add_epi32(lane_index, _mm256_set1_epi32(8));
+        // v first, NaN pixels leave the accumulators alone
+        min = _mm256_min_ps(v, min);
+        max = _mm256_max_ps(v, max);
+
+        // NaN lanes count as the pivot in the sums, as in Stats_SSE2
+        __m256 ordered = _mm256_cmp_ps(v, v, _CMP_ORD_Q);
+        valid = _mm256_sub_epi32(valid, _mm256_castps_si256(ordered));
+        v = _mm256_blendv_ps(pivot_ps, v, ordered);
+
+        __m256d lo = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(v)), pivot);
+        __m256d hi = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)), pivot);
+        sum = _mm256_add_pd(sum, _mm256_add_pd(lo, hi));
+        sum_squares = _mm256_add_pd(sum_squares, _mm256_add_pd(_mm256_mul_pd(lo, lo), _mm256_mul_pd(hi, hi)));
     }
 
-    // Debug output
-    switch (info->type)
+    float mins[8], maxs[8];
+    int32_t indices[8], counts[8];
+    double sums[4], squares[4];
+    _mm256_storeu_ps(mins, min);
+    _mm256_storeu_ps(maxs, max);
+    _mm256_storeu_si256((__m256i*)indices, max_index);
+    _mm256_storeu_si256((__m256i*)counts, valid);
+    _mm256_storeu_pd(sums, sum);
+    _mm256_storeu_pd(squares, sum_squares);
+
+    for (size_t l = 0; l < 8; l++)
+        acc->count += (uint64_t)counts[l];
+    acc->sum += (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    acc->sum_squares += (squares[0] + squares[1]) + (squares[2] + squares[3]);
+    Stats_Merge_Lanes(mins, maxs, indices, i ? 8 : 0, index, acc);
+    Stats_SSE2(values + i, count - i, index + i, acc);
+}
+#endif
+
+#if SGJW_HAVE_NEON && defined(__aarch64__)
+static void Stats_NEON(const float* values, size_t count, uint64_t index, StatsAccumulator* acc)
+{
+    const float64x2_t pivot = vdupq_n_f64(acc->pivot);
+    const float32x4_t pivot_ps = vdupq_n_f32((float)acc->pivot);
+    float32x4_t min = vdupq_n_f32(INFINITY);
+    float32x4_t max = vdupq_n_f32(-INFINITY);
+    uint32x4_t max_index = vdupq_n_u32(0);
+    uint32x4_t lane_index = {0, 1, 2, 3};
+    uint32x4_t valid = vdupq_n_u32(0);
+    float64x2_t sum = vdupq_n_f64(0.0);
+    float64x2_t sum_squares = vdupq_n_f64(0.0);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
     {
-        case FIELD_UINT8:
-            Debug("%s: [%x][%d]\n", info->name, *(uint8_t*)*info->field_ptr, *(uint8_t*)*info->field_ptr);
-            break;
-        case FIELD_UINT16:
-            Debug("%s: [%x][%d]\n", info->name, *(uint16_t*)*info->field_ptr, *(uint16_t*)*info->field_ptr);
-            break;
-        case FIELD_UINT32:
-            Debug("%s: [%x][%d]\n", info->name, *(uint32_t*)*info->field_ptr, *(uint32_t*)*info->field_ptr);
-            break;
-        case FIELD_FLOAT32:
-            Debug("%s: [%x][%.2f]\n", info->name, *(uint32_t*)*info->field_ptr, *(float*)*info->field_ptr);
-            break;
-        case FIELD_FLOAT64:
-            Debug("%s: [%x][%.2f]\n", info->name, *(uint64_t*)*info->field_ptr, *(double*)*info->field_ptr);
-            break;
-        case FIELD_CHAR_ARRAY:
-            Debug("%s: [%s]\n", info->name, (char*)*info->field_ptr);
-            break;
-        case FIELD_FLOAT_MATRIX:
-            Debug("%s: First element [%.2f]\n", info->name, ((float*)*info->field_ptr)[0]);
-            Debug("%s: Second element [%.2f]\n", info->name, ((float*)*info->field_ptr)[1]);
-            break;
+        float32x4_t v = vld1q_f32(values + i);
+        // Select rather than vminq / vmaxq, which would keep NaN, same comparisons as the scalar kernel
+        uint32x4_t greater = vcgtq_f32(v, max);
+        max_index = vbslq_u32(greater, lane_index, max_index);
+        lane_index = vaddq_u32(lane_index, vdupq_n_u32(4));
+        min = vbslq_f32(vcltq_f32(v, min), v, min);
+        max = vbslq_f32(greater, v, max);
+
+        // NaN lanes count as the pivot in the sums, as in Stats_SSE2
+        uint32x4_t ordered = vceqq_f32(v, v);
+        valid = vsubq_u32(valid, ordered);
+        v = vbslq_f32(ordered, v, pivot_ps);
+
+        float64x2_t lo = vsubq_f64(vcvt_f64_f32(vget_low_f32(v)), pivot);
+        float64x2_t hi = vsubq_f64(vcvt_high_f64_f32(v), pivot);
+        sum = vaddq_f64(sum, vaddq_f64(lo, hi));
+        sum_squares = vfmaq_f64(vfmaq_f64(sum_squares, lo, lo), hi, hi);
     }
 
-    *offset += info->size * (info->count ? info->count : 1);
-    return SGJW_SUCCESS;
+    float mins[4], maxs[4];
+    int32_t indices[4];
+    vst1q_f32(mins, min);
+    vst1q_f32(maxs, max);
+    vst1q_s32(indices, vreinterpretq_s32_u32(max_index));
+
+    acc->count += vaddvq_u32(valid);
+    acc->sum += vaddvq_f64(sum);
+    acc->sum_squares += vaddvq_f64(sum_squares);
+    Stats_Merge_Lanes(mins, maxs, indices, i ? 4 : 0, index, acc);
+    Stats_Scalar(values + i, count - i, index + i, acc);
 }
+#endif
 
-static int8_t Write_Field_Value(uint8_t* buffer, size_t offset, FieldInfo* info, void* field)
+static Stats_Kernel Stats_Get_Kernel(SGJW_KERNEL kernel)
 {
-    if (!buffer || !info || !field)
-        return SGJW_ERROR_INVALID_PARAMS;
-
-    switch (info->type)
+    switch (kernel)
     {
-        case FIELD_UINT8:
-            Binary_Set_Uint8_B2L(buffer, offset, *(uint8_t*)field);
-            break;
-        case FIELD_UINT16:
-            Binary_Set_Uint16_B2L(buffer, offset, *(uint16_t*)field);
-            break;
-        case FIELD_UINT32:
-            Binary_Set_Uint32_B2L(buffer, offset, *(uint32_t*)field);
-            break;
-        case FIELD_FLOAT32:
-            Binary_Set_Float32_B2L(buffer, offset, *(float*)field);
-            break;
-        case FIELD_FLOAT64:
-            Binary_Set_Float64_B2L(buffer, offset, *(double*)field);
-            break;
-        case FIELD_CHAR_ARRAY:
-            memcpy(buffer + offset, field, info->size);
-            break;
-        case FIELD_FLOAT_MATRIX:
-            for (size_t i = 0; i < info->count; i++)
-            {
-                Binary_Set_Float32_B2L(buffer, offset + i * sizeof(float), ((float*)field)[i]);
-            }
-            break;
+        case SGJW_KERNEL_AUTO:
+            return Stats_Get_Kernel(State_Grid_JPEG_Matrix_Kernel());
+        case SGJW_KERNEL_SCALAR:
+            return Stats_Scalar;
+#if SGJW_HAVE_X86
+        case SGJW_KERNEL_SSE2:
+            return Stats_SSE2;
+        case SGJW_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2") ? Stats_AVX2 : NULL;
+#endif
+#if SGJW_HAVE_NEON
+        case SGJW_KERNEL_NEON:
+#if defined(__aarch64__)
+            return Stats_NEON;
+#else
+            // No double lanes on 32-bit NEON
+            return Stats_Scalar;
+#endif
+#endif
         default:
-            return SGJW_ERROR_FIELD_SET_FAILED;
+            return NULL;
     }
-
-    return SGJW_SUCCESS;
 }
 
-static int8_t Write_Field(uint8_t* buffer, size_t* offset, FieldInfo* info)
+static void Stats_Begin(StatsAccumulator* acc, SGJWStats* stats)
 {
-    if (!buffer || !offset || !info || !*info->field_ptr)
-        return SGJW_ERROR_INVALID_PARAMS;
+    memset(acc, 0, sizeof(StatsAccumulator));
+    acc->min = INFINITY;
+    acc->max = -INFINITY;
+    acc->max_index = UINT64_MAX;
 
-    int8_t retval = Write_Field_Value(buffer, *offset, info, *info->field_ptr);
-    if (retval != SGJW_SUCCESS)
-        return retval;
+    memset(&stats->count, 0, sizeof(SGJWStats) - offsetof(SGJWStats, count));
+}
 
-    // Debug output
-    switch (info->type)
+/**
+ * @brief Fold the next chunk of the matrix into the statistics, meant to run while the chunk is in cache.
+ */
+static void Stats_Update(StatsAccumulator* acc, SGJWStats* stats, Stats_Kernel kernel, const float* values, size_t count)
+{
+    if (count == 0)
+        return;
+
+    // The pivot is the first pixel that is not NaN, nothing has been summed around it before
+    for (size_t i = 0; i < count && acc->count == 0; i++)
     {
-        case FIELD_UINT8:
-            Debug("Write %s: [%x][%d]\n", info->name, *(uint8_t*)*info->field_ptr, *(uint8_t*)*info->field_ptr);
-            break;
-        case FIELD_UINT16:
-            Debug("Write %s: [%x][%d]\n", info->name, *(uint16_t*)*info->field_ptr, *(uint16_t*)*info->field_ptr);
-            break;
-        case FIELD_UINT32:
-            Debug("Write %s: [%x][%d]\n", info->name, *(uint32_t*)*info->field_ptr, *(uint32_t*)*info->field_ptr);
-            break;
-        case FIELD_FLOAT32:
-            Debug("Write %s: [%.2f]\n", info->name, *(float*)*info->field_ptr);
-            break;
-        case FIELD_FLOAT64:
-            Debug("Write %s: [%.2f]\n", info->name, *(double*)*info->field_ptr);
-            break;
-        case FIELD_CHAR_ARRAY:
-            Debug("Write %s: [%s]\n", info->name, (char*)*info->field_ptr);
-            break;
-        case FIELD_FLOAT_MATRIX:
-            Debug("Write %s: First element [%.2f]\n", info->name, ((float*)*info->field_ptr)[0]);
+        if (values[i] == values[i])
+        {
+            acc->pivot = values[i];
             break;
+        }
     }
 
-    *offset += info->size * (info->count ? info->count : 1);
-    return SGJW_SUCCESS;
-}
+    kernel(values, count, acc->pixels, acc);
+    acc->pixels += count;
 
-/* ====================================================================================================== */
-/* ========================================== Main APIs ================================================= */
-/* ====================================================================================================== */
+    if (stats->histogram_high > stats->histogram_low)
+    {
+        const float low = stats->histogram_low;
+        const float scale = SGJW_HISTOGRAM_BINS / (stats->histogram_high - stats->histogram_low);
+        int32_t bins[64];
 
-int8_t State_Grid_JPEG_Read(const char* filepath, StateGridJPEG* obj)
+        for (size_t i = 0; i < count; i += 64)
+        {
+            size_t n = count - i < 64 ? count - i : 64;
+
+            // Branch-free so the compiler vectorizes it, NaN goes to the dropped bin
+            for (size_t j = 0; j < n; j++)
+            {
+                float value = values[i + j];
+                float bin = (value - low) * scale;
+                bin = bin > 0.0f ? bin : 0.0f;
+                bin = bin < SGJW_HISTOGRAM_BINS - 1 ? bin : SGJW_HISTOGRAM_BINS - 1;
+                bins[j] = value == value ? (int32_t)bin : SGJW_HISTOGRAM_BINS;
+            }
+
+            for (size_t j = 0; j < n; j++)
+                acc->histogram[j & 3][bins[j]]++;
+        }
+    }
+}
+
+static void Stats_End(StatsAccumulator* acc, SGJWStats* stats, uint16_t width)
 {
-    /* ---------- Step 1 : File Verification ---------- */
+    stats->count = acc->count;
+    if (acc->count == 0)
+        return;
 
-    if (!filepath || !obj)
-        return SGJW_ERROR_INVALID_PARAMS;
+    for (size_t i = 0; i < SGJW_HISTOGRAM_BINS; i++)
+        stats->histogram[i] = acc->histogram[0][i] + acc->histogram[1][i] + acc->histogram[2][i] + acc->histogram[3][i];
 
-    int8_t retval = SGJW_SUCCESS;
-    uint8_t* buffer = NULL;
-    size_t buffer_size = Open_File_In_Binary(filepath, &buffer);
+    double mean = acc->sum / acc->count;
+    double variance = acc->sum_squares / acc->count - mean * mean;
 
-    if (buffer_size == 0)
-    {
-        Debug("Read file: [%s] failed.\n", filepath);
-        return SGJW_ERROR_READ_FAILED;
-    }
-    Debug("Open Success\n");
+    stats->min = acc->min;
+    stats->max = acc->max;
+    stats->mean = acc->pivot + mean;
+    stats->stddev = variance > 0.0 ? sqrt(variance) : 0.0;
 
-    // Verify EOF signature
-    retval = Binary_Verification_EOF(buffer, buffer_size);
-    if (retval != SGJW_SUCCESS)
+    // Only NaN pixels leave the hottest pixel unset
+    if (width && acc->max_index != UINT64_MAX)
     {
-        Debug("File EOF label verification fail.\n");
-        goto cleanup;
+        stats->hottest_x = acc->max_index % width;
+        stats->hottest_y = acc->max_index / width;
     }
-    Debug("Verification Success\n");
+}
 
-    // Get data offset
-    size_t offset = Binary_Get_Offsite(buffer, buffer_size);
-    if (offset == 0)
-    {
-        retval = SGJW_ERROR_INVALID_OFFSET;
-        Debug("Get offset fail.\n");
-        goto cleanup;
-    }
-    Debug("Offset is: [%x][%d]\n", offset, offset);
+int8_t State_Grid_JPEG_Matrix_Stats(const float* matrix, uint16_t width, uint16_t height, SGJWStats* stats, SGJW_KERNEL kernel)
+{
+    Stats_Kernel func = Stats_Get_Kernel(kernel);
+    size_t count = (size_t)width * height;
+    if (!func || !stats || (!matrix && count > 0))
+        return SGJW_ERROR_INVALID_PARAMS;
 
-    /* ---------- Step 2 : Get Data in Binary ---------- */
+    StatsAccumulator acc;
+    Stats_Begin(&acc, stats);
 
+    // Same chunking as the read path, so both give the same sums
+    for (size_t done = 0; done < count; done += SGJW_STATS_CHUNK_FLOATS)
+        Stats_Update(&acc, stats, func, matrix + done, count - done < SGJW_STATS_CHUNK_FLOATS ? count - done : SGJW_STATS_CHUNK_FLOATS);
+
+    Stats_End(&acc, stats, width);
+    return SGJW_SUCCESS;
+}
+
+/* ====================================================================================================== */
+/* ======================================== File Operations ============================================= */
+/* ====================================================================================================== */
+
+static size_t Open_File_In_Binary(const char* filepath, uint8_t** buffer)
+{
+    FILE* file = fopen(filepath, "rb");
+    if (file == NULL)
+    {
+        Debug("No such file: [%s]\n", filepath);
+        return 0;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    rewind(file);
+
+    *buffer = (uint8_t*)SGJW_Malloc(file_size, sizeof(void*));
+    if (*buffer == NULL)
+    {
+        Debug("Malloc buffer fail.\n");
+        fclose(file);
+        return 0;
+    }
+
+    size_t read_size = fread(*buffer, 1, file_size, file);
+    __atomic_fetch_add(&sgjw_bytes_read, read_size, __ATOMIC_RELAXED);
+    if (read_size != file_size)
+    {
+        Debug("Buffer size not equal file size.\n");
+        SGJW_Free(*buffer);
+        fclose(file);
+        return 0;
+    }
+
+    fclose(file);
+    return read_size;
+}
+
+void SGJW_Count_Bytes_Read(uint64_t bytes)
+{
+    __atomic_fetch_add(&sgjw_bytes_read, bytes, __ATOMIC_RELAXED);
+}
+
+uint64_t SGJW_Now_Ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+uint8_t SGJW_Is_JPEG_Name(const char* name)
+{
+    const char* dot = strrchr(name, '.');
+    return dot && (strcasecmp(dot, ".jpg") == 0 || strcasecmp(dot, ".jpeg") == 0);
+}
+
+const char* SGJW_File_Name(const char* path)
+{
+    const char* slash = strrchr(path, '/');
+    const char* name = slash ? slash + 1 : path;
+    if (name[0] == '\0' || strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+        return NULL;
+    return name;
+}
+
+static int Name_Compare(const void* a, const void* b)
+{
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+int8_t SGJW_Check_Unique_Names(const char* const* filepaths, size_t count)
+{
+    const char** names = (const char**)SGJW_Malloc((count ? count : 1) * sizeof(char*), sizeof(void*));
+    if (!names)
+        return SGJW_ERROR_MALLOC_FAILED;
+
+    size_t named = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const char* name = filepaths[i] ? SGJW_File_Name(filepaths[i]) : NULL;
+        if (name)
+            names[named++] = name;
+    }
+    qsort(names, named, sizeof(char*), Name_Compare);
+
+    int8_t retval = SGJW_SUCCESS;
+    for (size_t i = 1; i < named && retval == SGJW_SUCCESS; ++i)
+    {
+        if (strcmp(names[i - 1], names[i]) == 0)
+        {
+            Debug("Two files are named [%s].\n", names[i]);
+            retval = SGJW_ERROR_INVALID_PARAMS;
+        }
+    }
+
+    SGJW_Free(names);
+    return retval;
+}
+
+void SGJW_Date_Key(const char* date, char fill, char key[SGJW_DATE_BYTES])
+{
+    size_t length = strnlen(date, SGJW_DATE_BYTES);
+    memcpy(key, date, length);
+    memset(key + length, fill, SGJW_DATE_BYTES - length);
+}
+
+uint32_t SGJW_Date_Bound(const void* dates, size_t stride, uint32_t count, const char key[SGJW_DATE_BYTES], uint8_t upper)
+{
+    uint32_t low = 0;
+    uint32_t high = count;
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        int order = memcmp((const uint8_t*)dates + (size_t)middle * stride, key, SGJW_DATE_BYTES);
+        if (order < 0 || (upper && order == 0))
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+int8_t SGJW_Pread_Full(int fd, void* buffer, size_t size, uint64_t offset)
+{
+    uint8_t* bytes = (uint8_t*)buffer;
+    while (size > 0)
+    {
+        ssize_t n = pread(fd, bytes, size, (off_t)offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return SGJW_ERROR_READ_FAILED;
+
+        SGJW_Count_Bytes_Read(n);
+        bytes += n;
+        size -= n;
+        offset += n;
+    }
+    return SGJW_SUCCESS;
+}
+
+int8_t SGJW_Pwrite_Full(int fd, const void* data, size_t size, uint64_t offset)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    while (size > 0)
+    {
+        ssize_t n = pwrite(fd, bytes, size, (off_t)offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return SGJW_ERROR_FILE_WRITE;
+
+        bytes += n;
+        size -= n;
+        offset += n;
+    }
+    return SGJW_SUCCESS;
+}
+
+static int8_t Pwritev_Full(int fd, struct iovec* iov, int iovcnt, uint64_t offset)
+{
+    while (iovcnt > 0)
+    {
+        ssize_t n = pwritev(fd, iov, iovcnt, offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return SGJW_ERROR_FILE_WRITE;
+        offset += n;
+
+        // Skip what has been written, a short write resumes inside an iovec
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len)
+        {
+            n -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (uint8_t*)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return SGJW_SUCCESS;
+}
+
+static int8_t Binary_Verification_EOF(uint8_t* buffer, size_t buffer_size)
+{
+    if (buffer_size < SGJW_EOF_BYTES)
+        return SGJW_ERROR_INVALID_EOF;
+
+    size_t offset = buffer_size - SGJW_EOF_BYTES;
+    return (memcmp(buffer + offset, SGJW_EOF_SIGNATURE, SGJW_EOF_BYTES) == 0) ? SGJW_SUCCESS : SGJW_ERROR_INVALID_EOF;
+}
+
+static size_t Binary_Get_Offsite(uint8_t* buffer, size_t buffer_size)
+{
+    if (buffer_size < SGJW_EOF_BYTES + SGJW_OFFSET_BYTES)
+        return 0;
+
+    size_t offset_start = buffer_size - SGJW_EOF_BYTES - SGJW_OFFSET_BYTES;
+    return Binary_Get_Uint_L2B(buffer, offset_start, SGJW_OFFSET_BYTES);
+}
+
+/* ====================================================================================================== */
+/* ======================================== Radiometric Compensation ==================================== */
+/* ====================================================================================================== */
+
+/*
+ * The camera sees W = tau * e * W(T) + tau * (1 - e) * W(T_refl) + (1 - tau) * W(T_atm), with the broadband
+ * W(T) = sigma * T^4 (Kelvin) and the atmospheric transmission tau of distance and humidity. For fixed
+ * parameters that is W = A * T^4 + B, so moving a pixel to new parameters is T'^4 = a * T^4 + b with
+ * a = A / A' and b = (B - B') / A'.
+ */
+
+// Convert count Celsius values, dst may equal src
+typedef void (*Radiometry_Kernel)(const float* src, size_t count, float a, float b, float* dst);
+
+// Reference kernel, every SIMD kernel must be bit-exact against it
+static void Radiometry_Scalar(const float* src, size_t count, float a, float b, float* dst)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        float kelvin = src[i] + (float)SGJW_KELVIN;
+        float square = kelvin * kelvin;
+        float value = a * (square * square) + b;
+        // Below the background the object would need negative radiance, clamp to absolute zero, NaN stays NaN
+        value = value < 0.0f ? 0.0f : value;
+        dst[i] = sqrtf(sqrtf(value)) - (float)SGJW_KELVIN;
+    }
+}
+
+#if SGJW_HAVE_X86
+static void Radiometry_SSE2(const float* src, size_t count, float a, float b, float* dst)
+{
+    const __m128 kelvin = _mm_set1_ps((float)SGJW_KELVIN);
+    const __m128 va = _mm_set1_ps(a);
+    const __m128 vb = _mm_set1_ps(b);
+    const __m128 zero = _mm_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 k = _mm_add_ps(_mm_loadu_ps(src + i), kelvin);
+        __m128 square = _mm_mul_ps(k, k);
+        __m128 value = _mm_add_ps(_mm_mul_ps(va, _mm_mul_ps(square, square)), vb);
+        // max(0, v) is 0 > v ? 0 : v, same as the scalar clamp
+        value = _mm_max_ps(zero, value);
+        _mm_storeu_ps(dst + i, _mm_sub_ps(_mm_sqrt_ps(_mm_sqrt_ps(value)), kelvin));
+    }
+    Radiometry_Scalar(src + i, count - i, a, b, dst + i);
+}
+
+__attribute__((target("avx2"))) static void Radiometry_AVX2(const float* src, size_t count, float a, float b, float* dst)
+{
+    const __m256 kelvin = _mm256_set1_ps((float)SGJW_KELVIN);
+    const __m256 va = _mm256_set1_ps(a);
+    const __m256 vb = _mm256_set1_ps(b);
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 k = _mm256_add_ps(_mm256_loadu_ps(src + i), kelvin);
+        __m256 square = _mm256_mul_ps(k, k);
+        __m256 value = _mm256_add_ps(_mm256_mul_ps(va, _mm256_mul_ps(square, square)), vb);
+        value = _mm256_max_ps(zero, value);
+        _mm256_storeu_ps(dst + i, _mm256_sub_ps(_mm256_sqrt_ps(_mm256_sqrt_ps(value)), kelvin));
+    }
+    Radiometry_SSE2(src + i, count - i, a, b, dst + i);
+}
+#endif
+
+#if SGJW_HAVE_NEON && defined(__aarch64__)
+static void Radiometry_NEON(const float* src, size_t count, float a, float b, float* dst)
+{
+    const float32x4_t kelvin = vdupq_n_f32((float)SGJW_KELVIN);
+    const float32x4_t va = vdupq_n_f32(a);
+    const float32x4_t vb = vdupq_n_f32(b);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4_t k = vaddq_f32(vld1q_f32(src + i), kelvin);
+        float32x4_t square = vmulq_f32(k, k);
+        float32x4_t value = vaddq_f32(vmulq_f32(va, vmulq_f32(square, square)), vb);
+        // Select rather than vmaxq, same comparison as the scalar clamp
+        value = vbslq_f32(vcltq_f32(value, zero), zero, value);
+        vst1q_f32(dst + i, vsubq_f32(vsqrtq_f32(vsqrtq_f32(value)), kelvin));
+    }
+    Radiometry_Scalar(src + i, count - i, a, b, dst + i);
+}
+#endif
+
+static Radiometry_Kernel Radiometry_Get_Kernel(SGJW_KERNEL kernel)
+{
+    switch (kernel)
+    {
+        case SGJW_KERNEL_AUTO:
+            return Radiometry_Get_Kernel(State_Grid_JPEG_Matrix_Kernel());
+        case SGJW_KERNEL_SCALAR:
+            return Radiometry_Scalar;
+#if SGJW_HAVE_X86
+        case SGJW_KERNEL_SSE2:
+            return Radiometry_SSE2;
+        case SGJW_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2") ? Radiometry_AVX2 : NULL;
+#endif
+#if SGJW_HAVE_NEON
+        case SGJW_KERNEL_NEON:
+#if defined(__aarch64__)
+            return Radiometry_NEON;
+#else
+            // No vector square root on 32-bit NEON
+            return Radiometry_Scalar;
+#endif
+#endif
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * @brief Atmospheric transmission over distance meters at a relative humidity and air temperature.
+ *
+ * @note The usual two-band model of thermography cameras, with the water vapour content of the air.
+ */
+static double Radiometry_Transmission(const SGJWRadiometry* radiometry)
+{
     // clang-format off
-    // Define all fields to be read
-    FieldInfo fields[] = {
-        { (void**)&obj->version, SGJW_VERSION_BYTES, 0, FIELD_UINT16, "Version" },
-        { (void**)&obj->width, SGJW_WIDTH_BYTES, 0, FIELD_UINT16, "Width" },
-        { (void**)&obj->height, SGJW_HEIGHT_BYTES, 0, FIELD_UINT16, "Height" },
-        { (void**)&obj->date, SGJW_DATE_BYTES, 0, FIELD_CHAR_ARRAY, "Date" },
-        { (void**)&obj->matrix, SGJW_FLOAT32_BYTES, 0, FIELD_FLOAT_MATRIX, "Matrix" }, // count will be set after reading width/height
-        { (void**)&obj->emissivity, SGJW_EMISSIVITY_BYTES, 0, FIELD_FLOAT32, "Emissivity" },
-        { (void**)&obj->ambient_temp, SGJW_AMBIENT_TEMP_BYTES, 0, FIELD_FLOAT32, "Ambient Temperature" },
-        { (void**)&obj->fov, SGJW_FOV_BYTES, 0, FIELD_UINT8, "FOV" },
-        { (void**)&obj->distance, SGJW_DISTANCE_BYTES, 0, FIELD_UINT32, "Distance" },
-        { (void**)&obj->humidity, SGJW_HUMIDITY_BYTES, 0, FIELD_UINT8, "Humidity" },
-        { (void**)&obj->reflective_temp, SGJW_REFLECTIVE_TEMP_BYTES, 0, FIELD_FLOAT32, "Reflective Temperature" },
-        { (void**)&obj->manufacturer, SGJW_MANUFACTURER_BYTES, 0, FIELD_CHAR_ARRAY, "Manufacturer" },
-        { (void**)&obj->product, SGJW_PRODUCT_BYTES, 0, FIELD_CHAR_ARRAY, "Product" },
-        { (void**)&obj->sn, SGJW_SN_BYTES, 0, FIELD_CHAR_ARRAY, "Serial Number" },
-        { (void**)&obj->longitude, SGJW_LONGITUDE_BYTES, 0, FIELD_FLOAT64, "Longitude" },
-        { (void**)&obj->latitude, SGJW_LATITUDE_BYTES, 0, FIELD_FLOAT64, "Latitude" },
-        { (void**)&obj->altitude, SGJW_ALTITUDE_BYTES, 0, FIELD_UINT32, "Altitude" },
-        { (void**)&obj->appendix_length, SGJW_APPENDIX_LENGTH_BYTES, 0, FIELD_UINT32, "Appendix Length" }
-    };
+    const double x = 1.9, alpha1 = 0.006569, alpha2 = 0.01262, beta1 = -0.002276, beta2 = -0.00667;
     // clang-format on
 
-    // Read each field
-    for (size_t i = 0; i < sizeof(fields) / sizeof(FieldInfo); ++i)
+    double t = radiometry->ambient_temp;
+    double water = radiometry->humidity / 100.0 * exp(1.5587 + 0.06939 * t - 0.00027816 * t * t + 0.00000068455 * t * t * t);
+    double root = sqrt((double)radiometry->distance);
+    double tau = x * exp(-root * (alpha1 + beta1 * sqrt(water))) + (1.0 - x) * exp(-root * (alpha2 + beta2 * sqrt(water)));
+    return tau > 1.0 ? 1.0 : tau;
+}
+
+/**
+ * @brief Coefficients of T'^4 = a * T^4 + b from the parameters a matrix has to the ones it should have.
+ */
+static int8_t Radiometry_Coefficients(const SGJWRadiometry* from, const SGJWRadiometry* to, float* a, float* b)
+{
+    const SGJWRadiometry* params[2] = {from, to};
+    double gain[2];
+    double offset[2];
+
+    for (int i = 0; i < 2; ++i)
+    {
+        double emissivity = params[i]->emissivity;
+        double reflected = params[i]->reflective_temp + SGJW_KELVIN;
+        double ambient = params[i]->ambient_temp + SGJW_KELVIN;
+        double tau = Radiometry_Transmission(params[i]);
+        if (!(emissivity > 0.0 && emissivity <= 1.0) || !(tau > 0.0))
+            return SGJW_ERROR_INVALID_PARAMS;
+
+        gain[i] = tau * emissivity;
+        offset[i] = tau * (1.0 - emissivity) * pow(reflected, 4.0) + (1.0 - tau) * pow(ambient, 4.0);
+    }
+
+    *a = (float)(gain[0] / gain[1]);
+    *b = (float)((offset[0] - offset[1]) / gain[1]);
+    return SGJW_SUCCESS;
+}
+
+// A contiguous range of pixels, in memory (src / dst) or in files (fd to out_fd, both at file_offset)
+typedef struct
+{
+    Radiometry_Kernel kernel;
+    float a;
+    float b;
+    const float* src;
+    float* dst;
+    int fd;
+    int out_fd;
+    uint64_t file_offset;
+    size_t count;
+    int8_t retval;
+} RadiometryTask;
+
+static void* Radiometry_Run(void* arg)
+{
+    RadiometryTask* task = (RadiometryTask*)arg;
+    if (task->fd < 0)
+    {
+        task->kernel(task->src, task->count, task->a, task->b, task->dst);
+        return NULL;
+    }
+
+    // Read, convert and write back chunk by chunk, the chunk never leaves L1
+    float chunk[SGJW_STATS_CHUNK_FLOATS];
+    for (size_t done = 0; done < task->count && task->retval == SGJW_SUCCESS; done += SGJW_STATS_CHUNK_FLOATS)
+    {
+        size_t n = task->count - done < SGJW_STATS_CHUNK_FLOATS ? task->count - done : SGJW_STATS_CHUNK_FLOATS;
+        uint64_t file_offset = task->file_offset + done * SGJW_FLOAT32_BYTES;
+
+        task->retval = SGJW_Pread_Full(task->fd, chunk, n * SGJW_FLOAT32_BYTES, file_offset);
+        if (task->retval != SGJW_SUCCESS)
+            break;
+
+        State_Grid_JPEG_Matrix_Decode((const uint8_t*)chunk, n, chunk);
+        task->kernel(chunk, n, task->a, task->b, chunk);
+        State_Grid_JPEG_Matrix_Encode(chunk, n, (uint8_t*)chunk);
+
+        struct iovec iov = {chunk, n * SGJW_FLOAT32_BYTES};
+        task->retval = Pwritev_Full(task->out_fd, &iov, 1, file_offset);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Split a task over threads, the calling thread takes the last part.
+ *
+ * @param threads 0 for one per online CPU, fewer when the frame is small.
+ */
+static int8_t Radiometry_Parallel(const RadiometryTask* whole, uint32_t threads)
+{
+    if (threads == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (uint32_t)cpus : 1;
+    }
+    size_t most = whole->count / SGJW_RADIOMETRY_THREAD_PIXELS;
+    if (threads > most)
+        threads = most > 0 ? (uint32_t)most : 1;
+    if (threads > 64)
+        threads = 64;
+
+    RadiometryTask tasks[64];
+    pthread_t ids[64];
+    uint8_t started[64] = {0};
+
+    // Parts start on a cache line of the matrix so two threads never write one line
+    size_t step = ((whole->count + threads - 1) / threads + 15) & ~(size_t)15;
+    for (uint32_t t = 0; t < threads; ++t)
+    {
+        size_t first = (size_t)t * step < whole->count ? (size_t)t * step : whole->count;
+        size_t last = first + step < whole->count ? first + step : whole->count;
+
+        tasks[t] = *whole;
+        tasks[t].src = whole->src ? whole->src + first : NULL;
+        tasks[t].dst = whole->dst ? whole->dst + first : NULL;
+        tasks[t].file_offset = whole->file_offset + first * SGJW_FLOAT32_BYTES;
+        tasks[t].count = last - first;
+        tasks[t].retval = SGJW_SUCCESS;
+    }
+
+    // A thread that cannot be started leaves its part to the calling thread
+    for (uint32_t t = 0; t + 1 < threads; ++t)
+        started[t] = pthread_create(&ids[t], NULL, Radiometry_Run, &tasks[t]) == 0;
+    for (uint32_t t = 0; t < threads; ++t)
+    {
+        if (!started[t])
+            Radiometry_Run(&tasks[t]);
+    }
+
+    int8_t retval = SGJW_SUCCESS;
+    for (uint32_t t = 0; t < threads; ++t)
+    {
+        if (started[t])
+            pthread_join(ids[t], NULL);
+        if (tasks[t].retval != SGJW_SUCCESS)
+            retval = tasks[t].retval;
+    }
+    return retval;
+}
+
+void State_Grid_JPEG_Radiometry_Of(const StateGridJPEGV2* obj, SGJWRadiometry* radiometry)
+{
+    radiometry->emissivity = obj->emissivity;
+    radiometry->reflective_temp = obj->reflective_temp;
+    radiometry->ambient_temp = obj->ambient_temp;
+    radiometry->distance = obj->distance;
+    radiometry->humidity = obj->humidity;
+}
+
+int8_t State_Grid_JPEG_Matrix_Recompensate(const float* src, float* dst, size_t count, const SGJWRadiometry* from, const SGJWRadiometry* to, uint32_t threads, SGJW_KERNEL kernel)
+{
+    if ((!src && count) || (!dst && count) || !from || !to)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    RadiometryTask task = {Radiometry_Get_Kernel(kernel), 0.0f, 0.0f, src, dst, -1, -1, 0, count, SGJW_SUCCESS};
+    if (!task.kernel)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    int8_t retval = Radiometry_Coefficients(from, to, &task.a, &task.b);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    return Radiometry_Parallel(&task, threads);
+}
+
+/* ====================================================================================================== */
+/* ======================================== Field Operations ============================================ */
+/* ====================================================================================================== */
+
+static int8_t Read_Field_Value(uint8_t* buffer, size_t offset, FieldInfo* info, void* field)
+{
+    switch (info->type)
+    {
+        case FIELD_UINT8:
+            *(uint8_t*)field = (uint8_t)Binary_Get_Uint_L2B(buffer, offset, 1);
+            break;
+        case FIELD_UINT16:
+            *(uint16_t*)field = (uint16_t)Binary_Get_Uint_L2B(buffer, offset, 2);
+            break;
+        case FIELD_UINT32:
+            *(uint32_t*)field = (uint32_t)Binary_Get_Uint_L2B(buffer, offset, 4);
+            break;
+        case FIELD_FLOAT32:
+            *(float*)field = Binary_Get_Float32_L2B(buffer, offset);
+            break;
+        case FIELD_FLOAT64:
+            *(double*)field = Binary_Get_Float64_L2B(buffer, offset);
+            break;
+        case FIELD_CHAR_ARRAY:
+            Binary_Get_Char(buffer, offset, info->size, (char*)field);
+            break;
+        case FIELD_FLOAT_MATRIX:
+            State_Grid_JPEG_Matrix_Decode(buffer + offset, info->count, (float*)field);
+            break;
+        default:
+            return SGJW_ERROR_FIELD_READ_FAILED;
+    }
+
+    return SGJW_SUCCESS;
+}
+
+static int8_t Read_Field(uint8_t* buffer, size_t buffer_size, size_t* offset, FieldInfo* info)
+{
+    size_t field_size = info->size * (info->count ? info->count : 1);
+
+    // Never read into the offset / EOF signature at the tail
+    if (*offset + field_size > buffer_size - SGJW_TAIL_BYTES)
+    {
+        Debug("Field %s exceeds trailer.\n", info->name);
+        return SGJW_ERROR_FIELD_READ_FAILED;
+    }
+
+    // Read the field value
+    int8_t retval = Read_Field_Value(buffer, *offset, info, info->field);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    // Debug output
+    switch (info->type)
+    {
+        case FIELD_UINT8:
+            Debug("%s: [%x][%d]\n", info->name, *(uint8_t*)info->field, *(uint8_t*)info->field);
+            break;
+        case FIELD_UINT16:
+            Debug("%s: [%x][%d]\n", info->name, *(uint16_t*)info->field, *(uint16_t*)info->field);
+            break;
+        case FIELD_UINT32:
+            Debug("%s: [%x][%d]\n", info->name, *(uint32_t*)info->field, *(uint32_t*)info->field);
+            break;
+        case FIELD_FLOAT32:
+            Debug("%s: [%x][%.2f]\n", info->name, *(uint32_t*)info->field, *(float*)info->field);
+            break;
+        case FIELD_FLOAT64:
+            Debug("%s: [%x][%.2f]\n", info->name, *(uint64_t*)info->field, *(double*)info->field);
+            break;
+        case FIELD_CHAR_ARRAY:
+            Debug("%s: [%s]\n", info->name, (char*)info->field);
+            break;
+        case FIELD_FLOAT_MATRIX:
+            Debug("%s: First element [%.2f]\n", info->name, ((float*)info->field)[0]);
+            Debug("%s: Second element [%.2f]\n", info->name, ((float*)info->field)[1]);
+            break;
+    }
+
+    *offset += field_size;
+    return SGJW_SUCCESS;
+}
+
+static int8_t Write_Field_Value(uint8_t* buffer, size_t offset, FieldInfo* info, void* field)
+{
+    if (!buffer || !info || !field)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    switch (info->type)
+    {
+        case FIELD_UINT8:
+            Binary_Set_Uint8_B2L(buffer, offset, *(uint8_t*)field);
+            break;
+        case FIELD_UINT16:
+            Binary_Set_Uint16_B2L(buffer, offset, *(uint16_t*)field);
+            break;
+        case FIELD_UINT32:
+            Binary_Set_Uint32_B2L(buffer, offset, *(uint32_t*)field);
+            break;
+        case FIELD_FLOAT32:
+            Binary_Set_Float32_B2L(buffer, offset, *(float*)field);
+            break;
+        case FIELD_FLOAT64:
+            Binary_Set_Float64_B2L(buffer, offset, *(double*)field);
+            break;
+        case FIELD_CHAR_ARRAY:
+            memcpy(buffer + offset, field, info->size);
+            break;
+        case FIELD_FLOAT_MATRIX:
+            State_Grid_JPEG_Matrix_Encode((float*)field, info->count, buffer + offset);
+            break;
+        default:
+            return SGJW_ERROR_FIELD_SET_FAILED;
+    }
+
+    return SGJW_SUCCESS;
+}
+
+static int8_t Write_Field(uint8_t* buffer, size_t* offset, FieldInfo* info)
+{
+    if (!buffer || !offset || !info || !info->field)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    int8_t retval = Write_Field_Value(buffer, *offset, info, info->field);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    // Debug output
+    switch (info->type)
+    {
+        case FIELD_UINT8:
+            Debug("Write %s: [%x][%d]\n", info->name, *(uint8_t*)info->field, *(uint8_t*)info->field);
+            break;
+        case FIELD_UINT16:
+            Debug("Write %s: [%x][%d]\n", info->name, *(uint16_t*)info->field, *(uint16_t*)info->field);
+            break;
+        case FIELD_UINT32:
+            Debug("Write %s: [%x][%d]\n", info->name, *(uint32_t*)info->field, *(uint32_t*)info->field);
+            break;
+        case FIELD_FLOAT32:
+            Debug("Write %s: [%.2f]\n", info->name, *(float*)info->field);
+            break;
+        case FIELD_FLOAT64:
+            Debug("Write %s: [%.2f]\n", info->name, *(double*)info->field);
+            break;
+        case FIELD_CHAR_ARRAY:
+            Debug("Write %s: [%s]\n", info->name, (char*)info->field);
+            break;
+        case FIELD_FLOAT_MATRIX:
+            Debug("Write %s: First element [%.2f]\n", info->name, ((float*)info->field)[0]);
+            break;
+    }
+
+    *offset += info->size * (info->count ? info->count : 1);
+    return SGJW_SUCCESS;
+}
+
+/**
+ * @brief Fill the fixed fields of a trailer, in file order, pointing into a v2 object.
+ *
+ * @note The matrix entry points to obj->matrix with width * height elements at the time of the call.
+ */
+static size_t Field_Table(StateGridJPEGV2* obj, FieldInfo fields[SGJW_FIELD_COUNT])
+{
+    // clang-format off
+    FieldInfo table[SGJW_FIELD_COUNT] = {
+        { &obj->version, SGJW_VERSION_BYTES, 0, FIELD_UINT16, "Version" },
+        { &obj->width, SGJW_WIDTH_BYTES, 0, FIELD_UINT16, "Width" },
+        { &obj->height, SGJW_HEIGHT_BYTES, 0, FIELD_UINT16, "Height" },
+        { obj->date, SGJW_DATE_BYTES, 0, FIELD_CHAR_ARRAY, "Date" },
+        { obj->matrix, SGJW_FLOAT32_BYTES, (size_t)obj->width * obj->height, FIELD_FLOAT_MATRIX, "Matrix" },
+        { &obj->emissivity, SGJW_EMISSIVITY_BYTES, 0, FIELD_FLOAT32, "Emissivity" },
+        { &obj->ambient_temp, SGJW_AMBIENT_TEMP_BYTES, 0, FIELD_FLOAT32, "Ambient Temperature" },
+        { &obj->fov, SGJW_FOV_BYTES, 0, FIELD_UINT8, "FOV" },
+        { &obj->distance, SGJW_DISTANCE_BYTES, 0, FIELD_UINT32, "Distance" },
+        { &obj->humidity, SGJW_HUMIDITY_BYTES, 0, FIELD_UINT8, "Humidity" },
+        { &obj->reflective_temp, SGJW_REFLECTIVE_TEMP_BYTES, 0, FIELD_FLOAT32, "Reflective Temperature" },
+        { obj->manufacturer, SGJW_MANUFACTURER_BYTES, 0, FIELD_CHAR_ARRAY, "Manufacturer" },
+        { obj->product, SGJW_PRODUCT_BYTES, 0, FIELD_CHAR_ARRAY, "Product" },
+        { obj->sn, SGJW_SN_BYTES, 0, FIELD_CHAR_ARRAY, "Serial Number" },
+        { &obj->longitude, SGJW_LONGITUDE_BYTES, 0, FIELD_FLOAT64, "Longitude" },
+        { &obj->latitude, SGJW_LATITUDE_BYTES, 0, FIELD_FLOAT64, "Latitude" },
+        { &obj->altitude, SGJW_ALTITUDE_BYTES, 0, FIELD_UINT32, "Altitude" },
+        { &obj->appendix_length, SGJW_APPENDIX_LENGTH_BYTES, 0, FIELD_UINT32, "Appendix Length" }
+    };
+    // clang-format on
+
+    memcpy(fields, table, sizeof(table));
+    return SGJW_FIELD_COUNT;
+}
+
+/**
+ * @brief Parse the fixed fields of a trailer starting at buffer[*offset] into a v2 object.
+ *
+ * @note The matrix is only located, *matrix_offset receives its position. It occupies width * height * 4 bytes
+ *       of the buffer, unless matrix_in_buffer is 0, i.e. header and footer are packed back to back.
+ *       On return *offset points at the appendix.
+ */
+static int8_t Parse_Fixed_Fields(uint8_t* buffer, size_t buffer_size, size_t* offset, uint8_t matrix_in_buffer, size_t* matrix_offset, StateGridJPEGV2* obj)
+{
+    FieldInfo fields[SGJW_FIELD_COUNT];
+    size_t field_count = Field_Table(obj, fields);
+
+    // Read each field, the matrix is only located here
+    for (size_t i = 0; i < field_count; ++i)
+    {
+        if (fields[i].type == FIELD_FLOAT_MATRIX)
+        {
+            size_t matrix_size = matrix_in_buffer ? (size_t)obj->width * obj->height * SGJW_FLOAT32_BYTES : 0;
+            if (*offset + matrix_size > buffer_size - SGJW_TAIL_BYTES)
+            {
+                Debug("Failed to read field: %s\n", fields[i].name);
+                return SGJW_ERROR_FIELD_READ_FAILED;
+            }
+            *matrix_offset = *offset;
+            *offset += matrix_size;
+            continue;
+        }
+
+        int8_t retval = Read_Field(buffer, buffer_size, offset, &fields[i]);
+        if (retval != SGJW_SUCCESS)
+        {
+            Debug("Failed to read field: %s\n", fields[i].name);
+            return retval;
+        }
+    }
+
+    return SGJW_SUCCESS;
+}
+
+/**
+ * @brief Parse the trailer starting at buffer[offset] into a v2 object.
+ *
+ * @note The footer is parsed before the matrix is decoded, so that matrix and appendix sizes are both
+ *       known when the block is reserved.
+ */
+static int8_t Parse_Trailer(uint8_t* buffer, size_t buffer_size, size_t offset, StateGridJPEGV2* obj)
+{
+    size_t matrix_offset = 0;
+    int8_t retval = Parse_Fixed_Fields(buffer, buffer_size, &offset, 1, &matrix_offset, obj);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    if (obj->appendix_length > buffer_size - SGJW_TAIL_BYTES - offset)
+    {
+        Debug("Failed to read appendix\n");
+        return SGJW_ERROR_FIELD_READ_FAILED;
+    }
+
+    // One allocation for matrix and appendix
+    retval = State_Grid_JPEG_V2_Resize(obj, obj->width, obj->height, obj->appendix_length);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    FieldInfo matrix_field = {obj->matrix, SGJW_FLOAT32_BYTES, (size_t)obj->width * obj->height, FIELD_FLOAT_MATRIX, "Matrix"};
+    if (matrix_field.count > 0)
+    {
+        retval = Read_Field(buffer, buffer_size, &matrix_offset, &matrix_field);
+        if (retval != SGJW_SUCCESS)
+            return retval;
+    }
+
+    // Read appendix if present
+    if (obj->appendix_length > 0)
+    {
+        FieldInfo appendix_field = {obj->appendix, obj->appendix_length, 0, FIELD_CHAR_ARRAY, "Appendix"};
+
+        retval = Read_Field(buffer, buffer_size, &offset, &appendix_field);
+        if (retval != SGJW_SUCCESS)
+        {
+            Debug("Failed to read appendix\n");
+            return retval;
+        }
+    }
+
+    return SGJW_SUCCESS;
+}
+
+/**
+ * @brief Fill the v1 pointers besides matrix and appendix, paired with their v2 values.
+ */
+static size_t Shim_Table(StateGridJPEG* v1, StateGridJPEGV2* v2, ShimField fields[SGJW_SHIM_FIELD_COUNT])
+{
+    // clang-format off
+    ShimField table[SGJW_SHIM_FIELD_COUNT] = {
+        { (void**)&v1->version, &v2->version, sizeof(uint16_t), 0 },
+        { (void**)&v1->width, &v2->width, sizeof(uint16_t), 0 },
+        { (void**)&v1->height, &v2->height, sizeof(uint16_t), 0 },
+        { (void**)&v1->date, v2->date, SGJW_DATE_BYTES, 1 },
+        { (void**)&v1->emissivity, &v2->emissivity, sizeof(float), 0 },
+        { (void**)&v1->ambient_temp, &v2->ambient_temp, sizeof(float), 0 },
+        { (void**)&v1->fov, &v2->fov, sizeof(uint8_t), 0 },
+        { (void**)&v1->distance, &v2->distance, sizeof(uint32_t), 0 },
+        { (void**)&v1->humidity, &v2->humidity, sizeof(uint8_t), 0 },
+        { (void**)&v1->reflective_temp, &v2->reflective_temp, sizeof(float), 0 },
+        { (void**)&v1->manufacturer, v2->manufacturer, SGJW_MANUFACTURER_BYTES, 1 },
+        { (void**)&v1->product, v2->product, SGJW_PRODUCT_BYTES, 1 },
+        { (void**)&v1->sn, v2->sn, SGJW_SN_BYTES, 1 },
+        { (void**)&v1->longitude, &v2->longitude, sizeof(double), 0 },
+        { (void**)&v1->latitude, &v2->latitude, sizeof(double), 0 },
+        { (void**)&v1->altitude, &v2->altitude, sizeof(uint32_t), 0 },
+        { (void**)&v1->appendix_length, &v2->appendix_length, sizeof(uint32_t), 0 }
+    };
+    // clang-format on
+
+    memcpy(fields, table, sizeof(table));
+    return SGJW_SHIM_FIELD_COUNT;
+}
+
+/**
+ * @brief Convert a v2 object into a v1 object, the v2 block is handed over as v1 matrix.
+ */
+static int8_t Shim_V1_From_V2(StateGridJPEGV2* v2, StateGridJPEG* v1)
+{
+    int8_t retval = SGJW_SUCCESS;
+    ShimField fields[SGJW_SHIM_FIELD_COUNT];
+    size_t field_count = Shim_Table(v1, v2, fields);
+
+    // The matrix sits at the start of the block, so the block can be freed as v1 matrix
+    v1->matrix = v2->matrix;
+    v2->block = NULL;
+
+    for (size_t i = 0; i < field_count; ++i)
+    {
+        if (!Malloc_Field(fields[i].field_ptr, fields[i].size + fields[i].is_text, "shim field", &retval))
+            return retval;
+        memcpy(*fields[i].field_ptr, fields[i].value, fields[i].size + fields[i].is_text);
+    }
+
+    if (v2->appendix_length > 0)
+    {
+        if (!Malloc_Field((void**)&v1->appendix, v2->appendix_length + 1, "Appendix", &retval))
+            return retval;
+        memcpy(v1->appendix, v2->appendix, v2->appendix_length + 1);
+    }
+
+    return SGJW_SUCCESS;
+}
+
+/**
+ * @brief Convert a v1 object into a v2 object borrowing the v1 matrix and appendix.
+ */
+static int8_t Shim_V2_From_V1(StateGridJPEG* v1, StateGridJPEGV2* v2)
+{
+    ShimField fields[SGJW_SHIM_FIELD_COUNT];
+    size_t field_count = Shim_Table(v1, v2, fields);
+
+    memset(v2, 0, sizeof(StateGridJPEGV2));
+    for (size_t i = 0; i < field_count; ++i)
+    {
+        if (!*fields[i].field_ptr)
+            return SGJW_ERROR_INVALID_PARAMS;
+        memcpy(fields[i].value, *fields[i].field_ptr, fields[i].size);
+    }
+
+    v2->matrix = v1->matrix;
+    v2->appendix = v1->appendix;
+    return SGJW_SUCCESS;
+}
+
+/* ====================================================================================================== */
+/* ========================================== Main APIs ================================================= */
+/* ====================================================================================================== */
+
+int8_t State_Grid_JPEG_Read(const char* filepath, StateGridJPEG* obj)
+{
+    return State_Grid_JPEG_Read_Ex(filepath, obj, SGJW_READ_DEFAULT);
+}
+
+int8_t State_Grid_JPEG_Read_Ex(const char* filepath, StateGridJPEG* obj, uint32_t flags)
+{
+    if (!filepath || !obj)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    memset(obj, 0, sizeof(StateGridJPEG));
+
+    StateGridJPEGV2 v2;
+    int8_t retval = State_Grid_JPEG_V2_Read(filepath, &v2, flags);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    retval = Shim_V1_From_V2(&v2, obj);
+    if (retval != SGJW_SUCCESS)
+        State_Grid_JPEG_Delete_OBJ(obj);
+
+    State_Grid_JPEG_V2_Delete_OBJ(&v2);
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Append(const char* filepath, StateGridJPEG* obj)
+{
+    if (!filepath || !obj)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    StateGridJPEGV2 v2;
+    int8_t retval = Shim_V2_From_V1(obj, &v2);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    return State_Grid_JPEG_V2_Append(filepath, &v2);
+}
+
+void State_Grid_JPEG_Delete_OBJ(StateGridJPEG* obj)
+{
+    if (!obj)
+        return;
+
+    // clang-format off
+    void* pointers[] = {
+        obj->version,
+        obj->width,
+        obj->height,
+        obj->date,
+        obj->matrix,
+        obj->emissivity,
+        obj->ambient_temp,
+        obj->fov,
+        obj->distance,
+        obj->humidity,
+        obj->reflective_temp,
+        obj->manufacturer,
+        obj->product,
+        obj->sn,
+        obj->longitude,
+        obj->latitude,
+        obj->altitude,
+        obj->appendix_length,
+        obj->appendix
+    };
+    // clang-format on
+
+    for (size_t i = 0; i < sizeof(pointers) / sizeof(void*); i++)
+    {
+        Debug("Try to free pointer %zu\n", i);
+        if (pointers[i])
+        {
+            SGJW_Free(pointers[i]);
+            pointers[i] = NULL;
+            Debug("Freed pointer %zu\n", i);
+        }
+    }
+
+    // Clear all pointers in the structure
+    memset(obj, 0, sizeof(StateGridJPEG));
+}
+
+int8_t State_Grid_JPEG_V2_Read(const char* filepath, StateGridJPEGV2* obj, uint32_t flags)
+{
+    /* ---------- Step 1 : File Verification ---------- */
+
+    if (!filepath || !obj)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    memset(obj, 0, sizeof(StateGridJPEGV2));
+
+    uint8_t* buffer = NULL;
+    size_t buffer_size = 0;
+    int8_t retval = SGJW_SUCCESS;
+
+    if (flags & SGJW_READ_TRAILER_ONLY)
+    {
+        // Positioned reads straight into the object
+        retval = State_Grid_JPEG_Read_Into(filepath, obj, flags);
+    }
+    else
+    {
+        buffer_size = Open_File_In_Binary(filepath, &buffer);
+        if (buffer_size == 0)
+        {
+            Debug("Read file: [%s] failed.\n", filepath);
+            return SGJW_ERROR_READ_FAILED;
+        }
+        Debug("Open Success\n");
+
+        /* ---------- Step 2 : Get Data in Binary ---------- */
+
+        retval = State_Grid_JPEG_Read_Buffer(buffer, buffer_size, obj);
+        SGJW_Free(buffer);
+    }
+
+    if (retval != SGJW_SUCCESS)
+        State_Grid_JPEG_V2_Delete_OBJ(obj);
+
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Read_Buffer(const uint8_t* data, size_t size, StateGridJPEGV2* obj)
+{
+    if (!data || !obj)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    // Parsing never writes to the buffer
+    uint8_t* buffer = (uint8_t*)data;
+
+    // Verify EOF signature
+    int8_t retval = Binary_Verification_EOF(buffer, size);
+    if (retval != SGJW_SUCCESS)
+    {
+        Debug("File EOF label verification fail.\n");
+        return retval;
+    }
+    Debug("Verification Success\n");
+
+    // Get data offset
+    size_t offset = Binary_Get_Offsite(buffer, size);
+    if (offset == 0 || offset > size - SGJW_TAIL_BYTES)
+    {
+        Debug("Get offset fail.\n");
+        return SGJW_ERROR_INVALID_OFFSET;
+    }
+    Debug("Offset is: [%x][%d]\n", offset, offset);
+
+    return Parse_Trailer(buffer, size, offset, obj);
+}
+
+int8_t SGJW_Check_Tail(uint8_t* fixed, uint64_t file_size, uint64_t* offset)
+{
+    if (file_size < SGJW_TAIL_BYTES)
+        return SGJW_ERROR_INVALID_EOF;
+
+    int8_t retval = Binary_Verification_EOF(fixed, SGJW_FIXED_BYTES);
+    if (retval != SGJW_SUCCESS)
+    {
+        Debug("File EOF label verification fail.\n");
+        return retval;
+    }
+
+    uint64_t trailer_end = file_size - SGJW_TAIL_BYTES;
+    *offset = Binary_Get_Offsite(fixed, SGJW_FIXED_BYTES);
+    if (*offset == 0 || *offset > trailer_end || trailer_end - *offset < SGJW_HEADER_BYTES + SGJW_FOOTER_BYTES)
+    {
+        Debug("Get offset fail.\n");
+        return SGJW_ERROR_INVALID_OFFSET;
+    }
+    Debug("Offset is: [%x][%d]\n", *offset, *offset);
+
+    return SGJW_SUCCESS;
+}
+
+int8_t SGJW_Check_Header(const uint8_t* fixed, uint64_t file_size, uint64_t offset, size_t* matrix_size)
+{
+    uint8_t* header = (uint8_t*)fixed;
+    *matrix_size = Binary_Get_Uint_L2B(header, SGJW_VERSION_BYTES, SGJW_WIDTH_BYTES) *
+                   Binary_Get_Uint_L2B(header, SGJW_VERSION_BYTES + SGJW_WIDTH_BYTES, SGJW_HEIGHT_BYTES) * SGJW_FLOAT32_BYTES;
+    if (*matrix_size > file_size - SGJW_TAIL_BYTES - offset - SGJW_HEADER_BYTES - SGJW_FOOTER_BYTES)
+    {
+        Debug("Matrix exceeds trailer.\n");
+        return SGJW_ERROR_FIELD_READ_FAILED;
+    }
+
+    return SGJW_SUCCESS;
+}
+
+int8_t SGJW_Parse_Fixed(uint8_t* fixed, uint64_t file_size, uint64_t offset, StateGridJPEGV2* obj, StateGridJPEGProbe* probe)
+{
+    size_t cursor = 0;
+    size_t matrix_offset = 0;
+
+    int8_t retval = Parse_Fixed_Fields(fixed, SGJW_FIXED_BYTES, &cursor, 0, &matrix_offset, obj);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    size_t matrix_size = (size_t)obj->width * obj->height * SGJW_FLOAT32_BYTES;
+    probe->file_size = file_size;
+    probe->trailer_offset = offset;
+    probe->matrix_offset = offset + SGJW_HEADER_BYTES;
+    probe->appendix_offset = offset + SGJW_HEADER_BYTES + matrix_size + SGJW_FOOTER_BYTES;
+    if (obj->appendix_length > file_size - SGJW_TAIL_BYTES - probe->appendix_offset)
+    {
+        Debug("Failed to read appendix\n");
+        return SGJW_ERROR_FIELD_READ_FAILED;
+    }
+
+    return SGJW_SUCCESS;
+}
+
+/**
+ * @brief Verify the tail ending at file_size and parse its fixed fields, without touching matrix or appendix.
+ *
+ * @note Costs three positioned reads: tail, header, and the footer behind the matrix.
+ *       obj keeps its block, probe receives the byte ranges (probe->header is not touched).
+ *       file_size below the real size looks at a trailer stacked under the last one.
+ */
+static int8_t Probe_Fd_At(int fd, uint64_t file_size, StateGridJPEGV2* obj, StateGridJPEGProbe* probe)
+{
+    int8_t retval = SGJW_SUCCESS;
+    uint64_t offset = 0;
+    size_t matrix_size = 0;
+
+    uint8_t fixed[SGJW_FIXED_BYTES];
+
+    /* ---------- Step 1 : File Verification ---------- */
+
+    if (file_size < SGJW_TAIL_BYTES)
+        return SGJW_ERROR_INVALID_EOF;
+
+    retval = SGJW_Pread_Full(fd, fixed + SGJW_HEADER_BYTES + SGJW_FOOTER_BYTES, SGJW_TAIL_BYTES, file_size - SGJW_TAIL_BYTES);
+    if (retval == SGJW_SUCCESS)
+        retval = SGJW_Check_Tail(fixed, file_size, &offset);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    /* ---------- Step 2 : Header, then the footer behind the matrix ---------- */
+
+    retval = SGJW_Pread_Full(fd, fixed, SGJW_HEADER_BYTES, offset);
+    if (retval == SGJW_SUCCESS)
+        retval = SGJW_Check_Header(fixed, file_size, offset, &matrix_size);
+    if (retval == SGJW_SUCCESS)
+        retval = SGJW_Pread_Full(fd, fixed + SGJW_HEADER_BYTES, SGJW_FOOTER_BYTES, offset + SGJW_HEADER_BYTES + matrix_size);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    return SGJW_Parse_Fixed(fixed, file_size, offset, obj, probe);
+}
+
+static int8_t Probe_Fd(int fd, StateGridJPEGV2* obj, StateGridJPEGProbe* probe)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return SGJW_ERROR_INVALID_EOF;
+    return Probe_Fd_At(fd, st.st_size, obj, probe);
+}
+
+int8_t State_Grid_JPEG_Read_Into(const char* filepath, StateGridJPEGV2* obj, uint32_t flags)
+{
+    return State_Grid_JPEG_Read_Stats(filepath, obj, flags, NULL);
+}
+
+/**
+ * @brief Fetch the matrix chunk by chunk, decoding and folding each chunk into stats while it is in cache.
+ *
+ * @param matrix Destination of the decoded matrix, NULL to drop each chunk after folding it.
+ */
+static int8_t Read_Matrix_Stats(int fd, uint64_t matrix_offset, size_t count, uint16_t width, float* matrix, SGJWStats* stats)
+{
+    float chunk[SGJW_STATS_CHUNK_FLOATS];
+    Stats_Kernel kernel = Stats_Get_Kernel(SGJW_KERNEL_AUTO);
+    StatsAccumulator acc;
+    int8_t retval = SGJW_SUCCESS;
+
+    Stats_Begin(&acc, stats);
+    for (size_t done = 0; done < count && retval == SGJW_SUCCESS; done += SGJW_STATS_CHUNK_FLOATS)
+    {
+        size_t n = count - done < SGJW_STATS_CHUNK_FLOATS ? count - done : SGJW_STATS_CHUNK_FLOATS;
+        float* dst = matrix ? matrix + done : chunk;
+
+        retval = SGJW_Pread_Full(fd, dst, n * SGJW_FLOAT32_BYTES, matrix_offset + done * SGJW_FLOAT32_BYTES);
+        if (retval != SGJW_SUCCESS)
+            break;
+
+        State_Grid_JPEG_Matrix_Decode((uint8_t*)dst, n, dst);
+        Stats_Update(&acc, stats, kernel, dst, n);
+    }
+    Stats_End(&acc, stats, width);
+
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Read_Stats(const char* filepath, StateGridJPEGV2* obj, uint32_t flags, SGJWStats* stats)
+{
+    uint8_t keep_matrix = !(flags & SGJW_READ_STATS_ONLY);
+    if (!filepath || !obj || (!keep_matrix && !stats))
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0)
+    {
+        Debug("No such file: [%s]\n", filepath);
+        return SGJW_ERROR_FILE_NOT_FOUND;
+    }
+
+    StateGridJPEGProbe ranges;
+    size_t matrix_count = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+
+    int8_t retval = Probe_Fd(fd, obj, &ranges);
+    if (retval != SGJW_SUCCESS)
+        goto cleanup;
+
+    /* ---------- Step 3 : Matrix and appendix straight into the block ---------- */
+
+    // Without the matrix the block only holds the appendix
+    width = obj->width;
+    height = obj->height;
+    retval = State_Grid_JPEG_V2_Resize(obj, keep_matrix ? width : 0, keep_matrix ? height : 0, obj->appendix_length);
+    if (retval != SGJW_SUCCESS)
+        goto cleanup;
+
+    obj->width = width;
+    obj->height = height;
+    if (!keep_matrix)
+        obj->matrix = NULL;
+
+    matrix_count = (size_t)width * height;
+    if (stats)
+    {
+        retval = Read_Matrix_Stats(fd, ranges.matrix_offset, matrix_count, width, obj->matrix, stats);
+    }
+    else
+    {
+        retval = SGJW_Pread_Full(fd, obj->matrix, matrix_count * SGJW_FLOAT32_BYTES, ranges.matrix_offset);
+
+        // In place, a no-op on little-endian hosts
+        if (retval == SGJW_SUCCESS)
+            State_Grid_JPEG_Matrix_Decode((uint8_t*)obj->matrix, matrix_count, obj->matrix);
+    }
+    if (retval != SGJW_SUCCESS)
+        goto cleanup;
+
+    if (obj->appendix_length > 0)
+        retval = SGJW_Pread_Full(fd, obj->appendix, obj->appendix_length, ranges.appendix_offset);
+
+cleanup:
+    close(fd);
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Probe(const char* filepath, StateGridJPEGProbe* probe)
+{
+    if (!filepath || !probe)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    memset(probe, 0, sizeof(StateGridJPEGProbe));
+
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0)
+    {
+        Debug("No such file: [%s]\n", filepath);
+        return SGJW_ERROR_FILE_NOT_FOUND;
+    }
+
+    int8_t retval = Probe_Fd(fd, &probe->header, probe);
+    close(fd);
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Read_Matrix(const char* filepath, const StateGridJPEGProbe* probe, float* matrix)
+{
+    if (!filepath || !probe || !matrix)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0)
+    {
+        Debug("No such file: [%s]\n", filepath);
+        return SGJW_ERROR_FILE_NOT_FOUND;
+    }
+
+    // A file rewritten since the probe no longer matches its byte ranges
+    int8_t retval = SGJW_SUCCESS;
+    struct stat st;
+    size_t count = (size_t)probe->header.width * probe->header.height;
+
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size != probe->file_size)
+        retval = SGJW_ERROR_INVALID_OFFSET;
+    else
+        retval = SGJW_Pread_Full(fd, matrix, count * SGJW_FLOAT32_BYTES, probe->matrix_offset);
+
+    if (retval == SGJW_SUCCESS)
+        State_Grid_JPEG_Matrix_Decode((uint8_t*)matrix, count, matrix);
+
+    close(fd);
+    return retval;
+}
+
+static uint8_t Region_Is_Valid(const SGJWRegion* region, uint16_t width, uint16_t height)
+{
+    return region->dst && region->stride >= region->width && (uint32_t)region->x + region->width <= width &&
+           (uint32_t)region->y + region->height <= height;
+}
+
+/**
+ * @brief Decode one region of the matrix starting at file offset matrix_offset.
+ *
+ * @note Rows are read straight into dst, unless the gap between them is small enough to read several rows
+ *       at once through a stack batch buffer: no more than half of the bytes read are thrown away.
+ */
+static int8_t Read_Region(int fd, uint64_t matrix_offset, uint16_t width, const SGJWRegion* region)
+{
+    uint8_t batch[SGJW_REGION_BATCH_BYTES];
+    size_t row_size = (size_t)width * SGJW_FLOAT32_BYTES;
+    size_t span_size = (size_t)region->width * SGJW_FLOAT32_BYTES;
+    int8_t retval = SGJW_SUCCESS;
+
+    // Nothing to read, and a frame without columns has no row size to batch by
+    if (span_size == 0)
+        return SGJW_SUCCESS;
+
+    size_t batch_rows = (row_size - span_size <= span_size) ? SGJW_REGION_BATCH_BYTES / row_size : 0;
+
+    for (size_t r = 0; r < region->height && retval == SGJW_SUCCESS;)
+    {
+        off_t offset = matrix_offset + ((size_t)(region->y + r) * width + region->x) * SGJW_FLOAT32_BYTES;
+
+        if (batch_rows < 2 || region->height - r < 2)
+        {
+            // Straight into the output row
+            float* dst = region->dst + r * region->stride;
+            retval = SGJW_Pread_Full(fd, dst, span_size, offset);
+            if (retval == SGJW_SUCCESS)
+                State_Grid_JPEG_Matrix_Decode((uint8_t*)dst, region->width, dst);
+            ++r;
+            continue;
+        }
+
+        // Several rows in one read, the bytes between the spans are read and dropped
+        size_t rows = region->height - r < batch_rows ? region->height - r : batch_rows;
+        retval = SGJW_Pread_Full(fd, batch, (rows - 1) * row_size + span_size, offset);
+        for (size_t i = 0; i < rows && retval == SGJW_SUCCESS; ++i)
+            State_Grid_JPEG_Matrix_Decode(batch + i * row_size, region->width, region->dst + (r + i) * region->stride);
+        r += rows;
+    }
+
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Read_Regions(const char* filepath, const StateGridJPEGProbe* probe, const SGJWRegion* regions, size_t count)
+{
+    if (!filepath || !probe || (!regions && count > 0))
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!Region_Is_Valid(&regions[i], probe->header.width, probe->header.height))
+            return SGJW_ERROR_INVALID_PARAMS;
+    }
+
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0)
+    {
+        Debug("No such file: [%s]\n", filepath);
+        return SGJW_ERROR_FILE_NOT_FOUND;
+    }
+
+    // A file rewritten since the probe no longer matches its byte ranges
+    int8_t retval = SGJW_SUCCESS;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size != probe->file_size)
+        retval = SGJW_ERROR_INVALID_OFFSET;
+
+    for (size_t i = 0; i < count && retval == SGJW_SUCCESS; ++i)
+        retval = Read_Region(fd, probe->matrix_offset, probe->header.width, &regions[i]);
+
+    close(fd);
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Read_Rows(const char* filepath, const StateGridJPEGProbe* probe, uint16_t first_row, uint16_t row_count, float* dst)
+{
+    if (!probe)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    // Full rows are contiguous both in the file and in dst, Read_Region turns them into a single read
+    SGJWRegion region = {0, first_row, probe->header.width, row_count, dst, probe->header.width};
+    return State_Grid_JPEG_Read_Regions(filepath, probe, &region, 1);
+}
+
+/**
+ * @brief Serialize the whole trailer of a v2 object, offset and EOF signature included, into buffer.
+ *
+ * @note buffer must hold State_Grid_JPEG_Trailer_Size(obj) bytes. With payload 0, matrix and appendix are
+ *       skipped, i.e. header, footer and tail are packed back to back into SGJW_HEADER_BYTES + SGJW_FOOTER_BYTES
+ *       + SGJW_TAIL_BYTES bytes.
+ */
+static int8_t Serialize_Trailer(uint8_t* buffer, const StateGridJPEGV2* obj, uint8_t payload, uint32_t offset_in_file)
+{
+    int8_t retval = SGJW_SUCCESS;
+    size_t offset = 0;
+
+    /* ---------- Step 1 : Write fields to buffer ---------- */
+    FieldInfo fields[SGJW_FIELD_COUNT];
+    size_t field_count = Field_Table((StateGridJPEGV2*)obj, fields);
+
+    for (size_t i = 0; i < field_count; ++i)
+    {
+        // An empty matrix has nothing to write, and may well be NULL
+        if (fields[i].type == FIELD_FLOAT_MATRIX && (fields[i].count == 0 || !payload))
+            continue;
+
+        retval = Write_Field(buffer, &offset, &fields[i]);
+        if (retval != SGJW_SUCCESS)
+        {
+            Debug("Failed to write field: %s\n", fields[i].name);
+            return retval;
+        }
+    }
+
+    // Write appendix if present
+    if (obj->appendix_length > 0 && payload)
+    {
+        FieldInfo appendix_field = {obj->appendix, obj->appendix_length, 0, FIELD_CHAR_ARRAY, "Appendix"};
+
+        retval = Write_Field(buffer, &offset, &appendix_field);
+        if (retval != SGJW_SUCCESS)
+        {
+            Debug("Failed to write appendix\n");
+            return retval;
+        }
+    }
+
+    /* ---------- Step 2 : Write offset ---------- */
+    Binary_Set_Uint32_B2L(buffer, offset, offset_in_file);
+    offset += SGJW_OFFSET_BYTES;
+    Debug("Offset: [%x]\n", offset_in_file);
+
+    /* ---------- Step 3 : Write EOF signature ---------- */
+    memcpy(buffer + offset, SGJW_EOF_SIGNATURE, SGJW_EOF_BYTES);
+    return SGJW_SUCCESS;
+}
+
+size_t State_Grid_JPEG_Trailer_Size(const StateGridJPEGV2* obj)
+{
+    if (!obj)
+        return 0;
+
+    size_t matrix_size = (size_t)obj->width * obj->height * SGJW_FLOAT32_BYTES;
+    return SGJW_HEADER_BYTES + matrix_size + SGJW_FOOTER_BYTES + obj->appendix_length + SGJW_TAIL_BYTES;
+}
+
+int8_t State_Grid_JPEG_Append_Buffer(uint8_t* buffer, size_t capacity, size_t jpeg_size, const StateGridJPEGV2* obj, size_t* total_size)
+{
+    if (!buffer || !obj || jpeg_size == 0 || jpeg_size > UINT32_MAX)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    size_t trailer_size = State_Grid_JPEG_Trailer_Size(obj);
+    if (total_size)
+        *total_size = jpeg_size + trailer_size;
+
+    if (capacity < jpeg_size || capacity - jpeg_size < trailer_size)
+    {
+        Debug("Buffer of %zu bytes cannot hold %zu + %zu bytes.\n", capacity, jpeg_size, trailer_size);
+        return SGJW_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    // The trailer offset is simply the JPEG size
+    return Serialize_Trailer(buffer + jpeg_size, obj, 1, (uint32_t)jpeg_size);
+}
+
+/**
+ * @brief Write the whole trailer of a v2 object at a file offset, which becomes its trailer offset.
+ *
+ * @note On little-endian hosts matrix and appendix are gathered straight from obj into one positioned write.
+ */
+static int8_t Write_Trailer_At(int fd, const StateGridJPEGV2* obj, uint64_t offset)
+{
+    int8_t retval = SGJW_SUCCESS;
+    size_t matrix_size = (size_t)obj->width * obj->height * SGJW_FLOAT32_BYTES;
+
+    if ((matrix_size > 0 && !obj->matrix) || (obj->appendix_length > 0 && !obj->appendix) || offset == 0 || offset > UINT32_MAX)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    if (SGJW_HOST_LITTLE_ENDIAN)
+    {
+        /* ---------- Step 1 : Serialize header, footer and tail only ---------- */
+        uint8_t fixed[SGJW_HEADER_BYTES + SGJW_FOOTER_BYTES + SGJW_TAIL_BYTES];
+
+        retval = Serialize_Trailer(fixed, obj, 0, (uint32_t)offset);
+        if (retval != SGJW_SUCCESS)
+            return retval;
+
+        /* ---------- Step 2 : Gather everything into one write ---------- */
+        // clang-format off
+        struct iovec iov[] = {
+            { fixed, SGJW_HEADER_BYTES },
+            { obj->matrix, matrix_size },
+            { fixed + SGJW_HEADER_BYTES, SGJW_FOOTER_BYTES },
+            { obj->appendix, obj->appendix_length },
+            { fixed + SGJW_HEADER_BYTES + SGJW_FOOTER_BYTES, SGJW_TAIL_BYTES }
+        };
+        // clang-format on
+
+        return Pwritev_Full(fd, iov, sizeof(iov) / sizeof(struct iovec), offset);
+    }
+
+    /* ---------- Step 1 : Serialize into a temporary buffer, the matrix needs a byte swap ---------- */
+    size_t total_size = State_Grid_JPEG_Trailer_Size(obj);
+    uint8_t* temp_buffer = (uint8_t*)SGJW_Malloc(total_size, sizeof(void*));
+    if (!temp_buffer)
+        return SGJW_ERROR_MALLOC_FAILED;
+
+    retval = Serialize_Trailer(temp_buffer, obj, 1, (uint32_t)offset);
+
+    /* ---------- Step 2 : Write to file ---------- */
+    if (retval == SGJW_SUCCESS)
+    {
+        struct iovec iov = {temp_buffer, total_size};
+        retval = Pwritev_Full(fd, &iov, 1, offset);
+    }
+
+    SGJW_Free(temp_buffer);
+    return retval;
+}
+
+int8_t State_Grid_JPEG_V2_Append(const char* filepath, const StateGridJPEGV2* obj)
+{
+    if (!filepath || !obj)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    /* ---------- Step 1 : Get original file size ---------- */
+    int fd = open(filepath, O_WRONLY);
+    if (fd < 0)
+    {
+        Debug("No such file: [%s]\n", filepath);
+        return SGJW_ERROR_FILE_WRITE;
+    }
+
+    int8_t retval = SGJW_SUCCESS;
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || (uint64_t)st.st_size > UINT32_MAX)
+    {
+        retval = SGJW_ERROR_INVALID_OFFSET;
+        goto cleanup;
+    }
+
+    /* ---------- Step 2 : Trailer behind the current end ---------- */
+    retval = Write_Trailer_At(fd, obj, st.st_size);
+
+    // Never leave a partial trailer behind
+    if (retval == SGJW_ERROR_FILE_WRITE && ftruncate(fd, st.st_size) != 0)
+        Debug("Truncate [%s] after failed append failed.\n", filepath);
+
+    if (retval == SGJW_SUCCESS)
+        Debug("Write Success!\n");
+cleanup:
+    close(fd);
+
+    return retval;
+}
+
+// clang-format off
+// SGJW_PATCH_FIELDS bit of each Field_Table entry, 0 for the ones that change the trailer size
+static const uint32_t SGJW_PATCH_FIELD_BITS[SGJW_FIELD_COUNT] = {
+    SGJW_PATCH_VERSION, 0, 0, SGJW_PATCH_DATE, 0,
+    SGJW_PATCH_EMISSIVITY, SGJW_PATCH_AMBIENT_TEMP, SGJW_PATCH_FOV, SGJW_PATCH_DISTANCE, SGJW_PATCH_HUMIDITY, SGJW_PATCH_REFLECTIVE_TEMP,
+    SGJW_PATCH_MANUFACTURER, SGJW_PATCH_PRODUCT, SGJW_PATCH_SN, SGJW_PATCH_LONGITUDE, SGJW_PATCH_LATITUDE, SGJW_PATCH_ALTITUDE, 0
+};
+// clang-format on
+
+/**
+ * @brief Write the selected fields of obj over the trailer a probe located, see State_Grid_JPEG_Patch.
+ */
+static int8_t Patch_Fd(int fd, const StateGridJPEGProbe* probe, const StateGridJPEGV2* obj, uint32_t fields)
+{
+    uint8_t fixed[SGJW_FIXED_BYTES];
+    int8_t retval = Serialize_Trailer(fixed, obj, 0, (uint32_t)probe->trailer_offset);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    // One write per run of adjacent patched fields
+
+    FieldInfo table[SGJW_FIELD_COUNT];
+    size_t field_count = Field_Table((StateGridJPEGV2*)obj, table);
+    uint64_t footer_offset = probe->appendix_offset - SGJW_FOOTER_BYTES;
+    size_t position = 0;
+    size_t run_start = 0;
+    size_t run_end = 0;
+
+    for (size_t i = 0; i <= field_count && retval == SGJW_SUCCESS; ++i)
     {
-        // Special handling for matrix field
-        if (fields[i].type == FIELD_FLOAT_MATRIX)
+        // The matrix separates header and footer, a run never spans it
+        uint8_t boundary = i == field_count || table[i].type == FIELD_FLOAT_MATRIX;
+        uint8_t patched = !boundary && (fields & SGJW_PATCH_FIELD_BITS[i]);
+
+        if (run_end > run_start && (boundary || !patched || position != run_end))
         {
-            fields[i].count = (*obj->width) * (*obj->height);
+            uint64_t file_offset = run_start < SGJW_HEADER_BYTES ? probe->trailer_offset + run_start : footer_offset + run_start - SGJW_HEADER_BYTES;
+            struct iovec iov = {fixed + run_start, run_end - run_start};
+            retval = Pwritev_Full(fd, &iov, 1, file_offset);
+            Debug("Patch [%zu] bytes at [%llu].\n", run_end - run_start, (unsigned long long)file_offset);
+            run_start = run_end = 0;
         }
 
-        retval = Read_Field(buffer, &offset, &fields[i]);
-        if (retval != SGJW_SUCCESS)
+        if (boundary)
+            continue;
+        if (patched)
         {
-            Debug("Failed to read field: %s\n", fields[i].name);
-            goto cleanup;
+            if (run_end == run_start)
+                run_start = position;
+            run_end = position + table[i].size;
         }
+        position += table[i].size;
     }
 
-    // Read appendix if present
-    if (obj->appendix_length && *(obj->appendix_length) > 0)
-    {
-        // clang-format off
-        FieldInfo appendix_field = 
-        {
-            (void**)&obj->appendix,
-            *(obj->appendix_length),
-            0,
-            FIELD_CHAR_ARRAY,
-            "Appendix"
-        };
-        // clang-format on
+    return retval;
+}
 
-        retval = Read_Field(buffer, &offset, &appendix_field);
-        if (retval != SGJW_SUCCESS)
-        {
-            Debug("Failed to read appendix\n");
-            goto cleanup;
-        }
+int8_t State_Grid_JPEG_Patch(const char* filepath, const StateGridJPEGV2* obj, uint32_t fields)
+{
+    if (!filepath || !obj || (fields & ~(uint32_t)SGJW_PATCH_ALL))
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    int fd = open(filepath, O_RDWR);
+    if (fd < 0)
+    {
+        Debug("No such file: [%s]\n", filepath);
+        return SGJW_ERROR_FILE_WRITE;
     }
 
-cleanup:
-    if (buffer)
-        free(buffer);
+    // Locate header and footer with three positioned reads, then write the fields
+    StateGridJPEGV2 current;
+    StateGridJPEGProbe probe;
+    memset(&current, 0, sizeof(StateGridJPEGV2));
 
-    if (retval != SGJW_SUCCESS)
-        State_Grid_JPEG_Delete_OBJ(obj);
+    int8_t retval = Probe_Fd(fd, &current, &probe);
+    if (retval == SGJW_SUCCESS)
+        retval = Patch_Fd(fd, &probe, obj, fields);
 
+    close(fd);
     return retval;
 }
 
-int8_t State_Grid_JPEG_Append(const char* filepath, StateGridJPEG* obj)
+int8_t State_Grid_JPEG_Replace(const char* filepath, const StateGridJPEGV2* obj)
 {
     if (!filepath || !obj)
         return SGJW_ERROR_INVALID_PARAMS;
 
+    int fd = open(filepath, O_RDWR);
+    if (fd < 0)
+    {
+        Debug("No such file: [%s]\n", filepath);
+        return SGJW_ERROR_FILE_WRITE;
+    }
+
+    /* ---------- Step 1 : Offset of the first trailer, walking back over stacked ones ---------- */
+
+    StateGridJPEGV2 current;
+    StateGridJPEGProbe probe;
+    struct stat st;
+    memset(&current, 0, sizeof(StateGridJPEGV2));
+
     int8_t retval = SGJW_SUCCESS;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        retval = SGJW_ERROR_INVALID_OFFSET;
+        goto cleanup;
+    }
 
-    /* ---------- Step 1 : Calculate total size ---------- */
-    size_t matrix_size = (*(obj->width)) * (*(obj->height)) * sizeof(float);
-    size_t appendix_size = obj->appendix_length ? *(obj->appendix_length) : 0;
+    uint64_t offset = st.st_size;
+    retval = Probe_Fd_At(fd, offset, &current, &probe);
+    if (retval == SGJW_ERROR_INVALID_EOF)
+    {
+        // A plain JPEG gets its first trailer
+        retval = SGJW_SUCCESS;
+    }
+    else if (retval == SGJW_SUCCESS)
+    {
+        offset = probe.trailer_offset;
+        while (Probe_Fd_At(fd, offset, &current, &probe) == SGJW_SUCCESS)
+            offset = probe.trailer_offset;
+    }
+    if (retval != SGJW_SUCCESS)
+        goto cleanup;
 
-    // clang-format off
-    size_t fixed_size = SGJW_VERSION_BYTES + SGJW_WIDTH_BYTES + SGJW_HEIGHT_BYTES +
-                        SGJW_DATE_BYTES + SGJW_EMISSIVITY_BYTES + SGJW_AMBIENT_TEMP_BYTES +
-                        SGJW_FOV_BYTES + SGJW_DISTANCE_BYTES + SGJW_HUMIDITY_BYTES +
-                        SGJW_REFLECTIVE_TEMP_BYTES + SGJW_MANUFACTURER_BYTES +
-                        SGJW_PRODUCT_BYTES + SGJW_SN_BYTES + SGJW_LONGITUDE_BYTES +
-                        SGJW_LATITUDE_BYTES + SGJW_ALTITUDE_BYTES + SGJW_APPENDIX_LENGTH_BYTES;
-    // clang-format on
+    /* ---------- Step 2 : New trailer over the old one, then cut what is left behind it ---------- */
 
-    size_t total_size = fixed_size + matrix_size + appendix_size + SGJW_OFFSET_BYTES + SGJW_EOF_BYTES;
+    // Same result as truncating first, but the blocks under the trailer are reused instead of freed and allocated
+    retval = Write_Trailer_At(fd, obj, offset);
+    if (retval == SGJW_SUCCESS && ftruncate(fd, offset + State_Grid_JPEG_Trailer_Size(obj)) != 0)
+        retval = SGJW_ERROR_FILE_WRITE;
 
-    /* ---------- Step 2 : Create temporary buffer ---------- */
-    uint8_t* temp_buffer = (uint8_t*)malloc(total_size);
-    if (!temp_buffer)
+cleanup:
+    close(fd);
+    return retval;
+}
+
+// Footer fields State_Grid_JPEG_Recompensate_File rewrites
+#define SGJW_PATCH_RADIOMETRY (SGJW_PATCH_EMISSIVITY | SGJW_PATCH_AMBIENT_TEMP | SGJW_PATCH_DISTANCE | SGJW_PATCH_HUMIDITY | SGJW_PATCH_REFLECTIVE_TEMP)
+
+static void Radiometry_Apply(StateGridJPEGV2* obj, const SGJWRadiometry* radiometry)
+{
+    obj->emissivity = radiometry->emissivity;
+    obj->reflective_temp = radiometry->reflective_temp;
+    obj->ambient_temp = radiometry->ambient_temp;
+    obj->distance = radiometry->distance;
+    obj->humidity = radiometry->humidity;
+}
+
+int8_t State_Grid_JPEG_V2_Recompensate(StateGridJPEGV2* obj, const SGJWRadiometry* to, uint32_t threads)
+{
+    if (!obj || !to || (!obj->matrix && obj->width && obj->height))
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    SGJWRadiometry from;
+    State_Grid_JPEG_Radiometry_Of(obj, &from);
+
+    size_t count = (size_t)obj->width * obj->height;
+    int8_t retval = State_Grid_JPEG_Matrix_Recompensate(obj->matrix, obj->matrix, count, &from, to, threads, SGJW_KERNEL_AUTO);
+    if (retval == SGJW_SUCCESS)
+        Radiometry_Apply(obj, to);
+
+    return retval;
+}
+
+/**
+ * @brief Copy size bytes at offset of one file to the same offset of another.
+ */
+static int8_t Copy_Range(int from, int to, uint64_t offset, uint64_t size)
+{
+    uint8_t* buffer = (uint8_t*)SGJW_Malloc(SGJW_COPY_CHUNK_BYTES, SGJW_CACHE_LINE);
+    if (!buffer)
         return SGJW_ERROR_MALLOC_FAILED;
 
-    size_t offset = 0;
+    int8_t retval = SGJW_SUCCESS;
+    for (uint64_t done = 0; done < size && retval == SGJW_SUCCESS; done += SGJW_COPY_CHUNK_BYTES)
+    {
+        size_t n = size - done < SGJW_COPY_CHUNK_BYTES ? (size_t)(size - done) : SGJW_COPY_CHUNK_BYTES;
+        retval = SGJW_Pread_Full(from, buffer, n, offset + done);
+        if (retval == SGJW_SUCCESS)
+            retval = SGJW_Pwrite_Full(to, buffer, n, offset + done);
+    }
 
-    /* ---------- Step 3 : Write fields to buffer ---------- */
-    // clang-format off
-    FieldInfo fields[] = {
-        { (void**)&obj->version, SGJW_VERSION_BYTES, 0, FIELD_UINT16, "Version" },
-        { (void**)&obj->width, SGJW_WIDTH_BYTES, 0, FIELD_UINT16, "Width" },
-        { (void**)&obj->height, SGJW_HEIGHT_BYTES, 0, FIELD_UINT16, "Height" },
-        { (void**)&obj->date, SGJW_DATE_BYTES, 0, FIELD_CHAR_ARRAY, "Date" },
-        { (void**)&obj->matrix, SGJW_FLOAT32_BYTES, (*(obj->width)) * (*(obj->height)), FIELD_FLOAT_MATRIX, "Matrix" },
-        { (void**)&obj->emissivity, SGJW_EMISSIVITY_BYTES, 0, FIELD_FLOAT32, "Emissivity" },
-        { (void**)&obj->ambient_temp, SGJW_AMBIENT_TEMP_BYTES, 0, FIELD_FLOAT32, "Ambient Temperature" },
-        { (void**)&obj->fov, SGJW_FOV_BYTES, 0, FIELD_UINT8, "FOV" },
-        { (void**)&obj->distance, SGJW_DISTANCE_BYTES, 0, FIELD_UINT32, "Distance" },
-        { (void**)&obj->humidity, SGJW_HUMIDITY_BYTES, 0, FIELD_UINT8, "Humidity" },
-        { (void**)&obj->reflective_temp, SGJW_REFLECTIVE_TEMP_BYTES, 0, FIELD_FLOAT32, "Reflective Temperature" },
-        { (void**)&obj->manufacturer, SGJW_MANUFACTURER_BYTES, 0, FIELD_CHAR_ARRAY, "Manufacturer" },
-        { (void**)&obj->product, SGJW_PRODUCT_BYTES, 0, FIELD_CHAR_ARRAY, "Product" },
-        { (void**)&obj->sn, SGJW_SN_BYTES, 0, FIELD_CHAR_ARRAY, "Serial Number" },
-        { (void**)&obj->longitude, SGJW_LONGITUDE_BYTES, 0, FIELD_FLOAT64, "Longitude" },
-        { (void**)&obj->latitude, SGJW_LATITUDE_BYTES, 0, FIELD_FLOAT64, "Latitude" },
-        { (void**)&obj->altitude, SGJW_ALTITUDE_BYTES, 0, FIELD_UINT32, "Altitude" },
-        { (void**)&obj->appendix_length, SGJW_APPENDIX_LENGTH_BYTES, 0, FIELD_UINT32, "Appendix Length" }
-    };
-    // clang-format on
+    SGJW_Free(buffer);
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Recompensate_File(const char* filepath, const SGJWRadiometry* to, uint32_t threads)
+{
+    if (!filepath || !to)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    char temp[4096];
+    if (snprintf(temp, sizeof(temp), "%s.tmp", filepath) >= (int)sizeof(temp))
+        return SGJW_ERROR_INVALID_PARAMS;
 
-    for (size_t i = 0; i < sizeof(fields) / sizeof(FieldInfo); ++i)
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0)
     {
-        retval = Write_Field(temp_buffer, &offset, &fields[i]);
-        if (retval != SGJW_SUCCESS)
-        {
-            Debug("Failed to write field: %s\n", fields[i].name);
-            goto cleanup;
-        }
+        Debug("No such file: [%s]\n", filepath);
+        return SGJW_ERROR_FILE_WRITE;
     }
 
-    // Write appendix if present
-    if (obj->appendix_length && *(obj->appendix_length) > 0)
+    /* ---------- Step 1 : Current parameters and matrix location, three positioned reads ---------- */
+
+    StateGridJPEGV2 current;
+    StateGridJPEGProbe probe;
+    SGJWRadiometry from;
+    struct stat st;
+    int out = -1;
+    memset(&current, 0, sizeof(StateGridJPEGV2));
+
+    RadiometryTask task = {Radiometry_Get_Kernel(SGJW_KERNEL_AUTO), 0.0f, 0.0f, NULL, NULL, fd, -1, 0, 0, SGJW_SUCCESS};
+    int8_t retval = Probe_Fd(fd, &current, &probe);
+    if (retval == SGJW_SUCCESS && fstat(fd, &st) != 0)
+        retval = SGJW_ERROR_INVALID_OFFSET;
+    if (retval != SGJW_SUCCESS)
+        goto cleanup;
+
+    State_Grid_JPEG_Radiometry_Of(&current, &from);
+    retval = Radiometry_Coefficients(&from, to, &task.a, &task.b);
+    if (retval != SGJW_SUCCESS)
+        goto cleanup;
+
+    /* ---------- Step 2 : Everything but the matrix into a temporary file, so matrix and parameters change together ---------- */
+
+    task.file_offset = probe.matrix_offset;
+    task.count = (size_t)current.width * current.height;
+    uint64_t matrix_end = probe.matrix_offset + (uint64_t)task.count * SGJW_FLOAT32_BYTES;
+
+    out = open(temp, O_WRONLY | O_CREAT | O_TRUNC, st.st_mode & 07777);
+    if (out < 0)
     {
-        // clang-format off
-        FieldInfo appendix_field = {
-            (void**)&obj->appendix,
-            *(obj->appendix_length),
-            0,
-            FIELD_CHAR_ARRAY,
-            "Appendix"
-        };
-        // clang-format on
+        retval = SGJW_ERROR_FILE_WRITE;
+        goto cleanup;
+    }
 
-        retval = Write_Field(temp_buffer, &offset, &appendix_field);
-        if (retval != SGJW_SUCCESS)
+    retval = Copy_Range(fd, out, 0, probe.matrix_offset);
+    if (retval == SGJW_SUCCESS)
+        retval = Copy_Range(fd, out, matrix_end, probe.file_size - matrix_end);
+
+    /* ---------- Step 3 : Each thread streams its rows through L1, decode, convert, encode, write to the copy ---------- */
+
+    task.out_fd = out;
+    if (retval == SGJW_SUCCESS)
+        retval = Radiometry_Parallel(&task, threads);
+
+    /* ---------- Step 4 : The new parameters, then the copy replaces the file ---------- */
+
+    Radiometry_Apply(&current, to);
+    if (retval == SGJW_SUCCESS)
+        retval = Patch_Fd(out, &probe, &current, SGJW_PATCH_RADIOMETRY);
+    if (retval == SGJW_SUCCESS && fsync(out) != 0)
+        retval = SGJW_ERROR_FILE_WRITE;
+    if (retval == SGJW_SUCCESS)
+        Debug("Recompensate [%zu] pixels, a = [%f], b = [%f].\n", task.count, task.a, task.b);
+
+cleanup:
+    if (out >= 0 && close(out) != 0 && retval == SGJW_SUCCESS)
+        retval = SGJW_ERROR_FILE_WRITE;
+    if (out >= 0 && retval == SGJW_SUCCESS && rename(temp, filepath) != 0)
+        retval = SGJW_ERROR_FILE_WRITE;
+    if (out >= 0 && retval != SGJW_SUCCESS)
+        unlink(temp);
+    close(fd);
+    return retval;
+}
+
+int8_t State_Grid_JPEG_V2_Resize(StateGridJPEGV2* obj, uint16_t width, uint16_t height, uint32_t appendix_length)
+{
+    if (!obj)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    // The appendix starts on its own cache line and keeps a null terminator
+    size_t matrix_size = ((size_t)width * height * sizeof(float) + SGJW_CACHE_LINE - 1) & ~((size_t)SGJW_CACHE_LINE - 1);
+    size_t block_size = matrix_size + appendix_length + 1;
+
+    if (!obj->block || block_size > obj->block_capacity)
+    {
+        void* block = SGJW_Malloc(block_size, SGJW_CACHE_LINE);
+        if (!block)
         {
-            Debug("Failed to write appendix\n");
-            goto cleanup;
+            Debug("Allocate block of %zu bytes failed.\n", block_size);
+            return SGJW_ERROR_MALLOC_FAILED;
         }
+
+        SGJW_Free(obj->block);
+        obj->block = block;
+        obj->block_capacity = block_size;
+    }
+
+    obj->width = width;
+    obj->height = height;
+    obj->appendix_length = appendix_length;
+    obj->matrix = (float*)obj->block;
+    obj->appendix = appendix_length ? (char*)obj->block + matrix_size : NULL;
+    if (obj->appendix)
+        obj->appendix[appendix_length] = '\0';
+
+    return SGJW_SUCCESS;
+}
+
+void State_Grid_JPEG_V2_Delete_OBJ(StateGridJPEGV2* obj)
+{
+    if (!obj)
+        return;
+
+    SGJW_Free(obj->block);
+    memset(obj, 0, sizeof(StateGridJPEGV2));
+}
+
+static size_t View_Get_Field(uint8_t* base, size_t offset, FieldType type, size_t size, void* field)
+{
+    FieldInfo info = {NULL, size, 0, type, NULL};
+    Read_Field_Value(base, offset, &info, field);
+    return offset + size;
+}
+
+int8_t SGJW_View_Trailer(uint8_t* base, size_t offset, size_t trailer_end, StateGridJPEGView* view)
+{
+    offset = View_Get_Field(base, offset, FIELD_UINT16, SGJW_VERSION_BYTES, &view->version);
+    offset = View_Get_Field(base, offset, FIELD_UINT16, SGJW_WIDTH_BYTES, &view->width);
+    offset = View_Get_Field(base, offset, FIELD_UINT16, SGJW_HEIGHT_BYTES, &view->height);
+    view->date = (const char*)base + offset;
+    offset += SGJW_DATE_BYTES;
+
+    size_t count = (size_t)view->width * view->height;
+    size_t matrix_size = count * SGJW_FLOAT32_BYTES;
+    if (matrix_size > trailer_end - offset - SGJW_FOOTER_BYTES)
+    {
+        Debug("Matrix exceeds trailer.\n");
+        return SGJW_ERROR_FIELD_READ_FAILED;
     }
 
-    /* ---------- Step 4 : Write offset ---------- */
-    FILE* file_size_check = fopen(filepath, "rb");
-    if (!file_size_check)
+    if (SGJW_HOST_LITTLE_ENDIAN && ((uintptr_t)(base + offset) % sizeof(float)) == 0)
     {
-        retval = SGJW_ERROR_FILE_WRITE;
-        goto cleanup;
+        view->matrix = (const float*)(base + offset);
     }
+    else if (count > 0)
+    {
+        view->matrix_copy = (float*)SGJW_Malloc(matrix_size, SGJW_CACHE_LINE);
+        if (!view->matrix_copy)
+            return SGJW_ERROR_MALLOC_FAILED;
+        State_Grid_JPEG_Matrix_Decode(base + offset, count, view->matrix_copy);
+        view->matrix = view->matrix_copy;
+    }
+    offset += matrix_size;
+
+    offset = View_Get_Field(base, offset, FIELD_FLOAT32, SGJW_EMISSIVITY_BYTES, &view->emissivity);
+    offset = View_Get_Field(base, offset, FIELD_FLOAT32, SGJW_AMBIENT_TEMP_BYTES, &view->ambient_temp);
+    offset = View_Get_Field(base, offset, FIELD_UINT8, SGJW_FOV_BYTES, &view->fov);
+    offset = View_Get_Field(base, offset, FIELD_UINT32, SGJW_DISTANCE_BYTES, &view->distance);
+    offset = View_Get_Field(base, offset, FIELD_UINT8, SGJW_HUMIDITY_BYTES, &view->humidity);
+    offset = View_Get_Field(base, offset, FIELD_FLOAT32, SGJW_REFLECTIVE_TEMP_BYTES, &view->reflective_temp);
+    view->manufacturer = (const char*)base + offset;
+    offset += SGJW_MANUFACTURER_BYTES;
+    view->product = (const char*)base + offset;
+    offset += SGJW_PRODUCT_BYTES;
+    view->sn = (const char*)base + offset;
+    offset += SGJW_SN_BYTES;
+    offset = View_Get_Field(base, offset, FIELD_FLOAT64, SGJW_LONGITUDE_BYTES, &view->longitude);
+    offset = View_Get_Field(base, offset, FIELD_FLOAT64, SGJW_LATITUDE_BYTES, &view->latitude);
+    offset = View_Get_Field(base, offset, FIELD_UINT32, SGJW_ALTITUDE_BYTES, &view->altitude);
+    offset = View_Get_Field(base, offset, FIELD_UINT32, SGJW_APPENDIX_LENGTH_BYTES, &view->appendix_length);
+
+    if (view->appendix_length > trailer_end - offset)
+    {
+        Debug("Appendix exceeds trailer.\n");
+        return SGJW_ERROR_FIELD_READ_FAILED;
+    }
+    view->appendix = view->appendix_length ? (const char*)base + offset : NULL;
 
-    // Get original file size
-    fseek(file_size_check, 0, SEEK_END);
-    long original_file_size = ftell(file_size_check);
-    fclose(file_size_check);
+    return SGJW_SUCCESS;
+}
 
-    // Calculate and write the actual offset
-    uint32_t offset_in_file = (uint32_t)(original_file_size);
-    Binary_Set_Uint32_B2L(temp_buffer, offset, offset_in_file);
-    offset += SGJW_OFFSET_BYTES;
-    Debug("Offset: [%x]\n", offset_in_file);
+int8_t State_Grid_JPEG_Map(const char* filepath, StateGridJPEGView* view)
+{
+    if (!filepath || !view)
+        return SGJW_ERROR_INVALID_PARAMS;
 
-    /* ---------- Step 5 : Write EOF signature ---------- */
-    memcpy(temp_buffer + offset, SGJW_EOF_SIGNATURE, SGJW_EOF_BYTES);
-    offset += SGJW_EOF_BYTES;
+    memset(view, 0, sizeof(StateGridJPEGView));
 
-    /* ---------- Step 6 : Append to file ---------- */
-    FILE* file = fopen(filepath, "ab");
-    if (!file)
+    /* ---------- Step 1 : Map and Verification ---------- */
+
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0)
     {
-        retval = SGJW_ERROR_FILE_WRITE;
+        Debug("No such file: [%s]\n", filepath);
+        return SGJW_ERROR_FILE_NOT_FOUND;
+    }
+
+    int8_t retval = SGJW_SUCCESS;
+    uint8_t tail[SGJW_TAIL_BYTES];
+    uint8_t* base = NULL;
+    size_t offset = 0;
+    size_t trailer_end = 0;
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || st.st_size < SGJW_TAIL_BYTES)
+    {
+        retval = SGJW_ERROR_INVALID_EOF;
         goto cleanup;
     }
 
-    if (fwrite(temp_buffer, 1, total_size, file) != total_size)
+    retval = SGJW_Pread_Full(fd, tail, SGJW_TAIL_BYTES, st.st_size - SGJW_TAIL_BYTES);
+    if (retval != SGJW_SUCCESS)
+        goto cleanup;
+
+    if (memcmp(tail + SGJW_OFFSET_BYTES, SGJW_EOF_SIGNATURE, SGJW_EOF_BYTES) != 0)
     {
-        retval = SGJW_ERROR_FILE_WRITE;
-        fclose(file);
+        retval = SGJW_ERROR_INVALID_EOF;
+        Debug("File EOF label verification fail.\n");
         goto cleanup;
     }
 
-    fclose(file);
-    Debug("Write Success!\n");
+    offset = Binary_Get_Offsite(tail, SGJW_TAIL_BYTES);
+    trailer_end = st.st_size - SGJW_TAIL_BYTES;
+    if (offset == 0 || offset > trailer_end || trailer_end - offset < SGJW_HEADER_BYTES + SGJW_FOOTER_BYTES)
+    {
+        retval = SGJW_ERROR_INVALID_OFFSET;
+        Debug("Get offset fail.\n");
+        goto cleanup;
+    }
+
+    // Map only the pages holding the trailer and fault them in with one call, the JPEG is never touched
+    size_t map_start = offset & ~((size_t)sysconf(_SC_PAGESIZE) - 1);
+    view->map_size = st.st_size - map_start;
+    view->map_base = mmap(NULL, view->map_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, map_start);
+    if (view->map_base == MAP_FAILED)
+    {
+        view->map_base = NULL;
+        retval = SGJW_ERROR_READ_FAILED;
+        Debug("Map file: [%s] failed.\n", filepath);
+        goto cleanup;
+    }
+
+    // Rebase onto the mapping, base[offset] is the first trailer byte
+    base = (uint8_t*)view->map_base;
+    offset -= map_start;
+    trailer_end -= map_start;
+
+    /* ---------- Step 2 : Borrow Fields ---------- */
+
+    retval = SGJW_View_Trailer(base, offset, trailer_end, view);
+    if (retval != SGJW_SUCCESS)
+        goto cleanup;
+
+    Debug("Map Success, matrix %s\n", view->matrix_copy ? "copied" : "borrowed");
+
 cleanup:
-    if (temp_buffer)
-        free(temp_buffer);
+    close(fd);
+    if (retval != SGJW_SUCCESS)
+        State_Grid_JPEG_Unmap(view);
 
     return retval;
 }
 
-void State_Grid_JPEG_Delete_OBJ(StateGridJPEG* obj)
+int8_t State_Grid_JPEG_View_Regions(const StateGridJPEGView* view, const SGJWRegion* regions, size_t count)
 {
-    if (!obj)
-        return;
-
-    // clang-format off
-    void* pointers[] = {
-        obj->version,
-        obj->width,
-        obj->height,
-        obj->date,
-        obj->matrix,
-        obj->emissivity,
-        obj->ambient_temp,
-        obj->fov,
-        obj->distance,
-        obj->humidity,
-        obj->reflective_temp,
-        obj->manufacturer,
-        obj->product,
-        obj->sn,
-        obj->longitude,
-        obj->latitude,
-        obj->altitude,
-        obj->appendix_length,
-        obj->appendix
-    };
-    // clang-format on
+    if (!view || !view->matrix || (!regions && count > 0))
+        return SGJW_ERROR_INVALID_PARAMS;
 
-    for (size_t i = 0; i < sizeof(pointers) / sizeof(void*); i++)
+    for (size_t i = 0; i < count; ++i)
     {
-        Debug("Try to free pointer %zu\n", i);
-        if (pointers[i])
+        const SGJWRegion* region = &regions[i];
+        if (!Region_Is_Valid(region, view->width, view->height))
+            return SGJW_ERROR_INVALID_PARAMS;
+
+        for (size_t r = 0; r < region->height; ++r)
         {
-            free(pointers[i]);
-            pointers[i] = NULL;
-            Debug("Freed pointer %zu\n", i);
+            const float* src = view->matrix + (size_t)(region->y + r) * view->width + region->x;
+            memcpy(region->dst + r * region->stride, src, region->width * sizeof(float));
         }
     }
 
-    // Clear all pointers in the structure
-    memset(obj, 0, sizeof(StateGridJPEG));
+    return SGJW_SUCCESS;
+}
+
+void State_Grid_JPEG_Unmap(StateGridJPEGView* view)
+{
+    if (!view)
+        return;
+
+    if (view->map_base)
+        munmap(view->map_base, view->map_size);
+
+    if (view->matrix_copy)
+        SGJW_Free(view->matrix_copy);
+
+    memset(view, 0, sizeof(StateGridJPEGView));
+}
+
+void State_Grid_JPEG_Set_Allocator(const SGJWAllocator* allocator)
+{
+    if (allocator)
+        sgjw_allocator = *allocator;
+    else
+        memset(&sgjw_allocator, 0, sizeof(SGJWAllocator));
+}
+
+uint64_t State_Grid_JPEG_Get_Bytes_Read(void)
+{
+    return __atomic_load_n(&sgjw_bytes_read, __ATOMIC_RELAXED);
+}
+
+void State_Grid_JPEG_Reset_Bytes_Read(void)
+{
+    __atomic_store_n(&sgjw_bytes_read, 0, __ATOMIC_RELAXED);
 }
\ No newline at end of file
@@ -21,6 +21,11 @@
  * 3. Utilize a JPEG library (e.g. libjpeg) or other suitable libraries to save a JPEG file, named _file.
  * 4. Invoke the State_Grid_JPEG_Append(_file, &_obj) function to append the metadata stored in _obj to the end of _file using steganography techniques.
  * 5. Call the State_Grid_JPEG_Delete_OBJ function to deallocate the memory associated with _obj.
+ * 
+ * @note StateGridJPEGV2 is the preferred object: scalars and texts are inline and matrix + appendix cost a single
+ * allocation. Use State_Grid_JPEG_V2_Read / State_Grid_JPEG_V2_Append / State_Grid_JPEG_V2_Delete_OBJ the same way as above,
+ * and State_Grid_JPEG_V2_Resize to allocate matrix and appendix before filling an object for writing.
+ * StateGridJPEG (v1) stays available as a compatibility shim on top of it.
  */
 
 #include <stdio.h>
@@ -46,9 +51,48 @@ typedef enum
     SGJW_ERROR_INVALID_PARAMS = -7,
     SGJW_ERROR_MEMORY_ALLOCATION = -8,
     SGJW_ERROR_FILE_WRITE = -9,
-    SGJW_ERROR_FIELD_SET_FAILED = -10
+    SGJW_ERROR_FIELD_SET_FAILED = -10,
+    SGJW_ERROR_BUFFER_TOO_SMALL = -11
 } SGJW_ERROR;
 
+// Read flags
+typedef enum
+{
+    // Load the whole file (JPEG + trailer) into memory, then parse the trailer.
+    SGJW_READ_DEFAULT = 0,
+    // Read the 20 tail bytes first, then only [offset, EOF) with positioned reads. The JPEG bytes are never loaded.
+    SGJW_READ_TRAILER_ONLY = 1 << 0,
+    // State_Grid_JPEG_Read_Stats only: stream the matrix through the statistics and drop it, obj->matrix stays NULL.
+    SGJW_READ_STATS_ONLY = 1 << 1
+} SGJW_READ_FLAGS;
+
+// Fields of State_Grid_JPEG_Patch, those at a fixed place in the trailer
+typedef enum
+{
+    SGJW_PATCH_VERSION = 1 << 0,
+    SGJW_PATCH_DATE = 1 << 1,
+    SGJW_PATCH_EMISSIVITY = 1 << 2,
+    SGJW_PATCH_AMBIENT_TEMP = 1 << 3,
+    SGJW_PATCH_FOV = 1 << 4,
+    SGJW_PATCH_DISTANCE = 1 << 5,
+    SGJW_PATCH_HUMIDITY = 1 << 6,
+    SGJW_PATCH_REFLECTIVE_TEMP = 1 << 7,
+    SGJW_PATCH_MANUFACTURER = 1 << 8,
+    SGJW_PATCH_PRODUCT = 1 << 9,
+    SGJW_PATCH_SN = 1 << 10,
+    SGJW_PATCH_LONGITUDE = 1 << 11,
+    SGJW_PATCH_LATITUDE = 1 << 12,
+    SGJW_PATCH_ALTITUDE = 1 << 13,
+    SGJW_PATCH_ALL = (1 << 14) - 1
+} SGJW_PATCH_FIELDS;
+
+// Inline text lengths of StateGridJPEGV2, the on-disk length without the null terminator
+#define SGJW_DATE_LENGTH 14
+#define SGJW_TEXT_LENGTH 32
+
+// Alignment of StateGridJPEGV2 and its matrix block
+#define SGJW_CACHE_LINE 64
+
 // Main structure
 typedef struct
 {
@@ -92,15 +136,227 @@ typedef struct
     char* appendix;
 } StateGridJPEG;
 
+// Main structure, v2. Scalars and texts are stored inline, matrix and appendix share one cache-line aligned allocation.
+typedef struct __attribute__((aligned(SGJW_CACHE_LINE)))
+{
+    /* ---------- Hot header, the first cache line ---------- */
+
+    // Longitude, IEEE-754 float64.
+    double longitude;
+    // Latitude, IEEE-754 float64.
+    double latitude;
+    // Temperature matrix data, width * height floats. @attention Which is Celsius, points into the block.
+    float* matrix;
+    // Appendix information i.e. description, null terminated. @attention Points into the block, NULL if appendix_length is 0.
+    char* appendix;
+    // Emissivity, @attention range in [0, 1].
+    float emissivity;
+    // Ambient temperature. @attention Which is Celsius.
+    float ambient_temp;
+    // Reflective temperature. @attention Which is Celsius.
+    float reflective_temp;
+    // Distance.
+    uint32_t distance;
+    // Altitude.
+    uint32_t altitude;
+    // Appendix information length, i.e. length of description.
+    uint32_t appendix_length;
+    // File version, @attention which is hex, 0x0100(big-endian) means version 1.0.
+    uint16_t version;
+    // Width of matrix.
+    uint16_t width;
+    // Height of matrix.
+    uint16_t height;
+    // FOV.
+    uint8_t fov;
+    // Humidity.
+    uint8_t humidity;
+
+    /* ---------- Texts, null terminated ---------- */
+
+    // Date YYYYMMDDHHMMSS.
+    char date[SGJW_DATE_LENGTH + 1];
+    // Manufacturer.
+    char manufacturer[SGJW_TEXT_LENGTH + 1];
+    // Product(type).
+    char product[SGJW_TEXT_LENGTH + 1];
+    // Serial number.
+    char sn[SGJW_TEXT_LENGTH + 1];
+
+    /* ---------- Private ---------- */
+
+    // The single allocation holding matrix and appendix, NULL when matrix and appendix are borrowed.
+    void* block;
+    // Capacity of block in bytes.
+    size_t block_capacity;
+} StateGridJPEGV2;
+
+// Heap allocator used by the library, see State_Grid_JPEG_Set_Allocator
+typedef struct
+{
+    // Allocate size bytes aligned to align (a power of two), NULL on failure.
+    void* (*alloc)(size_t size, size_t align, void* user);
+    // Release memory returned by alloc, never called with NULL.
+    void (*release)(void* ptr, void* user);
+    // Passed through to alloc and release.
+    void* user;
+} SGJWAllocator;
+
+// Byte-swap kernels for the float32 matrix, see State_Grid_JPEG_Matrix_Bswap32
+typedef enum
+{
+    // Best kernel for the running CPU.
+    SGJW_KERNEL_AUTO = 0,
+    // Byte-wise reference.
+    SGJW_KERNEL_SCALAR,
+    // x86, SSE2 (baseline on x86-64).
+    SGJW_KERNEL_SSE2,
+    // x86, AVX2, selected at runtime when the CPU supports it.
+    SGJW_KERNEL_AVX2,
+    // aarch64, NEON.
+    SGJW_KERNEL_NEON
+} SGJW_KERNEL;
+
+// Fixed fields and byte ranges of a file, see State_Grid_JPEG_Probe
+typedef struct
+{
+    // Fixed fields. @attention matrix, appendix and block stay NULL.
+    StateGridJPEGV2 header;
+    // Size of the file in bytes.
+    uint64_t file_size;
+    // File offset of the trailer, i.e. size of the JPEG.
+    uint64_t trailer_offset;
+    // File offset of the matrix, width * height * 4 bytes.
+    uint64_t matrix_offset;
+    // File offset of the appendix, appendix_length bytes.
+    uint64_t appendix_offset;
+} StateGridJPEGProbe;
+
+// Rectangle of the matrix and where to decode it, see State_Grid_JPEG_Read_Regions
+typedef struct
+{
+    // Left column.
+    uint16_t x;
+    // Top row.
+    uint16_t y;
+    // Number of columns.
+    uint16_t width;
+    // Number of rows.
+    uint16_t height;
+    // Output, row r of the rectangle lands at dst + r * stride.
+    float* dst;
+    // Output row pitch in floats, >= width.
+    size_t stride;
+} SGJWRegion;
+
+// Bins of SGJWStats::histogram
+#define SGJW_HISTOGRAM_BINS 256
+
+// Temperature statistics of a matrix, see State_Grid_JPEG_Read_Stats
+typedef struct
+{
+    // Input, histogram range. Values below / above land in the first / last bin, low >= high skips the histogram.
+    float histogram_low;
+    float histogram_high;
+
+    // Number of pixels, NaN pixels are left out of every field.
+    uint64_t count;
+    float min;
+    float max;
+    double mean;
+    // Population standard deviation.
+    double stddev;
+    // First pixel (row-major) holding max.
+    uint16_t hottest_x;
+    uint16_t hottest_y;
+    // Bin i counts values in [low + i * (high - low) / SGJW_HISTOGRAM_BINS, ...).
+    uint32_t histogram[SGJW_HISTOGRAM_BINS];
+} SGJWStats;
+
+// Measurement parameters a matrix was compensated with, see State_Grid_JPEG_Matrix_Recompensate
+typedef struct
+{
+    // Object emissivity, in (0, 1].
+    float emissivity;
+    // Reflected apparent temperature, in degrees Celsius.
+    float reflective_temp;
+    // Air temperature, in degrees Celsius.
+    float ambient_temp;
+    // Object distance, in meters.
+    uint32_t distance;
+    // Relative humidity, in percent.
+    uint8_t humidity;
+} SGJWRadiometry;
+
+// Zero-copy view of a mapped file, see State_Grid_JPEG_Map
+typedef struct
+{
+    // File version, @attention which is hex, 0x0100(big-endian) means version 1.0.
+    uint16_t version;
+    // Width of matrix.
+    uint16_t width;
+    // Height of matrix.
+    uint16_t height;
+    // Date YYYYMMDDHHMMSS, 14 bytes. @attention Borrowed from the mapping, NOT null terminated.
+    const char* date;
+    // Temperature matrix, width * height floats. @attention Borrowed from the mapping, or an aligned copy when the host needs one.
+    const float* matrix;
+    // Emissivity, @attention range in [0, 1].
+    float emissivity;
+    // Ambient temperature. @attention Which is Celsius.
+    float ambient_temp;
+    // FOV.
+    uint8_t fov;
+    // Distance.
+    uint32_t distance;
+    // Humidity.
+    uint8_t humidity;
+    // Reflective temperature. @attention Which is Celsius.
+    float reflective_temp;
+    // Manufacturer, 32 bytes. @attention Borrowed from the mapping, NOT null terminated.
+    const char* manufacturer;
+    // Product(type), 32 bytes. @attention Borrowed from the mapping, NOT null terminated.
+    const char* product;
+    // Serial number, 32 bytes. @attention Borrowed from the mapping, NOT null terminated.
+    const char* sn;
+    // Longitude, IEEE-754 float64.
+    double longitude;
+    // Latitude, IEEE-754 float64.
+    double latitude;
+    // Altitude.
+    uint32_t altitude;
+    // Appendix information length, i.e. length of description.
+    uint32_t appendix_length;
+    // Appendix information i.e. description. @attention Borrowed from the mapping, NOT null terminated.
+    const char* appendix;
+
+    // Private, the mapping and the optional matrix copy released by State_Grid_JPEG_Unmap.
+    void* map_base;
+    size_t map_size;
+    float* matrix_copy;
+} StateGridJPEGView;
+
 /**
  * @brief Read a JPEG file and parse its embedded metadata.
  * 
+ * @note Compatibility shim on top of State_Grid_JPEG_V2_Read, prefer StateGridJPEGV2 for new code.
+ * 
  * @param filepath The path to the JPEG file to be read.
  * @param obj A pointer to the StateGridJPEG structure that will store the parsed metadata.
  * @return An SGJW_ERROR code indicating the success or failure of the operation.
  */
 int8_t State_Grid_JPEG_Read(const char* filepath, StateGridJPEG* obj);
 
+/**
+ * @brief Read a JPEG file and parse its embedded metadata, with explicit read flags.
+ * 
+ * @param filepath The path to the JPEG file to be read.
+ * @param obj A pointer to the StateGridJPEG structure that will store the parsed metadata.
+ * @param flags A combination of SGJW_READ_FLAGS, e.g. SGJW_READ_TRAILER_ONLY to skip the JPEG image bytes.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Read_Ex(const char* filepath, StateGridJPEG* obj, uint32_t flags);
+
 /**
  * @brief Append SGJW metadata to a JPEG file.
  * 
@@ -118,6 +374,338 @@ int8_t State_Grid_JPEG_Append(const char* filepath, StateGridJPEG* obj);
  */
 void State_Grid_JPEG_Delete_OBJ(StateGridJPEG* obj);
 
+/**
+ * @brief Read a JPEG file and parse its embedded metadata into a v2 object.
+ * 
+ * @note The whole object costs one allocation, released by State_Grid_JPEG_V2_Delete_OBJ.
+ * 
+ * @param filepath The path to the JPEG file to be read.
+ * @param obj A pointer to the StateGridJPEGV2 structure that will store the parsed metadata.
+ * @param flags A combination of SGJW_READ_FLAGS.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_V2_Read(const char* filepath, StateGridJPEGV2* obj, uint32_t flags);
+
+/**
+ * @brief Read a JPEG file into an existing v2 object, reusing its block.
+ * 
+ * @note Meant for capture loops: the block is only reallocated when width, height or appendix length grow.
+ *       The trailer is fetched with positioned reads (SGJW_READ_TRAILER_ONLY is implied) straight into the object,
+ *       so the steady state performs no heap allocation at all.
+ *       On failure obj keeps its block, but its fields are undefined.
+ * 
+ * @param filepath The path to the JPEG file to be read.
+ * @param obj A pointer to a zeroed or previously read StateGridJPEGV2 structure.
+ * @param flags A combination of SGJW_READ_FLAGS.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Read_Into(const char* filepath, StateGridJPEGV2* obj, uint32_t flags);
+
+/**
+ * @brief State_Grid_JPEG_Read_Into that gathers temperature statistics while the matrix is decoded.
+ * 
+ * @note The matrix is fetched in cache-sized chunks, each one decoded and folded into the statistics while it is
+ *       still in cache, so the matrix crosses the memory bus once. With SGJW_READ_STATS_ONLY the chunks go through
+ *       a stack buffer and the block holds only the appendix.
+ * 
+ * @param filepath The path to the JPEG file to be read.
+ * @param obj A pointer to a zeroed or previously read StateGridJPEGV2.
+ * @param flags A combination of SGJW_READ_FLAGS.
+ * @param stats Output statistics with histogram_low / histogram_high set by the caller. NULL behaves like
+ *              State_Grid_JPEG_Read_Into, and is invalid together with SGJW_READ_STATS_ONLY.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Read_Stats(const char* filepath, StateGridJPEGV2* obj, uint32_t flags, SGJWStats* stats);
+
+/**
+ * @brief Validate a JPEG file and read only its fixed fields, plus the byte ranges of matrix and appendix.
+ * 
+ * @note Reads 178 bytes with three positioned reads, whatever the resolution. Pair it with State_Grid_JPEG_Read_Matrix.
+ * 
+ * @param filepath The path to the JPEG file to be probed.
+ * @param probe A pointer to the StateGridJPEGProbe structure that will store the fields and ranges, nothing to free.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Probe(const char* filepath, StateGridJPEGProbe* probe);
+
+/**
+ * @brief Decode the matrix of a probed file into a caller buffer.
+ * 
+ * @param filepath The path to the JPEG file that was probed.
+ * @param probe A pointer to the result of State_Grid_JPEG_Probe on this file.
+ * @param matrix Output, width * height floats.
+ * @return SGJW_ERROR_INVALID_OFFSET if the file changed size since the probe, otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Read_Matrix(const char* filepath, const StateGridJPEGProbe* probe, float* matrix);
+
+/**
+ * @brief Decode rectangles of the matrix of a probed file, fetching only the bytes they cover.
+ * 
+ * @note One open for all regions. Rows are fetched with positioned reads, neighbouring rows are batched
+ *       into one read when the bytes skipped between them are fewer than the bytes kept.
+ * 
+ * @param filepath The path to the JPEG file that was probed.
+ * @param probe A pointer to the result of State_Grid_JPEG_Probe on this file.
+ * @param regions The rectangles to decode, each with its own output buffer.
+ * @param count Number of regions.
+ * @return SGJW_ERROR_INVALID_PARAMS if a region is outside the matrix, otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Read_Regions(const char* filepath, const StateGridJPEGProbe* probe, const SGJWRegion* regions, size_t count);
+
+/**
+ * @brief Decode a range of full rows of the matrix of a probed file, with a single positioned read.
+ * 
+ * @param filepath The path to the JPEG file that was probed.
+ * @param probe A pointer to the result of State_Grid_JPEG_Probe on this file.
+ * @param first_row First row to decode.
+ * @param row_count Number of rows to decode.
+ * @param dst Output, row_count * width floats.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Read_Rows(const char* filepath, const StateGridJPEGProbe* probe, uint16_t first_row, uint16_t row_count, float* dst);
+
+/**
+ * @brief Parse the embedded metadata of an in-memory JPEG file (JPEG + trailer) into a v2 object.
+ * 
+ * @note Like State_Grid_JPEG_Read_Into, an existing block in obj is reused when it is large enough.
+ * 
+ * @param data The whole file in memory.
+ * @param size Size of data in bytes.
+ * @param obj A pointer to a zeroed or previously read StateGridJPEGV2 structure.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Read_Buffer(const uint8_t* data, size_t size, StateGridJPEGV2* obj);
+
+/**
+ * @brief Get the exact number of bytes State_Grid_JPEG_Append_Buffer adds behind the JPEG bytes.
+ * 
+ * @param obj A pointer to the StateGridJPEGV2 structure to be appended.
+ * @return The trailer size in bytes, offset and EOF signature included.
+ */
+size_t State_Grid_JPEG_Trailer_Size(const StateGridJPEGV2* obj);
+
+/**
+ * @brief Append SGJW metadata to an in-memory JPEG, i.e. serialize the trailer right behind the JPEG bytes.
+ * 
+ * @note Size the buffer with jpeg_size + State_Grid_JPEG_Trailer_Size(obj), then hand buffer[0, *total_size)
+ *       to a single write, a socket or a ring buffer.
+ * 
+ * @param buffer The buffer holding the JPEG bytes in [0, jpeg_size).
+ * @param capacity Capacity of buffer in bytes.
+ * @param jpeg_size Size of the JPEG in bytes, which becomes the trailer offset.
+ * @param obj A pointer to the StateGridJPEGV2 structure containing the metadata to be appended.
+ * @param total_size Optional, receives jpeg_size + trailer size, also when the buffer is too small.
+ * @return SGJW_ERROR_BUFFER_TOO_SMALL if capacity is not enough, otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Append_Buffer(uint8_t* buffer, size_t capacity, size_t jpeg_size, const StateGridJPEGV2* obj, size_t* total_size);
+
+/**
+ * @brief Append the metadata of a v2 object to a JPEG file.
+ * 
+ * @note matrix and appendix may be borrowed (block is NULL), only the pointers are read.
+ * 
+ * @param filepath The path to the output JPEG file.
+ * @param obj A pointer to the StateGridJPEGV2 structure containing the metadata to be appended.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_V2_Append(const char* filepath, const StateGridJPEGV2* obj);
+
+/**
+ * @brief Overwrite fixed-size fields of the trailer in place, e.g. to correct emissivity or distance.
+ * 
+ * @note Only the bytes of the selected fields are written, adjacent fields in one pwrite. Matrix, appendix
+ *       and the sizes cannot change this way, use State_Grid_JPEG_Replace for them.
+ * 
+ * @param filepath The path to a JPEG file with a trailer.
+ * @param obj The new values, only the fields selected are read.
+ * @param fields A combination of SGJW_PATCH_FIELDS.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Patch(const char* filepath, const StateGridJPEGV2* obj, uint32_t fields);
+
+/**
+ * @brief Replace the trailer of a JPEG file, e.g. for a new appendix or resolution.
+ * 
+ * @note The new trailer starts where the first one did, trailers stacked by repeated appends are dropped
+ *       and the file is cut right behind it. A plain JPEG gets its first trailer.
+ * 
+ * @param filepath The path to the JPEG file.
+ * @param obj A pointer to the StateGridJPEGV2 structure containing the new metadata.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Replace(const char* filepath, const StateGridJPEGV2* obj);
+
+/**
+ * @brief Recompensate the matrix of a loaded trailer in place and store the new parameters in it.
+ * 
+ * @param obj A trailer with its matrix, e.g. from State_Grid_JPEG_V2_Read.
+ * @param to The parameters to compensate with.
+ * @param threads Worker threads, 0 for one per CPU.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_V2_Recompensate(StateGridJPEGV2* obj, const SGJWRadiometry* to, uint32_t threads);
+
+/**
+ * @brief Recompensate the matrix of a file and patch the parameters of its footer.
+ * 
+ * @note The matrix streams through L1-sized chunks, no full copy is held. The result is written to
+ *       "<filepath>.tmp", synced and renamed over filepath, so a crash leaves either the old or the new file.
+ * 
+ * @param filepath The path to a JPEG file with a trailer.
+ * @param to The parameters to compensate with.
+ * @param threads Worker threads, 0 for one per CPU.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Recompensate_File(const char* filepath, const SGJWRadiometry* to, uint32_t threads);
+
+/**
+ * @brief Set width, height and appendix length of a v2 object and make its block large enough.
+ * 
+ * @note The block is only reallocated when it is too small, matrix and appendix contents are undefined afterwards.
+ * 
+ * @param obj A pointer to a zeroed or previously used StateGridJPEGV2 structure.
+ * @param width Width of matrix.
+ * @param height Height of matrix.
+ * @param appendix_length Appendix length, without the null terminator.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_V2_Resize(StateGridJPEGV2* obj, uint16_t width, uint16_t height, uint32_t appendix_length);
+
+/**
+ * @brief Deallocate the block of a StateGridJPEGV2 structure and zero it.
+ * 
+ * @param obj A pointer to the StateGridJPEGV2 structure to be deallocated.
+ */
+void State_Grid_JPEG_V2_Delete_OBJ(StateGridJPEGV2* obj);
+
+/**
+ * @brief Map a JPEG file and expose its embedded metadata without decoding copies.
+ * 
+ * @note On little-endian hosts the matrix is used in place whenever it is 4-byte aligned in the file,
+ *       otherwise (or on big-endian hosts) it is decoded once into a 64-byte aligned copy.
+ *       Scalars are decoded by value, strings and the appendix point into the mapping.
+ * 
+ * @param filepath The path to the JPEG file to be mapped.
+ * @param view A pointer to the StateGridJPEGView that will borrow from the mapping.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Map(const char* filepath, StateGridJPEGView* view);
+
+/**
+ * @brief Copy rectangles out of the matrix of a mapped view.
+ * 
+ * @param view A pointer to a view created by State_Grid_JPEG_Map.
+ * @param regions The rectangles to copy, each with its own output buffer.
+ * @param count Number of regions.
+ * @return SGJW_ERROR_INVALID_PARAMS if a region is outside the matrix, otherwise SGJW_SUCCESS.
+ */
+int8_t State_Grid_JPEG_View_Regions(const StateGridJPEGView* view, const SGJWRegion* regions, size_t count);
+
+/**
+ * @brief Unmap a view created by State_Grid_JPEG_Map, all borrowed pointers become invalid.
+ * 
+ * @param view A pointer to the StateGridJPEGView to be released.
+ */
+void State_Grid_JPEG_Unmap(StateGridJPEGView* view);
+
+/**
+ * @brief Decode a little-endian float32 matrix block, i.e. the on-disk matrix, into host floats.
+ * 
+ * @note A straight memcpy on little-endian hosts, a SIMD byte swap otherwise. src may be unaligned.
+ * 
+ * @param src The on-disk matrix bytes, count * 4 bytes.
+ * @param count Number of floats.
+ * @param dst Output floats, may be the same memory as src.
+ */
+void State_Grid_JPEG_Matrix_Decode(const uint8_t* src, size_t count, float* dst);
+
+/**
+ * @brief Encode host floats into a little-endian float32 matrix block, the inverse of State_Grid_JPEG_Matrix_Decode.
+ * 
+ * @param src Host floats.
+ * @param count Number of floats.
+ * @param dst Output bytes, count * 4 bytes, may be unaligned.
+ */
+void State_Grid_JPEG_Matrix_Encode(const float* src, size_t count, uint8_t* dst);
+
+/**
+ * @brief Reverse the byte order of count 32-bit words with a given kernel.
+ * 
+ * @param src Input words, may be unaligned.
+ * @param count Number of words.
+ * @param dst Output words, may be unaligned, may be the same memory as src.
+ * @param kernel The kernel to use, SGJW_KERNEL_AUTO picks the best one for the running CPU.
+ * @return SGJW_ERROR_INVALID_PARAMS if the kernel is not available on this CPU, otherwise SGJW_SUCCESS.
+ */
+int8_t State_Grid_JPEG_Matrix_Bswap32(const void* src, size_t count, void* dst, SGJW_KERNEL kernel);
+
+/**
+ * @brief Gather temperature statistics of a decoded matrix with a given kernel.
+ * 
+ * @param matrix Host floats, width * height values.
+ * @param width Matrix width, used for the hottest pixel location.
+ * @param height Matrix height.
+ * @param stats Output statistics with histogram_low / histogram_high set by the caller.
+ * @param kernel The kernel to use, SGJW_KERNEL_AUTO picks the best one for the running CPU.
+ * @return SGJW_ERROR_INVALID_PARAMS if the kernel is not available on this CPU, otherwise SGJW_SUCCESS.
+ */
+int8_t State_Grid_JPEG_Matrix_Stats(const float* matrix, uint16_t width, uint16_t height, SGJWStats* stats, SGJW_KERNEL kernel);
+
+/**
+ * @brief Get the measurement parameters stored in a trailer.
+ * 
+ * @param obj The trailer.
+ * @param radiometry Output.
+ */
+void State_Grid_JPEG_Radiometry_Of(const StateGridJPEGV2* obj, SGJWRadiometry* radiometry);
+
+/**
+ * @brief Recompute temperatures for new measurement parameters, e.g. after correcting the emissivity.
+ * 
+ * @note Broadband model: the detector sees tau * e * T^4 + tau * (1 - e) * T_refl^4 + (1 - tau) * T_atm^4
+ *       (Kelvin), with the atmospheric transmission tau from distance, humidity and air temperature.
+ *       Per pixel this is T'^4 = a * T^4 + b, the coefficients are computed once in double precision.
+ *       Temperatures that would need negative radiance become absolute zero.
+ * 
+ * @param src Celsius values compensated with from.
+ * @param dst Output, may be the same memory as src.
+ * @param count Number of values.
+ * @param from The parameters src was compensated with.
+ * @param to The parameters to compensate with.
+ * @param threads Worker threads, 0 for one per CPU. Small matrices use fewer.
+ * @param kernel The kernel to use, SGJW_KERNEL_AUTO picks the best one for the running CPU.
+ * @return SGJW_ERROR_INVALID_PARAMS if the kernel is not available or an emissivity is out of range, otherwise SGJW_SUCCESS.
+ */
+int8_t State_Grid_JPEG_Matrix_Recompensate(const float* src, float* dst, size_t count, const SGJWRadiometry* from, const SGJWRadiometry* to, uint32_t threads, SGJW_KERNEL kernel);
+
+/**
+ * @brief Get the kernel SGJW_KERNEL_AUTO resolves to on the running CPU.
+ * 
+ * @return The selected SGJW_KERNEL.
+ */
+SGJW_KERNEL State_Grid_JPEG_Matrix_Kernel(void);
+
+/**
+ * @brief Route every heap allocation of the library through a custom allocator.
+ * 
+ * @note Set it once before any other call, memory must be released by the allocator that allocated it.
+ * 
+ * @param allocator The allocator to use, NULL restores malloc / free.
+ */
+void State_Grid_JPEG_Set_Allocator(const SGJWAllocator* allocator);
+
+/**
+ * @brief Get the number of bytes read from disk by the library since the last reset.
+ * 
+ * @return Total bytes read by all read paths, summed over all threads.
+ */
+uint64_t State_Grid_JPEG_Get_Bytes_Read(void);
+
+/**
+ * @brief Reset the counter returned by State_Grid_JPEG_Get_Bytes_Read.
+ */
+void State_Grid_JPEG_Reset_Bytes_Read(void);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,344 @@
+#pragma once
+
+/**
+ * @file sgjw.hpp
+ * @brief Header-only C++20 wrapper of StateGridJPEGV2: a move-only frame owning its single block.
+ *
+ * @note Typical usage:
+ * 1. auto frame = sgjw::Frame::read(filepath); on failure frame.error() holds the SGJW_ERROR code.
+ * 2. Read the header through frame->width(), frame->date(), ... and the matrix through frame->matrix(), a
+ *    std::span<const float>, or frame->matrix_2d(), a row-major view indexed as (row, column).
+ * 3. Hand the frame to the next stage with std::move, only the handle moves, never the matrix.
+ * 4. The block is released when the last owner goes out of scope, also when a read fails partway through.
+ * For writing, sgjw::Frame::create allocates matrix and appendix, native() exposes the fields to fill and
+ * append() writes the trailer behind a JPEG. read_into() reuses the block of a frame, so a capture loop
+ * reading frames of the same size allocates nothing.
+ *
+ * Errors are returned as values, sgjw::Expected mirrors the part of std::expected the wrapper needs, so the
+ * header stays usable without C++23 and without exceptions. The C sources are still built as C.
+ */
+
+#include "sgjw.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <utility>
+
+namespace sgjw
+{
+
+/* ====================================================================================================== */
+/* ======================================== Error Handling ============================================== */
+/* ====================================================================================================== */
+
+/**
+ * @brief Short description of an SGJW_ERROR code, e.g. for logs.
+ */
+inline const char* message(SGJW_ERROR code) noexcept
+{
+    switch (code)
+    {
+    case SGJW_SUCCESS:
+        return "success";
+    case SGJW_ERROR_FILE_NOT_FOUND:
+        return "file not found";
+    case SGJW_ERROR_MALLOC_FAILED:
+    case SGJW_ERROR_MEMORY_ALLOCATION:
+        return "allocation failed";
+    case SGJW_ERROR_READ_FAILED:
+        return "read failed";
+    case SGJW_ERROR_INVALID_EOF:
+        return "invalid EOF signature";
+    case SGJW_ERROR_INVALID_OFFSET:
+        return "invalid trailer offset";
+    case SGJW_ERROR_FIELD_READ_FAILED:
+        return "field read failed";
+    case SGJW_ERROR_INVALID_PARAMS:
+        return "invalid parameters";
+    case SGJW_ERROR_FILE_WRITE:
+        return "file write failed";
+    case SGJW_ERROR_FIELD_SET_FAILED:
+        return "field set failed";
+    case SGJW_ERROR_BUFFER_TOO_SMALL:
+        return "buffer too small";
+    }
+    return "unknown error";
+}
+
+/**
+ * @brief A value or an SGJW_ERROR code, the subset of std::expected<T, SGJW_ERROR> used by the wrapper.
+ *
+ * @note T must be default constructible and cheap to move, the value is held next to the error.
+ */
+template <typename T>
+class Expected
+{
+public:
+    Expected(T&& value) noexcept : value_(std::move(value)), error_(SGJW_SUCCESS) {}
+    Expected(SGJW_ERROR error) noexcept : value_(), error_(error) {}
+
+    bool has_value() const noexcept { return error_ == SGJW_SUCCESS; }
+    explicit operator bool() const noexcept { return has_value(); }
+
+    // @attention Only valid with has_value().
+    T& value() & noexcept { return value_; }
+    const T& value() const& noexcept { return value_; }
+    T&& value() && noexcept { return std::move(value_); }
+    T& operator*() & noexcept { return value_; }
+    const T& operator*() const& noexcept { return value_; }
+    T&& operator*() && noexcept { return std::move(value_); }
+    T* operator->() noexcept { return &value_; }
+    const T* operator->() const noexcept { return &value_; }
+
+    // @attention Only valid without has_value().
+    SGJW_ERROR error() const noexcept { return error_; }
+
+private:
+    T value_;
+    SGJW_ERROR error_;
+};
+
+template <>
+class Expected<void>
+{
+public:
+    Expected() noexcept : error_(SGJW_SUCCESS) {}
+    Expected(SGJW_ERROR error) noexcept : error_(error) {}
+
+    bool has_value() const noexcept { return error_ == SGJW_SUCCESS; }
+    explicit operator bool() const noexcept { return has_value(); }
+    SGJW_ERROR error() const noexcept { return error_; }
+
+private:
+    SGJW_ERROR error_;
+};
+
+/* ====================================================================================================== */
+/* ======================================== Matrix View ================================================= */
+/* ====================================================================================================== */
+
+/**
+ * @brief Row-major 2D view of a matrix, mdspan-style: extent(0) is the height, extent(1) the width.
+ *
+ * @note Borrowed, valid as long as the frame it comes from keeps its block.
+ */
+template <typename T>
+class MatrixView
+{
+public:
+    MatrixView() noexcept = default;
+    MatrixView(T* data, std::size_t width, std::size_t height) noexcept : data_(data), width_(width), height_(height) {}
+
+    std::size_t extent(std::size_t rank) const noexcept { return rank == 0 ? height_ : width_; }
+    std::size_t width() const noexcept { return width_; }
+    std::size_t height() const noexcept { return height_; }
+    std::size_t size() const noexcept { return width_ * height_; }
+    bool empty() const noexcept { return size() == 0; }
+    T* data() const noexcept { return data_; }
+
+    T& operator()(std::size_t row, std::size_t column) const noexcept { return data_[row * width_ + column]; }
+    std::span<T> row(std::size_t row) const noexcept { return {data_ + row * width_, width_}; }
+    std::span<T> span() const noexcept { return {data_, size()}; }
+
+private:
+    T* data_ = nullptr;
+    std::size_t width_ = 0;
+    std::size_t height_ = 0;
+};
+
+/* ====================================================================================================== */
+/* ======================================== Frame ======================================================= */
+/* ====================================================================================================== */
+
+/**
+ * @brief A trailer with its matrix and appendix, owning the single block of a StateGridJPEGV2.
+ *
+ * @note Move-only: a move hands over the block and leaves the source empty. copy() is the explicit deep copy.
+ *       An empty frame has no matrix, its spans are empty.
+ */
+class Frame
+{
+public:
+    Frame() noexcept : obj_() {}
+    ~Frame() { State_Grid_JPEG_V2_Delete_OBJ(&obj_); }
+
+    Frame(const Frame&) = delete;
+    Frame& operator=(const Frame&) = delete;
+
+    Frame(Frame&& other) noexcept : obj_(other.obj_) { other.obj_ = StateGridJPEGV2(); }
+    Frame& operator=(Frame&& other) noexcept
+    {
+        if (this != &other)
+        {
+            State_Grid_JPEG_V2_Delete_OBJ(&obj_);
+            obj_ = other.obj_;
+            other.obj_ = StateGridJPEGV2();
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Read a file, see State_Grid_JPEG_V2_Read.
+     *
+     * @note The whole-file read reports a missing or empty file as SGJW_ERROR_READ_FAILED, as the C API does.
+     *       With SGJW_READ_TRAILER_ONLY (and in read_into()) the file is opened first, so a missing file gives
+     *       SGJW_ERROR_FILE_NOT_FOUND.
+     *
+     * @param flags A combination of SGJW_READ_FLAGS, SGJW_READ_TRAILER_ONLY skips the JPEG bytes.
+     */
+    static Expected<Frame> read(const char* filepath, uint32_t flags = SGJW_READ_DEFAULT) noexcept
+    {
+        Frame frame;
+        int8_t retval = State_Grid_JPEG_V2_Read(filepath, &frame.obj_, flags);
+        if (retval != SGJW_SUCCESS)
+            return static_cast<SGJW_ERROR>(retval);
+        return frame;
+    }
+
+    /**
+     * @brief Parse a whole file in memory, see State_Grid_JPEG_Read_Buffer. Matrix and appendix are copied.
+     */
+    static Expected<Frame> read(std::span<const uint8_t> data) noexcept
+    {
+        Frame frame;
+        int8_t retval = State_Grid_JPEG_Read_Buffer(data.data(), data.size(), &frame.obj_);
+        if (retval != SGJW_SUCCESS)
+            return static_cast<SGJW_ERROR>(retval);
+        return frame;
+    }
+
+    /**
+     * @brief A frame with room for a matrix and an appendix, their contents and all other fields zeroed.
+     */
+    static Expected<Frame> create(uint16_t width, uint16_t height, uint32_t appendix_length = 0) noexcept
+    {
+        Frame frame;
+        Expected<void> resized = frame.resize(width, height, appendix_length);
+        if (!resized)
+            return resized.error();
+        std::memset(frame.obj_.block, 0, frame.obj_.block_capacity);
+        return frame;
+    }
+
+    /**
+     * @brief Read a file into this frame, see State_Grid_JPEG_Read_Into.
+     *
+     * @note The block is only reallocated when the new frame is larger. On failure the frame keeps its block
+     *       but is empty.
+     */
+    Expected<void> read_into(const char* filepath, uint32_t flags = SGJW_READ_DEFAULT) noexcept
+    {
+        int8_t retval = State_Grid_JPEG_Read_Into(filepath, &obj_, flags);
+        if (retval != SGJW_SUCCESS)
+            Clear();
+        return static_cast<SGJW_ERROR>(retval);
+    }
+
+    /**
+     * @brief Set the sizes and make the block large enough, see State_Grid_JPEG_V2_Resize.
+     *
+     * @note Matrix and appendix contents are undefined afterwards. On failure the frame keeps its block but is empty.
+     */
+    Expected<void> resize(uint16_t width, uint16_t height, uint32_t appendix_length = 0) noexcept
+    {
+        int8_t retval = State_Grid_JPEG_V2_Resize(&obj_, width, height, appendix_length);
+        if (retval != SGJW_SUCCESS)
+            Clear();
+        return static_cast<SGJW_ERROR>(retval);
+    }
+
+    /**
+     * @brief Append the trailer to a JPEG file, see State_Grid_JPEG_V2_Append.
+     */
+    Expected<void> append(const char* filepath) const noexcept
+    {
+        if (empty())
+            return SGJW_ERROR_INVALID_PARAMS;
+        return static_cast<SGJW_ERROR>(State_Grid_JPEG_V2_Append(filepath, &obj_));
+    }
+
+    /**
+     * @brief Deep copy into a new frame, the only way a frame is copied.
+     */
+    Expected<Frame> copy() const noexcept
+    {
+        Frame frame;
+        Expected<void> resized = frame.resize(obj_.width, obj_.height, obj_.appendix_length);
+        if (!resized)
+            return resized.error();
+
+        void* block = frame.obj_.block;
+        std::size_t capacity = frame.obj_.block_capacity;
+        float* matrix = frame.obj_.matrix;
+        char* appendix = frame.obj_.appendix;
+        frame.obj_ = obj_;
+        frame.obj_.block = block;
+        frame.obj_.block_capacity = capacity;
+        frame.obj_.matrix = obj_.matrix ? matrix : nullptr;
+        frame.obj_.appendix = appendix;
+
+        if (obj_.matrix)
+            std::memcpy(matrix, obj_.matrix, matrix_size() * sizeof(float));
+        if (obj_.appendix)
+            std::memcpy(appendix, obj_.appendix, obj_.appendix_length);
+        return frame;
+    }
+
+    /* ---------- Header ---------- */
+
+    bool empty() const noexcept { return obj_.matrix == nullptr && obj_.appendix == nullptr; }
+    // File version, hex, 0x0100 means version 1.0.
+    uint16_t version() const noexcept { return obj_.version; }
+    uint16_t width() const noexcept { return obj_.width; }
+    uint16_t height() const noexcept { return obj_.height; }
+    // YYYYMMDDhhmmss.
+    std::string_view date() const noexcept { return obj_.date; }
+    float emissivity() const noexcept { return obj_.emissivity; }
+    float ambient_temp() const noexcept { return obj_.ambient_temp; }
+    uint8_t fov() const noexcept { return obj_.fov; }
+    uint32_t distance() const noexcept { return obj_.distance; }
+    uint8_t humidity() const noexcept { return obj_.humidity; }
+    float reflective_temp() const noexcept { return obj_.reflective_temp; }
+    std::string_view manufacturer() const noexcept { return obj_.manufacturer; }
+    std::string_view product() const noexcept { return obj_.product; }
+    std::string_view sn() const noexcept { return obj_.sn; }
+    double longitude() const noexcept { return obj_.longitude; }
+    double latitude() const noexcept { return obj_.latitude; }
+    uint32_t altitude() const noexcept { return obj_.altitude; }
+    std::string_view appendix() const noexcept { return obj_.appendix ? std::string_view(obj_.appendix, obj_.appendix_length) : std::string_view(); }
+
+    /* ---------- Matrix, in Celsius ---------- */
+
+    std::span<const float> matrix() const noexcept { return {obj_.matrix, matrix_size()}; }
+    std::span<float> matrix() noexcept { return {obj_.matrix, matrix_size()}; }
+    MatrixView<const float> matrix_2d() const noexcept { return {obj_.matrix, obj_.matrix ? obj_.width : 0u, obj_.matrix ? obj_.height : 0u}; }
+    MatrixView<float> matrix_2d() noexcept { return {obj_.matrix, obj_.matrix ? obj_.width : 0u, obj_.matrix ? obj_.height : 0u}; }
+
+    /**
+     * @brief The wrapped object, e.g. to fill the fields before append() or to call the C API.
+     *
+     * @attention block, block_capacity, matrix and appendix belong to the frame, change them only through resize().
+     */
+    StateGridJPEGV2& native() noexcept { return obj_; }
+    const StateGridJPEGV2& native() const noexcept { return obj_; }
+
+private:
+    std::size_t matrix_size() const noexcept { return obj_.matrix ? static_cast<std::size_t>(obj_.width) * obj_.height : 0; }
+
+    // Keep the block for the next read, drop everything else
+    void Clear() noexcept
+    {
+        void* block = obj_.block;
+        std::size_t capacity = obj_.block_capacity;
+        obj_ = StateGridJPEGV2();
+        obj_.block = block;
+        obj_.block_capacity = capacity;
+    }
+
+    StateGridJPEGV2 obj_;
+};
+
+} // namespace sgjw
@@ -0,0 +1,472 @@
+#include "sgjw_archive.h"
+#include "sgjw_internal.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SGJW_ARCHIVE_VERSION 1
+
+// Suffix of the file written before it is renamed over the archive
+#define SGJW_ARCHIVE_TEMP_SUFFIX ".tmp"
+
+// clang-format off
+static const char SGJW_ARCHIVE_MAGIC[8] = { 'S', 'G', 'J', 'W', 'A', 'R', 'C', '\0' };
+// clang-format on
+
+/* ====================================================================================================== */
+/* ======================================== Helper Structures =========================================== */
+/* ====================================================================================================== */
+
+// At offset 0, the first file follows, a cache line in size
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint8_t reserved[SGJW_CACHE_LINE - 12];
+} ArchiveHeader;
+
+// One frame of the index
+typedef struct
+{
+    // The file, verbatim
+    uint64_t offset;
+    uint64_t size;
+    // Into the names, null-terminated
+    uint64_t name_offset;
+    // Trailer offset within the file
+    uint32_t trailer_offset;
+    uint16_t version;
+    uint16_t width;
+    uint16_t height;
+    char date[SGJW_DATE_BYTES];
+    char sn[SGJW_SN_BYTES];
+} ArchiveRecord;
+
+// At the very end of the archive
+typedef struct
+{
+    uint64_t records;
+    uint64_t names;
+    uint64_t names_size;
+    uint64_t size;
+    uint32_t count;
+    uint32_t version;
+    char magic[8];
+} ArchiveFooter;
+
+// A file to pack, sorted by date then by its place in the list
+typedef struct
+{
+    ArchiveRecord record;
+    const char* path;
+    const char* name;
+    size_t input;
+} ArchiveInput;
+
+/* ====================================================================================================== */
+/* ======================================== Helper Functions ============================================ */
+/* ====================================================================================================== */
+
+static uint64_t Archive_Align(uint64_t offset)
+{
+    return (offset + SGJW_CACHE_LINE - 1) & ~((uint64_t)SGJW_CACHE_LINE - 1);
+}
+
+static int Archive_Input_Compare(const void* a, const void* b)
+{
+    const ArchiveInput* x = (const ArchiveInput*)a;
+    const ArchiveInput* y = (const ArchiveInput*)b;
+    int order = memcmp(x->record.date, y->record.date, SGJW_DATE_BYTES);
+    if (order != 0)
+        return order;
+    return (x->input > y->input) - (x->input < y->input);
+}
+
+/**
+ * @brief Read a whole file of an expected size into a growing buffer.
+ *
+ * @return SGJW_ERROR_READ_FAILED if it cannot be read or its size changed since it was probed.
+ */
+static int8_t Archive_Read_File(const char* path, uint64_t size, uint8_t** buffer, size_t* capacity)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return SGJW_ERROR_FILE_NOT_FOUND;
+
+    struct stat st;
+    int8_t retval = SGJW_SUCCESS;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size != size)
+    {
+        retval = SGJW_ERROR_READ_FAILED;
+        goto cleanup;
+    }
+
+    if (size > *capacity)
+    {
+        SGJW_Free(*buffer);
+        *buffer = (uint8_t*)SGJW_Malloc(size, SGJW_CACHE_LINE);
+        *capacity = *buffer ? size : 0;
+        if (!*buffer)
+        {
+            retval = SGJW_ERROR_MALLOC_FAILED;
+            goto cleanup;
+        }
+    }
+
+    retval = SGJW_Pread_Full(fd, *buffer, size, 0);
+
+cleanup:
+    close(fd);
+    return retval;
+}
+
+static const ArchiveRecord* Archive_Record(const SGJWArchive* archive, uint32_t frame)
+{
+    return (const ArchiveRecord*)archive->records + frame;
+}
+
+/* ====================================================================================================== */
+/* ========================================== Main APIs ================================================= */
+/* ====================================================================================================== */
+
+int8_t State_Grid_JPEG_Archive_Pack(const char* archive_path, const char* const* filepaths, size_t count, size_t* packed)
+{
+    if (!archive_path || (!filepaths && count > 0) || count > UINT32_MAX)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    if (packed)
+        *packed = 0;
+
+    // Only the names are stored, Unpack would write one file over the other
+    int8_t retval = SGJW_Check_Unique_Names(filepaths, count);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    int fd = -1;
+    size_t inputs = 0;
+    uint8_t* buffer = NULL;
+    size_t capacity = 0;
+    uint8_t* index = NULL;
+    char* temp_path = NULL;
+
+    /* ---------- Step 1 : Probe every file, order by date ---------- */
+
+    ArchiveInput* input = (ArchiveInput*)SGJW_Malloc((count ? count : 1) * sizeof(ArchiveInput), sizeof(void*));
+    if (!input)
+        return SGJW_ERROR_MALLOC_FAILED;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        StateGridJPEGProbe probe;
+        const char* name = filepaths[i] ? SGJW_File_Name(filepaths[i]) : NULL;
+        if (!name || State_Grid_JPEG_Probe(filepaths[i], &probe) != SGJW_SUCCESS)
+            continue;
+
+        ArchiveInput* item = &input[inputs++];
+        memset(item, 0, sizeof(ArchiveInput));
+        item->path = filepaths[i];
+        item->name = name;
+        item->input = i;
+        item->record.size = probe.file_size;
+        item->record.trailer_offset = (uint32_t)probe.trailer_offset;
+        item->record.version = probe.header.version;
+        item->record.width = probe.header.width;
+        item->record.height = probe.header.height;
+        memcpy(item->record.date, probe.header.date, SGJW_DATE_BYTES);
+        memcpy(item->record.sn, probe.header.sn, SGJW_SN_BYTES);
+    }
+    qsort(input, inputs, sizeof(ArchiveInput), Archive_Input_Compare);
+
+    /* ---------- Step 2 : Files back to back, each matrix on a cache line ---------- */
+
+    size_t temp_length = strlen(archive_path) + sizeof(SGJW_ARCHIVE_TEMP_SUFFIX);
+    temp_path = (char*)SGJW_Malloc(temp_length, sizeof(void*));
+    if (!temp_path)
+    {
+        retval = SGJW_ERROR_MALLOC_FAILED;
+        goto cleanup;
+    }
+    snprintf(temp_path, temp_length, "%s%s", archive_path, SGJW_ARCHIVE_TEMP_SUFFIX);
+
+    fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        retval = SGJW_ERROR_FILE_WRITE;
+        goto cleanup;
+    }
+
+    ArchiveHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SGJW_ARCHIVE_MAGIC, sizeof(SGJW_ARCHIVE_MAGIC));
+    header.version = SGJW_ARCHIVE_VERSION;
+    retval = SGJW_Pwrite_Full(fd, &header, sizeof(header), 0);
+
+    uint64_t cursor = sizeof(ArchiveHeader);
+    uint64_t names_size = 0;
+    size_t frames = 0;
+    for (size_t i = 0; i < inputs && retval == SGJW_SUCCESS; ++i)
+    {
+        ArchiveRecord* record = &input[i].record;
+
+        // Changed or gone since it was probed
+        if (Archive_Read_File(input[i].path, record->size, &buffer, &capacity) != SGJW_SUCCESS)
+            continue;
+
+        // The gap stays a hole, i.e. zeros
+        uint64_t matrix = record->trailer_offset + SGJW_HEADER_BYTES;
+        record->offset = Archive_Align(cursor + matrix) - matrix;
+        retval = SGJW_Pwrite_Full(fd, buffer, record->size, record->offset);
+
+        cursor = record->offset + record->size;
+        record->name_offset = names_size;
+        names_size += strlen(input[i].name) + 1;
+        input[frames++] = input[i];
+    }
+    if (retval != SGJW_SUCCESS)
+        goto cleanup;
+
+    /* ---------- Step 3 : Records, names and footer behind the files ---------- */
+
+    ArchiveFooter footer;
+    memset(&footer, 0, sizeof(footer));
+    footer.records = Archive_Align(cursor);
+    footer.names = footer.records + frames * sizeof(ArchiveRecord);
+    footer.names_size = names_size;
+    footer.size = footer.names + names_size + sizeof(ArchiveFooter);
+    footer.count = (uint32_t)frames;
+    footer.version = SGJW_ARCHIVE_VERSION;
+    memcpy(footer.magic, SGJW_ARCHIVE_MAGIC, sizeof(SGJW_ARCHIVE_MAGIC));
+
+    size_t index_size = footer.size - footer.records;
+    index = (uint8_t*)SGJW_Malloc(index_size, SGJW_CACHE_LINE);
+    if (!index)
+    {
+        retval = SGJW_ERROR_MALLOC_FAILED;
+        goto cleanup;
+    }
+
+    for (size_t i = 0; i < frames; ++i)
+    {
+        memcpy(index + i * sizeof(ArchiveRecord), &input[i].record, sizeof(ArchiveRecord));
+        strcpy((char*)index + (footer.names - footer.records) + input[i].record.name_offset, input[i].name);
+    }
+    memcpy(index + index_size - sizeof(ArchiveFooter), &footer, sizeof(ArchiveFooter));
+
+    retval = SGJW_Pwrite_Full(fd, index, index_size, footer.records);
+    if (retval == SGJW_SUCCESS && fsync(fd) != 0)
+        retval = SGJW_ERROR_FILE_WRITE;
+    close(fd);
+    fd = -1;
+
+    if (retval == SGJW_SUCCESS && rename(temp_path, archive_path) != 0)
+        retval = SGJW_ERROR_FILE_WRITE;
+    if (retval == SGJW_SUCCESS && packed)
+        *packed = frames;
+
+cleanup:
+    if (fd >= 0)
+        close(fd);
+    if (retval != SGJW_SUCCESS && temp_path)
+        unlink(temp_path);
+    SGJW_Free(temp_path);
+    SGJW_Free(index);
+    SGJW_Free(buffer);
+    SGJW_Free(input);
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Archive_Open(const char* archive_path, SGJWArchive* archive)
+{
+    if (!archive_path || !archive)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    memset(archive, 0, sizeof(SGJWArchive));
+
+    int fd = open(archive_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return SGJW_ERROR_FILE_NOT_FOUND;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(ArchiveHeader) + sizeof(ArchiveFooter))
+    {
+        close(fd);
+        return SGJW_ERROR_READ_FAILED;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return SGJW_ERROR_READ_FAILED;
+
+    archive->map_base = map;
+    archive->map_size = st.st_size;
+
+    /* ---------- Footer and index verification, no offset may point outside its section ---------- */
+
+    ArchiveFooter footer;
+    memcpy(&footer, (const uint8_t*)map + st.st_size - sizeof(ArchiveFooter), sizeof(ArchiveFooter));
+    const ArchiveHeader* header = (const ArchiveHeader*)map;
+
+    uint8_t valid = memcmp(header->magic, SGJW_ARCHIVE_MAGIC, sizeof(SGJW_ARCHIVE_MAGIC)) == 0 && header->version == SGJW_ARCHIVE_VERSION &&
+                    memcmp(footer.magic, SGJW_ARCHIVE_MAGIC, sizeof(SGJW_ARCHIVE_MAGIC)) == 0 && footer.version == SGJW_ARCHIVE_VERSION &&
+                    footer.size == (uint64_t)st.st_size && footer.records >= sizeof(ArchiveHeader) && footer.records % SGJW_CACHE_LINE == 0 &&
+                    footer.names == footer.records + (uint64_t)footer.count * sizeof(ArchiveRecord) &&
+                    footer.names + footer.names_size + sizeof(ArchiveFooter) == footer.size;
+
+    archive->records = (const uint8_t*)map + (valid ? footer.records : 0);
+    archive->names = (const char*)map + (valid ? footer.names : 0);
+    valid = valid && (footer.names_size == 0 || archive->names[footer.names_size - 1] == '\0');
+
+    for (uint32_t i = 0; i < footer.count && valid; ++i)
+    {
+        const ArchiveRecord* record = (const ArchiveRecord*)archive->records + i;
+        valid = record->offset >= sizeof(ArchiveHeader) && record->offset <= footer.records && record->size <= footer.records - record->offset &&
+                record->name_offset < footer.names_size;
+    }
+
+    if (!valid)
+    {
+        State_Grid_JPEG_Archive_Close(archive);
+        return SGJW_ERROR_READ_FAILED;
+    }
+
+    archive->count = footer.count;
+    return SGJW_SUCCESS;
+}
+
+int8_t State_Grid_JPEG_Archive_Get(const SGJWArchive* archive, uint32_t frame, SGJWArchiveEntry* entry)
+{
+    if (!archive || !archive->map_base || !entry || frame >= archive->count)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    const ArchiveRecord* record = Archive_Record(archive, frame);
+    memset(entry, 0, sizeof(SGJWArchiveEntry));
+    entry->name = archive->names + record->name_offset;
+    memcpy(entry->date, record->date, SGJW_DATE_BYTES);
+    memcpy(entry->sn, record->sn, SGJW_SN_BYTES);
+    entry->width = record->width;
+    entry->height = record->height;
+    entry->data = (const uint8_t*)archive->map_base + record->offset;
+    entry->size = record->size;
+    return SGJW_SUCCESS;
+}
+
+int8_t State_Grid_JPEG_Archive_View(const SGJWArchive* archive, uint32_t frame, StateGridJPEGView* view)
+{
+    if (!archive || !archive->map_base || !view || frame >= archive->count)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    memset(view, 0, sizeof(StateGridJPEGView));
+
+    const ArchiveRecord* record = Archive_Record(archive, frame);
+    uint8_t* data = (uint8_t*)archive->map_base + record->offset;
+    uint8_t fixed[SGJW_FIXED_BYTES];
+    uint64_t offset = 0;
+
+    if (record->size < SGJW_TAIL_BYTES)
+        return SGJW_ERROR_INVALID_EOF;
+
+    // Checked like a file, the frame is its own file
+    memcpy(fixed + SGJW_HEADER_BYTES + SGJW_FOOTER_BYTES, data + record->size - SGJW_TAIL_BYTES, SGJW_TAIL_BYTES);
+    int8_t retval = SGJW_Check_Tail(fixed, record->size, &offset);
+    if (retval == SGJW_SUCCESS)
+        retval = SGJW_View_Trailer(data, offset, record->size - SGJW_TAIL_BYTES, view);
+
+    if (retval != SGJW_SUCCESS)
+        State_Grid_JPEG_Unmap(view);
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Archive_Find(const SGJWArchive* archive, const char* date_from, const char* date_to, uint32_t* first, uint32_t* end)
+{
+    if (!archive || !first || !end)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    // A prefix widens to the first or last date it covers
+    char key[SGJW_DATE_BYTES];
+    *first = 0;
+    *end = archive->count;
+    if (date_from)
+    {
+        SGJW_Date_Key(date_from, '0', key);
+        *first = SGJW_Date_Bound(Archive_Record(archive, 0)->date, sizeof(ArchiveRecord), archive->count, key, 0);
+    }
+    if (date_to)
+    {
+        SGJW_Date_Key(date_to, '9', key);
+        *end = SGJW_Date_Bound(Archive_Record(archive, 0)->date, sizeof(ArchiveRecord), archive->count, key, 1);
+    }
+    if (*end < *first)
+        *end = *first;
+
+    return SGJW_SUCCESS;
+}
+
+int8_t State_Grid_JPEG_Archive_Unpack(const char* archive_path, const char* directory, size_t* unpacked)
+{
+    if (!archive_path || !directory)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    if (unpacked)
+        *unpacked = 0;
+
+    SGJWArchive archive;
+    int8_t retval = State_Grid_JPEG_Archive_Open(archive_path, &archive);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    int dirfd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd < 0)
+    {
+        State_Grid_JPEG_Archive_Close(&archive);
+        return SGJW_ERROR_FILE_NOT_FOUND;
+    }
+
+    for (uint32_t i = 0; i < archive.count && retval == SGJW_SUCCESS; ++i)
+    {
+        SGJWArchiveEntry entry;
+        retval = State_Grid_JPEG_Archive_Get(&archive, i, &entry);
+        if (retval != SGJW_SUCCESS)
+            break;
+
+        // Names come from the archive, never let one leave the folder
+        if (SGJW_File_Name(entry.name) != entry.name)
+        {
+            retval = SGJW_ERROR_READ_FAILED;
+            break;
+        }
+
+        int fd = openat(dirfd, entry.name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            retval = SGJW_ERROR_FILE_WRITE;
+            break;
+        }
+
+        retval = SGJW_Pwrite_Full(fd, entry.data, entry.size, 0);
+        if (close(fd) != 0 && retval == SGJW_SUCCESS)
+            retval = SGJW_ERROR_FILE_WRITE;
+        if (retval == SGJW_SUCCESS && unpacked)
+            ++*unpacked;
+    }
+
+    close(dirfd);
+    State_Grid_JPEG_Archive_Close(&archive);
+    return retval;
+}
+
+void State_Grid_JPEG_Archive_Close(SGJWArchive* archive)
+{
+    if (!archive)
+        return;
+
+    if (archive->map_base)
+        munmap(archive->map_base, archive->map_size);
+
+    memset(archive, 0, sizeof(SGJWArchive));
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+/**
+ * @file sgjw_archive.h
+ * @brief Single-file container of many SGJW captures, read through one mapping.
+ *
+ * @note Typical usage:
+ * 1. Invoke State_Grid_JPEG_Archive_Pack with the files to store, e.g. one day of a camera.
+ * 2. Invoke State_Grid_JPEG_Archive_Open to map the archive.
+ * 3. State_Grid_JPEG_Archive_Find gives the frames of a date range, State_Grid_JPEG_Archive_View a zero-copy
+ *    view of one frame, State_Grid_JPEG_Archive_Get its name and original bytes.
+ * 4. Call State_Grid_JPEG_Archive_Close to unmap it.
+ * State_Grid_JPEG_Archive_Unpack writes the original files back.
+ *
+ * Each file is stored verbatim, JPEG and trailer back to back, so unpacking gives the very same bytes.
+ * Files are ordered by date and each one is shifted by up to 63 bytes of padding so that its matrix
+ * starts on a 64-byte boundary of the archive, i.e. of the mapping: views hand out the matrix in place.
+ * A footer at the end locates the index, one record per frame with its offset, size and header fields,
+ * and the file names. The archive is written to a temporary name and renamed.
+ *
+ * Layout, little-endian: header | (padding | file) * count | records | names | footer.
+ */
+
+#include "sgjw.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One frame of an archive
+typedef struct
+{
+    // Name of the packed file, without its folder. @attention Borrowed from the mapping.
+    const char* name;
+    char date[SGJW_DATE_LENGTH + 1];
+    char sn[SGJW_TEXT_LENGTH + 1];
+    uint16_t width;
+    uint16_t height;
+    // The original file, JPEG and trailer. @attention Borrowed from the mapping.
+    const uint8_t* data;
+    uint64_t size;
+} SGJWArchiveEntry;
+
+// A mapped archive
+typedef struct
+{
+    // Number of frames, in date order.
+    uint32_t count;
+
+    // Private
+    void* map_base;
+    size_t map_size;
+    const void* records;
+    const char* names;
+} SGJWArchive;
+
+/**
+ * @brief Pack files into a new archive, replacing any archive at that path.
+ *
+ * @note Files that cannot be probed are skipped. Only the names are kept, so the file names must be distinct.
+ *
+ * @param archive_path The archive to write.
+ * @param filepaths The files to pack.
+ * @param count Number of files.
+ * @param packed Optional, receives the number of files packed.
+ * @return SGJW_ERROR_INVALID_PARAMS if two files share a name, SGJW_ERROR_FILE_WRITE if the archive cannot be written,
+ *         otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Archive_Pack(const char* archive_path, const char* const* filepaths, size_t count, size_t* packed);
+
+/**
+ * @brief Map an archive and verify its footer and index.
+ *
+ * @param archive_path The archive.
+ * @param archive Receives the mapping.
+ * @return SGJW_ERROR_READ_FAILED if it is not a valid archive, otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Archive_Open(const char* archive_path, SGJWArchive* archive);
+
+/**
+ * @brief Get the name, header fields and original bytes of a frame.
+ *
+ * @param archive The archive.
+ * @param frame Frame number, below archive->count.
+ * @param entry Receives the frame.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Archive_Get(const SGJWArchive* archive, uint32_t frame, SGJWArchiveEntry* entry);
+
+/**
+ * @brief Borrow the fields of a frame, as State_Grid_JPEG_Map does for a file.
+ *
+ * @note The view points into the archive mapping and is valid until State_Grid_JPEG_Archive_Close. Release it with
+ *       State_Grid_JPEG_Unmap, which only frees the matrix copy some hosts need.
+ *
+ * @param archive The archive.
+ * @param frame Frame number, below archive->count.
+ * @param view Receives the view.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Archive_View(const SGJWArchive* archive, uint32_t frame, StateGridJPEGView* view);
+
+/**
+ * @brief Find the frames of an inclusive date range, frames are in date order.
+ *
+ * @param archive The archive.
+ * @param date_from Date or date prefix (YYYYMMDDhhmmss), "2015" means from 20150000000000. NULL for an open end.
+ * @param date_to Date or date prefix, "2015" means up to 20159999999999. NULL for an open end.
+ * @param first Receives the first frame of the range.
+ * @param end Receives the frame behind the range, equal to first for an empty range.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Archive_Find(const SGJWArchive* archive, const char* date_from, const char* date_to, uint32_t* first, uint32_t* end);
+
+/**
+ * @brief Write every frame of an archive back to its original file in a folder.
+ *
+ * @param archive_path The archive.
+ * @param directory The folder, it must exist. Existing files of the same names are replaced.
+ * @param unpacked Optional, receives the number of files written.
+ * @return SGJW_ERROR_FILE_NOT_FOUND if the folder cannot be opened, otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Archive_Unpack(const char* archive_path, const char* directory, size_t* unpacked);
+
+/**
+ * @brief Unmap an archive, views and entries of it become invalid.
+ *
+ * @param archive The archive.
+ */
+void State_Grid_JPEG_Archive_Close(SGJWArchive* archive);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,927 @@
+#include "sgjw_batch.h"
+#include "sgjw_internal.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+// Queue depth of the io_uring backend when max_in_flight is 0
+#define SGJW_URING_DEFAULT_IN_FLIGHT 64
+
+/* ====================================================================================================== */
+/* ======================================== Helper Structures =========================================== */
+/* ====================================================================================================== */
+
+// One object of the memory budget, moves between the free list and the completion queue
+typedef struct BatchSlot
+{
+    StateGridJPEGV2 obj;
+    SGJWStats stats;
+    struct BatchSlot* next;
+    size_t index;
+    int8_t status;
+} BatchSlot;
+
+// Files [next, end) of the list still owned by one worker, on its own cache line
+typedef struct __attribute__((aligned(SGJW_CACHE_LINE)))
+{
+    pthread_mutex_t lock;
+    size_t next;
+    size_t end;
+} BatchRange;
+
+typedef struct
+{
+    const char* const* filepaths;
+    const SGJWBatchConfig* config;
+    BatchRange* ranges;
+    uint32_t workers;
+
+    // Guards the slot lists and stop
+    pthread_mutex_t lock;
+    pthread_cond_t slot_free;
+    pthread_cond_t slot_done;
+    BatchSlot* free_slots;
+    BatchSlot* done_head;
+    BatchSlot* done_tail;
+    uint8_t stop;
+} Batch;
+
+typedef struct
+{
+    Batch* batch;
+    uint32_t id;
+} BatchWorker;
+
+// Minimal io_uring, raw syscalls so liburing is not needed
+typedef struct
+{
+    int fd;
+    uint32_t sq_entries;
+    uint32_t sq_mask;
+    uint32_t* sq_head;
+    uint32_t* sq_tail;
+    uint32_t* sq_array;
+    struct io_uring_sqe* sqes;
+    uint32_t cq_mask;
+    uint32_t* cq_head;
+    uint32_t* cq_tail;
+    struct io_uring_cqe* cqes;
+    // SQEs prepared, and SQEs handed to the kernel
+    uint32_t sq_prepared;
+    uint32_t sq_submitted;
+    void* sq_map;
+    size_t sq_map_size;
+    void* cq_map;
+    size_t cq_map_size;
+    size_t sqes_size;
+} Uring;
+
+// Read stages of one file on the io_uring backend
+typedef enum
+{
+    URING_OPEN = 0,
+    URING_TAIL,
+    URING_HEADER,
+    URING_BODY
+} UringStage;
+
+// One file in flight, user_data of its SQEs is the slot address plus a tag in the low bits
+typedef struct __attribute__((aligned(SGJW_CACHE_LINE)))
+{
+    StateGridJPEGV2 obj;
+    SGJWStats stats;
+    struct statx stx;
+    // Header | footer | tail, as SGJW_Parse_Fixed wants them
+    uint8_t fixed[SGJW_FIXED_BYTES];
+    // Remaining destinations of the current read, advanced on short reads
+    struct iovec iov[3];
+    int iovcnt;
+    uint64_t read_offset;
+    uint64_t file_size;
+    uint64_t offset;
+    size_t index;
+    int fd;
+    UringStage stage;
+    uint8_t pending;
+    int8_t status;
+} UringSlot;
+
+// user_data tags of the two SQEs of URING_OPEN
+#define URING_TAG_OPEN 0
+#define URING_TAG_STATX 1
+
+/* ====================================================================================================== */
+/* ======================================== Helper Functions ============================================ */
+/* ====================================================================================================== */
+
+/**
+ * @brief Take the next file of a worker, stealing the upper half of another worker's range when its own is empty.
+ *
+ * @note A thief never holds two range locks at once, so workers stealing from each other cannot deadlock.
+ */
+static uint8_t Batch_Take(Batch* batch, uint32_t id, size_t* index)
+{
+    if (__atomic_load_n(&batch->stop, __ATOMIC_RELAXED))
+        return 0;
+
+    BatchRange* own = &batch->ranges[id];
+    pthread_mutex_lock(&own->lock);
+    uint8_t found = own->next < own->end;
+    if (found)
+        *index = own->next++;
+    pthread_mutex_unlock(&own->lock);
+
+    if (found)
+        return 1;
+
+    for (uint32_t i = 1; i < batch->workers; i++)
+    {
+        BatchRange* victim = &batch->ranges[(id + i) % batch->workers];
+
+        // A single remaining file is taken whole
+        pthread_mutex_lock(&victim->lock);
+        size_t begin = victim->next + (victim->end - victim->next) / 2;
+        size_t end = victim->end;
+        victim->end = begin;
+        pthread_mutex_unlock(&victim->lock);
+
+        if (begin < end)
+        {
+            *index = begin;
+            pthread_mutex_lock(&own->lock);
+            own->next = begin + 1;
+            own->end = end;
+            pthread_mutex_unlock(&own->lock);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void* Batch_Worker(void* arg)
+{
+    BatchWorker* worker = (BatchWorker*)arg;
+    Batch* batch = worker->batch;
+    const SGJWBatchConfig* config = batch->config;
+    size_t index = 0;
+
+    while (Batch_Take(batch, worker->id, &index))
+    {
+        /* ---------- Step 1 : Wait for the memory budget ---------- */
+
+        pthread_mutex_lock(&batch->lock);
+        while (!batch->free_slots && !batch->stop)
+            pthread_cond_wait(&batch->slot_free, &batch->lock);
+
+        BatchSlot* slot = batch->stop ? NULL : batch->free_slots;
+        if (slot)
+            batch->free_slots = slot->next;
+        pthread_mutex_unlock(&batch->lock);
+
+        if (!slot)
+            break;
+
+        /* ---------- Step 2 : Read into the slot, reusing its block ---------- */
+
+        slot->index = index;
+        slot->stats.histogram_low = config->histogram_low;
+        slot->stats.histogram_high = config->histogram_high;
+        slot->status = State_Grid_JPEG_Read_Stats(batch->filepaths[index], &slot->obj, config->flags, config->with_stats ? &slot->stats : NULL);
+
+        /* ---------- Step 3 : Hand over in completion order ---------- */
+
+        pthread_mutex_lock(&batch->lock);
+        slot->next = NULL;
+        if (batch->done_tail)
+            batch->done_tail->next = slot;
+        else
+            batch->done_head = slot;
+        batch->done_tail = slot;
+        pthread_cond_signal(&batch->slot_done);
+        pthread_mutex_unlock(&batch->lock);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Grow an SGJW_Malloc array to at least need elements, doubling its capacity.
+ */
+static int8_t Batch_Reserve(void** array, size_t* capacity, size_t used, size_t element_size, size_t need)
+{
+    if (need <= *capacity)
+        return SGJW_SUCCESS;
+
+    size_t new_capacity = *capacity ? *capacity : 64;
+    while (new_capacity < need)
+        new_capacity *= 2;
+
+    void* grown = SGJW_Malloc(new_capacity * element_size, sizeof(void*));
+    if (!grown)
+        return SGJW_ERROR_MALLOC_FAILED;
+
+    if (*array)
+        memcpy(grown, *array, used * element_size);
+    SGJW_Free(*array);
+    *array = grown;
+    *capacity = new_capacity;
+    return SGJW_SUCCESS;
+}
+
+/**
+ * @brief Thread backend: workers read into free slots, the calling thread delivers them.
+ */
+static int8_t Batch_Threads(const char* const* filepaths, size_t count, const SGJWBatchConfig* config, uint64_t* delivered, uint64_t* failed)
+{
+    /* ---------- Step 1 : Workers, budget and initial ranges ---------- */
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t workers = config->threads ? config->threads : (cpus > 0 ? (uint32_t)cpus : 1);
+    if (workers > count)
+        workers = count ? count : 1;
+    uint32_t max_in_flight = config->max_in_flight ? config->max_in_flight : 2 * workers;
+
+    Batch batch;
+    memset(&batch, 0, sizeof(Batch));
+    batch.filepaths = filepaths;
+    batch.config = config;
+    batch.workers = workers;
+
+    int8_t retval = SGJW_SUCCESS;
+    uint32_t started = 0;
+
+    BatchSlot* slots = (BatchSlot*)SGJW_Malloc(max_in_flight * sizeof(BatchSlot), SGJW_CACHE_LINE);
+    batch.ranges = (BatchRange*)SGJW_Malloc(workers * sizeof(BatchRange), SGJW_CACHE_LINE);
+    BatchWorker* args = (BatchWorker*)SGJW_Malloc(workers * sizeof(BatchWorker), sizeof(void*));
+    pthread_t* threads = (pthread_t*)SGJW_Malloc(workers * sizeof(pthread_t), sizeof(void*));
+    if (!slots || !batch.ranges || !args || !threads)
+    {
+        SGJW_Free(slots);
+        SGJW_Free(batch.ranges);
+        SGJW_Free(args);
+        SGJW_Free(threads);
+        return SGJW_ERROR_MALLOC_FAILED;
+    }
+
+    memset(slots, 0, max_in_flight * sizeof(BatchSlot));
+    for (uint32_t i = 0; i < max_in_flight; i++)
+    {
+        slots[i].next = batch.free_slots;
+        batch.free_slots = &slots[i];
+    }
+
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_cond_init(&batch.slot_free, NULL);
+    pthread_cond_init(&batch.slot_done, NULL);
+    for (uint32_t i = 0; i < workers; i++)
+    {
+        pthread_mutex_init(&batch.ranges[i].lock, NULL);
+        batch.ranges[i].next = count * i / workers;
+        batch.ranges[i].end = count * (i + 1) / workers;
+    }
+
+    // Ranges of workers that failed to start are stolen by the others
+    for (; started < workers; started++)
+    {
+        args[started].batch = &batch;
+        args[started].id = started;
+        if (pthread_create(&threads[started], NULL, Batch_Worker, &args[started]) != 0)
+            break;
+    }
+
+    if (started == 0 && count > 0)
+    {
+        retval = SGJW_ERROR_MALLOC_FAILED;
+        goto cleanup;
+    }
+
+    /* ---------- Step 2 : Deliver on the calling thread ---------- */
+
+    while (*delivered < count)
+    {
+        pthread_mutex_lock(&batch.lock);
+        while (!batch.done_head)
+            pthread_cond_wait(&batch.slot_done, &batch.lock);
+
+        BatchSlot* slot = batch.done_head;
+        batch.done_head = slot->next;
+        if (!batch.done_head)
+            batch.done_tail = NULL;
+        pthread_mutex_unlock(&batch.lock);
+
+        ++*delivered;
+        *failed += slot->status != SGJW_SUCCESS;
+        int stop = config->callback(filepaths[slot->index], slot->status, &slot->obj, config->with_stats ? &slot->stats : NULL, config->user);
+
+        pthread_mutex_lock(&batch.lock);
+        slot->next = batch.free_slots;
+        batch.free_slots = slot;
+        if (stop)
+        {
+            __atomic_store_n(&batch.stop, 1, __ATOMIC_RELAXED);
+            pthread_cond_broadcast(&batch.slot_free);
+        }
+        else
+        {
+            pthread_cond_signal(&batch.slot_free);
+        }
+        pthread_mutex_unlock(&batch.lock);
+
+        if (stop)
+            break;
+    }
+
+cleanup:
+    for (uint32_t i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    for (uint32_t i = 0; i < max_in_flight; i++)
+        State_Grid_JPEG_V2_Delete_OBJ(&slots[i].obj);
+    for (uint32_t i = 0; i < workers; i++)
+        pthread_mutex_destroy(&batch.ranges[i].lock);
+    pthread_mutex_destroy(&batch.lock);
+    pthread_cond_destroy(&batch.slot_free);
+    pthread_cond_destroy(&batch.slot_done);
+
+    SGJW_Free(slots);
+    SGJW_Free(batch.ranges);
+    SGJW_Free(args);
+    SGJW_Free(threads);
+    return retval;
+}
+
+/* ====================================================================================================== */
+/* ======================================== io_uring Backend ============================================ */
+/* ====================================================================================================== */
+
+static void Uring_Exit(Uring* ring)
+{
+    if (ring->sqes)
+        munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map && ring->cq_map != ring->sq_map)
+        munmap(ring->cq_map, ring->cq_map_size);
+    if (ring->sq_map)
+        munmap(ring->sq_map, ring->sq_map_size);
+    if (ring->fd >= 0)
+        close(ring->fd);
+    memset(ring, 0, sizeof(Uring));
+    ring->fd = -1;
+}
+
+/**
+ * @brief Check that the kernel knows every opcode the backend issues, io_uring itself may be older than them.
+ */
+static uint8_t Uring_Supports_Ops(int fd)
+{
+    // clang-format off
+    const uint8_t ops[] = { IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READV };
+    // clang-format on
+
+    size_t probe_size = sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = (struct io_uring_probe*)SGJW_Malloc(probe_size, sizeof(void*));
+    if (!probe)
+        return 0;
+
+    memset(probe, 0, probe_size);
+    uint8_t supported = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0;
+    for (size_t i = 0; i < sizeof(ops) && supported; i++)
+        supported = ops[i] <= probe->last_op && (probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED);
+
+    SGJW_Free(probe);
+    return supported;
+}
+
+static int8_t Uring_Init(Uring* ring, uint32_t entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(Uring));
+
+    ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0 || !Uring_Supports_Ops(ring->fd))
+        goto fail;
+
+    /* ---------- Step 1 : Map submission ring, completion ring and SQE array ---------- */
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cq_map_size > ring->sq_map_size)
+            ring->sq_map_size = ring->cq_map_size;
+        ring->cq_map_size = ring->sq_map_size;
+    }
+
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED)
+    {
+        ring->sq_map = NULL;
+        goto fail;
+    }
+
+    ring->cq_map = ring->sq_map;
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_map == MAP_FAILED)
+        {
+            ring->cq_map = NULL;
+            goto fail;
+        }
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        ring->sqes = NULL;
+        goto fail;
+    }
+
+    /* ---------- Step 2 : Ring pointers, the SQ index array is the identity ---------- */
+
+    ring->sq_entries = params.sq_entries;
+    ring->sq_mask = *(uint32_t*)((uint8_t*)ring->sq_map + params.sq_off.ring_mask);
+    ring->sq_head = (uint32_t*)((uint8_t*)ring->sq_map + params.sq_off.head);
+    ring->sq_tail = (uint32_t*)((uint8_t*)ring->sq_map + params.sq_off.tail);
+    ring->sq_array = (uint32_t*)((uint8_t*)ring->sq_map + params.sq_off.array);
+    ring->cq_mask = *(uint32_t*)((uint8_t*)ring->cq_map + params.cq_off.ring_mask);
+    ring->cq_head = (uint32_t*)((uint8_t*)ring->cq_map + params.cq_off.head);
+    ring->cq_tail = (uint32_t*)((uint8_t*)ring->cq_map + params.cq_off.tail);
+    ring->cqes = (struct io_uring_cqe*)((uint8_t*)ring->cq_map + params.cq_off.cqes);
+
+    for (uint32_t i = 0; i < ring->sq_entries; i++)
+        ring->sq_array[i] = i;
+    ring->sq_prepared = ring->sq_submitted = *ring->sq_tail;
+
+    return SGJW_SUCCESS;
+
+fail:
+    Uring_Exit(ring);
+    return SGJW_ERROR_READ_FAILED;
+}
+
+/**
+ * @brief Get a zeroed SQE, the ring is sized so that every slot can always queue its SQEs.
+ */
+static struct io_uring_sqe* Uring_Get_SQE(Uring* ring, void* slot, uint64_t tag)
+{
+    struct io_uring_sqe* sqe = &ring->sqes[ring->sq_prepared & ring->sq_mask];
+    ring->sq_prepared++;
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->user_data = (uint64_t)(uintptr_t)slot | tag;
+    return sqe;
+}
+
+/**
+ * @brief Hand the prepared SQEs to the kernel and wait until at least one completion is ready.
+ */
+static int8_t Uring_Submit_And_Wait(Uring* ring)
+{
+    __atomic_store_n(ring->sq_tail, ring->sq_prepared, __ATOMIC_RELEASE);
+
+    for (;;)
+    {
+        uint32_t to_submit = ring->sq_prepared - ring->sq_submitted;
+        long ret = syscall(__NR_io_uring_enter, ring->fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret >= 0)
+        {
+            ring->sq_submitted += ret;
+            if (ring->sq_submitted == ring->sq_prepared)
+                return SGJW_SUCCESS;
+            continue;
+        }
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            return SGJW_ERROR_READ_FAILED;
+    }
+}
+
+/**
+ * @brief Reap the completions of in_kernel SQEs without submitting more, after Uring_Submit_And_Wait failed.
+ *
+ * @note Files opened meanwhile get their fd recorded in the slot, so the caller can close it.
+ * @return 0 if the ring cannot be waited on, the SQEs may then still own their buffers.
+ */
+static uint8_t Uring_Drain(Uring* ring, uint32_t in_kernel)
+{
+    while (in_kernel > 0)
+    {
+        long ret = syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            return 0;
+
+        uint32_t head = *ring->cq_head;
+        uint32_t tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail && in_kernel > 0; head++, in_kernel--)
+        {
+            struct io_uring_cqe* cqe = &ring->cqes[head & ring->cq_mask];
+            UringSlot* slot = (UringSlot*)(uintptr_t)(cqe->user_data & ~(uint64_t)(SGJW_CACHE_LINE - 1));
+            if (slot->stage == URING_OPEN && (cqe->user_data & (SGJW_CACHE_LINE - 1)) == URING_TAG_OPEN && cqe->res >= 0)
+                slot->fd = cqe->res;
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+    return 1;
+}
+
+static void Uring_Queue_Read(Uring* ring, UringSlot* slot)
+{
+    struct io_uring_sqe* sqe = Uring_Get_SQE(ring, slot, 0);
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = slot->fd;
+    sqe->addr = (uint64_t)(uintptr_t)slot->iov;
+    sqe->len = slot->iovcnt;
+    sqe->off = slot->read_offset;
+}
+
+static void Uring_Start(Uring* ring, UringSlot* slot, const char* filepath, size_t index)
+{
+    slot->index = index;
+    slot->fd = -1;
+    slot->stage = URING_OPEN;
+    slot->status = SGJW_SUCCESS;
+    slot->pending = 2;
+
+    // Open and size the file in parallel, both by path
+    struct io_uring_sqe* sqe = Uring_Get_SQE(ring, slot, URING_TAG_OPEN);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)filepath;
+    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+
+    sqe = Uring_Get_SQE(ring, slot, URING_TAG_STATX);
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)filepath;
+    sqe->len = STATX_SIZE;
+    sqe->off = (uint64_t)(uintptr_t)&slot->stx;
+}
+
+/**
+ * @brief Consume the result of a READV, returns 1 while bytes are left to read.
+ */
+static int8_t Uring_Consume(UringSlot* slot, int32_t res, uint8_t* pending)
+{
+    if (res == -EINTR || res == -EAGAIN)
+    {
+        *pending = 1;
+        return SGJW_SUCCESS;
+    }
+    if (res <= 0)
+        return SGJW_ERROR_READ_FAILED;
+
+    SGJW_Count_Bytes_Read(res);
+    slot->read_offset += res;
+
+    size_t consumed = res;
+    while (slot->iovcnt > 0 && consumed >= slot->iov[0].iov_len)
+    {
+        consumed -= slot->iov[0].iov_len;
+        memmove(slot->iov, slot->iov + 1, (slot->iovcnt - 1) * sizeof(struct iovec));
+        slot->iovcnt--;
+    }
+    if (slot->iovcnt > 0)
+    {
+        slot->iov[0].iov_base = (uint8_t*)slot->iov[0].iov_base + consumed;
+        slot->iov[0].iov_len -= consumed;
+    }
+
+    *pending = slot->iovcnt > 0;
+    return SGJW_SUCCESS;
+}
+
+/**
+ * @brief Reserve the block from the header and read matrix, footer and appendix with one READV.
+ *
+ * @note The appendix length follows from the file size, the footer confirms it once parsed.
+ */
+static int8_t Uring_Plan_Body(UringSlot* slot)
+{
+    size_t matrix_size = 0;
+    int8_t retval = SGJW_Check_Header(slot->fixed, slot->file_size, slot->offset, &matrix_size);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    uint64_t appendix_space = slot->file_size - SGJW_TAIL_BYTES - slot->offset - SGJW_HEADER_BYTES - matrix_size - SGJW_FOOTER_BYTES;
+    if (appendix_space > UINT32_MAX)
+        return SGJW_ERROR_FIELD_READ_FAILED;
+
+    uint16_t width = slot->fixed[SGJW_VERSION_BYTES] | slot->fixed[SGJW_VERSION_BYTES + 1] << 8;
+    uint16_t height = slot->fixed[SGJW_VERSION_BYTES + SGJW_WIDTH_BYTES] | slot->fixed[SGJW_VERSION_BYTES + SGJW_WIDTH_BYTES + 1] << 8;
+    retval = State_Grid_JPEG_V2_Resize(&slot->obj, width, height, (uint32_t)appendix_space);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    slot->iovcnt = 0;
+    if (matrix_size > 0)
+        slot->iov[slot->iovcnt++] = (struct iovec){slot->obj.matrix, matrix_size};
+    slot->iov[slot->iovcnt++] = (struct iovec){slot->fixed + SGJW_HEADER_BYTES, SGJW_FOOTER_BYTES};
+    if (appendix_space > 0)
+        slot->iov[slot->iovcnt++] = (struct iovec){slot->obj.appendix, appendix_space};
+    slot->read_offset = slot->offset + SGJW_HEADER_BYTES;
+
+    return SGJW_SUCCESS;
+}
+
+/**
+ * @brief Parse the fixed fields with the field table, then decode and fold the matrix like State_Grid_JPEG_Read_Stats.
+ */
+static int8_t Uring_Finish_Body(UringSlot* slot, const SGJWBatchConfig* config)
+{
+    StateGridJPEGProbe ranges;
+    StateGridJPEGV2* obj = &slot->obj;
+
+    int8_t retval = SGJW_Parse_Fixed(slot->fixed, slot->file_size, slot->offset, obj, &ranges);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    // The footer may claim less appendix than the space before the tail
+    if (obj->appendix_length == 0)
+        obj->appendix = NULL;
+    else
+        obj->appendix[obj->appendix_length] = '\0';
+
+    size_t count = (size_t)obj->width * obj->height;
+    State_Grid_JPEG_Matrix_Decode((uint8_t*)obj->matrix, count, obj->matrix);
+
+    if (config->with_stats)
+    {
+        slot->stats.histogram_low = config->histogram_low;
+        slot->stats.histogram_high = config->histogram_high;
+        State_Grid_JPEG_Matrix_Stats(obj->matrix, obj->width, obj->height, &slot->stats, SGJW_KERNEL_AUTO);
+    }
+    if (config->flags & SGJW_READ_STATS_ONLY)
+        obj->matrix = NULL;
+
+    return SGJW_SUCCESS;
+}
+
+/**
+ * @brief Advance one file by one completion, returns 1 once the file is finished (slot->status is final).
+ */
+static uint8_t Uring_Step(Uring* ring, UringSlot* slot, uint64_t tag, int32_t res, const SGJWBatchConfig* config)
+{
+    uint8_t pending = 0;
+
+    /* ---------- Step 1 : Open and size, both must land ---------- */
+
+    if (slot->stage == URING_OPEN)
+    {
+        if (tag == URING_TAG_OPEN && res >= 0)
+            slot->fd = res;
+        else if (tag == URING_TAG_STATX && res >= 0)
+            slot->file_size = slot->stx.stx_size;
+        else
+            slot->status = SGJW_ERROR_FILE_NOT_FOUND;
+
+        if (--slot->pending > 0)
+            return 0;
+        if (slot->status != SGJW_SUCCESS)
+            goto finish;
+
+        if (slot->file_size < SGJW_TAIL_BYTES)
+        {
+            slot->status = SGJW_ERROR_INVALID_EOF;
+            goto finish;
+        }
+
+        slot->stage = URING_TAIL;
+        slot->iov[0] = (struct iovec){slot->fixed + SGJW_HEADER_BYTES + SGJW_FOOTER_BYTES, SGJW_TAIL_BYTES};
+        slot->iovcnt = 1;
+        slot->read_offset = slot->file_size - SGJW_TAIL_BYTES;
+        Uring_Queue_Read(ring, slot);
+        return 0;
+    }
+
+    /* ---------- Step 2 : Reads, resubmitted until complete ---------- */
+
+    slot->status = Uring_Consume(slot, res, &pending);
+    if (slot->status != SGJW_SUCCESS)
+        goto finish;
+    if (pending)
+    {
+        Uring_Queue_Read(ring, slot);
+        return 0;
+    }
+
+    switch (slot->stage)
+    {
+        case URING_TAIL:
+            slot->status = SGJW_Check_Tail(slot->fixed, slot->file_size, &slot->offset);
+            if (slot->status != SGJW_SUCCESS)
+                goto finish;
+
+            slot->stage = URING_HEADER;
+            slot->iov[0] = (struct iovec){slot->fixed, SGJW_HEADER_BYTES};
+            slot->iovcnt = 1;
+            slot->read_offset = slot->offset;
+            Uring_Queue_Read(ring, slot);
+            return 0;
+
+        case URING_HEADER:
+            slot->status = Uring_Plan_Body(slot);
+            if (slot->status != SGJW_SUCCESS)
+                goto finish;
+
+            slot->stage = URING_BODY;
+            Uring_Queue_Read(ring, slot);
+            return 0;
+
+        default:
+            slot->status = Uring_Finish_Body(slot, config);
+            break;
+    }
+
+finish:
+    if (slot->fd >= 0)
+        close(slot->fd);
+    slot->fd = -1;
+    return 1;
+}
+
+/**
+ * @brief io_uring backend: every slot walks open -> tail -> header -> body, the calling thread drives them all.
+ */
+static int8_t Batch_Uring(Uring* ring, const char* const* filepaths, size_t count, const SGJWBatchConfig* config, uint32_t max_in_flight,
+                          uint64_t* delivered, uint64_t* failed)
+{
+    UringSlot* slots = (UringSlot*)SGJW_Malloc(max_in_flight * sizeof(UringSlot), SGJW_CACHE_LINE);
+    if (!slots)
+        return SGJW_ERROR_MALLOC_FAILED;
+    memset(slots, 0, max_in_flight * sizeof(UringSlot));
+    for (uint32_t i = 0; i < max_in_flight; i++)
+        slots[i].fd = -1;
+
+    int8_t retval = SGJW_SUCCESS;
+    size_t next = 0;
+    uint32_t active = 0;
+    uint8_t stop = 0;
+    // SQEs taken by the kernel minus their completions reaped
+    uint32_t first_submitted = ring->sq_submitted;
+    uint32_t reaped = 0;
+
+    for (; active < max_in_flight && next < count; active++, next++)
+        Uring_Start(ring, &slots[active], filepaths[next], next);
+
+    // Buffers belong to the kernel until their completion, so even a stopped batch drains every slot
+    while (active > 0)
+    {
+        retval = Uring_Submit_And_Wait(ring);
+        if (retval != SGJW_SUCCESS)
+            break;
+
+        uint32_t head = *ring->cq_head;
+        uint32_t tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++, reaped++)
+        {
+            struct io_uring_cqe* cqe = &ring->cqes[head & ring->cq_mask];
+            UringSlot* slot = (UringSlot*)(uintptr_t)(cqe->user_data & ~(uint64_t)(SGJW_CACHE_LINE - 1));
+            if (!Uring_Step(ring, slot, cqe->user_data & (SGJW_CACHE_LINE - 1), cqe->res, config))
+                continue;
+
+            if (!stop)
+            {
+                ++*delivered;
+                *failed += slot->status != SGJW_SUCCESS;
+                stop = config->callback(filepaths[slot->index], slot->status, &slot->obj, config->with_stats ? &slot->stats : NULL, config->user) != 0;
+            }
+
+            if (!stop && next < count)
+            {
+                Uring_Start(ring, slot, filepaths[next], next);
+                next++;
+            }
+            else
+            {
+                active--;
+            }
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    // A failed submit leaves SQEs in flight, better leak the slots than free them under the kernel
+    if (retval != SGJW_SUCCESS && !Uring_Drain(ring, ring->sq_submitted - first_submitted - reaped))
+        return retval;
+
+    for (uint32_t i = 0; i < max_in_flight; i++)
+    {
+        if (slots[i].fd >= 0)
+            close(slots[i].fd);
+        State_Grid_JPEG_V2_Delete_OBJ(&slots[i].obj);
+    }
+    SGJW_Free(slots);
+    return retval;
+}
+
+/* ====================================================================================================== */
+/* ========================================== Main APIs ================================================= */
+/* ====================================================================================================== */
+
+int8_t State_Grid_JPEG_Batch_Read(const char* const* filepaths, size_t count, const SGJWBatchConfig* config, SGJWBatchReport* report)
+{
+    if ((!filepaths && count > 0) || !config || !config->callback)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    uint64_t bytes_before = State_Grid_JPEG_Get_Bytes_Read();
+    uint64_t start = SGJW_Now_Ns();
+    uint64_t delivered = 0;
+    uint64_t failed = 0;
+    int8_t retval = SGJW_SUCCESS;
+
+    // Every file holds at most two SQEs at once (open + statx)
+    Uring ring;
+    uint32_t max_in_flight = config->max_in_flight ? config->max_in_flight : SGJW_URING_DEFAULT_IN_FLIGHT;
+    if (config->backend != SGJW_BATCH_THREADS && Uring_Init(&ring, 2 * max_in_flight) == SGJW_SUCCESS)
+    {
+        retval = Batch_Uring(&ring, filepaths, count, config, max_in_flight, &delivered, &failed);
+        Uring_Exit(&ring);
+    }
+    else if (config->backend == SGJW_BATCH_URING)
+    {
+        return SGJW_ERROR_READ_FAILED;
+    }
+    else
+    {
+        retval = Batch_Threads(filepaths, count, config, &delivered, &failed);
+    }
+
+    if (report)
+    {
+        report->files = delivered;
+        report->failed = failed;
+        report->bytes = State_Grid_JPEG_Get_Bytes_Read() - bytes_before;
+        report->seconds = (SGJW_Now_Ns() - start) / 1e9;
+    }
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Batch_Read_Dir(const char* dirpath, const SGJWBatchConfig* config, SGJWBatchReport* report)
+{
+    if (!dirpath || !config)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    DIR* dir = opendir(dirpath);
+    if (!dir)
+        return SGJW_ERROR_FILE_NOT_FOUND;
+
+    /* ---------- Step 1 : Collect paths into one buffer, as offsets since the buffer moves ---------- */
+
+    char* names = NULL;
+    size_t names_size = 0;
+    size_t names_capacity = 0;
+    size_t* offsets = NULL;
+    size_t count = 0;
+    size_t offsets_capacity = 0;
+    const char** filepaths = NULL;
+    size_t dir_length = strlen(dirpath);
+    int8_t retval = SGJW_SUCCESS;
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (!SGJW_Is_JPEG_Name(entry->d_name))
+            continue;
+
+        size_t length = dir_length + 1 + strlen(entry->d_name) + 1;
+        retval = Batch_Reserve((void**)&names, &names_capacity, names_size, 1, names_size + length);
+        if (retval == SGJW_SUCCESS)
+            retval = Batch_Reserve((void**)&offsets, &offsets_capacity, count, sizeof(size_t), count + 1);
+        if (retval != SGJW_SUCCESS)
+            goto cleanup;
+
+        snprintf(names + names_size, length, "%s/%s", dirpath, entry->d_name);
+        offsets[count++] = names_size;
+        names_size += length;
+    }
+
+    /* ---------- Step 2 : Read them ---------- */
+
+    filepaths = (const char**)SGJW_Malloc((count ? count : 1) * sizeof(char*), sizeof(void*));
+    if (!filepaths)
+    {
+        retval = SGJW_ERROR_MALLOC_FAILED;
+        goto cleanup;
+    }
+
+    for (size_t i = 0; i < count; i++)
+        filepaths[i] = names + offsets[i];
+
+    retval = State_Grid_JPEG_Batch_Read(filepaths, count, config, report);
+
+cleanup:
+    closedir(dir);
+    SGJW_Free(filepaths);
+    SGJW_Free(offsets);
+    SGJW_Free(names);
+    return retval;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+/**
+ * @file sgjw_batch.h
+ * @brief Parallel batch reading of many SGJW files.
+ *
+ * @note Typical usage:
+ * 1. Fill an SGJWBatchConfig, at least the callback.
+ * 2. Invoke State_Grid_JPEG_Batch_Read with a file list, or State_Grid_JPEG_Batch_Read_Dir with a folder.
+ * 3. The callback receives every parsed object on the calling thread, in the order the reads complete.
+ *    The object is only valid during the callback, copy what has to outlive it.
+ *
+ * With the io_uring backend the calling thread keeps max_in_flight files in flight: open, size, tail, header
+ * and matrix reads of all of them are queued together, so many small reads overlap instead of waiting on
+ * each other. Without io_uring (old kernel, blocked by seccomp) reads run on a pool of worker threads.
+ * Each worker owns a range of the file list and steals half of another worker's remaining range when its
+ * own runs dry. Either way at most max_in_flight objects exist at once, their blocks are reused from file
+ * to file, so memory stays bounded whatever the number of files.
+ */
+
+#include "sgjw.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Receives one file of a batch.
+ *
+ * @param filepath The path of the file.
+ * @param status The SGJW_ERROR code of its read, obj is only meaningful on SGJW_SUCCESS.
+ * @param obj The parsed object, owned by the batch and reused once the callback returns.
+ * @param stats Statistics gathered while the matrix was decoded, NULL unless SGJWBatchConfig::with_stats is set.
+ * @param user SGJWBatchConfig::user.
+ * @return 0 to continue, anything else to stop the batch. Reads already running are dropped.
+ */
+typedef int (*SGJWBatchCallback)(const char* filepath, int8_t status, const StateGridJPEGV2* obj, const SGJWStats* stats, void* user);
+
+// Batch backends
+typedef enum
+{
+    // io_uring when the kernel supports it, worker threads otherwise.
+    SGJW_BATCH_AUTO = 0,
+    SGJW_BATCH_THREADS,
+    // Fails with SGJW_ERROR_READ_FAILED when io_uring is unavailable.
+    SGJW_BATCH_URING
+} SGJW_BATCH_BACKEND;
+
+typedef struct
+{
+    SGJW_BATCH_BACKEND backend;
+    // Worker threads of the thread backend, 0 for one per online CPU.
+    uint32_t threads;
+    // Objects alive at once, i.e. the memory budget in matrices and the io_uring queue depth in files.
+    // 0 for twice the number of threads, or 64 with io_uring.
+    uint32_t max_in_flight;
+    // A combination of SGJW_READ_FLAGS, passed to State_Grid_JPEG_Read_Stats.
+    uint32_t flags;
+    // Gather SGJWStats while each matrix is decoded, see State_Grid_JPEG_Read_Stats.
+    // io_uring reads the whole matrix and folds it afterwards, SGJW_READ_STATS_ONLY then only hides it.
+    uint8_t with_stats;
+    // Histogram range of the statistics.
+    float histogram_low;
+    float histogram_high;
+    SGJWBatchCallback callback;
+    void* user;
+} SGJWBatchConfig;
+
+typedef struct
+{
+    // Files delivered to the callback.
+    uint64_t files;
+    // Files whose read failed.
+    uint64_t failed;
+    // Bytes read from disk.
+    uint64_t bytes;
+    // Wall time of the whole batch.
+    double seconds;
+} SGJWBatchReport;
+
+/**
+ * @brief Read a list of files in parallel.
+ *
+ * @param filepaths The files to read.
+ * @param count Number of files.
+ * @param config The batch configuration, callback is required.
+ * @param report Optional, receives counters and wall time.
+ * @return SGJW_SUCCESS once every file was delivered or the callback stopped the batch, otherwise an SGJW_ERROR
+ *         code for the batch itself (a failed file is reported to the callback instead).
+ */
+int8_t State_Grid_JPEG_Batch_Read(const char* const* filepaths, size_t count, const SGJWBatchConfig* config, SGJWBatchReport* report);
+
+/**
+ * @brief Read every .jpg / .jpeg file of a folder in parallel, not recursive.
+ *
+ * @param dirpath The folder to read.
+ * @param config The batch configuration, callback is required.
+ * @param report Optional, receives counters and wall time.
+ * @return SGJW_ERROR_FILE_NOT_FOUND if the folder cannot be opened, otherwise as State_Grid_JPEG_Batch_Read.
+ */
+int8_t State_Grid_JPEG_Batch_Read_Dir(const char* dirpath, const SGJWBatchConfig* config, SGJWBatchReport* report);
+
+#ifdef __cplusplus
+}
+#endif
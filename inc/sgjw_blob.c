@@ -0,0 +1,544 @@
+#include "sgjw_blob.h"
+#include "sgjw_internal.h"
+
+#include <string.h>
+
+/* ====================================================================================================== */
+/* ======================================== Helper Structures =========================================== */
+/* ====================================================================================================== */
+
+// Hot pixels [x0, x1) of a row and the label they belong to
+typedef struct
+{
+    uint16_t x0;
+    uint16_t x1;
+    uint32_t label;
+} BlobRun;
+
+// A union-find node, the statistics are only meaningful on roots
+typedef struct
+{
+    uint32_t parent;
+    // Row + 1 the label was last seen in, so every label is released once per row
+    uint32_t seen;
+    uint32_t area;
+    float peak;
+    uint16_t peak_x;
+    uint16_t peak_y;
+    uint16_t left;
+    uint16_t top;
+    uint16_t right;
+    uint16_t bottom;
+    double sum;
+    double sum_x;
+    double sum_y;
+} BlobLabel;
+
+// Columns [a, b) of a row that are searched
+typedef struct
+{
+    uint16_t a;
+    uint16_t b;
+} BlobInterval;
+
+// The workspace carved for one width and ROI count
+typedef struct
+{
+    BlobRun* prev;
+    BlobRun* cur;
+    BlobLabel* labels;
+    uint32_t* free_labels;
+    uint32_t* candidates;
+    uint64_t* bits;
+    BlobInterval* intervals;
+    uint32_t free_count;
+} BlobScratch;
+
+// Where results go
+typedef struct
+{
+    SGJWBlob* blobs;
+    size_t capacity;
+    size_t found;
+    uint32_t min_area;
+} BlobOutput;
+
+/* ====================================================================================================== */
+/* ======================================== Threshold Kernels =========================================== */
+/* ====================================================================================================== */
+
+// Set bit i of bits where src[i] >= threshold, ceil(count / 64) words are written, bits past count are 0
+typedef void (*Threshold_Kernel)(const float* src, size_t count, float threshold, uint64_t* bits);
+
+// Reference kernel, every SIMD kernel must give the same bits
+static void Threshold_Scalar(const float* src, size_t count, float threshold, uint64_t* bits)
+{
+    for (size_t i = 0; i < count; i += 64)
+    {
+        size_t n = count - i < 64 ? count - i : 64;
+        uint64_t word = 0;
+        for (size_t j = 0; j < n; ++j)
+            word |= (uint64_t)(src[i + j] >= threshold) << j;
+        bits[i / 64] = word;
+    }
+}
+
+#if SGJW_HAVE_X86
+static void Threshold_SSE2(const float* src, size_t count, float threshold, uint64_t* bits)
+{
+    const __m128 t = _mm_set1_ps(threshold);
+
+    size_t i = 0;
+    for (; i + 64 <= count; i += 64)
+    {
+        uint64_t word = 0;
+        for (size_t j = 0; j < 64; j += 4)
+            word |= (uint64_t)_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(src + i + j), t)) << j;
+        bits[i / 64] = word;
+    }
+    Threshold_Scalar(src + i, count - i, threshold, bits + i / 64);
+}
+
+__attribute__((target("avx2"))) static void Threshold_AVX2(const float* src, size_t count, float threshold, uint64_t* bits)
+{
+    const __m256 t = _mm256_set1_ps(threshold);
+
+    size_t i = 0;
+    for (; i + 64 <= count; i += 64)
+    {
+        uint64_t word = 0;
+        for (size_t j = 0; j < 64; j += 8)
+            word |= (uint64_t)_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(src + i + j), t, _CMP_GE_OQ)) << j;
+        bits[i / 64] = word;
+    }
+    Threshold_Scalar(src + i, count - i, threshold, bits + i / 64);
+}
+#endif
+
+#if SGJW_HAVE_NEON && defined(__aarch64__)
+static void Threshold_NEON(const float* src, size_t count, float threshold, uint64_t* bits)
+{
+    const float32x4_t t = vdupq_n_f32(threshold);
+    const uint32_t weights[4] = {1, 2, 4, 8};
+    const uint32x4_t weight = vld1q_u32(weights);
+
+    size_t i = 0;
+    for (; i + 64 <= count; i += 64)
+    {
+        uint64_t word = 0;
+        for (size_t j = 0; j < 64; j += 4)
+            word |= (uint64_t)vaddvq_u32(vandq_u32(vcgeq_f32(vld1q_f32(src + i + j), t), weight)) << j;
+        bits[i / 64] = word;
+    }
+    Threshold_Scalar(src + i, count - i, threshold, bits + i / 64);
+}
+#endif
+
+static Threshold_Kernel Threshold_Get_Kernel(SGJW_KERNEL kernel)
+{
+    switch (kernel)
+    {
+        case SGJW_KERNEL_AUTO:
+            return Threshold_Get_Kernel(State_Grid_JPEG_Matrix_Kernel());
+        case SGJW_KERNEL_SCALAR:
+            return Threshold_Scalar;
+#if SGJW_HAVE_X86
+        case SGJW_KERNEL_SSE2:
+            return Threshold_SSE2;
+        case SGJW_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2") ? Threshold_AVX2 : NULL;
+#endif
+#if SGJW_HAVE_NEON
+        case SGJW_KERNEL_NEON:
+#if defined(__aarch64__)
+            return Threshold_NEON;
+#else
+            // No horizontal add on 32-bit NEON
+            return Threshold_Scalar;
+#endif
+#endif
+        default:
+            return NULL;
+    }
+}
+
+/* ====================================================================================================== */
+/* ======================================== Helper Functions ============================================ */
+/* ====================================================================================================== */
+
+// Runs per row at most: every run but the last is followed by a cold pixel
+static size_t Blob_Max_Runs(uint16_t width)
+{
+    return (size_t)width / 2 + 1;
+}
+
+/**
+ * @brief Size the scratch for a width and ROI count, and carve it out of the workspace, growing it if needed.
+ */
+static int8_t Blob_Scratch(SGJWBlobWorkspace* workspace, uint16_t width, size_t roi_count, BlobScratch* scratch)
+{
+    size_t runs = Blob_Max_Runs(width);
+    size_t labels = runs * 2;
+    size_t words = ((size_t)width + 63) / 64;
+
+    // Largest alignment first, so every array stays aligned
+    size_t size = labels * sizeof(BlobLabel) + words * sizeof(uint64_t) + runs * 2 * sizeof(BlobRun) + labels * sizeof(uint32_t) * 2 +
+                  (roi_count + 1) * sizeof(BlobInterval);
+
+    if (size > workspace->capacity)
+    {
+        void* block = SGJW_Malloc(size, SGJW_CACHE_LINE);
+        if (!block)
+            return SGJW_ERROR_MALLOC_FAILED;
+
+        SGJW_Free(workspace->block);
+        workspace->block = block;
+        workspace->capacity = size;
+    }
+
+    uint8_t* cursor = (uint8_t*)workspace->block;
+    scratch->labels = (BlobLabel*)cursor;
+    cursor += labels * sizeof(BlobLabel);
+    scratch->bits = (uint64_t*)cursor;
+    cursor += words * sizeof(uint64_t);
+    scratch->prev = (BlobRun*)cursor;
+    cursor += runs * sizeof(BlobRun);
+    scratch->cur = (BlobRun*)cursor;
+    cursor += runs * sizeof(BlobRun);
+    scratch->free_labels = (uint32_t*)cursor;
+    cursor += labels * sizeof(uint32_t);
+    scratch->candidates = (uint32_t*)cursor;
+    cursor += labels * sizeof(uint32_t);
+    scratch->intervals = (BlobInterval*)cursor;
+
+    // Pop order gives the low labels first
+    for (size_t i = 0; i < labels; ++i)
+        scratch->free_labels[i] = (uint32_t)(labels - 1 - i);
+    scratch->free_count = (uint32_t)labels;
+    return SGJW_SUCCESS;
+}
+
+static uint32_t Blob_Find(BlobLabel* labels, uint32_t label)
+{
+    uint32_t root = label;
+    while (labels[root].parent != root)
+        root = labels[root].parent;
+
+    // Path compression
+    while (labels[label].parent != root)
+    {
+        uint32_t next = labels[label].parent;
+        labels[label].parent = root;
+        label = next;
+    }
+    return root;
+}
+
+// Whether a's peak comes before b's, i.e. is hotter or the first in row-major order on a tie
+static uint8_t Blob_Peak_Before(const BlobLabel* a, const BlobLabel* b)
+{
+    if (a->peak != b->peak)
+        return a->peak > b->peak;
+    return a->peak_y != b->peak_y ? a->peak_y < b->peak_y : a->peak_x < b->peak_x;
+}
+
+/**
+ * @brief Join two roots, the statistics of b fold into a.
+ */
+static uint32_t Blob_Union(BlobLabel* labels, uint32_t a, uint32_t b)
+{
+    if (a == b)
+        return a;
+
+    BlobLabel* root = &labels[a];
+    BlobLabel* child = &labels[b];
+    if (Blob_Peak_Before(child, root))
+    {
+        root->peak = child->peak;
+        root->peak_x = child->peak_x;
+        root->peak_y = child->peak_y;
+    }
+    root->area += child->area;
+    root->sum += child->sum;
+    root->sum_x += child->sum_x;
+    root->sum_y += child->sum_y;
+    root->left = child->left < root->left ? child->left : root->left;
+    root->top = child->top < root->top ? child->top : root->top;
+    root->right = child->right > root->right ? child->right : root->right;
+    root->bottom = child->bottom > root->bottom ? child->bottom : root->bottom;
+    child->parent = a;
+    return a;
+}
+
+/**
+ * @brief Fold the pixels of a run into its root.
+ */
+static void Blob_Add_Run(BlobLabel* label, const float* row, const BlobRun* run, uint16_t y)
+{
+    uint32_t length = run->x1 - run->x0;
+    float peak = row[run->x0];
+    uint16_t peak_x = run->x0;
+    double sum = 0.0;
+
+    for (uint32_t x = run->x0; x < run->x1; ++x)
+    {
+        sum += row[x];
+        if (row[x] > peak)
+        {
+            peak = row[x];
+            peak_x = (uint16_t)x;
+        }
+    }
+
+    // Everything already in the label comes earlier in row-major order, so a tie keeps it
+    if (label->area == 0 || peak > label->peak)
+    {
+        label->peak = peak;
+        label->peak_x = peak_x;
+        label->peak_y = y;
+    }
+    if (label->area == 0)
+    {
+        label->left = run->x0;
+        label->top = y;
+        label->right = run->x1 - 1;
+        label->bottom = y;
+    }
+    label->area += length;
+    label->sum += sum;
+    label->sum_x += (double)length * (run->x0 + run->x1 - 1) / 2.0;
+    label->sum_y += (double)length * y;
+    label->left = run->x0 < label->left ? run->x0 : label->left;
+    label->right = run->x1 - 1 > label->right ? run->x1 - 1 : label->right;
+    label->bottom = y;
+}
+
+static void Blob_Emit(const BlobLabel* label, BlobOutput* output)
+{
+    if (label->area < output->min_area)
+        return;
+
+    if (output->found < output->capacity)
+    {
+        SGJWBlob* blob = &output->blobs[output->found];
+        blob->area = label->area;
+        blob->peak = label->peak;
+        blob->peak_x = label->peak_x;
+        blob->peak_y = label->peak_y;
+        blob->mean = (float)(label->sum / label->area);
+        blob->centroid_x = (float)(label->sum_x / label->area);
+        blob->centroid_y = (float)(label->sum_y / label->area);
+        blob->left = label->left;
+        blob->top = label->top;
+        blob->right = label->right;
+        blob->bottom = label->bottom;
+    }
+    output->found++;
+}
+
+/**
+ * @brief The searched columns of a row: the ROIs covering it, sorted and joined, or the whole row.
+ */
+static size_t Blob_Intervals(const SGJWBlobConfig* config, uint16_t width, uint16_t y, BlobInterval* intervals)
+{
+    if (config->roi_count == 0)
+    {
+        intervals[0].a = 0;
+        intervals[0].b = width;
+        return 1;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < config->roi_count; ++i)
+    {
+        const SGJWBlobROI* roi = &config->rois[i];
+        if (y < roi->y || y >= roi->y + roi->height || roi->width == 0)
+            continue;
+
+        // Insertion sort by start, there are only a few ROIs
+        BlobInterval interval = {roi->x, (uint16_t)(roi->x + roi->width)};
+        size_t j = count++;
+        for (; j > 0 && intervals[j - 1].a > interval.a; --j)
+            intervals[j] = intervals[j - 1];
+        intervals[j] = interval;
+    }
+
+    // Touching intervals join too, a run never ends at a border between two ROIs
+    size_t joined = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (joined > 0 && intervals[i].a <= intervals[joined - 1].b)
+        {
+            if (intervals[i].b > intervals[joined - 1].b)
+                intervals[joined - 1].b = intervals[i].b;
+        }
+        else
+            intervals[joined++] = intervals[i];
+    }
+    return joined;
+}
+
+/**
+ * @brief Append the runs of set bits [0, count) as columns offset + [x0, x1).
+ */
+static size_t Blob_Extract_Runs(const uint64_t* bits, size_t count, uint16_t offset, BlobRun* runs, size_t run_count)
+{
+    size_t words = (count + 63) / 64;
+    size_t x = 0;
+
+    while (x < count)
+    {
+        // Next set bit
+        size_t w = x / 64;
+        uint64_t word = bits[w] & (~0ULL << (x % 64));
+        while (!word && ++w < words)
+            word = bits[w];
+        if (!word)
+            break;
+        size_t start = w * 64 + __builtin_ctzll(word);
+
+        // Next clear bit, bits past count are clear
+        w = start / 64;
+        word = ~bits[w] & (~0ULL << (start % 64));
+        while (!word && ++w < words)
+            word = ~bits[w];
+        size_t end = word ? w * 64 + __builtin_ctzll(word) : words * 64;
+        end = end < count ? end : count;
+
+        runs[run_count].x0 = (uint16_t)(offset + start);
+        runs[run_count].x1 = (uint16_t)(offset + end);
+        run_count++;
+        x = end;
+    }
+    return run_count;
+}
+
+/* ====================================================================================================== */
+/* ======================================== Main APIs =================================================== */
+/* ====================================================================================================== */
+
+int8_t State_Grid_JPEG_Find_Blobs(const float* matrix, uint16_t width, uint16_t height, const SGJWBlobConfig* config, SGJWBlobWorkspace* workspace,
+                                  SGJWBlob* blobs, size_t capacity, size_t* found)
+{
+    Threshold_Kernel kernel = config ? Threshold_Get_Kernel(config->kernel) : NULL;
+    if (!kernel || !workspace || !found || (!blobs && capacity) || (!matrix && width && height) || (!config->rois && config->roi_count) ||
+        (config->connectivity != 0 && config->connectivity != 4 && config->connectivity != 8))
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    *found = 0;
+    for (size_t i = 0; i < config->roi_count; ++i)
+    {
+        const SGJWBlobROI* roi = &config->rois[i];
+        if ((uint32_t)roi->x + roi->width > width || (uint32_t)roi->y + roi->height > height)
+            return SGJW_ERROR_INVALID_PARAMS;
+    }
+    if (width == 0 || height == 0)
+        return SGJW_SUCCESS;
+
+    BlobScratch scratch;
+    int8_t retval = Blob_Scratch(workspace, width, config->roi_count, &scratch);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    BlobOutput output = {blobs, capacity, 0, config->min_area};
+    BlobLabel* labels = scratch.labels;
+    // Runs of the row above touch with a shared edge, or a shared corner as well for 8 neighbours
+    uint16_t reach = config->connectivity == 4 ? 0 : 1;
+    size_t prev_count = 0;
+
+    for (uint16_t y = 0; y < height; ++y)
+    {
+        const float* row = matrix + (size_t)y * width;
+
+        /* ---------- Step 1 : Threshold the searched columns into runs ---------- */
+
+        size_t cur_count = 0;
+        size_t interval_count = Blob_Intervals(config, width, y, scratch.intervals);
+        for (size_t i = 0; i < interval_count; ++i)
+        {
+            size_t count = scratch.intervals[i].b - scratch.intervals[i].a;
+            kernel(row + scratch.intervals[i].a, count, config->threshold, scratch.bits);
+            cur_count = Blob_Extract_Runs(scratch.bits, count, scratch.intervals[i].a, scratch.cur, cur_count);
+        }
+
+        /* ---------- Step 2 : Label each run, joining the runs it touches in the row above ---------- */
+
+        size_t p = 0;
+        for (size_t c = 0; c < cur_count; ++c)
+        {
+            BlobRun* run = &scratch.cur[c];
+            while (p < prev_count && scratch.prev[p].x1 + reach <= run->x0)
+                ++p;
+
+            // The last run touched may touch the next run as well, p stays on it
+            uint32_t label = UINT32_MAX;
+            for (size_t q = p; q < prev_count && scratch.prev[q].x0 < run->x1 + reach; ++q)
+            {
+                uint32_t root = Blob_Find(labels, scratch.prev[q].label);
+                label = label == UINT32_MAX ? root : Blob_Union(labels, label, root);
+            }
+
+            if (label == UINT32_MAX)
+            {
+                label = scratch.free_labels[--scratch.free_count];
+                memset(&labels[label], 0, sizeof(BlobLabel));
+                labels[label].parent = label;
+            }
+
+            Blob_Add_Run(&labels[label], row, run, y);
+            run->label = label;
+        }
+
+        /* ---------- Step 3 : Report blobs no run of this row touches, release every label no run refers to ---------- */
+
+        size_t candidate_count = 0;
+        for (size_t i = 0; i < prev_count; ++i)
+            scratch.candidates[candidate_count++] = scratch.prev[i].label;
+        for (size_t i = 0; i < cur_count; ++i)
+            scratch.candidates[candidate_count++] = scratch.cur[i].label;
+
+        for (size_t i = 0; i < cur_count; ++i)
+        {
+            scratch.cur[i].label = Blob_Find(labels, scratch.cur[i].label);
+            labels[scratch.cur[i].label].seen = (uint32_t)y + 1;
+        }
+
+        for (size_t i = 0; i < candidate_count; ++i)
+        {
+            BlobLabel* label = &labels[scratch.candidates[i]];
+            if (label->seen == (uint32_t)y + 1)
+                continue;
+            if (label->parent == scratch.candidates[i])
+                Blob_Emit(label, &output);
+            label->seen = (uint32_t)y + 1;
+            scratch.free_labels[scratch.free_count++] = scratch.candidates[i];
+        }
+
+        BlobRun* swap = scratch.prev;
+        scratch.prev = scratch.cur;
+        scratch.cur = swap;
+        prev_count = cur_count;
+    }
+
+    // Blobs touching the last row
+    for (size_t i = 0; i < prev_count; ++i)
+    {
+        BlobLabel* label = &labels[scratch.prev[i].label];
+        if (label->seen == (uint32_t)height + 1)
+            continue;
+        Blob_Emit(label, &output);
+        label->seen = (uint32_t)height + 1;
+    }
+
+    *found = output.found;
+    return SGJW_SUCCESS;
+}
+
+void State_Grid_JPEG_Blob_Workspace_Free(SGJWBlobWorkspace* workspace)
+{
+    if (!workspace)
+        return;
+
+    SGJW_Free(workspace->block);
+    memset(workspace, 0, sizeof(SGJWBlobWorkspace));
+}
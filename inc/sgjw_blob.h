@@ -0,0 +1,106 @@
+#pragma once
+
+/**
+ * @file sgjw_blob.h
+ * @brief Hot-spot detection: threshold and connected components of a temperature matrix in one pass.
+ *
+ * @note Typical usage:
+ * 1. Zero-initialize an SGJWBlobWorkspace once, e.g. per camera thread.
+ * 2. Fill an SGJWBlobConfig with the alarm threshold and, optionally, the regions to watch.
+ * 3. Invoke State_Grid_JPEG_Find_Blobs on every frame, it fills an array of SGJWBlob.
+ * 4. Call State_Grid_JPEG_Blob_Workspace_Free when done.
+ *
+ * The matrix is read once, row by row. Each row is thresholded into a bit mask with SIMD and cut into runs
+ * of hot pixels; a run joins the labels of the runs it touches in the row above through a union-find, and
+ * the statistics of a blob are folded into its root as runs arrive. A blob is reported as soon as a row no
+ * longer touches it and its label is recycled, so the workspace only depends on the matrix width: it is
+ * allocated on the first frame and reused, later frames of the same width never allocate.
+ */
+
+#include "sgjw.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Rectangle to search, see SGJWBlobConfig
+typedef struct
+{
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+} SGJWBlobROI;
+
+typedef struct
+{
+    // Pixels at or above the threshold are hot, NaN never is.
+    float threshold;
+    // 4 or 8 neighbours, 0 for 8.
+    uint8_t connectivity;
+    // Blobs with fewer pixels are not reported.
+    uint32_t min_area;
+    // Optional, only pixels inside at least one ROI are searched. Overlapping ROIs join.
+    const SGJWBlobROI* rois;
+    size_t roi_count;
+    // The threshold kernel, SGJW_KERNEL_AUTO picks the best one for the running CPU.
+    SGJW_KERNEL kernel;
+} SGJWBlobConfig;
+
+// One connected region of hot pixels
+typedef struct
+{
+    // Number of pixels.
+    uint32_t area;
+    // Hottest pixel, the first one in row-major order on a tie.
+    float peak;
+    uint16_t peak_x;
+    uint16_t peak_y;
+    float mean;
+    // Center of the pixels, unweighted.
+    float centroid_x;
+    float centroid_y;
+    // Bounding box, inclusive.
+    uint16_t left;
+    uint16_t top;
+    uint16_t right;
+    uint16_t bottom;
+} SGJWBlob;
+
+// Scratch memory of State_Grid_JPEG_Find_Blobs, zero-initialize before the first use
+typedef struct
+{
+    // Private
+    void* block;
+    size_t capacity;
+} SGJWBlobWorkspace;
+
+/**
+ * @brief Find the blobs of hot pixels of a matrix.
+ *
+ * @note Blobs are reported in the order they end, i.e. by their bottom row.
+ *
+ * @param matrix Host floats, width * height values.
+ * @param width Matrix width.
+ * @param height Matrix height.
+ * @param config The detection options.
+ * @param workspace Scratch memory, grown when the width or the number of ROIs grows.
+ * @param blobs Output, may be NULL when capacity is 0.
+ * @param capacity Size of blobs.
+ * @param found Receives the number of blobs, which may exceed capacity (only the first capacity are stored).
+ * @return SGJW_ERROR_INVALID_PARAMS for a kernel not available on this CPU or an ROI leaving the matrix, otherwise an
+ *         SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Find_Blobs(const float* matrix, uint16_t width, uint16_t height, const SGJWBlobConfig* config, SGJWBlobWorkspace* workspace,
+                                  SGJWBlob* blobs, size_t capacity, size_t* found);
+
+/**
+ * @brief Release the memory of a workspace, it may be used again afterwards.
+ *
+ * @param workspace The workspace.
+ */
+void State_Grid_JPEG_Blob_Workspace_Free(SGJWBlobWorkspace* workspace);
+
+#ifdef __cplusplus
+}
+#endif
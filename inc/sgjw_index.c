@@ -0,0 +1,1166 @@
+#include "sgjw_index.h"
+#include "sgjw_internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* ====================================================================================================== */
+/* ======================================== Constants Definition ========================================= */
+/* ====================================================================================================== */
+
+#define SGJW_INDEX_VERSION 2
+
+// The builder sizes the GPS grid for about this many records per cell
+#define SGJW_INDEX_CELL_RECORDS 16
+#define SGJW_INDEX_MAX_GRID_SIDE 256
+
+// Journal records: payload size and checksum, then the fixed fields, then the path without terminator
+#define SGJW_JOURNAL_FRAME_BYTES 8
+#define SGJW_JOURNAL_FIXED_BYTES                                                                                                           \
+    (SGJW_DATE_BYTES + SGJW_MANUFACTURER_BYTES + SGJW_PRODUCT_BYTES + SGJW_SN_BYTES + SGJW_LONGITUDE_BYTES + SGJW_LATITUDE_BYTES +    \
+     SGJW_ALTITUDE_BYTES + SGJW_WIDTH_BYTES + SGJW_HEIGHT_BYTES + 2 * sizeof(uint64_t))
+
+// clang-format off
+static const char SGJW_INDEX_MAGIC[8] = { 'S', 'G', 'J', 'W', 'I', 'D', 'X', '\0' };
+static const char SGJW_JOURNAL_MAGIC[8] = { 'S', 'G', 'J', 'W', 'J', 'R', 'N', '\0' };
+// clang-format on
+
+/* ====================================================================================================== */
+/* ======================================== Helper Structures =========================================== */
+/* ====================================================================================================== */
+
+// Arrays of the index file, in file order
+typedef enum
+{
+    INDEX_DATE = 0,
+    INDEX_MANUFACTURER,
+    INDEX_PRODUCT,
+    INDEX_SN,
+    INDEX_LONGITUDE,
+    INDEX_LATITUDE,
+    INDEX_ALTITUDE,
+    INDEX_WIDTH,
+    INDEX_HEIGHT,
+    INDEX_MATRIX_OFFSET,
+    INDEX_FILE_SIZE,
+    INDEX_PATH_OFFSET,
+    // grid_columns * grid_rows + 1 starts into INDEX_CELL_RECORDS
+    INDEX_CELL_START,
+    // Record numbers of each cell, ascending within a cell
+    INDEX_CELL_RECORDS,
+    // Null-terminated paths
+    INDEX_PATHS,
+    INDEX_COLUMN_COUNT
+} IndexColumn;
+
+// clang-format off
+// Bytes per record of each array, 0 for the ones sized otherwise
+static const size_t SGJW_INDEX_RECORD_BYTES[INDEX_COLUMN_COUNT] = {
+    SGJW_DATE_BYTES, SGJW_MANUFACTURER_BYTES, SGJW_PRODUCT_BYTES, SGJW_SN_BYTES,
+    sizeof(double), sizeof(double), sizeof(uint32_t), sizeof(uint16_t), sizeof(uint16_t),
+    sizeof(uint64_t), sizeof(uint64_t), sizeof(uint64_t),
+    0, sizeof(uint32_t), 0
+};
+// clang-format on
+
+// File header, followed by the arrays, each on its own cache line
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint32_t grid_columns;
+    uint32_t grid_rows;
+    double longitude_min;
+    double longitude_max;
+    double latitude_min;
+    double latitude_max;
+    uint64_t paths_size;
+    // Journal generation folded into this file, older journals are ignored
+    uint64_t journal_generation;
+    uint64_t size;
+    uint64_t columns[INDEX_COLUMN_COUNT];
+} IndexHeader;
+
+// Journal file header, records follow
+typedef struct
+{
+    char magic[8];
+    // Greater than IndexHeader::journal_generation while the records are not folded into the index
+    uint64_t generation;
+} JournalHeader;
+
+// Sort key of the builder
+typedef struct
+{
+    char date[SGJW_DATE_BYTES];
+    uint32_t entry;
+} IndexOrder;
+
+/* ====================================================================================================== */
+/* ======================================== Helper Functions ============================================ */
+/* ====================================================================================================== */
+
+/**
+ * @brief Place every array behind the header from count, grid and paths size.
+ *
+ * @note Open recomputes the layout and compares it, so a stored offset can never point outside the file.
+ */
+static void Index_Layout(IndexHeader* header)
+{
+    uint64_t cells = (uint64_t)header->grid_columns * header->grid_rows;
+    uint64_t offset = (sizeof(IndexHeader) + SGJW_CACHE_LINE - 1) & ~((uint64_t)SGJW_CACHE_LINE - 1);
+
+    for (size_t i = 0; i < INDEX_COLUMN_COUNT; ++i)
+    {
+        uint64_t size = (uint64_t)header->count * SGJW_INDEX_RECORD_BYTES[i];
+        if (i == INDEX_CELL_START)
+            size = (cells + 1) * sizeof(uint32_t);
+        else if (i == INDEX_PATHS)
+            size = header->paths_size;
+
+        header->columns[i] = offset;
+        offset = (offset + size + SGJW_CACHE_LINE - 1) & ~((uint64_t)SGJW_CACHE_LINE - 1);
+    }
+
+    header->size = offset;
+}
+
+static const void* Index_Column(const SGJWIndex* index, IndexColumn column)
+{
+    const IndexHeader* header = (const IndexHeader*)index->map_base;
+    return (const uint8_t*)index->map_base + header->columns[column];
+}
+
+/**
+ * @brief Grid step of a coordinate, out-of-range values clamp to the border cells and NaN lands in cell 0.
+ */
+static uint32_t Index_Grid_Step(double value, double min, double max, uint32_t steps)
+{
+    if (!(max > min))
+        return 0;
+
+    double position = (value - min) / (max - min) * steps;
+    if (!(position > 0.0))
+        return 0;
+    return position >= steps ? steps - 1 : (uint32_t)position;
+}
+
+static uint32_t Index_Cell(const IndexHeader* header, double longitude, double latitude)
+{
+    uint32_t column = Index_Grid_Step(longitude, header->longitude_min, header->longitude_max, header->grid_columns);
+    uint32_t row = Index_Grid_Step(latitude, header->latitude_min, header->latitude_max, header->grid_rows);
+    return row * header->grid_columns + column;
+}
+
+static int Index_Order_Compare(const void* a, const void* b)
+{
+    const IndexOrder* left = (const IndexOrder*)a;
+    const IndexOrder* right = (const IndexOrder*)b;
+    int order = memcmp(left->date, right->date, SGJW_DATE_BYTES);
+    return order ? order : (left->entry > right->entry) - (left->entry < right->entry);
+}
+
+static int Index_Record_Compare(const void* a, const void* b)
+{
+    uint32_t left = *(const uint32_t*)a;
+    uint32_t right = *(const uint32_t*)b;
+    return (left > right) - (left < right);
+}
+
+static void Index_Heap_Sift_Down(uint32_t* heap, size_t size, size_t i)
+{
+    for (;;)
+    {
+        size_t largest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if (left < size && heap[left] > heap[largest])
+            largest = left;
+        if (right < size && heap[right] > heap[largest])
+            largest = right;
+        if (largest == i)
+            return;
+
+        uint32_t swap = heap[i];
+        heap[i] = heap[largest];
+        heap[largest] = swap;
+        i = largest;
+    }
+}
+
+/**
+ * @brief Add the matches-th match of an unordered walk, results keeps the capacity smallest record numbers.
+ *
+ * @note Once full, results is a max-heap: a record below its top replaces it. Sort results afterwards.
+ */
+static void Index_Keep_Smallest(uint32_t* results, size_t capacity, size_t matches, uint32_t record)
+{
+    if (matches < capacity)
+    {
+        results[matches] = record;
+        if (matches + 1 == capacity)
+        {
+            for (size_t i = capacity / 2; i-- > 0;)
+                Index_Heap_Sift_Down(results, capacity, i);
+        }
+    }
+    else if (capacity > 0 && record < results[0])
+    {
+        results[0] = record;
+        Index_Heap_Sift_Down(results, capacity, 0);
+    }
+}
+
+static void Index_Set_Text(uint8_t* column, uint32_t record, size_t size, const char* text)
+{
+    // Zero padded like the SGJW trailer (the column is zeroed), not null-terminated when full
+    memcpy(column + (size_t)record * size, text, strnlen(text, size));
+}
+
+static void Index_Get_Text(const void* column, uint32_t record, size_t size, char* text)
+{
+    memcpy(text, (const uint8_t*)column + (size_t)record * size, size);
+    text[size] = '\0';
+}
+
+/**
+ * @brief Lay out the whole index in memory: sorted columns, GPS grid and paths.
+ */
+static int8_t Index_Serialize(const SGJWIndexEntry* entries, size_t count, uint64_t journal_generation, uint8_t** buffer, size_t* size)
+{
+    IndexHeader header;
+    memset(&header, 0, sizeof(IndexHeader));
+    memcpy(header.magic, SGJW_INDEX_MAGIC, sizeof(SGJW_INDEX_MAGIC));
+    header.version = SGJW_INDEX_VERSION;
+    header.count = (uint32_t)count;
+    header.journal_generation = journal_generation;
+
+    /* ---------- Step 1 : Date order, GPS bounds and grid size ---------- */
+
+    IndexOrder* order = (IndexOrder*)SGJW_Malloc((count ? count : 1) * sizeof(IndexOrder), sizeof(void*));
+    if (!order)
+        return SGJW_ERROR_MALLOC_FAILED;
+
+    header.longitude_min = header.latitude_min = INFINITY;
+    header.longitude_max = header.latitude_max = -INFINITY;
+    for (size_t i = 0; i < count; ++i)
+    {
+        SGJW_Date_Key(entries[i].date, '0', order[i].date);
+        order[i].entry = (uint32_t)i;
+        header.paths_size += strlen(entries[i].path) + 1;
+
+        if (isfinite(entries[i].longitude) && isfinite(entries[i].latitude))
+        {
+            header.longitude_min = fmin(header.longitude_min, entries[i].longitude);
+            header.longitude_max = fmax(header.longitude_max, entries[i].longitude);
+            header.latitude_min = fmin(header.latitude_min, entries[i].latitude);
+            header.latitude_max = fmax(header.latitude_max, entries[i].latitude);
+        }
+    }
+    qsort(order, count, sizeof(IndexOrder), Index_Order_Compare);
+
+    uint32_t side = (uint32_t)ceil(sqrt((double)count / SGJW_INDEX_CELL_RECORDS));
+    header.grid_columns = header.grid_rows = side < 1 ? 1 : (side > SGJW_INDEX_MAX_GRID_SIDE ? SGJW_INDEX_MAX_GRID_SIDE : side);
+    Index_Layout(&header);
+
+    /* ---------- Step 2 : Columns in date order ---------- */
+
+    uint8_t* data = (uint8_t*)SGJW_Malloc(header.size, SGJW_CACHE_LINE);
+    if (!data)
+    {
+        SGJW_Free(order);
+        return SGJW_ERROR_MALLOC_FAILED;
+    }
+    memset(data, 0, header.size);
+    memcpy(data, &header, sizeof(IndexHeader));
+
+    uint8_t* columns[INDEX_COLUMN_COUNT];
+    for (size_t i = 0; i < INDEX_COLUMN_COUNT; ++i)
+        columns[i] = data + header.columns[i];
+
+    uint32_t* cell_start = (uint32_t*)columns[INDEX_CELL_START];
+    uint64_t path_offset = 0;
+    for (uint32_t r = 0; r < header.count; ++r)
+    {
+        const SGJWIndexEntry* entry = &entries[order[r].entry];
+
+        memcpy(columns[INDEX_DATE] + (size_t)r * SGJW_DATE_BYTES, order[r].date, SGJW_DATE_BYTES);
+        Index_Set_Text(columns[INDEX_MANUFACTURER], r, SGJW_MANUFACTURER_BYTES, entry->manufacturer);
+        Index_Set_Text(columns[INDEX_PRODUCT], r, SGJW_PRODUCT_BYTES, entry->product);
+        Index_Set_Text(columns[INDEX_SN], r, SGJW_SN_BYTES, entry->sn);
+        ((double*)columns[INDEX_LONGITUDE])[r] = entry->longitude;
+        ((double*)columns[INDEX_LATITUDE])[r] = entry->latitude;
+        ((uint32_t*)columns[INDEX_ALTITUDE])[r] = entry->altitude;
+        ((uint16_t*)columns[INDEX_WIDTH])[r] = entry->width;
+        ((uint16_t*)columns[INDEX_HEIGHT])[r] = entry->height;
+        ((uint64_t*)columns[INDEX_MATRIX_OFFSET])[r] = entry->matrix_offset;
+        ((uint64_t*)columns[INDEX_FILE_SIZE])[r] = entry->file_size;
+        ((uint64_t*)columns[INDEX_PATH_OFFSET])[r] = path_offset;
+
+        size_t path_size = strlen(entry->path) + 1;
+        memcpy(columns[INDEX_PATHS] + path_offset, entry->path, path_size);
+        path_offset += path_size;
+
+        cell_start[Index_Cell(&header, entry->longitude, entry->latitude) + 1]++;
+    }
+
+    /* ---------- Step 3 : Grid, a counting sort keeps each cell in date order ---------- */
+
+    uint32_t cells = header.grid_columns * header.grid_rows;
+    for (uint32_t c = 0; c < cells; ++c)
+        cell_start[c + 1] += cell_start[c];
+
+    SGJW_Free(order);
+    uint32_t* cell_fill = (uint32_t*)SGJW_Malloc(cells * sizeof(uint32_t), sizeof(void*));
+    if (!cell_fill)
+    {
+        SGJW_Free(data);
+        return SGJW_ERROR_MALLOC_FAILED;
+    }
+    memcpy(cell_fill, cell_start, cells * sizeof(uint32_t));
+
+    const double* longitudes = (const double*)columns[INDEX_LONGITUDE];
+    const double* latitudes = (const double*)columns[INDEX_LATITUDE];
+    for (uint32_t r = 0; r < header.count; ++r)
+        ((uint32_t*)columns[INDEX_CELL_RECORDS])[cell_fill[Index_Cell(&header, longitudes[r], latitudes[r])]++] = r;
+
+    SGJW_Free(cell_fill);
+    *buffer = data;
+    *size = header.size;
+    return SGJW_SUCCESS;
+}
+
+static uint8_t Index_Match(const SGJWIndex* index, uint32_t record, const SGJWIndexQuery* query, const char* sn)
+{
+    if (sn && memcmp((const char*)Index_Column(index, INDEX_SN) + (size_t)record * SGJW_SN_BYTES, sn, SGJW_SN_BYTES) != 0)
+        return 0;
+
+    if (query->use_box)
+    {
+        double longitude = ((const double*)Index_Column(index, INDEX_LONGITUDE))[record];
+        double latitude = ((const double*)Index_Column(index, INDEX_LATITUDE))[record];
+        if (!(longitude >= query->longitude_min && longitude <= query->longitude_max && latitude >= query->latitude_min &&
+              latitude <= query->latitude_max))
+            return 0;
+    }
+
+    return 1;
+}
+
+static char* Index_Sidecar_Path(const char* index_path, const char* suffix)
+{
+    size_t length = strlen(index_path) + strlen(suffix) + 1;
+    char* path = (char*)SGJW_Malloc(length, sizeof(void*));
+    if (path)
+        snprintf(path, length, "%s%s", index_path, suffix);
+    return path;
+}
+
+/**
+ * @brief Read a whole file into an SGJW_Malloc buffer, the caller frees it.
+ */
+static int8_t Index_Read_All(int fd, uint8_t** data, size_t* size)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return SGJW_ERROR_READ_FAILED;
+
+    *size = st.st_size;
+    *data = (uint8_t*)SGJW_Malloc(*size ? *size : 1, sizeof(void*));
+    if (!*data)
+        return SGJW_ERROR_MALLOC_FAILED;
+
+    for (size_t done = 0; done < *size;)
+    {
+        ssize_t n = pread(fd, *data + done, *size - done, done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            // Shrunk while reading, keep what is there
+            *size = done;
+            break;
+        }
+        done += n;
+    }
+    return SGJW_SUCCESS;
+}
+
+/* ====================================================================================================== */
+/* ======================================== Journal Functions =========================================== */
+/* ====================================================================================================== */
+
+// FNV-1a, catches records torn by a crash
+static uint32_t Journal_Checksum(const uint8_t* data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
+
+static size_t Journal_Record_Bytes(const SGJWIndexEntry* entry)
+{
+    return SGJW_JOURNAL_FRAME_BYTES + SGJW_JOURNAL_FIXED_BYTES + strlen(entry->path);
+}
+
+static size_t Journal_Encode(const SGJWIndexEntry* entry, uint8_t* record)
+{
+    size_t path_length = strlen(entry->path);
+    uint32_t payload = (uint32_t)(SGJW_JOURNAL_FIXED_BYTES + path_length);
+    uint8_t* cursor = record + SGJW_JOURNAL_FRAME_BYTES;
+
+    memset(cursor, 0, SGJW_JOURNAL_FIXED_BYTES);
+    Index_Set_Text(cursor, 0, SGJW_DATE_BYTES, entry->date);
+    cursor += SGJW_DATE_BYTES;
+    Index_Set_Text(cursor, 0, SGJW_MANUFACTURER_BYTES, entry->manufacturer);
+    cursor += SGJW_MANUFACTURER_BYTES;
+    Index_Set_Text(cursor, 0, SGJW_PRODUCT_BYTES, entry->product);
+    cursor += SGJW_PRODUCT_BYTES;
+    Index_Set_Text(cursor, 0, SGJW_SN_BYTES, entry->sn);
+    cursor += SGJW_SN_BYTES;
+    memcpy(cursor, &entry->longitude, SGJW_LONGITUDE_BYTES);
+    cursor += SGJW_LONGITUDE_BYTES;
+    memcpy(cursor, &entry->latitude, SGJW_LATITUDE_BYTES);
+    cursor += SGJW_LATITUDE_BYTES;
+    memcpy(cursor, &entry->altitude, SGJW_ALTITUDE_BYTES);
+    cursor += SGJW_ALTITUDE_BYTES;
+    memcpy(cursor, &entry->width, SGJW_WIDTH_BYTES);
+    cursor += SGJW_WIDTH_BYTES;
+    memcpy(cursor, &entry->height, SGJW_HEIGHT_BYTES);
+    cursor += SGJW_HEIGHT_BYTES;
+    memcpy(cursor, &entry->matrix_offset, sizeof(uint64_t));
+    cursor += sizeof(uint64_t);
+    memcpy(cursor, &entry->file_size, sizeof(uint64_t));
+    cursor += sizeof(uint64_t);
+    memcpy(cursor, entry->path, path_length);
+
+    uint32_t checksum = Journal_Checksum(record + SGJW_JOURNAL_FRAME_BYTES, payload);
+    memcpy(record, &payload, sizeof(uint32_t));
+    memcpy(record + sizeof(uint32_t), &checksum, sizeof(uint32_t));
+    return SGJW_JOURNAL_FRAME_BYTES + payload;
+}
+
+/**
+ * @brief Decode the record at data.
+ *
+ * @param path Receives the path, not null-terminated, path_length bytes.
+ * @return Size of the record, 0 if it is torn or corrupt.
+ */
+static size_t Journal_Decode(const uint8_t* data, size_t size, SGJWIndexEntry* entry, const char** path, size_t* path_length)
+{
+    uint32_t payload;
+    uint32_t checksum;
+    if (size < SGJW_JOURNAL_FRAME_BYTES)
+        return 0;
+
+    memcpy(&payload, data, sizeof(uint32_t));
+    memcpy(&checksum, data + sizeof(uint32_t), sizeof(uint32_t));
+    if (payload < SGJW_JOURNAL_FIXED_BYTES || payload > size - SGJW_JOURNAL_FRAME_BYTES ||
+        Journal_Checksum(data + SGJW_JOURNAL_FRAME_BYTES, payload) != checksum)
+        return 0;
+
+    const uint8_t* cursor = data + SGJW_JOURNAL_FRAME_BYTES;
+    memset(entry, 0, sizeof(SGJWIndexEntry));
+    Index_Get_Text(cursor, 0, SGJW_DATE_BYTES, entry->date);
+    cursor += SGJW_DATE_BYTES;
+    Index_Get_Text(cursor, 0, SGJW_MANUFACTURER_BYTES, entry->manufacturer);
+    cursor += SGJW_MANUFACTURER_BYTES;
+    Index_Get_Text(cursor, 0, SGJW_PRODUCT_BYTES, entry->product);
+    cursor += SGJW_PRODUCT_BYTES;
+    Index_Get_Text(cursor, 0, SGJW_SN_BYTES, entry->sn);
+    cursor += SGJW_SN_BYTES;
+    memcpy(&entry->longitude, cursor, SGJW_LONGITUDE_BYTES);
+    cursor += SGJW_LONGITUDE_BYTES;
+    memcpy(&entry->latitude, cursor, SGJW_LATITUDE_BYTES);
+    cursor += SGJW_LATITUDE_BYTES;
+    memcpy(&entry->altitude, cursor, SGJW_ALTITUDE_BYTES);
+    cursor += SGJW_ALTITUDE_BYTES;
+    memcpy(&entry->width, cursor, SGJW_WIDTH_BYTES);
+    cursor += SGJW_WIDTH_BYTES;
+    memcpy(&entry->height, cursor, SGJW_HEIGHT_BYTES);
+    cursor += SGJW_HEIGHT_BYTES;
+    memcpy(&entry->matrix_offset, cursor, sizeof(uint64_t));
+    cursor += sizeof(uint64_t);
+    memcpy(&entry->file_size, cursor, sizeof(uint64_t));
+    cursor += sizeof(uint64_t);
+
+    *path = (const char*)cursor;
+    *path_length = payload - SGJW_JOURNAL_FIXED_BYTES;
+    return SGJW_JOURNAL_FRAME_BYTES + payload;
+}
+
+/**
+ * @brief Generation of the journal beside an index, 0 if there is none.
+ */
+static uint64_t Journal_Read_Generation(const char* index_path)
+{
+    char* path = Index_Sidecar_Path(index_path, ".journal");
+    if (!path)
+        return 0;
+
+    JournalHeader header;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    SGJW_Free(path);
+    if (fd < 0)
+        return 0;
+
+    ssize_t n = pread(fd, &header, sizeof(JournalHeader), 0);
+    close(fd);
+    if (n != (ssize_t)sizeof(JournalHeader) || memcmp(header.magic, SGJW_JOURNAL_MAGIC, sizeof(SGJW_JOURNAL_MAGIC)) != 0)
+        return 0;
+    return header.generation;
+}
+
+static int8_t Journal_Reset(SGJWIndexJournal* journal, uint64_t generation)
+{
+    JournalHeader header;
+    memcpy(header.magic, SGJW_JOURNAL_MAGIC, sizeof(SGJW_JOURNAL_MAGIC));
+    header.generation = generation;
+
+    if (ftruncate(journal->fd, 0) != 0 || SGJW_Pwrite_Full(journal->fd, &header, sizeof(JournalHeader), 0) != SGJW_SUCCESS ||
+        fsync(journal->fd) != 0)
+        return SGJW_ERROR_FILE_WRITE;
+
+    journal->generation = generation;
+    journal->size = sizeof(JournalHeader);
+    journal->count = 0;
+    return SGJW_SUCCESS;
+}
+
+static int Journal_Entry_Compare(const void* a, const void* b)
+{
+    const SGJWIndexEntry* left = (const SGJWIndexEntry*)a;
+    const SGJWIndexEntry* right = (const SGJWIndexEntry*)b;
+    int order = memcmp(left->date, right->date, SGJW_DATE_BYTES);
+    return order ? order : strcmp(left->path, right->path);
+}
+
+/**
+ * @brief Load the records the index has not folded yet, sorted by date.
+ */
+static int8_t Index_Load_Journal(const char* index_path, SGJWIndex* index, uint64_t folded)
+{
+    char* path = Index_Sidecar_Path(index_path, ".journal");
+    if (!path)
+        return SGJW_ERROR_MALLOC_FAILED;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    SGJW_Free(path);
+    if (fd < 0)
+        return SGJW_SUCCESS;
+
+    uint8_t* data = NULL;
+    size_t size = 0;
+    int8_t retval = Index_Read_All(fd, &data, &size);
+    close(fd);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    JournalHeader header;
+    if (size < sizeof(JournalHeader))
+        goto cleanup;
+    memcpy(&header, data, sizeof(JournalHeader));
+    if (memcmp(header.magic, SGJW_JOURNAL_MAGIC, sizeof(SGJW_JOURNAL_MAGIC)) != 0 || header.generation <= folded)
+        goto cleanup;
+
+    /* ---------- Step 1 : Count the intact records ---------- */
+
+    SGJWIndexEntry entry;
+    const char* record_path;
+    size_t path_length;
+    size_t count = 0;
+    size_t paths_size = 0;
+    for (size_t offset = sizeof(JournalHeader), n; (n = Journal_Decode(data + offset, size - offset, &entry, &record_path, &path_length)) != 0;
+         offset += n)
+    {
+        count++;
+        paths_size += path_length + 1;
+    }
+    if (count == 0 || count > UINT32_MAX - index->indexed)
+        goto cleanup;
+
+    /* ---------- Step 2 : Decode them with terminated paths ---------- */
+
+    index->journal = (SGJWIndexEntry*)SGJW_Malloc(count * sizeof(SGJWIndexEntry), sizeof(void*));
+    index->journal_paths = (char*)SGJW_Malloc(paths_size, sizeof(void*));
+    if (!index->journal || !index->journal_paths)
+    {
+        retval = SGJW_ERROR_MALLOC_FAILED;
+        goto cleanup;
+    }
+
+    char* cursor = index->journal_paths;
+    size_t offset = sizeof(JournalHeader);
+    for (size_t i = 0; i < count; ++i)
+    {
+        offset += Journal_Decode(data + offset, size - offset, &index->journal[i], &record_path, &path_length);
+        memcpy(cursor, record_path, path_length);
+        cursor[path_length] = '\0';
+        index->journal[i].path = cursor;
+        cursor += path_length + 1;
+
+        // Compared like the date column
+        char key[SGJW_DATE_BYTES];
+        SGJW_Date_Key(index->journal[i].date, '0', key);
+        memcpy(index->journal[i].date, key, SGJW_DATE_BYTES);
+    }
+    qsort(index->journal, count, sizeof(SGJWIndexEntry), Journal_Entry_Compare);
+
+    index->journal_count = (uint32_t)count;
+    index->count = index->indexed + index->journal_count;
+
+cleanup:
+    SGJW_Free(data);
+    return retval;
+}
+
+static uint8_t Journal_Match(const SGJWIndexEntry* entry, const SGJWIndexQuery* query)
+{
+    char key[SGJW_DATE_BYTES];
+    if (query->date_from)
+    {
+        SGJW_Date_Key(query->date_from, '0', key);
+        if (memcmp(entry->date, key, SGJW_DATE_BYTES) < 0)
+            return 0;
+    }
+    if (query->date_to)
+    {
+        SGJW_Date_Key(query->date_to, '9', key);
+        if (memcmp(entry->date, key, SGJW_DATE_BYTES) > 0)
+            return 0;
+    }
+
+    if (query->sn && strncmp(entry->sn, query->sn, SGJW_SN_BYTES) != 0)
+        return 0;
+
+    if (query->use_box && !(entry->longitude >= query->longitude_min && entry->longitude <= query->longitude_max &&
+                            entry->latitude >= query->latitude_min && entry->latitude <= query->latitude_max))
+        return 0;
+
+    return 1;
+}
+
+/**
+ * @brief Serialize entries to a temporary file and rename it over the index.
+ */
+static int8_t Index_Write_File(const char* index_path, const SGJWIndexEntry* entries, size_t count, uint64_t journal_generation)
+{
+    uint8_t* buffer = NULL;
+    size_t size = 0;
+    int8_t retval = Index_Serialize(entries, count, journal_generation, &buffer, &size);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    /* ---------- Write a temporary file and rename it over the index ---------- */
+
+    char* temp_path = Index_Sidecar_Path(index_path, ".tmp");
+    int fd = -1;
+    if (!temp_path)
+    {
+        retval = SGJW_ERROR_MALLOC_FAILED;
+        goto cleanup;
+    }
+
+    fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        retval = SGJW_ERROR_FILE_NOT_FOUND;
+        goto cleanup;
+    }
+
+    retval = SGJW_Pwrite_Full(fd, buffer, size, 0);
+    if (retval == SGJW_SUCCESS && fsync(fd) != 0)
+        retval = SGJW_ERROR_FILE_WRITE;
+    close(fd);
+
+    if (retval == SGJW_SUCCESS && rename(temp_path, index_path) != 0)
+        retval = SGJW_ERROR_FILE_WRITE;
+    if (retval != SGJW_SUCCESS)
+        unlink(temp_path);
+
+cleanup:
+    SGJW_Free(temp_path);
+    SGJW_Free(buffer);
+    return retval;
+}
+
+/* ====================================================================================================== */
+/* ========================================== Main APIs ================================================= */
+/* ====================================================================================================== */
+
+int8_t State_Grid_JPEG_Index_Write(const char* index_path, const SGJWIndexEntry* entries, size_t count)
+{
+    if (!index_path || (!entries && count > 0) || count > UINT32_MAX)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+#if !SGJW_HOST_LITTLE_ENDIAN
+    // The arrays are mapped as they are, so the index only exists in little-endian
+    return SGJW_ERROR_INVALID_PARAMS;
+#endif
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!entries[i].path)
+            return SGJW_ERROR_INVALID_PARAMS;
+    }
+
+    return Index_Write_File(index_path, entries, count, Journal_Read_Generation(index_path));
+}
+
+void State_Grid_JPEG_Index_Entry_From_Probe(const char* filepath, const StateGridJPEGProbe* probe, SGJWIndexEntry* entry)
+{
+    const StateGridJPEGV2* header = &probe->header;
+
+    memset(entry, 0, sizeof(SGJWIndexEntry));
+    memcpy(entry->date, header->date, sizeof(entry->date));
+    memcpy(entry->manufacturer, header->manufacturer, sizeof(entry->manufacturer));
+    memcpy(entry->product, header->product, sizeof(entry->product));
+    memcpy(entry->sn, header->sn, sizeof(entry->sn));
+    entry->longitude = header->longitude;
+    entry->latitude = header->latitude;
+    entry->altitude = header->altitude;
+    entry->width = header->width;
+    entry->height = header->height;
+    entry->matrix_offset = probe->matrix_offset;
+    entry->file_size = probe->file_size;
+    entry->path = filepath;
+}
+
+int8_t State_Grid_JPEG_Index_Build(const char* index_path, const char* const* filepaths, size_t count, size_t* indexed)
+{
+    if (!index_path || (!filepaths && count > 0))
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    SGJWIndexEntry* entries = (SGJWIndexEntry*)SGJW_Malloc((count ? count : 1) * sizeof(SGJWIndexEntry), sizeof(void*));
+    if (!entries)
+        return SGJW_ERROR_MALLOC_FAILED;
+
+    // Three small positioned reads per file, matrices are never touched
+    size_t used = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        StateGridJPEGProbe probe;
+        if (State_Grid_JPEG_Probe(filepaths[i], &probe) == SGJW_SUCCESS)
+            State_Grid_JPEG_Index_Entry_From_Probe(filepaths[i], &probe, &entries[used++]);
+    }
+
+    int8_t retval = State_Grid_JPEG_Index_Write(index_path, entries, used);
+    if (indexed)
+        *indexed = retval == SGJW_SUCCESS ? used : 0;
+
+    SGJW_Free(entries);
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Index_Open(const char* index_path, SGJWIndex* index)
+{
+    if (!index_path || !index)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    memset(index, 0, sizeof(SGJWIndex));
+
+    int fd = open(index_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return SGJW_ERROR_FILE_NOT_FOUND;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(IndexHeader))
+    {
+        close(fd);
+        return SGJW_ERROR_READ_FAILED;
+    }
+
+    // Pages are faulted in by the queries that need them
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return SGJW_ERROR_READ_FAILED;
+
+    index->map_base = map;
+    index->map_size = st.st_size;
+
+    /* ---------- Layout Verification ---------- */
+
+    IndexHeader expected;
+    memcpy(&expected, map, sizeof(IndexHeader));
+    Index_Layout(&expected);
+
+    const IndexHeader* header = (const IndexHeader*)map;
+    uint64_t cells = (uint64_t)header->grid_columns * header->grid_rows;
+    uint8_t valid = memcmp(header->magic, SGJW_INDEX_MAGIC, sizeof(SGJW_INDEX_MAGIC)) == 0 && header->version == SGJW_INDEX_VERSION && cells > 0 &&
+                    memcmp(&expected, header, sizeof(IndexHeader)) == 0 && header->size == (uint64_t)st.st_size;
+    valid = valid && ((const uint32_t*)Index_Column(index, INDEX_CELL_START))[cells] == header->count;
+    valid = valid && (header->paths_size == 0 || ((const char*)Index_Column(index, INDEX_PATHS))[header->paths_size - 1] == '\0');
+
+    if (!valid)
+    {
+        State_Grid_JPEG_Index_Close(index);
+        return SGJW_ERROR_READ_FAILED;
+    }
+
+    index->indexed = index->count = header->count;
+
+    int8_t retval = Index_Load_Journal(index_path, index, header->journal_generation);
+    if (retval != SGJW_SUCCESS)
+        State_Grid_JPEG_Index_Close(index);
+    return retval;
+}
+
+/**
+ * @brief Query the mapped records, see State_Grid_JPEG_Index_Query.
+ */
+static size_t Index_Query_Mapped(const SGJWIndex* index, const SGJWIndexQuery* query, uint32_t* results, size_t capacity)
+{
+    const IndexHeader* header = (const IndexHeader*)index->map_base;
+    const char* dates = (const char*)Index_Column(index, INDEX_DATE);
+    size_t matches = 0;
+
+    /* ---------- Step 1 : Date range by binary search ---------- */
+
+    char key[SGJW_DATE_BYTES];
+    uint32_t first = 0;
+    uint32_t last = header->count;
+    if (query->date_from)
+    {
+        SGJW_Date_Key(query->date_from, '0', key);
+        first = SGJW_Date_Bound(dates, SGJW_DATE_BYTES, header->count, key, 0);
+    }
+    if (query->date_to)
+    {
+        SGJW_Date_Key(query->date_to, '9', key);
+        last = SGJW_Date_Bound(dates, SGJW_DATE_BYTES, header->count, key, 1);
+    }
+    if (first >= last)
+        return 0;
+
+    char sn_key[SGJW_SN_BYTES];
+    const char* sn = NULL;
+    if (query->sn)
+    {
+        memset(sn_key, 0, SGJW_SN_BYTES);
+        memcpy(sn_key, query->sn, strnlen(query->sn, SGJW_SN_BYTES));
+        sn = sn_key;
+    }
+
+    /* ---------- Step 2 : Grid cells of the box, unless the date range is the smaller walk ---------- */
+
+    uint32_t column_first = 0, column_last = 0, row_first = 0, row_last = 0;
+    uint64_t cell_records = (uint64_t)last - first + 1;
+    const uint32_t* cell_start = (const uint32_t*)Index_Column(index, INDEX_CELL_START);
+    if (query->use_box)
+    {
+        if (!(query->longitude_min <= query->longitude_max && query->latitude_min <= query->latitude_max))
+            return 0;
+
+        column_first = Index_Grid_Step(query->longitude_min, header->longitude_min, header->longitude_max, header->grid_columns);
+        column_last = Index_Grid_Step(query->longitude_max, header->longitude_min, header->longitude_max, header->grid_columns);
+        row_first = Index_Grid_Step(query->latitude_min, header->latitude_min, header->latitude_max, header->grid_rows);
+        row_last = Index_Grid_Step(query->latitude_max, header->latitude_min, header->latitude_max, header->grid_rows);
+
+        cell_records = 0;
+        for (uint32_t row = row_first; row <= row_last; ++row)
+            cell_records += cell_start[row * header->grid_columns + column_last + 1] - cell_start[row * header->grid_columns + column_first];
+    }
+
+    if (cell_records > (uint64_t)last - first)
+    {
+        // Already in date order
+        for (uint32_t r = first; r < last; ++r)
+        {
+            if (!Index_Match(index, r, query, sn))
+                continue;
+            if (matches < capacity)
+                results[matches] = r;
+            matches++;
+        }
+        return matches;
+    }
+
+    const uint32_t* records = (const uint32_t*)Index_Column(index, INDEX_CELL_RECORDS);
+    for (uint32_t row = row_first; row <= row_last; ++row)
+    {
+        for (uint32_t column = column_first; column <= column_last; ++column)
+        {
+            uint32_t cell = row * header->grid_columns + column;
+
+            // Records of a cell are ascending, so the date range is a binary search here as well
+            uint32_t low = cell_start[cell];
+            uint32_t high = cell_start[cell + 1];
+            while (low < high)
+            {
+                uint32_t middle = low + (high - low) / 2;
+                if (records[middle] < first)
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+
+            for (uint32_t i = low; i < cell_start[cell + 1] && records[i] < last; ++i)
+            {
+                if (!Index_Match(index, records[i], query, sn))
+                    continue;
+                Index_Keep_Smallest(results, capacity, matches, records[i]);
+                matches++;
+            }
+        }
+    }
+
+    // Cells are visited in grid order, record numbers are date order: the earliest capacity matches are kept, then sorted
+    qsort(results, matches < capacity ? matches : capacity, sizeof(uint32_t), Index_Record_Compare);
+    return matches;
+}
+
+size_t State_Grid_JPEG_Index_Query(const SGJWIndex* index, const SGJWIndexQuery* query, uint32_t* results, size_t capacity)
+{
+    if (!index || !index->map_base || !query || (!results && capacity > 0))
+        return 0;
+
+    size_t matches = Index_Query_Mapped(index, query, results, capacity);
+    if (index->journal_count == 0)
+        return matches;
+
+    /* ---------- Journal records, merged by date behind the mapped ones of the same date ---------- */
+
+    size_t stored = matches < capacity ? matches : capacity;
+    uint32_t* merged = (uint32_t*)SGJW_Malloc((stored + index->journal_count) * sizeof(uint32_t), sizeof(void*));
+    if (!merged)
+        return matches;
+
+    const char* dates = (const char*)Index_Column(index, INDEX_DATE);
+    size_t mapped = 0;
+    size_t total = 0;
+    for (uint32_t j = 0; j < index->journal_count; ++j)
+    {
+        const SGJWIndexEntry* entry = &index->journal[j];
+        if (!Journal_Match(entry, query))
+            continue;
+
+        while (mapped < stored && memcmp(dates + (size_t)results[mapped] * SGJW_DATE_BYTES, entry->date, SGJW_DATE_BYTES) <= 0)
+            merged[total++] = results[mapped++];
+        merged[total++] = index->indexed + j;
+        matches++;
+    }
+    while (mapped < stored)
+        merged[total++] = results[mapped++];
+
+    // The first capacity of the union only draw from the first capacity of each part
+    memcpy(results, merged, (total < capacity ? total : capacity) * sizeof(uint32_t));
+    SGJW_Free(merged);
+    return matches;
+}
+
+int8_t State_Grid_JPEG_Index_Get(const SGJWIndex* index, uint32_t record, SGJWIndexEntry* entry)
+{
+    if (!index || !index->map_base || !entry || record >= index->count)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    if (record >= index->indexed)
+    {
+        *entry = index->journal[record - index->indexed];
+        return SGJW_SUCCESS;
+    }
+
+    const IndexHeader* header = (const IndexHeader*)index->map_base;
+    uint64_t path_offset = ((const uint64_t*)Index_Column(index, INDEX_PATH_OFFSET))[record];
+    if (path_offset >= header->paths_size)
+        return SGJW_ERROR_READ_FAILED;
+
+    Index_Get_Text(Index_Column(index, INDEX_DATE), record, SGJW_DATE_BYTES, entry->date);
+    Index_Get_Text(Index_Column(index, INDEX_MANUFACTURER), record, SGJW_MANUFACTURER_BYTES, entry->manufacturer);
+    Index_Get_Text(Index_Column(index, INDEX_PRODUCT), record, SGJW_PRODUCT_BYTES, entry->product);
+    Index_Get_Text(Index_Column(index, INDEX_SN), record, SGJW_SN_BYTES, entry->sn);
+    entry->longitude = ((const double*)Index_Column(index, INDEX_LONGITUDE))[record];
+    entry->latitude = ((const double*)Index_Column(index, INDEX_LATITUDE))[record];
+    entry->altitude = ((const uint32_t*)Index_Column(index, INDEX_ALTITUDE))[record];
+    entry->width = ((const uint16_t*)Index_Column(index, INDEX_WIDTH))[record];
+    entry->height = ((const uint16_t*)Index_Column(index, INDEX_HEIGHT))[record];
+    entry->matrix_offset = ((const uint64_t*)Index_Column(index, INDEX_MATRIX_OFFSET))[record];
+    entry->file_size = ((const uint64_t*)Index_Column(index, INDEX_FILE_SIZE))[record];
+    entry->path = (const char*)Index_Column(index, INDEX_PATHS) + path_offset;
+
+    return SGJW_SUCCESS;
+}
+
+void State_Grid_JPEG_Index_Close(SGJWIndex* index)
+{
+    if (!index)
+        return;
+
+    if (index->map_base)
+        munmap(index->map_base, index->map_size);
+    SGJW_Free(index->journal);
+    SGJW_Free(index->journal_paths);
+    memset(index, 0, sizeof(SGJWIndex));
+}
+
+int8_t State_Grid_JPEG_Index_Journal_Open(const char* index_path, SGJWIndexJournal* journal)
+{
+    if (!index_path || !journal)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    memset(journal, 0, sizeof(SGJWIndexJournal));
+    journal->fd = -1;
+
+    /* ---------- Step 1 : Generation folded into the index, an empty index on first use ---------- */
+
+    uint64_t folded = 0;
+    int fd = open(index_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        if (errno != ENOENT)
+            return SGJW_ERROR_FILE_NOT_FOUND;
+
+        int8_t retval = Index_Write_File(index_path, NULL, 0, 0);
+        if (retval != SGJW_SUCCESS)
+            return retval;
+    }
+    else
+    {
+        IndexHeader header;
+        ssize_t n = pread(fd, &header, sizeof(IndexHeader), 0);
+        close(fd);
+        if (n != (ssize_t)sizeof(IndexHeader) || memcmp(header.magic, SGJW_INDEX_MAGIC, sizeof(SGJW_INDEX_MAGIC)) != 0 ||
+            header.version != SGJW_INDEX_VERSION)
+            return SGJW_ERROR_READ_FAILED;
+        folded = header.journal_generation;
+    }
+
+    /* ---------- Step 2 : Keep the intact records of an unfolded journal, otherwise start a new one ---------- */
+
+    char* path = Index_Sidecar_Path(index_path, ".journal");
+    if (!path)
+        return SGJW_ERROR_MALLOC_FAILED;
+    journal->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    SGJW_Free(path);
+    if (journal->fd < 0)
+        return SGJW_ERROR_FILE_NOT_FOUND;
+
+    uint8_t* data = NULL;
+    size_t size = 0;
+    int8_t retval = Index_Read_All(journal->fd, &data, &size);
+    if (retval != SGJW_SUCCESS)
+    {
+        State_Grid_JPEG_Index_Journal_Close(journal);
+        return retval;
+    }
+
+    JournalHeader header;
+    if (size >= sizeof(JournalHeader))
+        memcpy(&header, data, sizeof(JournalHeader));
+
+    if (size >= sizeof(JournalHeader) && memcmp(header.magic, SGJW_JOURNAL_MAGIC, sizeof(SGJW_JOURNAL_MAGIC)) == 0 && header.generation > folded)
+    {
+        SGJWIndexEntry entry;
+        const char* record_path;
+        size_t path_length;
+        size_t offset = sizeof(JournalHeader);
+        for (size_t n; (n = Journal_Decode(data + offset, size - offset, &entry, &record_path, &path_length)) != 0; offset += n)
+            journal->count++;
+
+        // A record torn by a crash is dropped, its file is ingested again
+        if (offset < size && ftruncate(journal->fd, offset) != 0)
+            retval = SGJW_ERROR_FILE_WRITE;
+        journal->generation = header.generation;
+        journal->size = offset;
+    }
+    else
+    {
+        retval = Journal_Reset(journal, folded + 1);
+    }
+
+    SGJW_Free(data);
+    if (retval != SGJW_SUCCESS)
+        State_Grid_JPEG_Index_Journal_Close(journal);
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Index_Journal_Append(SGJWIndexJournal* journal, const SGJWIndexEntry* entries, size_t count)
+{
+    if (!journal || journal->fd < 0 || (!entries && count > 0))
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!entries[i].path)
+            return SGJW_ERROR_INVALID_PARAMS;
+        bytes += Journal_Record_Bytes(&entries[i]);
+    }
+    if (bytes == 0)
+        return SGJW_SUCCESS;
+
+    uint8_t* buffer = (uint8_t*)SGJW_Malloc(bytes, sizeof(void*));
+    if (!buffer)
+        return SGJW_ERROR_MALLOC_FAILED;
+
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i)
+        offset += Journal_Encode(&entries[i], buffer + offset);
+
+    // One write and one flush for the whole batch
+    int8_t retval = SGJW_Pwrite_Full(journal->fd, buffer, bytes, journal->size);
+    if (retval == SGJW_SUCCESS && fdatasync(journal->fd) != 0)
+        retval = SGJW_ERROR_FILE_WRITE;
+    SGJW_Free(buffer);
+
+    if (retval != SGJW_SUCCESS)
+    {
+        // Drop the partial batch, should that fail as well the next open drops the torn record
+        (void)!ftruncate(journal->fd, journal->size);
+        return retval;
+    }
+
+    journal->size += bytes;
+    journal->count += (uint32_t)count;
+    return SGJW_SUCCESS;
+}
+
+int8_t State_Grid_JPEG_Index_Compact(const char* index_path, SGJWIndexJournal* journal)
+{
+    if (!index_path)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    SGJWIndex index;
+    int8_t retval = State_Grid_JPEG_Index_Open(index_path, &index);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    SGJWIndexEntry* entries = (SGJWIndexEntry*)SGJW_Malloc((index.count ? index.count : 1) * sizeof(SGJWIndexEntry), sizeof(void*));
+    if (!entries)
+    {
+        State_Grid_JPEG_Index_Close(&index);
+        return SGJW_ERROR_MALLOC_FAILED;
+    }
+
+    for (uint32_t r = 0; r < index.count && retval == SGJW_SUCCESS; ++r)
+        retval = State_Grid_JPEG_Index_Get(&index, r, &entries[r]);
+
+    // The new index records the generation it folded, so a crash before the reset below cannot apply it twice
+    uint64_t generation = journal ? journal->generation : Journal_Read_Generation(index_path);
+    if (retval == SGJW_SUCCESS)
+        retval = Index_Write_File(index_path, entries, index.count, generation);
+
+    SGJW_Free(entries);
+    State_Grid_JPEG_Index_Close(&index);
+
+    if (retval == SGJW_SUCCESS && journal)
+        retval = Journal_Reset(journal, generation + 1);
+    return retval;
+}
+
+void State_Grid_JPEG_Index_Journal_Close(SGJWIndexJournal* journal)
+{
+    if (!journal)
+        return;
+
+    if (journal->fd >= 0)
+        close(journal->fd);
+    memset(journal, 0, sizeof(SGJWIndexJournal));
+    journal->fd = -1;
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+/**
+ * @file sgjw_index.h
+ * @brief Persistent metadata index over many SGJW files.
+ *
+ * @note Typical usage:
+ * 1. Invoke State_Grid_JPEG_Index_Build once with the files of an archive, it probes them and writes the index.
+ * 2. Invoke State_Grid_JPEG_Index_Open to map the index, queries never open a JPEG.
+ * 3. Invoke State_Grid_JPEG_Index_Query with a date range, a serial number and / or a GPS box.
+ * 4. State_Grid_JPEG_Index_Get gives path and matrix offset of each match, e.g. for State_Grid_JPEG_Read_Matrix.
+ * 5. Call State_Grid_JPEG_Index_Close to unmap it.
+ *
+ * The index file is columnar and little-endian: one array per field, records sorted by date, so a date
+ * range is a binary search and the other filters scan only the columns they need. A uniform grid over
+ * the GPS bounds lists the records of each cell, a box query only visits the cells it overlaps.
+ * The file is written to a temporary name and renamed, readers keep a consistent mapping while it is rebuilt.
+ *
+ * Rewriting the index costs the whole archive, so an ingester appends new captures to a journal beside it
+ * ("<index>.journal") instead: State_Grid_JPEG_Index_Journal_Append writes and flushes one batch, and
+ * State_Grid_JPEG_Index_Open picks the journal up, so queries see a capture as soon as its batch is flushed.
+ * State_Grid_JPEG_Index_Compact folds the journal into the index now and then. The index records which
+ * journal generation it folded, a crash at any point neither loses nor duplicates a capture.
+ * One process at a time may write the index and its journal.
+ */
+
+#include "sgjw.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One indexed capture
+typedef struct
+{
+    char date[SGJW_DATE_LENGTH + 1];
+    char manufacturer[SGJW_TEXT_LENGTH + 1];
+    char product[SGJW_TEXT_LENGTH + 1];
+    char sn[SGJW_TEXT_LENGTH + 1];
+    double longitude;
+    double latitude;
+    uint32_t altitude;
+    uint16_t width;
+    uint16_t height;
+    // File offset of the matrix, see StateGridJPEGProbe.
+    uint64_t matrix_offset;
+    // Size of the file when it was indexed, a changed size means the offsets are stale.
+    uint64_t file_size;
+    // @attention Borrowed from the index mapping (Get) or from the caller (Write).
+    const char* path;
+} SGJWIndexEntry;
+
+// Query filters, zero-initialize and set the ones needed
+typedef struct
+{
+    // Inclusive date range as stored (YYYYMMDDhhmmss), NULL for open ends.
+    const char* date_from;
+    const char* date_to;
+    // Exact serial number, NULL for any.
+    const char* sn;
+    // Inclusive GPS box, only used when use_box is set.
+    uint8_t use_box;
+    double longitude_min;
+    double longitude_max;
+    double latitude_min;
+    double latitude_max;
+} SGJWIndexQuery;
+
+// A mapped index
+typedef struct
+{
+    // Number of indexed captures, including the journal.
+    uint32_t count;
+
+    // Private
+    void* map_base;
+    size_t map_size;
+    uint32_t indexed;
+    uint32_t journal_count;
+    SGJWIndexEntry* journal;
+    char* journal_paths;
+} SGJWIndex;
+
+// The journal of an index, held by its writer
+typedef struct
+{
+    // Captures appended since the last compaction.
+    uint32_t count;
+
+    // Private
+    int fd;
+    uint64_t generation;
+    uint64_t size;
+} SGJWIndexJournal;
+
+/**
+ * @brief Write an index file from entries, e.g. collected while ingesting.
+ *
+ * @note The new index replaces its journal as well.
+ *
+ * @param index_path The index file to create or replace.
+ * @param entries The captures, in any order.
+ * @param count Number of entries.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Index_Write(const char* index_path, const SGJWIndexEntry* entries, size_t count);
+
+/**
+ * @brief Probe a list of files and write their index, files that fail to probe are left out.
+ *
+ * @param index_path The index file to create or replace.
+ * @param filepaths The files to index.
+ * @param count Number of files.
+ * @param indexed Optional, receives the number of files in the index.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Index_Build(const char* index_path, const char* const* filepaths, size_t count, size_t* indexed);
+
+/**
+ * @brief Fill an index entry from a probed file, e.g. to add it to State_Grid_JPEG_Index_Write.
+ *
+ * @param filepath The path of the probed file, borrowed by the entry.
+ * @param probe The result of State_Grid_JPEG_Probe.
+ * @param entry Output.
+ */
+void State_Grid_JPEG_Index_Entry_From_Probe(const char* filepath, const StateGridJPEGProbe* probe, SGJWIndexEntry* entry);
+
+/**
+ * @brief Map an index file, check its layout and load the captures of its journal.
+ *
+ * @param index_path The index file.
+ * @param index Output.
+ * @return SGJW_ERROR_READ_FAILED if the file is not a valid index, otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Index_Open(const char* index_path, SGJWIndex* index);
+
+/**
+ * @brief Find the captures matching every set filter.
+ *
+ * @param index A mapped index.
+ * @param query The filters.
+ * @param results Output, record numbers in date order, may be NULL when capacity is 0.
+ * @param capacity Size of results.
+ * @return The number of matches, which may exceed capacity (only the first capacity are stored).
+ */
+size_t State_Grid_JPEG_Index_Query(const SGJWIndex* index, const SGJWIndexQuery* query, uint32_t* results, size_t capacity);
+
+/**
+ * @brief Get one record of the index.
+ *
+ * @param index A mapped index.
+ * @param record A record number below index->count, e.g. from State_Grid_JPEG_Index_Query.
+ * @param entry Output, path points into the mapping.
+ * @return SGJW_ERROR_INVALID_PARAMS if record is out of range, otherwise SGJW_SUCCESS.
+ */
+int8_t State_Grid_JPEG_Index_Get(const SGJWIndex* index, uint32_t record, SGJWIndexEntry* entry);
+
+/**
+ * @brief Unmap an index, all paths borrowed from it become invalid.
+ *
+ * @param index The index to close.
+ */
+void State_Grid_JPEG_Index_Close(SGJWIndex* index);
+
+/**
+ * @brief Open the journal of an index for appending, creating an empty index and journal on first use.
+ *
+ * @note A record torn by a crash is cut off, a journal already folded into the index is started anew.
+ *
+ * @param index_path The index file.
+ * @param journal Output.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Index_Journal_Open(const char* index_path, SGJWIndexJournal* journal);
+
+/**
+ * @brief Append captures to the journal and flush them to disk with a single write.
+ *
+ * @param journal An open journal.
+ * @param entries The captures.
+ * @param count Number of entries.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation, on failure nothing is appended.
+ */
+int8_t State_Grid_JPEG_Index_Journal_Append(SGJWIndexJournal* journal, const SGJWIndexEntry* entries, size_t count);
+
+/**
+ * @brief Rewrite the index with the captures of its journal and empty the journal.
+ *
+ * @param index_path The index file.
+ * @param journal The open journal of the writer, or NULL when none is open.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Index_Compact(const char* index_path, SGJWIndexJournal* journal);
+
+/**
+ * @brief Close a journal.
+ *
+ * @param journal The journal to close.
+ */
+void State_Grid_JPEG_Index_Journal_Close(SGJWIndexJournal* journal);
+
+#ifdef __cplusplus
+}
+#endif
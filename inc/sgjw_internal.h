@@ -0,0 +1,195 @@
+#pragma once
+
+/**
+ * @file sgjw_internal.h
+ * @brief Helpers shared by the SGJW modules (sgjw_*.c), not part of the public API.
+ */
+
+#include "sgjw.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ====================================================================================================== */
+/* ======================================== File Layout ================================================= */
+/* ====================================================================================================== */
+
+// Field sizes
+#define SGJW_EOF_BYTES 16
+#define SGJW_OFFSET_BYTES 4
+#define SGJW_VERSION_BYTES 2
+#define SGJW_WIDTH_BYTES 2
+#define SGJW_HEIGHT_BYTES 2
+#define SGJW_DATE_BYTES 14
+#define SGJW_FLOAT32_BYTES 4
+#define SGJW_EMISSIVITY_BYTES 4
+#define SGJW_AMBIENT_TEMP_BYTES 4
+#define SGJW_FOV_BYTES 1
+#define SGJW_DISTANCE_BYTES 4
+#define SGJW_HUMIDITY_BYTES 1
+#define SGJW_REFLECTIVE_TEMP_BYTES 4
+#define SGJW_MANUFACTURER_BYTES 32
+#define SGJW_PRODUCT_BYTES 32
+#define SGJW_SN_BYTES 32
+#define SGJW_LONGITUDE_BYTES 8
+#define SGJW_LATITUDE_BYTES 8
+#define SGJW_ALTITUDE_BYTES 4
+#define SGJW_APPENDIX_LENGTH_BYTES 4
+
+// Offset + EOF signature at the very end of the file
+#define SGJW_TAIL_BYTES (SGJW_OFFSET_BYTES + SGJW_EOF_BYTES)
+
+// Fixed fields in front of the matrix (version ~ date)
+#define SGJW_HEADER_BYTES (SGJW_VERSION_BYTES + SGJW_WIDTH_BYTES + SGJW_HEIGHT_BYTES + SGJW_DATE_BYTES)
+
+// clang-format off
+// Fixed fields behind the matrix (emissivity ~ appendix length)
+#define SGJW_FOOTER_BYTES (SGJW_EMISSIVITY_BYTES + SGJW_AMBIENT_TEMP_BYTES + SGJW_FOV_BYTES + SGJW_DISTANCE_BYTES + \
+                           SGJW_HUMIDITY_BYTES + SGJW_REFLECTIVE_TEMP_BYTES + SGJW_MANUFACTURER_BYTES + SGJW_PRODUCT_BYTES + \
+                           SGJW_SN_BYTES + SGJW_LONGITUDE_BYTES + SGJW_LATITUDE_BYTES + SGJW_ALTITUDE_BYTES + SGJW_APPENDIX_LENGTH_BYTES)
+// clang-format on
+
+// Host byte order, the file is always little-endian
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define SGJW_HOST_LITTLE_ENDIAN 0
+#else
+#define SGJW_HOST_LITTLE_ENDIAN 1
+#endif
+
+// SIMD of the build target, kernels for other instruction sets are still picked at run time
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SGJW_HAVE_NEON 1
+#else
+#define SGJW_HAVE_NEON 0
+#endif
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#define SGJW_HAVE_X86 1
+#else
+#define SGJW_HAVE_X86 0
+#endif
+
+// Header, footer and tail packed back to back, i.e. a trailer without matrix and appendix
+#define SGJW_FIXED_BYTES (SGJW_HEADER_BYTES + SGJW_FOOTER_BYTES + SGJW_TAIL_BYTES)
+
+/* ====================================================================================================== */
+/* ======================================== Shared Helpers ============================================== */
+/* ====================================================================================================== */
+
+/**
+ * @brief Allocate through the allocator set by State_Grid_JPEG_Set_Allocator.
+ * 
+ * @param size Number of bytes.
+ * @param align Alignment, a power of two.
+ * @return The memory, or NULL on failure.
+ */
+void* SGJW_Malloc(size_t size, size_t align);
+
+/**
+ * @brief Release memory from SGJW_Malloc, NULL is ignored.
+ */
+void SGJW_Free(void* ptr);
+
+/**
+ * @brief Add to the counter returned by State_Grid_JPEG_Get_Bytes_Read, for reads issued outside sgjw.c.
+ */
+void SGJW_Count_Bytes_Read(uint64_t bytes);
+
+/**
+ * @brief Positioned read, step 1: verify the tail of a file.
+ * 
+ * @param fixed A packed header | footer | tail buffer of SGJW_FIXED_BYTES, with only the tail filled.
+ * @param file_size Size of the file.
+ * @param offset Output, file offset of the trailer.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t SGJW_Check_Tail(uint8_t* fixed, uint64_t file_size, uint64_t* offset);
+
+/**
+ * @brief Positioned read, step 2: size the matrix from the header.
+ * 
+ * @param fixed The packed buffer of SGJW_Check_Tail, now with the header filled.
+ * @param file_size Size of the file.
+ * @param offset File offset of the trailer.
+ * @param matrix_size Output, matrix bytes, the footer sits at offset + SGJW_HEADER_BYTES + matrix_size.
+ * @return SGJW_ERROR_FIELD_READ_FAILED if the matrix does not fit in the file.
+ */
+int8_t SGJW_Check_Header(const uint8_t* fixed, uint64_t file_size, uint64_t offset, size_t* matrix_size);
+
+/**
+ * @brief Positioned read, step 3: parse the fixed fields with the field table and locate matrix and appendix.
+ * 
+ * @param fixed The packed buffer, now complete.
+ * @param file_size Size of the file.
+ * @param offset File offset of the trailer.
+ * @param obj Receives the fixed fields, its block is not touched.
+ * @param probe Receives the byte ranges, probe->header is not touched.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t SGJW_Parse_Fixed(uint8_t* fixed, uint64_t file_size, uint64_t offset, StateGridJPEGV2* obj, StateGridJPEGProbe* probe);
+
+/**
+ * @brief Borrow the fields of a trailer in memory into a view, as State_Grid_JPEG_Map does.
+ *
+ * @param base The memory holding the trailer, e.g. a mapping.
+ * @param offset Position of the trailer in base.
+ * @param trailer_end Position of the tail in base.
+ * @param view Receives the fields, map_base is not touched. The matrix is copied into matrix_copy when the host needs it.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t SGJW_View_Trailer(uint8_t* base, size_t offset, size_t trailer_end, StateGridJPEGView* view);
+
+/**
+ * @brief Monotonic clock in nanoseconds, for durations and deadlines.
+ */
+uint64_t SGJW_Now_Ns(void);
+
+/**
+ * @brief Whether a file name ends in .jpg / .jpeg, case-insensitive.
+ */
+uint8_t SGJW_Is_JPEG_Name(const char* name);
+
+/**
+ * @brief The file name of a path, NULL if it cannot be created in a folder as is (empty, "." or "..").
+ */
+const char* SGJW_File_Name(const char* path);
+
+/**
+ * @brief SGJW_ERROR_INVALID_PARAMS if two of the paths share a file name, i.e. they would overwrite each other in one folder.
+ */
+int8_t SGJW_Check_Unique_Names(const char* const* filepaths, size_t count);
+
+/**
+ * @brief Widen a date prefix to a full key, "2015" becomes 20150000000000 with fill '0' or 20159999999999 with '9'.
+ */
+void SGJW_Date_Key(const char* date, char fill, char key[SGJW_DATE_BYTES]);
+
+/**
+ * @brief Binary search of a date-ordered array: first element whose date is >= key (upper = 0) or > key (upper = 1).
+ *
+ * @param dates Date of the first element.
+ * @param stride Bytes from one date to the next.
+ * @param count Number of elements.
+ */
+uint32_t SGJW_Date_Bound(const void* dates, size_t stride, uint32_t count, const char key[SGJW_DATE_BYTES], uint8_t upper);
+
+/**
+ * @brief pread until size bytes are in, retried on EINTR and counted in State_Grid_JPEG_Get_Bytes_Read.
+ *
+ * @return SGJW_ERROR_READ_FAILED on an error or a premature end of file.
+ */
+int8_t SGJW_Pread_Full(int fd, void* buffer, size_t size, uint64_t offset);
+
+/**
+ * @brief pwrite until size bytes are out, retried on EINTR.
+ *
+ * @return SGJW_ERROR_FILE_WRITE on an error.
+ */
+int8_t SGJW_Pwrite_Full(int fd, const void* data, size_t size, uint64_t offset);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,508 @@
+#include "sgjw_pyramid.h"
+#include "sgjw_internal.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Matrix rows read and decoded at once when building from a file
+#define SGJW_PYRAMID_BAND_BYTES (256 * 1024)
+
+// Sidecar suffix of State_Grid_JPEG_Pyramid_Cached
+#define SGJW_PYRAMID_SUFFIX ".pyr"
+
+#define SGJW_PYRAMID_MAGIC "SGJWPYR"
+#define SGJW_PYRAMID_VERSION 1
+
+/* ====================================================================================================== */
+/* ======================================== Helper Structures =========================================== */
+/* ====================================================================================================== */
+
+// Head of a cache file, then min / max / mean of every level, all little-endian
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint16_t width;
+    uint16_t height;
+    uint8_t levels;
+    uint8_t reserved[7];
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+} PyramidHeader;
+
+/* ====================================================================================================== */
+/* ======================================== Helper Functions ============================================ */
+/* ====================================================================================================== */
+
+// Between host and file byte order, either way
+static void Pyramid_Header_Swap(PyramidHeader* header)
+{
+#if !SGJW_HOST_LITTLE_ENDIAN
+    header->version = __builtin_bswap32(header->version);
+    header->width = __builtin_bswap16(header->width);
+    header->height = __builtin_bswap16(header->height);
+    header->source_size = __builtin_bswap64(header->source_size);
+    header->source_mtime_ns = (int64_t)__builtin_bswap64((uint64_t)header->source_mtime_ns);
+#else
+    (void)header;
+#endif
+}
+
+static uint8_t Pyramid_Max_Levels(uint16_t width, uint16_t height)
+{
+    uint8_t levels = 0;
+    while (width > 1 || height > 1)
+    {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        ++levels;
+    }
+    return levels;
+}
+
+// Pixels of an axis of size n covered by cell x of level l
+static uint32_t Pyramid_Cell_Span(uint8_t level, uint32_t x, uint32_t n)
+{
+    uint32_t span = 1u << (level + 1);
+    uint32_t first = x * span;
+    return n - first < span ? n - first : span;
+}
+
+// Cache line aligned plane size, in floats
+static size_t Pyramid_Plane_Floats(const SGJWPyramidLevel* level)
+{
+    return ((size_t)level->width * level->height + 15) & ~(size_t)15;
+}
+
+/**
+ * @brief Size the levels and carve their planes out of one allocation.
+ */
+static int8_t Pyramid_Alloc(SGJWPyramid* pyramid, uint16_t width, uint16_t height, uint8_t levels)
+{
+    memset(pyramid, 0, sizeof(SGJWPyramid));
+    if (width == 0 || height == 0)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    uint8_t most = Pyramid_Max_Levels(width, height);
+    if (levels == 0 || levels > most)
+        levels = most;
+    if (levels > SGJW_PYRAMID_MAX_LEVELS)
+        levels = SGJW_PYRAMID_MAX_LEVELS;
+
+    pyramid->width = width;
+    pyramid->height = height;
+    pyramid->levels = levels;
+
+    size_t total = 0;
+    for (uint8_t l = 0; l < levels; ++l)
+    {
+        SGJWPyramidLevel* level = &pyramid->level[l];
+        level->width = ((l ? pyramid->level[l - 1].width : width) + 1) / 2;
+        level->height = ((l ? pyramid->level[l - 1].height : height) + 1) / 2;
+        total += Pyramid_Plane_Floats(level) * 3;
+    }
+
+    // A 1x1 matrix has no level
+    if (total == 0)
+        return SGJW_SUCCESS;
+
+    float* planes = (float*)SGJW_Malloc(total * sizeof(float), SGJW_CACHE_LINE);
+    if (!planes)
+        return SGJW_ERROR_MALLOC_FAILED;
+
+    pyramid->block = planes;
+    for (uint8_t l = 0; l < levels; ++l)
+    {
+        SGJWPyramidLevel* level = &pyramid->level[l];
+        size_t plane = Pyramid_Plane_Floats(level);
+        level->min = planes;
+        level->max = planes + plane;
+        level->mean = planes + plane * 2;
+        planes += plane * 3;
+    }
+    return SGJW_SUCCESS;
+}
+
+/**
+ * @brief Reduce one or two matrix rows into a row of level 0.
+ *
+ * @param row1 The second row, NULL for the last row of an odd height.
+ */
+static void Pyramid_Reduce_Rows(const float* row0, const float* row1, uint16_t width, SGJWPyramidLevel* level, uint16_t y)
+{
+    float* min = level->min + (size_t)y * level->width;
+    float* max = level->max + (size_t)y * level->width;
+    float* mean = level->mean + (size_t)y * level->width;
+
+    for (uint16_t x = 0; x < level->width; ++x)
+    {
+        uint32_t first = (uint32_t)x * 2;
+        uint32_t columns = first + 1 < width ? 2 : 1;
+        float low = INFINITY;
+        float high = -INFINITY;
+        float sum = 0.0f;
+
+        // NaN fails both compares, min / max skip it while the sum carries it into the mean
+        for (const float* row = row0; row; row = row == row0 ? row1 : NULL)
+        {
+            for (uint32_t c = 0; c < columns; ++c)
+            {
+                float v = row[first + c];
+                low = v < low ? v : low;
+                high = v > high ? v : high;
+                sum += v;
+            }
+        }
+
+        uint32_t count = columns * (row1 ? 2 : 1);
+        min[x] = low <= high ? low : NAN;
+        max[x] = low <= high ? high : NAN;
+        mean[x] = sum / count;
+    }
+}
+
+/**
+ * @brief Reduce level l - 1 into level l, means weighted by the pixels each cell covers.
+ */
+static void Pyramid_Reduce_Level(SGJWPyramid* pyramid, uint8_t l)
+{
+    const SGJWPyramidLevel* fine = &pyramid->level[l - 1];
+    SGJWPyramidLevel* coarse = &pyramid->level[l];
+
+    for (uint16_t y = 0; y < coarse->height; ++y)
+    {
+        for (uint16_t x = 0; x < coarse->width; ++x)
+        {
+            float low = INFINITY;
+            float high = -INFINITY;
+            double sum = 0.0;
+            double weight = 0.0;
+
+            for (uint32_t cy = (uint32_t)y * 2; cy < (uint32_t)y * 2 + 2 && cy < fine->height; ++cy)
+            {
+                for (uint32_t cx = (uint32_t)x * 2; cx < (uint32_t)x * 2 + 2 && cx < fine->width; ++cx)
+                {
+                    size_t i = (size_t)cy * fine->width + cx;
+                    double pixels = (double)Pyramid_Cell_Span(l - 1, cx, pyramid->width) * Pyramid_Cell_Span(l - 1, cy, pyramid->height);
+                    low = fine->min[i] < low ? fine->min[i] : low;
+                    high = fine->max[i] > high ? fine->max[i] : high;
+                    sum += fine->mean[i] * pixels;
+                    weight += pixels;
+                }
+            }
+
+            size_t o = (size_t)y * coarse->width + x;
+            coarse->min[o] = low <= high ? low : NAN;
+            coarse->max[o] = low <= high ? high : NAN;
+            coarse->mean[o] = (float)(sum / weight);
+        }
+    }
+}
+
+// Floats of all the planes, in file order
+static size_t Pyramid_Floats(const SGJWPyramid* pyramid)
+{
+    size_t total = 0;
+    for (uint8_t l = 0; l < pyramid->levels; ++l)
+        total += (size_t)pyramid->level[l].width * pyramid->level[l].height * 3;
+    return total;
+}
+
+/* ====================================================================================================== */
+/* ======================================== Main APIs =================================================== */
+/* ====================================================================================================== */
+
+int8_t State_Grid_JPEG_Pyramid_Build(const float* matrix, uint16_t width, uint16_t height, uint8_t levels, SGJWPyramid* pyramid)
+{
+    if (!matrix || !pyramid)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    int8_t retval = Pyramid_Alloc(pyramid, width, height, levels);
+    if (retval != SGJW_SUCCESS || pyramid->levels == 0)
+        return retval;
+
+    for (uint32_t y = 0; y < height; y += 2)
+    {
+        const float* row0 = matrix + (size_t)y * width;
+        Pyramid_Reduce_Rows(row0, y + 1 < height ? row0 + width : NULL, width, &pyramid->level[0], y / 2);
+    }
+    for (uint8_t l = 1; l < pyramid->levels; ++l)
+        Pyramid_Reduce_Level(pyramid, l);
+
+    return SGJW_SUCCESS;
+}
+
+int8_t State_Grid_JPEG_Read_Pyramid(const char* filepath, uint8_t levels, SGJWPyramid* pyramid)
+{
+    if (!filepath || !pyramid)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    memset(pyramid, 0, sizeof(SGJWPyramid));
+
+    /* ---------- Step 1 : Locate the matrix ---------- */
+
+    StateGridJPEGProbe probe;
+    int8_t retval = State_Grid_JPEG_Probe(filepath, &probe);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0)
+        return SGJW_ERROR_FILE_NOT_FOUND;
+
+    float* band = NULL;
+    struct stat st;
+    uint16_t width = probe.header.width;
+    uint16_t height = probe.header.height;
+
+    // A file rewritten since the probe no longer matches its byte ranges
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size != probe.file_size)
+    {
+        retval = SGJW_ERROR_INVALID_OFFSET;
+        goto cleanup;
+    }
+
+    retval = Pyramid_Alloc(pyramid, width, height, levels);
+    if (retval != SGJW_SUCCESS)
+        goto cleanup;
+
+    // Even without levels, so the sidecar of a 1x1 matrix matches its file
+    pyramid->source_size = probe.file_size;
+    pyramid->source_mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    if (pyramid->levels == 0)
+        goto cleanup;
+
+    /* ---------- Step 2 : Level 0 from bands of an even number of rows, read and decoded in place ---------- */
+
+    size_t row_bytes = (size_t)width * SGJW_FLOAT32_BYTES;
+    uint32_t band_rows = (uint32_t)(SGJW_PYRAMID_BAND_BYTES / row_bytes) & ~1u;
+    band_rows = band_rows < 2 ? 2 : band_rows;
+    band_rows = band_rows > height ? height : band_rows;
+
+    band = (float*)SGJW_Malloc(row_bytes * band_rows, SGJW_CACHE_LINE);
+    if (!band)
+    {
+        retval = SGJW_ERROR_MALLOC_FAILED;
+        goto cleanup;
+    }
+
+    for (uint32_t y = 0; y < height && retval == SGJW_SUCCESS; y += band_rows)
+    {
+        uint32_t rows = height - y < band_rows ? height - y : band_rows;
+        retval = SGJW_Pread_Full(fd, band, row_bytes * rows, probe.matrix_offset + row_bytes * y);
+        if (retval != SGJW_SUCCESS)
+            break;
+        State_Grid_JPEG_Matrix_Decode((const uint8_t*)band, (size_t)width * rows, band);
+
+        for (uint32_t r = 0; r < rows; r += 2)
+        {
+            const float* row0 = band + (size_t)r * width;
+            Pyramid_Reduce_Rows(row0, r + 1 < rows ? row0 + width : NULL, width, &pyramid->level[0], (y + r) / 2);
+        }
+    }
+
+    /* ---------- Step 3 : Coarser levels from level 0 ---------- */
+
+    for (uint8_t l = 1; l < pyramid->levels && retval == SGJW_SUCCESS; ++l)
+        Pyramid_Reduce_Level(pyramid, l);
+
+cleanup:
+    SGJW_Free(band);
+    close(fd);
+    if (retval != SGJW_SUCCESS)
+        State_Grid_JPEG_Pyramid_Delete(pyramid);
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Pyramid_Save(const char* path, const SGJWPyramid* pyramid)
+{
+    if (!path || !pyramid)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    /* ---------- Step 1 : Header and planes in one buffer ---------- */
+
+    size_t floats = Pyramid_Floats(pyramid);
+    size_t size = sizeof(PyramidHeader) + floats * SGJW_FLOAT32_BYTES;
+    uint8_t* buffer = (uint8_t*)SGJW_Malloc(size, SGJW_CACHE_LINE);
+    if (!buffer)
+        return SGJW_ERROR_MALLOC_FAILED;
+
+    PyramidHeader header;
+    memset(&header, 0, sizeof(PyramidHeader));
+    memcpy(header.magic, SGJW_PYRAMID_MAGIC, sizeof(SGJW_PYRAMID_MAGIC));
+    header.version = SGJW_PYRAMID_VERSION;
+    header.width = pyramid->width;
+    header.height = pyramid->height;
+    header.levels = pyramid->levels;
+    header.source_size = pyramid->source_size;
+    header.source_mtime_ns = pyramid->source_mtime_ns;
+    Pyramid_Header_Swap(&header);
+    memcpy(buffer, &header, sizeof(PyramidHeader));
+
+    uint8_t* cursor = buffer + sizeof(PyramidHeader);
+    for (uint8_t l = 0; l < pyramid->levels; ++l)
+    {
+        const SGJWPyramidLevel* level = &pyramid->level[l];
+        size_t count = (size_t)level->width * level->height;
+        const float* planes[3] = {level->min, level->max, level->mean};
+        for (int p = 0; p < 3; ++p, cursor += count * SGJW_FLOAT32_BYTES)
+            State_Grid_JPEG_Matrix_Encode(planes[p], count, cursor);
+    }
+
+    /* ---------- Step 2 : Temporary file, synced, then rename ---------- */
+
+    char temp[4096];
+    int8_t retval = SGJW_SUCCESS;
+    if (snprintf(temp, sizeof(temp), "%s.tmp", path) >= (int)sizeof(temp))
+        retval = SGJW_ERROR_INVALID_PARAMS;
+
+    int fd = retval == SGJW_SUCCESS ? open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    if (retval == SGJW_SUCCESS && fd < 0)
+        retval = SGJW_ERROR_FILE_WRITE;
+    if (retval == SGJW_SUCCESS)
+        retval = SGJW_Pwrite_Full(fd, buffer, size, 0);
+    if (retval == SGJW_SUCCESS && fsync(fd) != 0)
+        retval = SGJW_ERROR_FILE_WRITE;
+    if (fd >= 0 && close(fd) != 0 && retval == SGJW_SUCCESS)
+        retval = SGJW_ERROR_FILE_WRITE;
+    if (retval == SGJW_SUCCESS && rename(temp, path) != 0)
+        retval = SGJW_ERROR_FILE_WRITE;
+    if (fd >= 0 && retval != SGJW_SUCCESS)
+        unlink(temp);
+
+    SGJW_Free(buffer);
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Pyramid_Load(const char* path, SGJWPyramid* pyramid)
+{
+    if (!path || !pyramid)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    memset(pyramid, 0, sizeof(SGJWPyramid));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return SGJW_ERROR_FILE_NOT_FOUND;
+
+    /* ---------- Step 1 : Header, the sizes must match the levels it announces ---------- */
+
+    PyramidHeader header;
+    struct stat st;
+    int8_t retval = SGJW_Pread_Full(fd, &header, sizeof(PyramidHeader), 0);
+    Pyramid_Header_Swap(&header);
+    if (retval == SGJW_SUCCESS && (memcmp(header.magic, SGJW_PYRAMID_MAGIC, sizeof(SGJW_PYRAMID_MAGIC)) != 0 ||
+                                   header.version != SGJW_PYRAMID_VERSION || header.width == 0 || header.height == 0 ||
+                                   header.levels > Pyramid_Max_Levels(header.width, header.height)))
+        retval = SGJW_ERROR_READ_FAILED;
+
+    // A 1x1 matrix has no level, which Pyramid_Alloc would take as "every level"
+    if (retval == SGJW_SUCCESS && header.levels == 0)
+    {
+        pyramid->width = header.width;
+        pyramid->height = header.height;
+    }
+    else if (retval == SGJW_SUCCESS)
+    {
+        retval = Pyramid_Alloc(pyramid, header.width, header.height, header.levels);
+        if (retval == SGJW_SUCCESS && pyramid->levels != header.levels)
+            retval = SGJW_ERROR_READ_FAILED;
+    }
+
+    size_t floats = retval == SGJW_SUCCESS ? Pyramid_Floats(pyramid) : 0;
+    if (retval == SGJW_SUCCESS && (fstat(fd, &st) != 0 || (uint64_t)st.st_size != sizeof(PyramidHeader) + floats * SGJW_FLOAT32_BYTES))
+        retval = SGJW_ERROR_READ_FAILED;
+
+    /* ---------- Step 2 : Each plane straight into place ---------- */
+
+    uint64_t offset = sizeof(PyramidHeader);
+    for (uint8_t l = 0; l < pyramid->levels && retval == SGJW_SUCCESS; ++l)
+    {
+        SGJWPyramidLevel* level = &pyramid->level[l];
+        size_t count = (size_t)level->width * level->height;
+        float* planes[3] = {level->min, level->max, level->mean};
+        for (int p = 0; p < 3 && retval == SGJW_SUCCESS; ++p, offset += count * SGJW_FLOAT32_BYTES)
+        {
+            retval = SGJW_Pread_Full(fd, planes[p], count * SGJW_FLOAT32_BYTES, offset);
+            State_Grid_JPEG_Matrix_Decode((const uint8_t*)planes[p], count, planes[p]);
+        }
+    }
+    if (retval == SGJW_SUCCESS)
+    {
+        pyramid->source_size = header.source_size;
+        pyramid->source_mtime_ns = header.source_mtime_ns;
+    }
+
+    close(fd);
+    if (retval != SGJW_SUCCESS)
+        State_Grid_JPEG_Pyramid_Delete(pyramid);
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Pyramid_Cached(const char* filepath, uint8_t levels, SGJWPyramid* pyramid)
+{
+    if (!filepath || !pyramid)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    char sidecar[4096];
+    struct stat st;
+    if (snprintf(sidecar, sizeof(sidecar), "%s" SGJW_PYRAMID_SUFFIX, filepath) >= (int)sizeof(sidecar))
+        return SGJW_ERROR_INVALID_PARAMS;
+    if (stat(filepath, &st) != 0)
+        return SGJW_ERROR_FILE_NOT_FOUND;
+
+    // A sidecar of the same file version with enough levels is used as is
+    if (State_Grid_JPEG_Pyramid_Load(sidecar, pyramid) == SGJW_SUCCESS)
+    {
+        uint8_t most = Pyramid_Max_Levels(pyramid->width, pyramid->height);
+        uint8_t wanted = levels == 0 || levels > most ? most : levels;
+        int64_t mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+        if (pyramid->source_size == (uint64_t)st.st_size && pyramid->source_mtime_ns == mtime_ns && pyramid->levels >= wanted)
+            return SGJW_SUCCESS;
+        State_Grid_JPEG_Pyramid_Delete(pyramid);
+    }
+
+    int8_t retval = State_Grid_JPEG_Read_Pyramid(filepath, levels, pyramid);
+    if (retval == SGJW_SUCCESS)
+        (void)State_Grid_JPEG_Pyramid_Save(sidecar, pyramid);
+    return retval;
+}
+
+uint8_t State_Grid_JPEG_Pyramid_Level_For(const SGJWPyramid* pyramid, uint16_t max_width, uint16_t max_height)
+{
+    if (!pyramid || pyramid->levels == 0)
+        return 0;
+
+    for (uint8_t l = 0; l < pyramid->levels; ++l)
+    {
+        if (pyramid->level[l].width <= max_width && pyramid->level[l].height <= max_height)
+            return l;
+    }
+    return pyramid->levels - 1;
+}
+
+int8_t State_Grid_JPEG_Pyramid_Sample(const SGJWPyramid* pyramid, uint8_t level, uint16_t x, uint16_t y, float* values)
+{
+    if (!pyramid || !values || level >= pyramid->levels || x >= pyramid->width || y >= pyramid->height)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    const SGJWPyramidLevel* cells = &pyramid->level[level];
+    size_t i = (size_t)(y >> (level + 1)) * cells->width + (x >> (level + 1));
+    values[0] = cells->min[i];
+    values[1] = cells->max[i];
+    values[2] = cells->mean[i];
+    return SGJW_SUCCESS;
+}
+
+void State_Grid_JPEG_Pyramid_Delete(SGJWPyramid* pyramid)
+{
+    if (!pyramid)
+        return;
+
+    SGJW_Free(pyramid->block);
+    memset(pyramid, 0, sizeof(SGJWPyramid));
+}
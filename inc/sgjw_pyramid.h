@@ -0,0 +1,138 @@
+#pragma once
+
+/**
+ * @file sgjw_pyramid.h
+ * @brief Reduced-resolution levels of a temperature matrix for previews and coarse zoom.
+ *
+ * @note Typical usage:
+ * 1. Invoke State_Grid_JPEG_Pyramid_Cached with a file, it loads "<file>.pyr" or builds and writes it.
+ * 2. State_Grid_JPEG_Pyramid_Level_For picks the level fitting a thumbnail, e.g. to render its max plane.
+ * 3. State_Grid_JPEG_Pyramid_Sample gives min / max / mean under the cursor at that zoom.
+ * 4. Call State_Grid_JPEG_Pyramid_Delete to release it.
+ *
+ * Level 0 halves the matrix, each further level halves the previous one (odd sizes round up). Every cell
+ * keeps the min, max and mean of all the pixels it covers, so a single hot pixel still shows in the max
+ * plane of a 10x10 thumbnail. Built from a file the matrix streams through a band of rows, it is never
+ * held whole. All levels together take as much memory as the matrix.
+ */
+
+#include "sgjw.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Levels of a pyramid at most, enough to reduce 65535 pixels to 1
+#define SGJW_PYRAMID_MAX_LEVELS 16
+
+// One level, cell (x, y) of level l covers the pixels [x << (l + 1), (x + 1) << (l + 1)) of each axis
+typedef struct
+{
+    uint16_t width;
+    uint16_t height;
+    // Row-major planes of width * height values. NaN pixels are skipped by min / max and spread into mean.
+    float* min;
+    float* max;
+    float* mean;
+} SGJWPyramidLevel;
+
+typedef struct
+{
+    // Size of the full matrix.
+    uint16_t width;
+    uint16_t height;
+    uint8_t levels;
+    SGJWPyramidLevel level[SGJW_PYRAMID_MAX_LEVELS];
+    // Size and modification time of the source file, 0 when built from memory.
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+
+    // Private
+    void* block;
+} SGJWPyramid;
+
+/**
+ * @brief Build a pyramid from a decoded matrix.
+ *
+ * @param matrix Host floats, width * height values.
+ * @param width Matrix width.
+ * @param height Matrix height.
+ * @param levels Number of levels, 0 to go on until a single cell is left.
+ * @param pyramid Output, release with State_Grid_JPEG_Pyramid_Delete.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Pyramid_Build(const float* matrix, uint16_t width, uint16_t height, uint8_t levels, SGJWPyramid* pyramid);
+
+/**
+ * @brief Build a pyramid while decoding the matrix of a file, a few rows at a time.
+ *
+ * @param filepath The path to a JPEG file with a trailer.
+ * @param levels Number of levels, 0 to go on until a single cell is left.
+ * @param pyramid Output, release with State_Grid_JPEG_Pyramid_Delete.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Read_Pyramid(const char* filepath, uint8_t levels, SGJWPyramid* pyramid);
+
+/**
+ * @brief Write a pyramid to a cache file, through a temporary file so readers never see half of it.
+ *
+ * @param path The cache file.
+ * @param pyramid The pyramid.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Pyramid_Save(const char* path, const SGJWPyramid* pyramid);
+
+/**
+ * @brief Read a pyramid from a cache file.
+ *
+ * @param path The cache file.
+ * @param pyramid Output, release with State_Grid_JPEG_Pyramid_Delete.
+ * @return SGJW_ERROR_READ_FAILED if the file is not a valid pyramid, otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Pyramid_Load(const char* path, SGJWPyramid* pyramid);
+
+/**
+ * @brief Get the pyramid of a file from its sidecar "<filepath>.pyr", building and writing it when missing or stale.
+ *
+ * @note The sidecar is stale once size or modification time of the file changed. It is only a cache: when it
+ *       cannot be written, e.g. in a read-only folder, the pyramid is still returned.
+ *
+ * @param filepath The path to a JPEG file with a trailer.
+ * @param levels Number of levels, 0 for all. A sidecar with fewer levels is rebuilt.
+ * @param pyramid Output, release with State_Grid_JPEG_Pyramid_Delete.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Pyramid_Cached(const char* filepath, uint8_t levels, SGJWPyramid* pyramid);
+
+/**
+ * @brief Pick the finest level no larger than a box, e.g. a thumbnail.
+ *
+ * @param pyramid The pyramid.
+ * @param max_width Width of the box.
+ * @param max_height Height of the box.
+ * @return The level, or the coarsest one when none fits.
+ */
+uint8_t State_Grid_JPEG_Pyramid_Level_For(const SGJWPyramid* pyramid, uint16_t max_width, uint16_t max_height);
+
+/**
+ * @brief Get the statistics of the cell covering a pixel at a given level.
+ *
+ * @param pyramid The pyramid.
+ * @param level The level.
+ * @param x Column of the full matrix.
+ * @param y Row of the full matrix.
+ * @param values Output, min, max and mean.
+ * @return SGJW_ERROR_INVALID_PARAMS if level or pixel are out of range, otherwise SGJW_SUCCESS.
+ */
+int8_t State_Grid_JPEG_Pyramid_Sample(const SGJWPyramid* pyramid, uint8_t level, uint16_t x, uint16_t y, float* values);
+
+/**
+ * @brief Release a pyramid.
+ *
+ * @param pyramid The pyramid to release.
+ */
+void State_Grid_JPEG_Pyramid_Delete(SGJWPyramid* pyramid);
+
+#ifdef __cplusplus
+}
+#endif
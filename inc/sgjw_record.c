@@ -0,0 +1,458 @@
+#include "sgjw_record.h"
+#include "sgjw_internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Defaults of SGJWRecorderConfig
+#define SGJW_RECORD_DEFAULT_SLOTS 16
+#define SGJW_RECORD_DEFAULT_SYNC_FILES 16
+#define SGJW_RECORD_DEFAULT_SYNC_MS 500
+
+/* ====================================================================================================== */
+/* ======================================== Helper Structures =========================================== */
+/* ====================================================================================================== */
+
+// One frame of the ring, moves between the free list and the write queue
+typedef struct RecordSlot
+{
+    SGJWRecordFrame frame;
+    struct RecordSlot* next;
+    // Room for JPEG and trailer, State_Grid_JPEG_Append_Buffer serializes into it
+    size_t capacity;
+    float* matrix;
+    char* appendix;
+    uint64_t committed_us;
+} RecordSlot;
+
+struct SGJWRecorder
+{
+    SGJWRecorderConfig config;
+    int dirfd;
+    void* block;
+    RecordSlot* slots;
+
+    // Guards everything below
+    pthread_mutex_t lock;
+    pthread_cond_t slot_free;
+    pthread_cond_t slot_ready;
+    pthread_t writer;
+    RecordSlot* free_slots;
+    RecordSlot* queue_head;
+    RecordSlot* queue_tail;
+    uint8_t closing;
+
+    // Written files waiting for their sync, still open
+    int group[SGJW_RECORD_MAX_GROUP];
+    uint32_t group_count;
+    uint64_t group_start_us;
+
+    SGJWRecorderStats stats;
+    uint64_t latency_us_total;
+};
+
+/* ====================================================================================================== */
+/* ======================================== Helper Functions ============================================ */
+/* ====================================================================================================== */
+
+// The frame as the caller gets it: no name, zeroed metadata, matrix and appendix in the slot
+static void Recorder_Reset_Frame(RecordSlot* slot)
+{
+    slot->frame.name[0] = '\0';
+    slot->frame.jpeg_size = 0;
+    memset(&slot->frame.obj, 0, sizeof(StateGridJPEGV2));
+    slot->frame.obj.matrix = slot->matrix;
+    slot->frame.obj.appendix = slot->appendix;
+}
+
+// Called with the lock held
+static void Recorder_Release(SGJWRecorder* recorder, RecordSlot* slot)
+{
+    slot->next = recorder->free_slots;
+    recorder->free_slots = slot;
+    pthread_cond_signal(&recorder->slot_free);
+}
+
+/**
+ * @brief Serialize the trailer behind the JPEG of a slot and write the file at once, it is left open for its sync.
+ *
+ * @note A file that could not be written completely is removed.
+ */
+static int8_t Recorder_Write(SGJWRecorder* recorder, RecordSlot* slot, int* fd)
+{
+    size_t total_size = 0;
+    int8_t retval = State_Grid_JPEG_Append_Buffer(slot->frame.jpeg, slot->capacity, slot->frame.jpeg_size, &slot->frame.obj, &total_size);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    *fd = openat(recorder->dirfd, slot->frame.name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (*fd < 0)
+        return SGJW_ERROR_FILE_WRITE;
+
+    retval = SGJW_Pwrite_Full(*fd, slot->frame.jpeg, total_size, 0);
+    if (retval != SGJW_SUCCESS)
+    {
+        close(*fd);
+        unlinkat(recorder->dirfd, slot->frame.name, 0);
+    }
+    return retval;
+}
+
+/**
+ * @brief Sync the files of the current group back to back, then the folder once, and close them.
+ *
+ * @note Called with the lock held, it is released while syncing.
+ */
+static void Recorder_Sync(SGJWRecorder* recorder)
+{
+    int group[SGJW_RECORD_MAX_GROUP];
+    uint32_t count = recorder->group_count;
+    memcpy(group, recorder->group, count * sizeof(int));
+    recorder->group_count = 0;
+    pthread_mutex_unlock(&recorder->lock);
+
+    uint64_t start = SGJW_Now_Ns() / 1000;
+    uint32_t failed = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        failed += fsync(group[i]) != 0;
+        close(group[i]);
+    }
+
+    // The new names themselves
+    fsync(recorder->dirfd);
+    uint64_t elapsed = SGJW_Now_Ns() / 1000 - start;
+
+    pthread_mutex_lock(&recorder->lock);
+    recorder->stats.syncs++;
+    recorder->stats.synced += count - failed;
+    recorder->stats.failed += failed;
+    if (elapsed > recorder->stats.sync_us_max)
+        recorder->stats.sync_us_max = elapsed;
+}
+
+static void* Recorder_Writer(void* arg)
+{
+    SGJWRecorder* recorder = (SGJWRecorder*)arg;
+    uint64_t sync_us = (uint64_t)recorder->config.sync_ms * 1000;
+
+    pthread_mutex_lock(&recorder->lock);
+    for (;;)
+    {
+        /* ---------- Step 1 : Wait for a frame, a group due or the end ---------- */
+
+        while (!recorder->queue_head && !recorder->closing)
+        {
+            if (recorder->group_count == 0)
+            {
+                pthread_cond_wait(&recorder->slot_ready, &recorder->lock);
+                continue;
+            }
+
+            uint64_t due = recorder->group_start_us + sync_us;
+            struct timespec deadline = {(time_t)(due / 1000000), (long)(due % 1000000) * 1000};
+            if (pthread_cond_timedwait(&recorder->slot_ready, &recorder->lock, &deadline) == ETIMEDOUT)
+                break;
+        }
+
+        /* ---------- Step 2 : Write the oldest frame, unlocked ---------- */
+
+        RecordSlot* slot = recorder->queue_head;
+        if (slot)
+        {
+            recorder->queue_head = slot->next;
+            if (!recorder->queue_head)
+                recorder->queue_tail = NULL;
+            recorder->stats.depth--;
+            pthread_mutex_unlock(&recorder->lock);
+
+            int fd = -1;
+            int8_t retval = Recorder_Write(recorder, slot, &fd);
+            uint64_t now = SGJW_Now_Ns() / 1000;
+            uint64_t latency = now - slot->committed_us;
+
+            pthread_mutex_lock(&recorder->lock);
+            if (retval == SGJW_SUCCESS)
+            {
+                if (recorder->group_count == 0)
+                    recorder->group_start_us = now;
+                recorder->group[recorder->group_count++] = fd;
+                recorder->stats.written++;
+                recorder->latency_us_total += latency;
+                if (latency > recorder->stats.latency_us_max)
+                    recorder->stats.latency_us_max = latency;
+            }
+            else
+            {
+                recorder->stats.failed++;
+            }
+            Recorder_Release(recorder, slot);
+        }
+
+        /* ---------- Step 3 : Sync the group once full, overdue, or at the end ---------- */
+
+        uint8_t drained = recorder->closing && !recorder->queue_head;
+        if (recorder->group_count > 0 && (recorder->group_count >= recorder->config.sync_files || drained ||
+                                          SGJW_Now_Ns() / 1000 - recorder->group_start_us >= sync_us))
+            Recorder_Sync(recorder);
+
+        if (drained && recorder->group_count == 0 && !recorder->queue_head)
+            break;
+    }
+    pthread_mutex_unlock(&recorder->lock);
+    return NULL;
+}
+
+/* ====================================================================================================== */
+/* ======================================== Main APIs =================================================== */
+/* ====================================================================================================== */
+
+int8_t State_Grid_JPEG_Recorder_Open(const SGJWRecorderConfig* config, SGJWRecorder** recorder)
+{
+    if (!config || !recorder || !config->directory || config->max_jpeg_size == 0 || config->max_jpeg_size > UINT32_MAX ||
+        config->sync_files > SGJW_RECORD_MAX_GROUP)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    *recorder = NULL;
+
+    /* ---------- Step 1 : Recorder and defaults ---------- */
+
+    SGJWRecorder* rec = (SGJWRecorder*)SGJW_Malloc(sizeof(SGJWRecorder), SGJW_CACHE_LINE);
+    if (!rec)
+        return SGJW_ERROR_MALLOC_FAILED;
+
+    memset(rec, 0, sizeof(SGJWRecorder));
+    rec->config = *config;
+    if (rec->config.slots == 0)
+        rec->config.slots = SGJW_RECORD_DEFAULT_SLOTS;
+    if (rec->config.sync_files == 0)
+        rec->config.sync_files = SGJW_RECORD_DEFAULT_SYNC_FILES;
+    if (rec->config.sync_ms == 0)
+        rec->config.sync_ms = SGJW_RECORD_DEFAULT_SYNC_MS;
+
+    rec->dirfd = open(config->directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (rec->dirfd < 0)
+    {
+        SGJW_Free(rec);
+        return SGJW_ERROR_FILE_NOT_FOUND;
+    }
+
+    /* ---------- Step 2 : Every slot in one block, touched now rather than on the capture thread ---------- */
+
+    StateGridJPEGV2 largest;
+    memset(&largest, 0, sizeof(largest));
+    largest.width = config->max_width;
+    largest.height = config->max_height;
+    largest.appendix_length = config->max_appendix_length;
+
+    size_t file_bytes = (config->max_jpeg_size + State_Grid_JPEG_Trailer_Size(&largest) + SGJW_CACHE_LINE - 1) & ~(size_t)(SGJW_CACHE_LINE - 1);
+    size_t matrix_bytes = ((size_t)config->max_width * config->max_height * sizeof(float) + SGJW_CACHE_LINE - 1) & ~(size_t)(SGJW_CACHE_LINE - 1);
+    size_t appendix_bytes = (config->max_appendix_length + 1 + SGJW_CACHE_LINE - 1) & ~(size_t)(SGJW_CACHE_LINE - 1);
+    size_t slot_bytes = file_bytes + matrix_bytes + appendix_bytes;
+
+    rec->slots = (RecordSlot*)SGJW_Malloc(rec->config.slots * sizeof(RecordSlot), SGJW_CACHE_LINE);
+    rec->block = SGJW_Malloc(rec->config.slots * slot_bytes, SGJW_CACHE_LINE);
+    if (!rec->slots || !rec->block)
+    {
+        SGJW_Free(rec->slots);
+        SGJW_Free(rec->block);
+        close(rec->dirfd);
+        SGJW_Free(rec);
+        return SGJW_ERROR_MALLOC_FAILED;
+    }
+
+    memset(rec->block, 0, rec->config.slots * slot_bytes);
+    memset(rec->slots, 0, rec->config.slots * sizeof(RecordSlot));
+    for (uint32_t i = rec->config.slots; i-- > 0;)
+    {
+        RecordSlot* slot = &rec->slots[i];
+        uint8_t* base = (uint8_t*)rec->block + i * slot_bytes;
+        slot->frame.jpeg = base;
+        slot->capacity = file_bytes;
+        slot->matrix = (float*)(base + file_bytes);
+        slot->appendix = (char*)(base + file_bytes + matrix_bytes);
+        Recorder_Reset_Frame(slot);
+        slot->next = rec->free_slots;
+        rec->free_slots = slot;
+    }
+
+    /* ---------- Step 3 : Writer thread ---------- */
+
+    // Timed waits of the writer run on the monotonic clock
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&rec->lock, NULL);
+    pthread_cond_init(&rec->slot_free, NULL);
+    pthread_cond_init(&rec->slot_ready, &attr);
+    pthread_condattr_destroy(&attr);
+
+    if (pthread_create(&rec->writer, NULL, Recorder_Writer, rec) != 0)
+    {
+        pthread_cond_destroy(&rec->slot_ready);
+        pthread_cond_destroy(&rec->slot_free);
+        pthread_mutex_destroy(&rec->lock);
+        SGJW_Free(rec->slots);
+        SGJW_Free(rec->block);
+        close(rec->dirfd);
+        SGJW_Free(rec);
+        return SGJW_ERROR_MALLOC_FAILED;
+    }
+
+    *recorder = rec;
+    return SGJW_SUCCESS;
+}
+
+int8_t State_Grid_JPEG_Recorder_Acquire(SGJWRecorder* recorder, SGJWRecordFrame** frame)
+{
+    if (!recorder || !frame)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    pthread_mutex_lock(&recorder->lock);
+    while (!recorder->free_slots)
+    {
+        // The frame the writer takes next is the one dropped
+        if (recorder->config.policy == SGJW_RECORD_DROP_OLDEST && recorder->queue_head)
+        {
+            RecordSlot* oldest = recorder->queue_head;
+            recorder->queue_head = oldest->next;
+            if (!recorder->queue_head)
+                recorder->queue_tail = NULL;
+            recorder->stats.depth--;
+            recorder->stats.dropped++;
+            oldest->next = recorder->free_slots;
+            recorder->free_slots = oldest;
+            break;
+        }
+
+        uint64_t start = SGJW_Now_Ns() / 1000;
+        pthread_cond_wait(&recorder->slot_free, &recorder->lock);
+        recorder->stats.blocked_us += SGJW_Now_Ns() / 1000 - start;
+    }
+
+    RecordSlot* slot = recorder->free_slots;
+    recorder->free_slots = slot->next;
+    pthread_mutex_unlock(&recorder->lock);
+
+    Recorder_Reset_Frame(slot);
+    *frame = &slot->frame;
+    return SGJW_SUCCESS;
+}
+
+int8_t State_Grid_JPEG_Recorder_Commit(SGJWRecorder* recorder, SGJWRecordFrame* frame)
+{
+    if (!recorder || !frame)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    // The frame sits at the start of its slot
+    RecordSlot* slot = (RecordSlot*)frame;
+    if (slot < recorder->slots || slot >= recorder->slots + recorder->config.slots)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    const StateGridJPEGV2* obj = &frame->obj;
+    uint8_t valid = frame->name[0] != '\0' && memchr(frame->name, '\0', sizeof(frame->name)) && frame->jpeg_size > 0 &&
+                    frame->jpeg_size <= recorder->config.max_jpeg_size && obj->matrix == slot->matrix && obj->appendix == slot->appendix &&
+                    (size_t)obj->width * obj->height <= (size_t)recorder->config.max_width * recorder->config.max_height &&
+                    obj->appendix_length <= recorder->config.max_appendix_length && !obj->block;
+
+    pthread_mutex_lock(&recorder->lock);
+    if (!valid)
+    {
+        Recorder_Release(recorder, slot);
+        pthread_mutex_unlock(&recorder->lock);
+        return SGJW_ERROR_INVALID_PARAMS;
+    }
+
+    slot->committed_us = SGJW_Now_Ns() / 1000;
+    slot->next = NULL;
+    if (recorder->queue_tail)
+        recorder->queue_tail->next = slot;
+    else
+        recorder->queue_head = slot;
+    recorder->queue_tail = slot;
+
+    recorder->stats.submitted++;
+    recorder->stats.depth++;
+    if (recorder->stats.depth > recorder->stats.max_depth)
+        recorder->stats.max_depth = recorder->stats.depth;
+    pthread_cond_signal(&recorder->slot_ready);
+    pthread_mutex_unlock(&recorder->lock);
+    return SGJW_SUCCESS;
+}
+
+int8_t State_Grid_JPEG_Recorder_Submit(SGJWRecorder* recorder, const char* name, const uint8_t* jpeg, size_t jpeg_size, const StateGridJPEGV2* obj)
+{
+    if (!recorder || !name || !jpeg || !obj)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    size_t matrix_count = (size_t)obj->width * obj->height;
+    if (strlen(name) > SGJW_RECORD_NAME_LENGTH || jpeg_size > recorder->config.max_jpeg_size ||
+        matrix_count > (size_t)recorder->config.max_width * recorder->config.max_height ||
+        obj->appendix_length > recorder->config.max_appendix_length)
+        return SGJW_ERROR_BUFFER_TOO_SMALL;
+    if ((matrix_count > 0 && !obj->matrix) || (obj->appendix_length > 0 && !obj->appendix))
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    SGJWRecordFrame* frame = NULL;
+    int8_t retval = State_Grid_JPEG_Recorder_Acquire(recorder, &frame);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    // Everything but the slot pointers and ownership
+    float* matrix = frame->obj.matrix;
+    char* appendix = frame->obj.appendix;
+    frame->obj = *obj;
+    frame->obj.matrix = matrix;
+    frame->obj.appendix = appendix;
+    frame->obj.block = NULL;
+    frame->obj.block_capacity = 0;
+
+    strcpy(frame->name, name);
+    memcpy(frame->jpeg, jpeg, jpeg_size);
+    frame->jpeg_size = jpeg_size;
+    if (matrix_count > 0)
+        memcpy(matrix, obj->matrix, matrix_count * sizeof(float));
+    if (obj->appendix_length > 0)
+        memcpy(appendix, obj->appendix, obj->appendix_length);
+    appendix[obj->appendix_length] = '\0';
+
+    return State_Grid_JPEG_Recorder_Commit(recorder, frame);
+}
+
+void State_Grid_JPEG_Recorder_Stats(SGJWRecorder* recorder, SGJWRecorderStats* stats)
+{
+    if (!recorder || !stats)
+        return;
+
+    pthread_mutex_lock(&recorder->lock);
+    *stats = recorder->stats;
+    stats->latency_us_mean = stats->written ? (double)recorder->latency_us_total / stats->written : 0.0;
+    pthread_mutex_unlock(&recorder->lock);
+}
+
+void State_Grid_JPEG_Recorder_Close(SGJWRecorder* recorder, SGJWRecorderStats* stats)
+{
+    if (!recorder)
+        return;
+
+    pthread_mutex_lock(&recorder->lock);
+    recorder->closing = 1;
+    pthread_cond_signal(&recorder->slot_ready);
+    pthread_mutex_unlock(&recorder->lock);
+    pthread_join(recorder->writer, NULL);
+
+    if (stats)
+        State_Grid_JPEG_Recorder_Stats(recorder, stats);
+
+    pthread_cond_destroy(&recorder->slot_ready);
+    pthread_cond_destroy(&recorder->slot_free);
+    pthread_mutex_destroy(&recorder->lock);
+    close(recorder->dirfd);
+    SGJW_Free(recorder->slots);
+    SGJW_Free(recorder->block);
+    SGJW_Free(recorder);
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+/**
+ * @file sgjw_record.h
+ * @brief Write-behind recording of capture sequences, the capture thread never waits on storage.
+ *
+ * @note Typical usage:
+ * 1. Fill an SGJWRecorderConfig with the folder and the largest JPEG / matrix / appendix of the camera.
+ * 2. Invoke State_Grid_JPEG_Recorder_Open once, all slots are allocated and touched here.
+ * 3. Per frame: State_Grid_JPEG_Recorder_Acquire, fill the frame in place, State_Grid_JPEG_Recorder_Commit.
+ *    Or State_Grid_JPEG_Recorder_Submit, which copies a ready JPEG and object into a slot.
+ * 4. Call State_Grid_JPEG_Recorder_Close at the end, it drains the ring and syncs what is left.
+ *
+ * The ring is a fixed set of slots, each with room for the JPEG, its trailer and the matrix, so
+ * recording never allocates. A committed slot is queued to a writer thread, which serializes the trailer
+ * behind the JPEG with State_Grid_JPEG_Append_Buffer and writes the file at once. Written files are
+ * kept open and synced as a group, once sync_files of them are pending or the oldest waited sync_ms,
+ * followed by a single sync of the folder. When every slot is taken, Acquire either waits for the writer
+ * (SGJW_RECORD_BLOCK) or recycles the oldest frame not yet written (SGJW_RECORD_DROP_OLDEST).
+ */
+
+#include "sgjw.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Longest file name of a frame, without the null terminator
+#define SGJW_RECORD_NAME_LENGTH 63
+
+// Largest sync group, files stay open until synced
+#define SGJW_RECORD_MAX_GROUP 256
+
+// What Acquire does when every slot is taken
+typedef enum
+{
+    // Wait until the writer frees a slot, nothing is lost.
+    SGJW_RECORD_BLOCK = 0,
+    // Drop the oldest frame still queued and reuse its slot, the capture thread never waits.
+    SGJW_RECORD_DROP_OLDEST
+} SGJW_RECORD_POLICY;
+
+typedef struct
+{
+    // Folder the files are written to, it must exist.
+    const char* directory;
+    // Slots of the ring, 0 for 16, i.e. half a second at 30 Hz.
+    uint32_t slots;
+    // Room per slot: the largest JPEG in bytes, matrix size and appendix length.
+    size_t max_jpeg_size;
+    uint16_t max_width;
+    uint16_t max_height;
+    uint32_t max_appendix_length;
+    SGJW_RECORD_POLICY policy;
+    // Sync once this many files are written, 0 for 16, 1 syncs every file. At most SGJW_RECORD_MAX_GROUP.
+    uint32_t sync_files;
+    // Or once the oldest unsynced file waited this long, 0 for 500 ms.
+    uint32_t sync_ms;
+} SGJWRecorderConfig;
+
+// One frame, filled by the capture thread between Acquire and Commit
+typedef struct
+{
+    // File name, relative to SGJWRecorderConfig::directory.
+    char name[SGJW_RECORD_NAME_LENGTH + 1];
+    // Room for max_jpeg_size bytes, jpeg_size is set by the caller.
+    uint8_t* jpeg;
+    size_t jpeg_size;
+    // Metadata, width / height / appendix_length included. @attention matrix and appendix point into the slot
+    // (max_width * max_height floats, max_appendix_length bytes) and must not be changed.
+    StateGridJPEGV2 obj;
+} SGJWRecordFrame;
+
+typedef struct
+{
+    // Frames committed.
+    uint64_t submitted;
+    // Files written, synced or not.
+    uint64_t written;
+    // Files synced.
+    uint64_t synced;
+    // Frames dropped by SGJW_RECORD_DROP_OLDEST.
+    uint64_t dropped;
+    // Files whose write or sync failed, a file that could not be written is removed.
+    uint64_t failed;
+    // Sync groups.
+    uint64_t syncs;
+    // Frames committed but not written yet, now and at most.
+    uint32_t depth;
+    uint32_t max_depth;
+    // From Commit to the file written, in microseconds.
+    double latency_us_mean;
+    uint64_t latency_us_max;
+    // Longest sync of a group, in microseconds.
+    uint64_t sync_us_max;
+    // Time Acquire spent waiting for a slot, in microseconds.
+    uint64_t blocked_us;
+} SGJWRecorderStats;
+
+// Recorder handle, see State_Grid_JPEG_Recorder_Open
+typedef struct SGJWRecorder SGJWRecorder;
+
+/**
+ * @brief Allocate the ring and start the writer thread.
+ *
+ * @param config The recorder configuration, directory and max_jpeg_size are required.
+ * @param recorder Receives the recorder.
+ * @return SGJW_ERROR_FILE_NOT_FOUND if the folder cannot be opened, otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Recorder_Open(const SGJWRecorderConfig* config, SGJWRecorder** recorder);
+
+/**
+ * @brief Take a free slot, never allocates. Waits or drops the oldest queued frame when none is free, see SGJW_RECORD_POLICY.
+ *
+ * @note The frame comes back with an empty name and zeroed metadata. Several threads may acquire at once.
+ *
+ * @param recorder The recorder.
+ * @param frame Receives the frame to fill.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Recorder_Acquire(SGJWRecorder* recorder, SGJWRecordFrame** frame);
+
+/**
+ * @brief Queue a filled frame to the writer.
+ *
+ * @param recorder The recorder.
+ * @param frame The frame from State_Grid_JPEG_Recorder_Acquire, not to be touched afterwards.
+ * @return SGJW_ERROR_INVALID_PARAMS if name, sizes or the matrix and appendix pointers are wrong, the slot is then
+ *         released and the frame not written. Otherwise SGJW_SUCCESS.
+ */
+int8_t State_Grid_JPEG_Recorder_Commit(SGJWRecorder* recorder, SGJWRecordFrame* frame);
+
+/**
+ * @brief Copy a JPEG and its metadata into a slot and queue it, i.e. Acquire, copy and Commit.
+ *
+ * @param recorder The recorder.
+ * @param name File name, relative to the folder.
+ * @param jpeg The JPEG bytes.
+ * @param jpeg_size Size of the JPEG in bytes.
+ * @param obj The metadata, matrix and appendix included.
+ * @return SGJW_ERROR_BUFFER_TOO_SMALL if the frame does not fit in a slot, otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Recorder_Submit(SGJWRecorder* recorder, const char* name, const uint8_t* jpeg, size_t jpeg_size, const StateGridJPEGV2* obj);
+
+/**
+ * @brief Read the counters, at any time.
+ *
+ * @param recorder The recorder.
+ * @param stats Receives the counters.
+ */
+void State_Grid_JPEG_Recorder_Stats(SGJWRecorder* recorder, SGJWRecorderStats* stats);
+
+/**
+ * @brief Write and sync every committed frame, stop the writer and release the ring.
+ *
+ * @note No Acquire, Commit or Submit may run during or after the call.
+ *
+ * @param recorder The recorder, NULL is ignored.
+ * @param stats Optional, receives the final counters.
+ */
+void State_Grid_JPEG_Recorder_Close(SGJWRecorder* recorder, SGJWRecorderStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
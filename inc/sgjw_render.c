@@ -0,0 +1,401 @@
+#include "sgjw_render.h"
+#include "sgjw_internal.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+// Rendering only spreads over threads when each gets at least this many pixels
+#define SGJW_RENDER_THREAD_PIXELS 65536
+
+// Pixels quantized at once, the levels stay in L1 until they are looked up
+#define SGJW_RENDER_CHUNK_PIXELS 512
+
+// Level of the isotherm, one past the palette
+#define SGJW_RENDER_ISOTHERM SGJW_PALETTE_SIZE
+
+/* ====================================================================================================== */
+/* ======================================== Helper Structures =========================================== */
+/* ====================================================================================================== */
+
+typedef struct
+{
+    // Level = (value - low) * scale, clamped to the palette.
+    float low;
+    float scale;
+    // Values in [isotherm_low, isotherm_high] get SGJW_RENDER_ISOTHERM, an empty range when disabled.
+    float isotherm_low;
+    float isotherm_high;
+} RenderParams;
+
+// Quantize count values to levels, 0 ~ SGJW_PALETTE_SIZE - 1 or SGJW_RENDER_ISOTHERM
+typedef void (*Quantize_Kernel)(const float* src, size_t count, const RenderParams* params, uint16_t* dst);
+
+// One band of rows
+typedef struct
+{
+    Quantize_Kernel kernel;
+    const RenderParams* params;
+    SGJW_RENDER_FORMAT format;
+    // Level to output, one more entry for the isotherm. RGB entries hold R G B in their first 3 bytes.
+    const uint32_t* lut;
+    const float* matrix;
+    uint16_t width;
+    uint8_t* dst;
+    size_t stride;
+    uint32_t row_first;
+    uint32_t row_last;
+} RenderTask;
+
+// clang-format off
+// Palette control points, level and color, linearly interpolated in between
+typedef struct
+{
+    uint8_t level;
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+} PalettePoint;
+
+static const PalettePoint SGJW_PALETTE_IRON_POINTS[] = {
+    {   0,   0,   0,   0 },
+    {  40,  40,   0, 120 },
+    {  85, 140,   0, 150 },
+    { 130, 210,  50,  60 },
+    { 175, 245, 130,   0 },
+    { 215, 255, 200,  20 },
+    { 255, 255, 255, 255 }
+};
+
+static const PalettePoint SGJW_PALETTE_RAINBOW_POINTS[] = {
+    {   0,   0,   0, 255 },
+    {  64,   0, 255, 255 },
+    { 128,   0, 255,   0 },
+    { 192, 255, 255,   0 },
+    { 255, 255,   0,   0 }
+};
+
+static const PalettePoint SGJW_PALETTE_GRAY_POINTS[] = {
+    {   0,   0,   0,   0 },
+    { 255, 255, 255, 255 }
+};
+
+static const struct
+{
+    const PalettePoint* points;
+    size_t count;
+} SGJW_PALETTES[SGJW_PALETTE_COUNT] = {
+    { SGJW_PALETTE_IRON_POINTS, sizeof(SGJW_PALETTE_IRON_POINTS) / sizeof(PalettePoint) },
+    { SGJW_PALETTE_RAINBOW_POINTS, sizeof(SGJW_PALETTE_RAINBOW_POINTS) / sizeof(PalettePoint) },
+    { SGJW_PALETTE_GRAY_POINTS, sizeof(SGJW_PALETTE_GRAY_POINTS) / sizeof(PalettePoint) }
+};
+// clang-format on
+
+/* ====================================================================================================== */
+/* ======================================== Quantization Kernels ======================================== */
+/* ====================================================================================================== */
+
+// Reference kernel, every SIMD kernel must be bit-exact against it
+static void Quantize_Scalar(const float* src, size_t count, const RenderParams* params, uint16_t* dst)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        // NaN fails the first compare and lands on level 0
+        float level = (src[i] - params->low) * params->scale;
+        level = level > 0.0f ? level : 0.0f;
+        level = level < SGJW_PALETTE_SIZE - 1 ? level : SGJW_PALETTE_SIZE - 1;
+
+        uint8_t isotherm = src[i] >= params->isotherm_low && src[i] <= params->isotherm_high;
+        dst[i] = isotherm ? SGJW_RENDER_ISOTHERM : (uint16_t)(int32_t)level;
+    }
+}
+
+#if SGJW_HAVE_X86
+static inline __m128i Quantize_SSE2_4(__m128 v, __m128 low, __m128 scale, __m128 top, __m128 iso_low, __m128 iso_high)
+{
+    // max / min return their second operand for NaN, exactly the scalar compares
+    __m128 level = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(v, low), scale), _mm_setzero_ps()), top);
+    __m128i mask = _mm_castps_si128(_mm_and_ps(_mm_cmpge_ps(v, iso_low), _mm_cmple_ps(v, iso_high)));
+    __m128i isotherm = _mm_set1_epi32(SGJW_RENDER_ISOTHERM);
+    return _mm_or_si128(_mm_and_si128(mask, isotherm), _mm_andnot_si128(mask, _mm_cvttps_epi32(level)));
+}
+
+static void Quantize_SSE2(const float* src, size_t count, const RenderParams* params, uint16_t* dst)
+{
+    const __m128 low = _mm_set1_ps(params->low);
+    const __m128 scale = _mm_set1_ps(params->scale);
+    const __m128 top = _mm_set1_ps(SGJW_PALETTE_SIZE - 1);
+    const __m128 iso_low = _mm_set1_ps(params->isotherm_low);
+    const __m128 iso_high = _mm_set1_ps(params->isotherm_high);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i a = Quantize_SSE2_4(_mm_loadu_ps(src + i), low, scale, top, iso_low, iso_high);
+        __m128i b = Quantize_SSE2_4(_mm_loadu_ps(src + i + 4), low, scale, top, iso_low, iso_high);
+        // Levels are at most SGJW_RENDER_ISOTHERM, signed saturation never kicks in
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(a, b));
+    }
+    Quantize_Scalar(src + i, count - i, params, dst + i);
+}
+
+__attribute__((target("avx2"))) static inline __m256i Quantize_AVX2_8(__m256 v, __m256 low, __m256 scale, __m256 top, __m256 iso_low,
+                                                                      __m256 iso_high)
+{
+    __m256 level = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(v, low), scale), _mm256_setzero_ps()), top);
+    __m256i mask = _mm256_castps_si256(_mm256_and_ps(_mm256_cmp_ps(v, iso_low, _CMP_GE_OQ), _mm256_cmp_ps(v, iso_high, _CMP_LE_OQ)));
+    return _mm256_blendv_epi8(_mm256_cvttps_epi32(level), _mm256_set1_epi32(SGJW_RENDER_ISOTHERM), mask);
+}
+
+__attribute__((target("avx2"))) static void Quantize_AVX2(const float* src, size_t count, const RenderParams* params, uint16_t* dst)
+{
+    const __m256 low = _mm256_set1_ps(params->low);
+    const __m256 scale = _mm256_set1_ps(params->scale);
+    const __m256 top = _mm256_set1_ps(SGJW_PALETTE_SIZE - 1);
+    const __m256 iso_low = _mm256_set1_ps(params->isotherm_low);
+    const __m256 iso_high = _mm256_set1_ps(params->isotherm_high);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256i a = Quantize_AVX2_8(_mm256_loadu_ps(src + i), low, scale, top, iso_low, iso_high);
+        __m256i b = Quantize_AVX2_8(_mm256_loadu_ps(src + i + 8), low, scale, top, iso_low, iso_high);
+        // packs works per 128-bit lane, put the quarters back in order
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8));
+    }
+    Quantize_SSE2(src + i, count - i, params, dst + i);
+}
+#endif
+
+#if SGJW_HAVE_NEON
+static void Quantize_NEON(const float* src, size_t count, const RenderParams* params, uint16_t* dst)
+{
+    const float32x4_t low = vdupq_n_f32(params->low);
+    const float32x4_t scale = vdupq_n_f32(params->scale);
+    const float32x4_t top = vdupq_n_f32(SGJW_PALETTE_SIZE - 1);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t iso_low = vdupq_n_f32(params->isotherm_low);
+    const float32x4_t iso_high = vdupq_n_f32(params->isotherm_high);
+    const uint32x4_t isotherm = vdupq_n_u32(SGJW_RENDER_ISOTHERM);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4_t v = vld1q_f32(src + i);
+        float32x4_t level = vmulq_f32(vsubq_f32(v, low), scale);
+        // Select rather than vmaxq / vminq, which would keep NaN
+        level = vbslq_f32(vcgtq_f32(level, zero), level, zero);
+        level = vbslq_f32(vcltq_f32(level, top), level, top);
+
+        uint32x4_t mask = vandq_u32(vcgeq_f32(v, iso_low), vcleq_f32(v, iso_high));
+        uint32x4_t index = vbslq_u32(mask, isotherm, vreinterpretq_u32_s32(vcvtq_s32_f32(level)));
+        vst1_u16(dst + i, vmovn_u32(index));
+    }
+    Quantize_Scalar(src + i, count - i, params, dst + i);
+}
+#endif
+
+static Quantize_Kernel Quantize_Get_Kernel(SGJW_KERNEL kernel)
+{
+    switch (kernel)
+    {
+        case SGJW_KERNEL_AUTO:
+            return Quantize_Get_Kernel(State_Grid_JPEG_Matrix_Kernel());
+        case SGJW_KERNEL_SCALAR:
+            return Quantize_Scalar;
+#if SGJW_HAVE_X86
+        case SGJW_KERNEL_SSE2:
+            return Quantize_SSE2;
+        case SGJW_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2") ? Quantize_AVX2 : NULL;
+#endif
+#if SGJW_HAVE_NEON
+        case SGJW_KERNEL_NEON:
+            return Quantize_NEON;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+/* ====================================================================================================== */
+/* ======================================== Rendering =================================================== */
+/* ====================================================================================================== */
+
+static void* Render_Rows(void* arg)
+{
+    RenderTask* task = (RenderTask*)arg;
+    uint16_t levels[SGJW_RENDER_CHUNK_PIXELS];
+
+    for (uint32_t y = task->row_first; y < task->row_last; ++y)
+    {
+        const float* src = task->matrix + (size_t)y * task->width;
+        uint8_t* row = task->dst + (size_t)y * task->stride;
+
+        for (size_t x = 0; x < task->width; x += SGJW_RENDER_CHUNK_PIXELS)
+        {
+            size_t n = task->width - x < SGJW_RENDER_CHUNK_PIXELS ? task->width - x : SGJW_RENDER_CHUNK_PIXELS;
+            task->kernel(src + x, n, task->params, levels);
+
+            if (task->format == SGJW_RENDER_INDEXED8)
+            {
+                for (size_t i = 0; i < n; ++i)
+                    row[x + i] = (uint8_t)task->lut[levels[i]];
+                continue;
+            }
+
+            // One 4-byte store per pixel, the extra byte is overwritten by the next one. The last pixel of a row
+            // stores 3 bytes so nothing is written past the row.
+            uint8_t* out = row + x * 3;
+            size_t last = x + n == task->width ? n - 1 : n;
+            for (size_t i = 0; i < last; ++i)
+                memcpy(out + i * 3, &task->lut[levels[i]], 4);
+            if (last < n)
+                memcpy(out + last * 3, &task->lut[levels[last]], 3);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Split the rows over threads, the calling thread takes the last band.
+ */
+static void Render_Parallel(const RenderTask* whole, uint16_t height, uint32_t threads)
+{
+    if (threads == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (uint32_t)cpus : 1;
+    }
+    size_t most = (size_t)whole->width * height / SGJW_RENDER_THREAD_PIXELS;
+    if (threads > most)
+        threads = most > 0 ? (uint32_t)most : 1;
+    if (threads > 64)
+        threads = 64;
+
+    RenderTask tasks[64];
+    pthread_t ids[64];
+    uint8_t started[64] = {0};
+
+    uint32_t step = (height + threads - 1) / threads;
+    for (uint32_t t = 0; t < threads; ++t)
+    {
+        tasks[t] = *whole;
+        tasks[t].row_first = t * step < height ? t * step : height;
+        tasks[t].row_last = tasks[t].row_first + step < height ? tasks[t].row_first + step : height;
+    }
+
+    // A thread that cannot be started leaves its band to the calling thread
+    for (uint32_t t = 0; t + 1 < threads; ++t)
+        started[t] = pthread_create(&ids[t], NULL, Render_Rows, &tasks[t]) == 0;
+    for (uint32_t t = 0; t < threads; ++t)
+    {
+        if (!started[t])
+            Render_Rows(&tasks[t]);
+    }
+    for (uint32_t t = 0; t < threads; ++t)
+    {
+        if (started[t])
+            pthread_join(ids[t], NULL);
+    }
+}
+
+int8_t State_Grid_JPEG_Palette(SGJW_PALETTE palette, uint8_t* rgb)
+{
+    if ((unsigned)palette >= SGJW_PALETTE_COUNT || !rgb)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    const PalettePoint* points = SGJW_PALETTES[palette].points;
+    size_t segment = 0;
+
+    for (int level = 0; level < SGJW_PALETTE_SIZE; ++level)
+    {
+        while (segment + 2 < SGJW_PALETTES[palette].count && level > points[segment + 1].level)
+            ++segment;
+
+        const PalettePoint* a = &points[segment];
+        const PalettePoint* b = &points[segment + 1];
+        int span = b->level - a->level;
+        int from = b->level - level;
+        int to = level - a->level;
+
+        // Rounded linear interpolation
+        rgb[level * 3 + 0] = (uint8_t)((a->r * from + b->r * to + span / 2) / span);
+        rgb[level * 3 + 1] = (uint8_t)((a->g * from + b->g * to + span / 2) / span);
+        rgb[level * 3 + 2] = (uint8_t)((a->b * from + b->b * to + span / 2) / span);
+    }
+    return SGJW_SUCCESS;
+}
+
+int8_t State_Grid_JPEG_Render(const float* matrix, uint16_t width, uint16_t height, const SGJWRenderConfig* config, uint8_t* dst, size_t stride, float* span)
+{
+    SGJWRenderConfig defaults;
+    if (!config)
+    {
+        memset(&defaults, 0, sizeof(SGJWRenderConfig));
+        config = &defaults;
+    }
+
+    size_t count = (size_t)width * height;
+    size_t pixel_bytes = config->format == SGJW_RENDER_INDEXED8 ? 1 : 3;
+    Quantize_Kernel kernel = Quantize_Get_Kernel(config->kernel);
+    if (!kernel || (count && (!matrix || !dst)) || stride < (size_t)width * pixel_bytes ||
+        (config->format != SGJW_RENDER_RGB888 && config->format != SGJW_RENDER_INDEXED8))
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    /* ---------- Step 1 : Span, from the matrix unless fixed ---------- */
+
+    float low = config->span_low;
+    float high = config->span_high;
+    if (!(low < high))
+    {
+        // The histogram is skipped, only min / max are needed
+        SGJWStats stats;
+        memset(&stats, 0, sizeof(SGJWStats));
+        int8_t retval = State_Grid_JPEG_Matrix_Stats(matrix, width, height, &stats, config->kernel);
+        if (retval != SGJW_SUCCESS)
+            return retval;
+
+        // An all-NaN matrix leaves min > max, a flat one min == max
+        low = stats.count && stats.min <= stats.max ? stats.min : 0.0f;
+        high = stats.count && stats.min < stats.max ? stats.max : low + 1.0f;
+    }
+    if (span)
+    {
+        span[0] = low;
+        span[1] = high;
+    }
+
+    /* ---------- Step 2 : Level to output table ---------- */
+
+    uint8_t rgb[SGJW_PALETTE_SIZE * 3];
+    int8_t retval = State_Grid_JPEG_Palette(config->palette, rgb);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    uint32_t lut[SGJW_PALETTE_SIZE + 1];
+    for (int level = 0; level <= SGJW_PALETTE_SIZE; ++level)
+    {
+        const uint8_t* color = level < SGJW_PALETTE_SIZE ? rgb + level * 3 : config->isotherm_rgb;
+        uint8_t entry[4] = {color[0], color[1], color[2], 0};
+        if (config->format == SGJW_RENDER_INDEXED8)
+            lut[level] = level < SGJW_PALETTE_SIZE ? (uint32_t)level : config->isotherm_index;
+        else
+            memcpy(&lut[level], entry, 4);
+    }
+
+    /* ---------- Step 3 : Quantize and look up, rows split over threads ---------- */
+
+    RenderParams params = {low, SGJW_PALETTE_SIZE / (high - low), 1.0f, 0.0f};
+    if (config->use_isotherm)
+    {
+        params.isotherm_low = config->isotherm_low;
+        params.isotherm_high = config->isotherm_high;
+    }
+
+    RenderTask task = {kernel, &params, config->format, lut, matrix, width, dst, stride, 0, height};
+    if (count)
+        Render_Parallel(&task, height, config->threads);
+
+    return SGJW_SUCCESS;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+/**
+ * @file sgjw_render.h
+ * @brief False-color rendering of a temperature matrix into raw pixel buffers.
+ *
+ * @note Typical usage:
+ * 1. Fill an SGJWRenderConfig, zero-initialized it renders iron RGB888 over the span of the matrix.
+ * 2. Invoke State_Grid_JPEG_Render with the matrix of a StateGridJPEGV2 and a buffer of height rows.
+ * 3. For SGJW_RENDER_INDEXED8, State_Grid_JPEG_Palette gives the colors of the indices.
+ *
+ * Each temperature is quantized to one of SGJW_PALETTE_SIZE levels of the span with SIMD, then looked up
+ * in a table built once per call, so the cost per pixel is a subtract, a multiply and a load whatever the
+ * palette. Rows are split over threads. Only raw buffers are produced, encoding them (PNG, JPEG) is left
+ * to the caller.
+ */
+
+#include "sgjw.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Levels of a palette
+#define SGJW_PALETTE_SIZE 256
+
+// Built-in palettes, cold to hot
+typedef enum
+{
+    // Black, blue, magenta, orange, yellow, white.
+    SGJW_PALETTE_IRON = 0,
+    // Blue, cyan, green, yellow, red.
+    SGJW_PALETTE_RAINBOW,
+    // Black to white.
+    SGJW_PALETTE_GRAY,
+    SGJW_PALETTE_COUNT
+} SGJW_PALETTE;
+
+// Pixel formats of State_Grid_JPEG_Render
+typedef enum
+{
+    // 3 bytes per pixel, R G B.
+    SGJW_RENDER_RGB888 = 0,
+    // 1 byte per pixel, the palette level (0 coldest, SGJW_PALETTE_SIZE - 1 hottest) or isotherm_index.
+    SGJW_RENDER_INDEXED8
+} SGJW_RENDER_FORMAT;
+
+typedef struct
+{
+    SGJW_PALETTE palette;
+    SGJW_RENDER_FORMAT format;
+    // Temperatures mapped to the first / last level, low >= high spans the min / max of the matrix.
+    // Values outside the span are clamped, NaN gets the first level.
+    float span_low;
+    float span_high;
+    // Paint the pixels in [isotherm_low, isotherm_high] with isotherm_rgb / isotherm_index.
+    uint8_t use_isotherm;
+    float isotherm_low;
+    float isotherm_high;
+    uint8_t isotherm_rgb[3];
+    uint8_t isotherm_index;
+    // Worker threads, 0 for one per CPU. Small matrices use fewer.
+    uint32_t threads;
+    // The quantization kernel, SGJW_KERNEL_AUTO picks the best one for the running CPU.
+    SGJW_KERNEL kernel;
+} SGJWRenderConfig;
+
+/**
+ * @brief Get the colors of a palette, e.g. for the indices of SGJW_RENDER_INDEXED8.
+ *
+ * @param palette The palette.
+ * @param rgb Output, SGJW_PALETTE_SIZE colors of 3 bytes (R G B), coldest first.
+ * @return SGJW_ERROR_INVALID_PARAMS if the palette is unknown, otherwise SGJW_SUCCESS.
+ */
+int8_t State_Grid_JPEG_Palette(SGJW_PALETTE palette, uint8_t* rgb);
+
+/**
+ * @brief Render a temperature matrix into a raw image.
+ *
+ * @param matrix Host floats, width * height values, e.g. StateGridJPEGV2::matrix.
+ * @param width Matrix width.
+ * @param height Matrix height.
+ * @param config The rendering options, NULL for the defaults.
+ * @param dst Output, height rows of width pixels.
+ * @param stride Output row pitch in bytes, at least width * 3 for RGB888 or width for INDEXED8.
+ * @param span Optional, receives the low / high temperature of the span used.
+ * @return SGJW_ERROR_INVALID_PARAMS for a stride too small or a kernel not available on this CPU, otherwise SGJW_SUCCESS.
+ */
+int8_t State_Grid_JPEG_Render(const float* matrix, uint16_t width, uint16_t height, const SGJWRenderConfig* config, uint8_t* dst, size_t stride, float* span);
+
+#ifdef __cplusplus
+}
+#endif
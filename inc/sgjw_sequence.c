@@ -0,0 +1,1203 @@
+#include "sgjw_sequence.h"
+#include "sgjw_internal.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SGJW_SEQUENCE_VERSION 1
+
+// Suffix of the file written before it is renamed over the sequence
+#define SGJW_SEQUENCE_TEMP_SUFFIX ".tmp"
+
+// Values per packed block, lane l holds values l, l + 4, l + 8, ...
+#define SGJW_SEQUENCE_BLOCK 128
+#define SGJW_SEQUENCE_LANES 4
+
+// No frame decoded yet
+#define SGJW_SEQUENCE_NONE UINT32_MAX
+
+// Most distinct values a group is coded through a value table with, indexes then fit in 16 bits
+#define SGJW_SEQUENCE_MAX_PALETTE 65536
+
+// Hash table of the distinct values of a matrix, twice the largest value table, keys then indexes
+#define SGJW_SEQUENCE_TABLE_BITS 17
+#define SGJW_SEQUENCE_TABLE (1u << SGJW_SEQUENCE_TABLE_BITS)
+
+// clang-format off
+static const char SGJW_SEQUENCE_MAGIC[8] = { 'S', 'G', 'J', 'W', 'S', 'E', 'Q', '\0' };
+// clang-format on
+
+/* ====================================================================================================== */
+/* ======================================== Helper Structures =========================================== */
+/* ====================================================================================================== */
+
+// At offset 0, the first frame follows, a cache line in size
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t keyframe_interval;
+    uint8_t reserved[SGJW_CACHE_LINE - 16];
+} SequenceHeader;
+
+// One frame of the index
+typedef struct
+{
+    // The frame, 64-byte aligned
+    uint64_t offset;
+    // The original file, its matrix starts at matrix_offset
+    uint64_t file_size;
+    // Into the names, null-terminated
+    uint64_t name_offset;
+    uint32_t matrix_offset;
+    // Within the frame: one width per block, then the packed blocks, 16-byte aligned
+    uint32_t widths_offset;
+    uint32_t words_offset;
+    uint32_t words_size;
+    // Value table of the group, stored with its keyframe, 0 when the bit patterns are coded as is
+    uint32_t palette_offset;
+    uint32_t palette_size;
+    uint16_t width;
+    uint16_t height;
+    uint8_t keyframe;
+    uint8_t reserved[3];
+} SequenceRecord;
+
+// At the very end of the sequence
+typedef struct
+{
+    uint64_t records;
+    uint64_t names;
+    uint64_t names_size;
+    uint64_t size;
+    uint32_t count;
+    uint32_t version;
+    char magic[8];
+} SequenceFooter;
+
+// One file of the encoding window
+typedef struct __attribute__((aligned(SGJW_CACHE_LINE)))
+{
+    // The whole file, shifted in the buffer so the matrix is aligned
+    uint8_t* buffer;
+    size_t buffer_capacity;
+    const uint8_t* file;
+    const char* name;
+    int8_t status;
+    uint8_t keyframe;
+    uint16_t width;
+    uint16_t height;
+    uint64_t file_size;
+    uint64_t matrix_offset;
+    // Distinct values of the matrix as sorted order keys, SGJW_SEQUENCE_NONE when there are too many
+    uint8_t* distinct;
+    size_t distinct_capacity;
+    uint32_t distinct_count;
+    // Value table of the group as sorted order keys, NULL to code the bit patterns
+    const uint32_t* palette;
+    uint32_t palette_size;
+    // Table indexes or bit patterns, what is coded
+    uint8_t* plane;
+    size_t plane_capacity;
+    // Block widths, then the packed blocks from words_offset
+    uint8_t* packed;
+    size_t packed_capacity;
+    uint32_t words_offset;
+    uint32_t words_size;
+} SequenceSlot;
+
+// A window of files, one keyframe interval, processed in phases by all workers
+typedef struct
+{
+    const char* const* filepaths;
+    SequenceSlot* slots;
+    size_t first;
+    uint32_t frames;
+    uint32_t workers;
+    // One hash table per worker, see Sequence_Distinct and Sequence_Map_Slot
+    uint32_t* tables;
+} SequenceEncoder;
+
+typedef struct
+{
+    SequenceEncoder* encoder;
+    uint32_t id;
+    uint8_t started;
+} SequenceWorker;
+
+/* ====================================================================================================== */
+/* ======================================== Helper Functions ============================================ */
+/* ====================================================================================================== */
+
+static uint64_t Sequence_Align(uint64_t offset, uint64_t align)
+{
+    return (offset + align - 1) & ~(align - 1);
+}
+
+static size_t Sequence_Blocks(uint16_t width, uint16_t height)
+{
+    return ((size_t)width * height + SGJW_SEQUENCE_BLOCK - 1) / SGJW_SEQUENCE_BLOCK;
+}
+
+static int8_t Sequence_Reserve(uint8_t** buffer, size_t* capacity, size_t size)
+{
+    if (size <= *capacity)
+        return SGJW_SUCCESS;
+
+    SGJW_Free(*buffer);
+    *buffer = (uint8_t*)SGJW_Malloc(size, SGJW_CACHE_LINE);
+    *capacity = *buffer ? size : 0;
+    return *buffer ? SGJW_SUCCESS : SGJW_ERROR_MALLOC_FAILED;
+}
+
+// Close values, positive or negative, give small codes
+static inline uint32_t Sequence_Zigzag(uint32_t delta)
+{
+    return (delta << 1) ^ (0u - (delta >> 31));
+}
+
+static inline uint32_t Sequence_Unzigzag(uint32_t code)
+{
+    return (code >> 1) ^ (0u - (code & 1));
+}
+
+/**
+ * @brief Pack 128 codes below 2^width, lane by lane: width words per lane, interleaved.
+ */
+static void Sequence_Pack_Block(const uint32_t* codes, uint8_t width, uint32_t* words)
+{
+    for (uint32_t lane = 0; lane < SGJW_SEQUENCE_LANES; ++lane)
+    {
+        uint64_t bits = 0;
+        uint32_t used = 0;
+        uint32_t k = 0;
+        for (uint32_t j = 0; j < SGJW_SEQUENCE_BLOCK / SGJW_SEQUENCE_LANES; ++j)
+        {
+            bits |= (uint64_t)codes[j * SGJW_SEQUENCE_LANES + lane] << used;
+            used += width;
+            if (used >= 32)
+            {
+                words[k++ * SGJW_SEQUENCE_LANES + lane] = (uint32_t)bits;
+                bits >>= 32;
+                used -= 32;
+            }
+        }
+    }
+}
+
+// Reverse of Sequence_Pack_Block
+static void Sequence_Unpack_Block(const uint32_t* words, uint8_t width, uint32_t* codes)
+{
+    const uint32_t mask = width == 32 ? ~0u : (1u << width) - 1;
+    for (uint32_t j = 0; j < SGJW_SEQUENCE_BLOCK / SGJW_SEQUENCE_LANES; ++j)
+    {
+        uint32_t bit = j * width;
+        uint32_t k = bit / 32;
+        uint32_t shift = bit % 32;
+        for (uint32_t lane = 0; lane < SGJW_SEQUENCE_LANES; ++lane)
+        {
+            uint32_t code = width ? words[k * SGJW_SEQUENCE_LANES + lane] >> shift : 0;
+            if (shift + width > 32)
+                code |= words[(k + 1) * SGJW_SEQUENCE_LANES + lane] << (32 - shift);
+            codes[j * SGJW_SEQUENCE_LANES + lane] = code & mask;
+        }
+    }
+}
+
+// Unsigned order of the keys is the order of the floats, NaN patterns included
+static inline uint32_t Sequence_Key(uint32_t bits)
+{
+    return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+
+static inline uint32_t Sequence_Unkey(uint32_t key)
+{
+    return key & 0x80000000u ? key & 0x7FFFFFFFu : ~key;
+}
+
+static inline uint32_t Sequence_Hash(uint32_t key)
+{
+    return (key * 0x9E3779B1u) >> (32 - SGJW_SEQUENCE_TABLE_BITS);
+}
+
+static int Sequence_Compare_Keys(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Collect the distinct values of a matrix as sorted keys.
+ *
+ * @param table Hash table of SGJW_SEQUENCE_TABLE entries.
+ * @return Number of keys, SGJW_SEQUENCE_NONE when there are more than SGJW_SEQUENCE_MAX_PALETTE.
+ */
+static uint32_t Sequence_Distinct(const uint32_t* bits, size_t count, uint32_t* table, uint32_t* keys)
+{
+    // 0 marks a free entry, key 0 is kept aside
+    memset(table, 0, SGJW_SEQUENCE_TABLE * sizeof(uint32_t));
+    uint32_t found = 0;
+    uint8_t zero = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        // Neighbours often share a value
+        if (i > 0 && bits[i] == bits[i - 1])
+            continue;
+
+        uint32_t key = Sequence_Key(bits[i]);
+        if (key == 0)
+        {
+            zero = 1;
+            continue;
+        }
+
+        uint32_t h = Sequence_Hash(key);
+        while (table[h] != 0 && table[h] != key)
+            h = (h + 1) & (SGJW_SEQUENCE_TABLE - 1);
+        if (table[h] == 0)
+        {
+            if (found == SGJW_SEQUENCE_MAX_PALETTE)
+                return SGJW_SEQUENCE_NONE;
+            table[h] = key;
+            keys[found++] = key;
+        }
+    }
+    if (zero)
+    {
+        if (found == SGJW_SEQUENCE_MAX_PALETTE)
+            return SGJW_SEQUENCE_NONE;
+        keys[found++] = 0;
+    }
+
+    qsort(keys, found, sizeof(uint32_t), Sequence_Compare_Keys);
+    return found;
+}
+
+/**
+ * @brief Merge the distinct values of the frames [a, b) into the value table of the group, a is its keyframe.
+ *
+ * @param palette Room for the distinct values of every frame.
+ * @return Size of the table, 0 if the group codes bit patterns.
+ */
+static uint32_t Sequence_Group(SequenceSlot* slots, uint32_t a, uint32_t b, uint32_t* palette)
+{
+    size_t count = 0;
+    uint8_t raw = 0;
+    for (uint32_t i = a; i < b && !raw; ++i)
+    {
+        raw = slots[i].distinct_count == SGJW_SEQUENCE_NONE;
+        if (!raw)
+        {
+            memcpy(palette + count, slots[i].distinct, slots[i].distinct_count * sizeof(uint32_t));
+            count += slots[i].distinct_count;
+        }
+    }
+
+    uint32_t size = 0;
+    if (!raw)
+    {
+        qsort(palette, count, sizeof(uint32_t), Sequence_Compare_Keys);
+        for (size_t i = 0; i < count; ++i)
+            if (size == 0 || palette[size - 1] != palette[i])
+                palette[size++] = palette[i];
+        if (size > SGJW_SEQUENCE_MAX_PALETTE)
+            size = 0;
+    }
+
+    for (uint32_t i = a; i < b; ++i)
+    {
+        slots[i].keyframe = i == a;
+        slots[i].palette = size ? palette : NULL;
+        slots[i].palette_size = size;
+    }
+    return size;
+}
+
+/**
+ * @brief Replace each value of a matrix by its index in the value table, or copy the patterns without one.
+ *
+ * @param table Hash table of 2 * SGJW_SEQUENCE_TABLE entries, filled with the value table first.
+ */
+static void Sequence_Map_Slot(SequenceSlot* slot, uint32_t* table)
+{
+    size_t count = (size_t)slot->width * slot->height;
+    const uint32_t* bits = (const uint32_t*)(slot->file + slot->matrix_offset);
+    uint32_t* plane = (uint32_t*)slot->plane;
+
+    if (!slot->palette)
+    {
+        memcpy(plane, bits, count * sizeof(uint32_t));
+        return;
+    }
+
+    // As in Sequence_Distinct, 0 marks a free entry and key 0 is kept aside
+    uint32_t* keys = table;
+    uint32_t* indexes = table + SGJW_SEQUENCE_TABLE;
+    uint32_t zero = 0;
+    memset(keys, 0, SGJW_SEQUENCE_TABLE * sizeof(uint32_t));
+    for (uint32_t i = 0; i < slot->palette_size; ++i)
+    {
+        uint32_t key = slot->palette[i];
+        if (key == 0)
+        {
+            zero = i;
+            continue;
+        }
+
+        uint32_t h = Sequence_Hash(key);
+        while (keys[h] != 0)
+            h = (h + 1) & (SGJW_SEQUENCE_TABLE - 1);
+        keys[h] = key;
+        indexes[h] = i;
+    }
+
+    // Every value is in the table
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (i > 0 && bits[i] == bits[i - 1])
+        {
+            plane[i] = plane[i - 1];
+            continue;
+        }
+
+        uint32_t key = Sequence_Key(bits[i]);
+        if (key == 0)
+        {
+            plane[i] = zero;
+            continue;
+        }
+
+        uint32_t h = Sequence_Hash(key);
+        while (keys[h] != key)
+            h = (h + 1) & (SGJW_SEQUENCE_TABLE - 1);
+        plane[i] = indexes[h];
+    }
+}
+
+/**
+ * @brief Code the plane of a slot, against the previous plane or, on a keyframe, against the row above.
+ */
+static int8_t Sequence_Code_Slot(SequenceSlot* slot, const SequenceSlot* prev)
+{
+    size_t count = (size_t)slot->width * slot->height;
+    size_t blocks = Sequence_Blocks(slot->width, slot->height);
+    size_t words_offset = Sequence_Align(blocks, 16);
+
+    int8_t retval = Sequence_Reserve(&slot->packed, &slot->packed_capacity, words_offset + blocks * SGJW_SEQUENCE_BLOCK * sizeof(uint32_t));
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    const uint32_t* cur = (const uint32_t*)slot->plane;
+    const uint32_t* ref = prev ? (const uint32_t*)prev->plane : NULL;
+    uint32_t* words = (uint32_t*)(slot->packed + words_offset);
+    uint32_t codes[SGJW_SEQUENCE_BLOCK];
+    size_t used = 0;
+
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        size_t start = b * SGJW_SEQUENCE_BLOCK;
+        size_t n = count - start < SGJW_SEQUENCE_BLOCK ? count - start : SGJW_SEQUENCE_BLOCK;
+        uint32_t any = 0;
+        for (size_t j = 0; j < n; ++j)
+        {
+            size_t i = start + j;
+            uint32_t predicted = ref ? ref[i] : (i >= slot->width ? cur[i - slot->width] : 0);
+            codes[j] = Sequence_Zigzag(cur[i] - predicted);
+            any |= codes[j];
+        }
+        memset(codes + n, 0, (SGJW_SEQUENCE_BLOCK - n) * sizeof(uint32_t));
+
+        uint8_t width = any ? (uint8_t)(32 - __builtin_clz(any)) : 0;
+        slot->packed[b] = width;
+        Sequence_Pack_Block(codes, width, words + used);
+        used += (size_t)width * SGJW_SEQUENCE_LANES;
+    }
+
+    slot->words_offset = (uint32_t)words_offset;
+    slot->words_size = (uint32_t)(used * sizeof(uint32_t));
+    return SGJW_SUCCESS;
+}
+
+/**
+ * @brief Probe a file, read it whole so its matrix lands on a cache line of the slot, and collect its distinct values.
+ */
+static int8_t Sequence_Read_Slot(SequenceSlot* slot, const char* path, uint32_t* table)
+{
+    slot->name = path ? SGJW_File_Name(path) : NULL;
+    if (!slot->name)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    StateGridJPEGProbe probe;
+    int8_t retval = State_Grid_JPEG_Probe(path, &probe);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    size_t count = (size_t)probe.header.width * probe.header.height;
+    size_t distinct = count < SGJW_SEQUENCE_MAX_PALETTE ? count : SGJW_SEQUENCE_MAX_PALETTE;
+    size_t shift = (SGJW_CACHE_LINE - probe.matrix_offset % SGJW_CACHE_LINE) % SGJW_CACHE_LINE;
+    retval = Sequence_Reserve(&slot->buffer, &slot->buffer_capacity, shift + probe.file_size);
+    if (retval == SGJW_SUCCESS)
+        retval = Sequence_Reserve(&slot->plane, &slot->plane_capacity, (count ? count : 1) * sizeof(uint32_t));
+    if (retval == SGJW_SUCCESS)
+        retval = Sequence_Reserve(&slot->distinct, &slot->distinct_capacity, (distinct ? distinct : 1) * sizeof(uint32_t));
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return SGJW_ERROR_FILE_NOT_FOUND;
+
+    // Changed since it was probed
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size != probe.file_size)
+        retval = SGJW_ERROR_READ_FAILED;
+
+    if (retval == SGJW_SUCCESS)
+        retval = SGJW_Pread_Full(fd, slot->buffer + shift, probe.file_size, 0);
+    close(fd);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    slot->file = slot->buffer + shift;
+    slot->file_size = probe.file_size;
+    slot->matrix_offset = probe.matrix_offset;
+    slot->width = probe.header.width;
+    slot->height = probe.header.height;
+    slot->distinct_count = Sequence_Distinct((const uint32_t*)(slot->file + slot->matrix_offset), count, table, (uint32_t*)slot->distinct);
+    return SGJW_SUCCESS;
+}
+
+static void* Sequence_Read_Worker(void* arg)
+{
+    SequenceWorker* worker = (SequenceWorker*)arg;
+    SequenceEncoder* encoder = worker->encoder;
+    uint32_t* table = encoder->tables + (size_t)worker->id * 2 * SGJW_SEQUENCE_TABLE;
+    for (uint32_t i = worker->id; i < encoder->frames; i += encoder->workers)
+        encoder->slots[i].status = Sequence_Read_Slot(&encoder->slots[i], encoder->filepaths[encoder->first + i], table);
+    return NULL;
+}
+
+static void* Sequence_Map_Worker(void* arg)
+{
+    SequenceWorker* worker = (SequenceWorker*)arg;
+    SequenceEncoder* encoder = worker->encoder;
+    uint32_t* table = encoder->tables + (size_t)worker->id * 2 * SGJW_SEQUENCE_TABLE;
+    for (uint32_t i = worker->id; i < encoder->frames; i += encoder->workers)
+        if (encoder->slots[i].status == SGJW_SUCCESS)
+            Sequence_Map_Slot(&encoder->slots[i], table);
+    return NULL;
+}
+
+static void* Sequence_Code_Worker(void* arg)
+{
+    SequenceWorker* worker = (SequenceWorker*)arg;
+    SequenceEncoder* encoder = worker->encoder;
+    for (uint32_t i = worker->id; i < encoder->frames; i += encoder->workers)
+    {
+        SequenceSlot* slot = &encoder->slots[i];
+        if (slot->status == SGJW_SUCCESS)
+            slot->status = Sequence_Code_Slot(slot, slot->keyframe ? NULL : &encoder->slots[i - 1]);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Run one phase on every worker, worker 0 and workers that fail to start run on the calling thread.
+ */
+static void Sequence_Run(SequenceEncoder* encoder, pthread_t* threads, SequenceWorker* args, void* (*phase)(void*))
+{
+    for (uint32_t i = 0; i < encoder->workers; ++i)
+    {
+        args[i].encoder = encoder;
+        args[i].id = i;
+        args[i].started = i > 0 && pthread_create(&threads[i], NULL, phase, &args[i]) == 0;
+    }
+    for (uint32_t i = 0; i < encoder->workers; ++i)
+        if (!args[i].started)
+            phase(&args[i]);
+    for (uint32_t i = 0; i < encoder->workers; ++i)
+        if (args[i].started)
+            pthread_join(threads[i], NULL);
+}
+
+/**
+ * @brief Write a coded frame at offset: the file without its matrix, the value table on keyframes, block widths and packed blocks.
+ */
+static int8_t Sequence_Write_Frame(int fd, const SequenceSlot* slot, uint64_t offset, SequenceRecord* record)
+{
+    size_t matrix_size = (size_t)slot->width * slot->height * sizeof(float);
+    size_t blocks = Sequence_Blocks(slot->width, slot->height);
+    size_t palette_size = slot->keyframe && slot->palette ? slot->palette_size * sizeof(uint32_t) : 0;
+
+    memset(record, 0, sizeof(SequenceRecord));
+    record->offset = offset;
+    record->file_size = slot->file_size;
+    record->matrix_offset = (uint32_t)slot->matrix_offset;
+    record->palette_offset = (uint32_t)Sequence_Align(slot->file_size - matrix_size, 16);
+    record->palette_size = slot->palette_size;
+    record->widths_offset = (uint32_t)Sequence_Align(record->palette_offset + palette_size, 16);
+    record->words_offset = (uint32_t)Sequence_Align(record->widths_offset + blocks, 16);
+    record->words_size = slot->words_size;
+    record->width = slot->width;
+    record->height = slot->height;
+    record->keyframe = slot->keyframe;
+
+    // The gaps stay holes, i.e. zeros
+    int8_t retval = SGJW_Pwrite_Full(fd, slot->file, slot->matrix_offset, offset);
+    if (retval == SGJW_SUCCESS)
+        retval = SGJW_Pwrite_Full(fd, slot->file + slot->matrix_offset + matrix_size, slot->file_size - slot->matrix_offset - matrix_size,
+                                  offset + slot->matrix_offset);
+    if (retval == SGJW_SUCCESS)
+        retval = SGJW_Pwrite_Full(fd, slot->palette, palette_size, offset + record->palette_offset);
+    if (retval == SGJW_SUCCESS)
+        retval = SGJW_Pwrite_Full(fd, slot->packed, blocks, offset + record->widths_offset);
+    if (retval == SGJW_SUCCESS)
+        retval = SGJW_Pwrite_Full(fd, slot->packed + slot->words_offset, slot->words_size, offset + record->words_offset);
+    return retval;
+}
+
+static const SequenceRecord* Sequence_Record(const SGJWSequence* sequence, uint32_t frame)
+{
+    return (const SequenceRecord*)sequence->records + frame;
+}
+
+/* ====================================================================================================== */
+/* ======================================== Decoding Kernels ============================================ */
+/* ====================================================================================================== */
+
+// Add the decoded differences of whole blocks to dst, the words of a block follow the ones before it
+typedef void (*Sequence_Kernel)(const uint8_t* widths, size_t blocks, const uint32_t* words, uint32_t* dst);
+
+// Reference kernel, every SIMD kernel must give the same values
+static void Sequence_Scalar(const uint8_t* widths, size_t blocks, const uint32_t* words, uint32_t* dst)
+{
+    uint32_t codes[SGJW_SEQUENCE_BLOCK];
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        Sequence_Unpack_Block(words, widths[b], codes);
+        for (uint32_t j = 0; j < SGJW_SEQUENCE_BLOCK; ++j)
+            dst[b * SGJW_SEQUENCE_BLOCK + j] += Sequence_Unzigzag(codes[j]);
+        words += (size_t)widths[b] * SGJW_SEQUENCE_LANES;
+    }
+}
+
+#if SGJW_HAVE_X86
+static void Sequence_SSE2(const uint8_t* widths, size_t blocks, const uint32_t* words, uint32_t* dst)
+{
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i zero = _mm_setzero_si128();
+
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        uint32_t width = widths[b];
+        if (width == 0)
+            continue;
+
+        const __m128i mask = _mm_set1_epi32((int)(width == 32 ? ~0u : (1u << width) - 1));
+        uint32_t* out = dst + b * SGJW_SEQUENCE_BLOCK;
+        for (uint32_t j = 0; j < SGJW_SEQUENCE_BLOCK / SGJW_SEQUENCE_LANES; ++j)
+        {
+            uint32_t bit = j * width;
+            uint32_t shift = bit % 32;
+            const __m128i* in = (const __m128i*)(words + bit / 32 * SGJW_SEQUENCE_LANES);
+
+            __m128i code = _mm_srl_epi32(_mm_loadu_si128(in), _mm_cvtsi32_si128((int)shift));
+            if (shift + width > 32)
+                code = _mm_or_si128(code, _mm_sll_epi32(_mm_loadu_si128(in + 1), _mm_cvtsi32_si128((int)(32 - shift))));
+            code = _mm_and_si128(code, mask);
+
+            __m128i delta = _mm_xor_si128(_mm_srli_epi32(code, 1), _mm_sub_epi32(zero, _mm_and_si128(code, one)));
+            __m128i* o = (__m128i*)(out + j * SGJW_SEQUENCE_LANES);
+            _mm_storeu_si128(o, _mm_add_epi32(_mm_loadu_si128(o), delta));
+        }
+        words += width * SGJW_SEQUENCE_LANES;
+    }
+}
+#endif
+
+#if SGJW_HAVE_NEON
+static void Sequence_NEON(const uint8_t* widths, size_t blocks, const uint32_t* words, uint32_t* dst)
+{
+    const uint32x4_t one = vdupq_n_u32(1);
+    const uint32x4_t zero = vdupq_n_u32(0);
+
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        uint32_t width = widths[b];
+        if (width == 0)
+            continue;
+
+        const uint32x4_t mask = vdupq_n_u32(width == 32 ? ~0u : (1u << width) - 1);
+        uint32_t* out = dst + b * SGJW_SEQUENCE_BLOCK;
+        for (uint32_t j = 0; j < SGJW_SEQUENCE_BLOCK / SGJW_SEQUENCE_LANES; ++j)
+        {
+            uint32_t bit = j * width;
+            int32_t shift = (int32_t)(bit % 32);
+            const uint32_t* in = words + bit / 32 * SGJW_SEQUENCE_LANES;
+
+            // A negative count shifts right
+            uint32x4_t code = vshlq_u32(vld1q_u32(in), vdupq_n_s32(-shift));
+            if ((uint32_t)shift + width > 32)
+                code = vorrq_u32(code, vshlq_u32(vld1q_u32(in + SGJW_SEQUENCE_LANES), vdupq_n_s32(32 - shift)));
+            code = vandq_u32(code, mask);
+
+            uint32x4_t delta = veorq_u32(vshrq_n_u32(code, 1), vsubq_u32(zero, vandq_u32(code, one)));
+            uint32_t* o = out + j * SGJW_SEQUENCE_LANES;
+            vst1q_u32(o, vaddq_u32(vld1q_u32(o), delta));
+        }
+        words += width * SGJW_SEQUENCE_LANES;
+    }
+}
+#endif
+
+static Sequence_Kernel Sequence_Get_Kernel(SGJW_KERNEL kernel)
+{
+    switch (kernel)
+    {
+        case SGJW_KERNEL_AUTO:
+            return Sequence_Get_Kernel(State_Grid_JPEG_Matrix_Kernel());
+        case SGJW_KERNEL_SCALAR:
+            return Sequence_Scalar;
+#if SGJW_HAVE_X86
+        case SGJW_KERNEL_SSE2:
+            return Sequence_SSE2;
+        case SGJW_KERNEL_AVX2:
+            // Four lanes per block, wider registers gain nothing
+            return __builtin_cpu_supports("avx2") ? Sequence_SSE2 : NULL;
+#endif
+#if SGJW_HAVE_NEON
+        case SGJW_KERNEL_NEON:
+            return Sequence_NEON;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * @brief Decode one frame into the sequence plane, which holds the frame before it unless it is a keyframe.
+ */
+static int8_t Sequence_Decode(SGJWSequence* sequence, uint32_t frame)
+{
+    const SequenceRecord* record = Sequence_Record(sequence, frame);
+    const uint8_t* data = (const uint8_t*)sequence->map_base + record->offset;
+    const uint8_t* widths = data + record->widths_offset;
+    const uint32_t* words = (const uint32_t*)(data + record->words_offset);
+    size_t count = (size_t)record->width * record->height;
+    size_t blocks = Sequence_Blocks(record->width, record->height);
+    size_t whole = count / SGJW_SEQUENCE_BLOCK;
+
+    // The widths must account for every packed word, or a corrupt frame would read past its end
+    size_t total = 0;
+    size_t tail = 0;
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        if (widths[b] > 32)
+            return SGJW_ERROR_READ_FAILED;
+        if (b == whole)
+            tail = total;
+        total += widths[b];
+    }
+    if (total * SGJW_SEQUENCE_LANES * sizeof(uint32_t) != record->words_size)
+        return SGJW_ERROR_READ_FAILED;
+
+    uint32_t* dst = sequence->plane;
+    if (record->keyframe)
+    {
+        memset(dst, 0, count * sizeof(uint32_t));
+        sequence->palette = record->palette_size ? (const uint32_t*)(data + record->palette_offset) : NULL;
+        sequence->palette_size = record->palette_size;
+    }
+
+    Sequence_Get_Kernel(sequence->kernel)(widths, whole, words, dst);
+    if (whole < blocks)
+    {
+        uint32_t codes[SGJW_SEQUENCE_BLOCK];
+        Sequence_Unpack_Block(words + tail * SGJW_SEQUENCE_LANES, widths[whole], codes);
+        for (size_t j = 0; j < count - whole * SGJW_SEQUENCE_BLOCK; ++j)
+            dst[whole * SGJW_SEQUENCE_BLOCK + j] += Sequence_Unzigzag(codes[j]);
+    }
+
+    // Keyframe rows were coded against the row above
+    if (record->keyframe)
+    {
+        for (size_t y = 1; y < record->height; ++y)
+        {
+            uint32_t* row = dst + y * record->width;
+            const uint32_t* above = row - record->width;
+            for (size_t x = 0; x < record->width; ++x)
+                row[x] += above[x];
+        }
+    }
+    return SGJW_SUCCESS;
+}
+
+/**
+ * @brief Turn the decoded plane into the matrix, through the value table of the group if it has one.
+ *
+ * @return SGJW_ERROR_READ_FAILED if an index is outside the table.
+ */
+static int8_t Sequence_Output(SGJWSequence* sequence, size_t count)
+{
+    uint32_t* matrix = (uint32_t*)sequence->matrix;
+    if (!sequence->palette)
+    {
+        memcpy(matrix, sequence->plane, count * sizeof(uint32_t));
+        return SGJW_SUCCESS;
+    }
+
+    const uint32_t* palette = sequence->palette;
+    uint32_t size = sequence->palette_size;
+    uint32_t outside = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t index = sequence->plane[i];
+        outside |= index >= size;
+        matrix[i] = Sequence_Unkey(palette[index < size ? index : 0]);
+    }
+    return outside ? SGJW_ERROR_READ_FAILED : SGJW_SUCCESS;
+}
+
+/**
+ * @brief Decode a frame and write its original file, relative to dirfd.
+ */
+static int8_t Sequence_Write_File(SGJWSequence* sequence, uint32_t frame, int dirfd, const char* filepath)
+{
+    const float* matrix = NULL;
+    int8_t retval = State_Grid_JPEG_Sequence_Matrix(sequence, frame, &matrix);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    const SequenceRecord* record = Sequence_Record(sequence, frame);
+    const uint8_t* data = (const uint8_t*)sequence->map_base + record->offset;
+    size_t matrix_size = (size_t)record->width * record->height * sizeof(float);
+
+    int fd = openat(dirfd, filepath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return SGJW_ERROR_FILE_WRITE;
+
+    retval = SGJW_Pwrite_Full(fd, data, record->matrix_offset, 0);
+    if (retval == SGJW_SUCCESS)
+        retval = SGJW_Pwrite_Full(fd, matrix, matrix_size, record->matrix_offset);
+    if (retval == SGJW_SUCCESS)
+        retval = SGJW_Pwrite_Full(fd, data + record->matrix_offset, record->file_size - record->matrix_offset - matrix_size,
+                                  record->matrix_offset + matrix_size);
+    if (close(fd) != 0 && retval == SGJW_SUCCESS)
+        retval = SGJW_ERROR_FILE_WRITE;
+    return retval;
+}
+
+/* ====================================================================================================== */
+/* ========================================== Main APIs ================================================= */
+/* ====================================================================================================== */
+
+int8_t State_Grid_JPEG_Sequence_Encode(const char* sequence_path, const char* const* filepaths, size_t count, const SGJWSequenceConfig* config,
+                                       SGJWSequenceReport* report)
+{
+    if (!sequence_path || (!filepaths && count > 0) || count > UINT32_MAX)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    // Only the names are stored, Unpack would write one file over the other
+    int8_t retval = SGJW_Check_Unique_Names(filepaths, count);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    SGJWSequenceReport counters;
+    memset(&counters, 0, sizeof(counters));
+    uint64_t start = SGJW_Now_Ns();
+
+    /* ---------- Step 1 : Workers, window and records ---------- */
+
+    // A window holds whole keyframe intervals, at least one file per worker
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t workers = config && config->threads ? config->threads : (cpus > 0 ? (uint32_t)cpus : 1);
+    uint32_t interval = config && config->keyframe_interval ? config->keyframe_interval : SGJW_SEQUENCE_DEFAULT_KEYFRAME;
+    size_t window = ((size_t)workers + interval - 1) / interval * interval;
+    if (window > count)
+        window = count ? count : 1;
+    if (workers > window)
+        workers = (uint32_t)window;
+
+    SequenceEncoder encoder;
+    memset(&encoder, 0, sizeof(encoder));
+    encoder.filepaths = filepaths;
+    encoder.workers = workers;
+
+    int fd = -1;
+    uint8_t* index = NULL;
+    char* temp_path = NULL;
+    uint8_t* palettes = NULL;
+    size_t palettes_capacity = 0;
+
+    encoder.slots = (SequenceSlot*)SGJW_Malloc(window * sizeof(SequenceSlot), SGJW_CACHE_LINE);
+    encoder.tables = (uint32_t*)SGJW_Malloc((size_t)workers * 2 * SGJW_SEQUENCE_TABLE * sizeof(uint32_t), SGJW_CACHE_LINE);
+    SequenceRecord* records = (SequenceRecord*)SGJW_Malloc((count ? count : 1) * sizeof(SequenceRecord), SGJW_CACHE_LINE);
+    const char** names = (const char**)SGJW_Malloc((count ? count : 1) * sizeof(char*), sizeof(void*));
+    SequenceWorker* args = (SequenceWorker*)SGJW_Malloc(workers * sizeof(SequenceWorker), sizeof(void*));
+    pthread_t* threads = (pthread_t*)SGJW_Malloc(workers * sizeof(pthread_t), sizeof(void*));
+    size_t temp_length = strlen(sequence_path) + sizeof(SGJW_SEQUENCE_TEMP_SUFFIX);
+    temp_path = (char*)SGJW_Malloc(temp_length, sizeof(void*));
+    if (!encoder.slots || !encoder.tables || !records || !names || !args || !threads || !temp_path)
+    {
+        retval = SGJW_ERROR_MALLOC_FAILED;
+        goto cleanup;
+    }
+    memset(encoder.slots, 0, window * sizeof(SequenceSlot));
+
+    snprintf(temp_path, temp_length, "%s%s", sequence_path, SGJW_SEQUENCE_TEMP_SUFFIX);
+    fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        retval = SGJW_ERROR_FILE_WRITE;
+        goto cleanup;
+    }
+
+    SequenceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SGJW_SEQUENCE_MAGIC, sizeof(SGJW_SEQUENCE_MAGIC));
+    header.version = SGJW_SEQUENCE_VERSION;
+    header.keyframe_interval = interval;
+    retval = SGJW_Pwrite_Full(fd, &header, sizeof(header), 0);
+
+    /* ---------- Step 2 : Per window, read, group, map and code in parallel, write in order ---------- */
+
+    uint64_t cursor = sizeof(SequenceHeader);
+    uint64_t names_size = 0;
+    size_t frames = 0;
+    for (size_t first = 0; first < count && retval == SGJW_SUCCESS; first += window)
+    {
+        encoder.first = first;
+        encoder.frames = (uint32_t)(count - first < window ? count - first : window);
+        Sequence_Run(&encoder, threads, args, Sequence_Read_Worker);
+
+        // Room for every distinct value of the window, the tables of its groups are carved from it
+        size_t distinct = 0;
+        for (uint32_t i = 0; i < encoder.frames; ++i)
+        {
+            const SequenceSlot* slot = &encoder.slots[i];
+            if (slot->status == SGJW_ERROR_MALLOC_FAILED)
+                retval = SGJW_ERROR_MALLOC_FAILED;
+            if (slot->status == SGJW_SUCCESS && slot->distinct_count != SGJW_SEQUENCE_NONE)
+                distinct += slot->distinct_count;
+        }
+        if (retval == SGJW_SUCCESS)
+            retval = Sequence_Reserve(&palettes, &palettes_capacity, (distinct ? distinct : 1) * sizeof(uint32_t));
+        if (retval != SGJW_SUCCESS)
+            break;
+
+        // A group runs from a keyframe to the next interval, a missing file or a file of another size
+        size_t used = 0;
+        for (uint32_t a = 0, b = 0; a < encoder.frames; a = b)
+        {
+            const SequenceSlot* key = &encoder.slots[a];
+            for (b = a + 1; b < encoder.frames && key->status == SGJW_SUCCESS; ++b)
+            {
+                const SequenceSlot* slot = &encoder.slots[b];
+                if ((first + b) % interval == 0 || slot->status != SGJW_SUCCESS || slot->width != key->width || slot->height != key->height)
+                    break;
+            }
+            if (key->status == SGJW_SUCCESS)
+                used += Sequence_Group(encoder.slots, a, b, (uint32_t*)palettes + used);
+        }
+
+        Sequence_Run(&encoder, threads, args, Sequence_Map_Worker);
+        Sequence_Run(&encoder, threads, args, Sequence_Code_Worker);
+
+        for (uint32_t i = 0; i < encoder.frames && retval == SGJW_SUCCESS; ++i)
+        {
+            SequenceSlot* slot = &encoder.slots[i];
+            if (slot->status == SGJW_ERROR_MALLOC_FAILED)
+                retval = SGJW_ERROR_MALLOC_FAILED;
+            if (slot->status != SGJW_SUCCESS)
+            {
+                counters.failed++;
+                continue;
+            }
+
+            SequenceRecord* record = &records[frames];
+            cursor = Sequence_Align(cursor, SGJW_CACHE_LINE);
+            retval = Sequence_Write_Frame(fd, slot, cursor, record);
+            cursor += record->words_offset + record->words_size;
+
+            record->name_offset = names_size;
+            names_size += strlen(slot->name) + 1;
+            names[frames++] = slot->name;
+
+            counters.frames++;
+            counters.keyframes += slot->keyframe;
+            counters.matrix_bytes += (uint64_t)slot->width * slot->height * sizeof(float);
+            counters.packed_bytes += record->words_offset + record->words_size - record->palette_offset;
+        }
+    }
+    if (retval != SGJW_SUCCESS)
+        goto cleanup;
+
+    /* ---------- Step 3 : Records, names and footer behind the frames ---------- */
+
+    SequenceFooter footer;
+    memset(&footer, 0, sizeof(footer));
+    footer.records = Sequence_Align(cursor, SGJW_CACHE_LINE);
+    footer.names = footer.records + frames * sizeof(SequenceRecord);
+    footer.names_size = names_size;
+    footer.size = footer.names + names_size + sizeof(SequenceFooter);
+    footer.count = (uint32_t)frames;
+    footer.version = SGJW_SEQUENCE_VERSION;
+    memcpy(footer.magic, SGJW_SEQUENCE_MAGIC, sizeof(SGJW_SEQUENCE_MAGIC));
+
+    size_t index_size = footer.size - footer.records;
+    index = (uint8_t*)SGJW_Malloc(index_size, SGJW_CACHE_LINE);
+    if (!index)
+    {
+        retval = SGJW_ERROR_MALLOC_FAILED;
+        goto cleanup;
+    }
+
+    memcpy(index, records, frames * sizeof(SequenceRecord));
+    for (size_t i = 0; i < frames; ++i)
+        strcpy((char*)index + (footer.names - footer.records) + records[i].name_offset, names[i]);
+    memcpy(index + index_size - sizeof(SequenceFooter), &footer, sizeof(SequenceFooter));
+
+    retval = SGJW_Pwrite_Full(fd, index, index_size, footer.records);
+    if (retval == SGJW_SUCCESS && fsync(fd) != 0)
+        retval = SGJW_ERROR_FILE_WRITE;
+    close(fd);
+    fd = -1;
+
+    if (retval == SGJW_SUCCESS && rename(temp_path, sequence_path) != 0)
+        retval = SGJW_ERROR_FILE_WRITE;
+
+cleanup:
+    if (fd >= 0)
+        close(fd);
+    if (retval != SGJW_SUCCESS && temp_path)
+        unlink(temp_path);
+    if (encoder.slots)
+    {
+        for (size_t i = 0; i < window; ++i)
+        {
+            SGJW_Free(encoder.slots[i].buffer);
+            SGJW_Free(encoder.slots[i].distinct);
+            SGJW_Free(encoder.slots[i].plane);
+            SGJW_Free(encoder.slots[i].packed);
+        }
+    }
+    SGJW_Free(encoder.slots);
+    SGJW_Free(encoder.tables);
+    SGJW_Free(palettes);
+    SGJW_Free(records);
+    SGJW_Free(names);
+    SGJW_Free(args);
+    SGJW_Free(threads);
+    SGJW_Free(temp_path);
+    SGJW_Free(index);
+
+    counters.seconds = (SGJW_Now_Ns() - start) / 1e9;
+    if (report)
+        *report = counters;
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Sequence_Open(const char* sequence_path, SGJWSequence* sequence, SGJW_KERNEL kernel)
+{
+    if (!sequence_path || !sequence || !Sequence_Get_Kernel(kernel))
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    memset(sequence, 0, sizeof(SGJWSequence));
+    sequence->kernel = kernel;
+    sequence->current = SGJW_SEQUENCE_NONE;
+
+    int fd = open(sequence_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return SGJW_ERROR_FILE_NOT_FOUND;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(SequenceHeader) + sizeof(SequenceFooter))
+    {
+        close(fd);
+        return SGJW_ERROR_READ_FAILED;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return SGJW_ERROR_READ_FAILED;
+
+    sequence->map_base = map;
+    sequence->map_size = st.st_size;
+
+    /* ---------- Footer and record verification, no offset may point outside its section ---------- */
+
+    SequenceFooter footer;
+    memcpy(&footer, (const uint8_t*)map + st.st_size - sizeof(SequenceFooter), sizeof(SequenceFooter));
+    const SequenceHeader* header = (const SequenceHeader*)map;
+
+    uint8_t valid = memcmp(header->magic, SGJW_SEQUENCE_MAGIC, sizeof(SGJW_SEQUENCE_MAGIC)) == 0 && header->version == SGJW_SEQUENCE_VERSION &&
+                    memcmp(footer.magic, SGJW_SEQUENCE_MAGIC, sizeof(SGJW_SEQUENCE_MAGIC)) == 0 && footer.version == SGJW_SEQUENCE_VERSION &&
+                    footer.size == (uint64_t)st.st_size && footer.records >= sizeof(SequenceHeader) && footer.records % SGJW_CACHE_LINE == 0 &&
+                    footer.names == footer.records + (uint64_t)footer.count * sizeof(SequenceRecord) &&
+                    footer.names + footer.names_size + sizeof(SequenceFooter) == footer.size;
+
+    sequence->records = (const uint8_t*)map + (valid ? footer.records : 0);
+    sequence->names = (const char*)map + (valid ? footer.names : 0);
+    valid = valid && (footer.names_size == 0 || sequence->names[footer.names_size - 1] == '\0');
+
+    for (uint32_t i = 0; i < footer.count && valid; ++i)
+    {
+        const SequenceRecord* record = (const SequenceRecord*)sequence->records + i;
+        const SequenceRecord* prev = i > 0 ? record - 1 : NULL;
+        uint64_t matrix_size = (uint64_t)record->width * record->height * sizeof(float);
+        uint64_t size = (uint64_t)record->words_offset + record->words_size;
+        uint64_t palette_end = record->palette_offset + (record->keyframe ? (uint64_t)record->palette_size * sizeof(uint32_t) : 0);
+        valid = record->offset >= sizeof(SequenceHeader) && record->offset % SGJW_CACHE_LINE == 0 && record->offset <= footer.records &&
+                size <= footer.records - record->offset && matrix_size <= record->file_size &&
+                record->matrix_offset <= record->file_size - matrix_size && record->file_size - matrix_size <= record->palette_offset &&
+                record->palette_offset % sizeof(uint32_t) == 0 && record->palette_size <= SGJW_SEQUENCE_MAX_PALETTE &&
+                palette_end <= record->widths_offset &&
+                (uint64_t)record->widths_offset + Sequence_Blocks(record->width, record->height) <= record->words_offset &&
+                record->words_offset % 16 == 0 && record->name_offset < footer.names_size;
+
+        // A delta continues the plane and the value table of the frame before it
+        valid = valid && (record->keyframe || (prev && prev->width == record->width && prev->height == record->height &&
+                                               prev->palette_size == record->palette_size));
+    }
+
+    if (!valid)
+    {
+        State_Grid_JPEG_Sequence_Close(sequence);
+        return SGJW_ERROR_READ_FAILED;
+    }
+
+    sequence->count = footer.count;
+    return SGJW_SUCCESS;
+}
+
+int8_t State_Grid_JPEG_Sequence_Get(const SGJWSequence* sequence, uint32_t frame, SGJWSequenceEntry* entry)
+{
+    if (!sequence || !sequence->map_base || !entry || frame >= sequence->count)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    const SequenceRecord* record = Sequence_Record(sequence, frame);
+    memset(entry, 0, sizeof(SGJWSequenceEntry));
+    entry->name = sequence->names + record->name_offset;
+    entry->width = record->width;
+    entry->height = record->height;
+    entry->keyframe = record->keyframe;
+    entry->file_size = record->file_size;
+    return SGJW_SUCCESS;
+}
+
+int8_t State_Grid_JPEG_Sequence_Matrix(SGJWSequence* sequence, uint32_t frame, const float** matrix)
+{
+    if (!sequence || !sequence->map_base || !matrix || frame >= sequence->count)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    const SequenceRecord* record = Sequence_Record(sequence, frame);
+    size_t count = (size_t)record->width * record->height;
+    if (count > sequence->matrix_capacity)
+    {
+        SGJW_Free(sequence->plane);
+        SGJW_Free(sequence->matrix);
+        sequence->current = SGJW_SEQUENCE_NONE;
+        sequence->plane = (uint32_t*)SGJW_Malloc(count * sizeof(uint32_t), SGJW_CACHE_LINE);
+        sequence->matrix = (float*)SGJW_Malloc(count * sizeof(float), SGJW_CACHE_LINE);
+        sequence->matrix_capacity = sequence->plane && sequence->matrix ? count : 0;
+        if (!sequence->matrix_capacity)
+            return SGJW_ERROR_MALLOC_FAILED;
+    }
+
+    if (sequence->current == frame)
+    {
+        *matrix = sequence->matrix;
+        return SGJW_SUCCESS;
+    }
+
+    /* ---------- From the keyframe before the frame, or from the frame decoded last if it is on the way ---------- */
+
+    uint32_t start = frame;
+    while (start > 0 && !Sequence_Record(sequence, start)->keyframe)
+        --start;
+    if (sequence->current != SGJW_SEQUENCE_NONE && sequence->current >= start && sequence->current < frame)
+        start = sequence->current + 1;
+
+    int8_t retval = SGJW_SUCCESS;
+    for (uint32_t i = start; i <= frame && retval == SGJW_SUCCESS; ++i)
+        retval = Sequence_Decode(sequence, i);
+
+    // Only the frame asked for goes through the value table
+    if (retval == SGJW_SUCCESS)
+        retval = Sequence_Output(sequence, count);
+
+    sequence->current = retval == SGJW_SUCCESS ? frame : SGJW_SEQUENCE_NONE;
+    *matrix = sequence->matrix;
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Sequence_Extract(SGJWSequence* sequence, uint32_t frame, const char* filepath)
+{
+    if (!sequence || !filepath)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    return Sequence_Write_File(sequence, frame, AT_FDCWD, filepath);
+}
+
+int8_t State_Grid_JPEG_Sequence_Unpack(const char* sequence_path, const char* directory, size_t* unpacked)
+{
+    if (!sequence_path || !directory)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    if (unpacked)
+        *unpacked = 0;
+
+    SGJWSequence sequence;
+    int8_t retval = State_Grid_JPEG_Sequence_Open(sequence_path, &sequence, SGJW_KERNEL_AUTO);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    int dirfd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd < 0)
+    {
+        State_Grid_JPEG_Sequence_Close(&sequence);
+        return SGJW_ERROR_FILE_NOT_FOUND;
+    }
+
+    for (uint32_t i = 0; i < sequence.count && retval == SGJW_SUCCESS; ++i)
+    {
+        // Names come from the sequence, never let one leave the folder
+        const char* name = sequence.names + Sequence_Record(&sequence, i)->name_offset;
+        if (SGJW_File_Name(name) != name)
+        {
+            retval = SGJW_ERROR_READ_FAILED;
+            break;
+        }
+
+        retval = Sequence_Write_File(&sequence, i, dirfd, name);
+        if (retval == SGJW_SUCCESS && unpacked)
+            ++*unpacked;
+    }
+
+    close(dirfd);
+    State_Grid_JPEG_Sequence_Close(&sequence);
+    return retval;
+}
+
+void State_Grid_JPEG_Sequence_Close(SGJWSequence* sequence)
+{
+    if (!sequence)
+        return;
+
+    if (sequence->map_base)
+        munmap(sequence->map_base, sequence->map_size);
+    SGJW_Free(sequence->plane);
+    SGJW_Free(sequence->matrix);
+
+    memset(sequence, 0, sizeof(SGJWSequence));
+    sequence->current = SGJW_SEQUENCE_NONE;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+/**
+ * @file sgjw_sequence.h
+ * @brief Lossless temporal compression of capture sequences from a fixed camera.
+ *
+ * @note Typical usage:
+ * 1. Invoke State_Grid_JPEG_Sequence_Encode with the files of a sequence, in capture order.
+ * 2. Invoke State_Grid_JPEG_Sequence_Open to map the sequence.
+ * 3. State_Grid_JPEG_Sequence_Matrix decodes the matrix of a frame, State_Grid_JPEG_Sequence_Extract
+ *    writes the original file back. Frames are cheapest in order, each one is a delta of the last.
+ * 4. Call State_Grid_JPEG_Sequence_Close to unmap it.
+ * State_Grid_JPEG_Sequence_Unpack writes every original file back into a folder.
+ *
+ * Sensor matrices come from raw counts through a calibration curve, so a sequence holds few distinct
+ * floats. Each group, a keyframe and the frames up to the next one, gets a value table: its distinct floats
+ * in ascending order, and pixels become indexes into it, so neighbouring temperatures get neighbouring
+ * indexes. A group with more than 65536 distinct values codes the bit patterns of the floats instead.
+ * Each index is subtracted from the same pixel of the previous frame, or on a keyframe from the pixel
+ * above, and the zigzagged differences are bit-packed in blocks of 128 values at the width of the largest
+ * one of the block. A block is four interleaved lanes, so the decoder unpacks four values per SIMD
+ * instruction. Integer arithmetic wraps, any pattern, NaN included, comes back bit-exact. JPEG, header,
+ * footer and appendix bytes are stored verbatim, so a decoded file is identical to the encoded one.
+ *
+ * Keyframes, every keyframe_interval frames, bound the frames to decode for random access. The encoder
+ * works on whole intervals at a time, each phase in parallel over the frames: read and collect distinct
+ * values, map to indexes, code against the previous frame.
+ *
+ * Layout, little-endian: header | (frame) * count | records | names | footer,
+ * frame: JPEG and header | footer, appendix and tail | value table (keyframes) | block widths | packed blocks.
+ */
+
+#include "sgjw.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Keyframe interval when SGJWSequenceConfig::keyframe_interval is 0, one second at 30 Hz
+#define SGJW_SEQUENCE_DEFAULT_KEYFRAME 30
+
+typedef struct
+{
+    // A keyframe every this many files, 0 for SGJW_SEQUENCE_DEFAULT_KEYFRAME, 1 makes every frame one.
+    // The encoder holds at least one interval of files in memory.
+    uint32_t keyframe_interval;
+    // Encoder threads, 0 for one per online CPU.
+    uint32_t threads;
+} SGJWSequenceConfig;
+
+typedef struct
+{
+    // Frames encoded, keyframes included.
+    uint64_t frames;
+    uint64_t keyframes;
+    // Files skipped because they cannot be probed or changed while being read.
+    uint64_t failed;
+    // Matrix bytes before and after coding, value tables included.
+    uint64_t matrix_bytes;
+    uint64_t packed_bytes;
+    // Wall time of the encoding.
+    double seconds;
+} SGJWSequenceReport;
+
+// One frame of a sequence
+typedef struct
+{
+    // Name of the encoded file, without its folder. @attention Borrowed from the mapping.
+    const char* name;
+    uint16_t width;
+    uint16_t height;
+    uint8_t keyframe;
+    // Size of the original file.
+    uint64_t file_size;
+} SGJWSequenceEntry;
+
+// A mapped sequence, with the decoder state
+typedef struct
+{
+    // Number of frames, in capture order.
+    uint32_t count;
+
+    // Private
+    void* map_base;
+    size_t map_size;
+    const void* records;
+    const char* names;
+    SGJW_KERNEL kernel;
+    uint32_t* plane;
+    float* matrix;
+    size_t matrix_capacity;
+    const uint32_t* palette;
+    uint32_t palette_size;
+    uint32_t current;
+} SGJWSequence;
+
+/**
+ * @brief Encode files into a new sequence, replacing any sequence at that path.
+ *
+ * @note Files that cannot be probed are skipped, the next file is then a keyframe, as is any file whose matrix
+ *       size differs from the previous one. Only the names are kept, so the file names must be distinct.
+ *
+ * @param sequence_path The sequence to write.
+ * @param filepaths The files, in capture order.
+ * @param count Number of files.
+ * @param config Optional, NULL for the defaults.
+ * @param report Optional, receives the counters.
+ * @return SGJW_ERROR_INVALID_PARAMS if two files share a name, SGJW_ERROR_FILE_WRITE if the sequence cannot be written,
+ *         otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Sequence_Encode(const char* sequence_path, const char* const* filepaths, size_t count, const SGJWSequenceConfig* config,
+                                       SGJWSequenceReport* report);
+
+/**
+ * @brief Map a sequence and verify its footer and records.
+ *
+ * @param sequence_path The sequence.
+ * @param sequence Receives the mapping.
+ * @param kernel The decoding kernel, SGJW_KERNEL_AUTO picks the best one for the running CPU.
+ * @return SGJW_ERROR_READ_FAILED if it is not a valid sequence, otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Sequence_Open(const char* sequence_path, SGJWSequence* sequence, SGJW_KERNEL kernel);
+
+/**
+ * @brief Get the name, matrix size and keyframe flag of a frame.
+ *
+ * @param sequence The sequence.
+ * @param frame Frame number, below sequence->count.
+ * @param entry Receives the frame.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Sequence_Get(const SGJWSequence* sequence, uint32_t frame, SGJWSequenceEntry* entry);
+
+/**
+ * @brief Decode the matrix of a frame.
+ *
+ * @note The next frame costs one delta; any other frame decodes from the keyframe before it. A sequence handle
+ *       decodes on one thread at a time.
+ *
+ * @param sequence The sequence.
+ * @param frame Frame number, below sequence->count.
+ * @param matrix Receives the matrix, width * height floats. @attention Owned by the sequence, valid until the next
+ *        call or State_Grid_JPEG_Sequence_Close.
+ * @return SGJW_ERROR_READ_FAILED if the frame is corrupt, otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Sequence_Matrix(SGJWSequence* sequence, uint32_t frame, const float** matrix);
+
+/**
+ * @brief Decode a frame back into its original file.
+ *
+ * @param sequence The sequence.
+ * @param frame Frame number, below sequence->count.
+ * @param filepath The file to write, replaced if it exists.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Sequence_Extract(SGJWSequence* sequence, uint32_t frame, const char* filepath);
+
+/**
+ * @brief Decode every frame of a sequence back to its original file in a folder.
+ *
+ * @param sequence_path The sequence.
+ * @param directory The folder, it must exist. Existing files of the same names are replaced.
+ * @param unpacked Optional, receives the number of files written.
+ * @return SGJW_ERROR_FILE_NOT_FOUND if the folder cannot be opened, otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Sequence_Unpack(const char* sequence_path, const char* directory, size_t* unpacked);
+
+/**
+ * @brief Unmap a sequence and release its decoder state, matrices and entries of it become invalid.
+ *
+ * @param sequence The sequence.
+ */
+void State_Grid_JPEG_Sequence_Close(SGJWSequence* sequence);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,431 @@
+#include "sgjw_stream.h"
+#include "sgjw_internal.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+// Smallest window allocation, it then doubles up to the bound
+#define SGJW_STREAM_MIN_WINDOW (64 * 1024)
+
+// Bytes read at once by State_Grid_JPEG_Read_Fd
+#define SGJW_STREAM_CHUNK_BYTES (64 * 1024)
+
+// JPEG marker codes
+#define SGJW_JPEG_SOI 0xD8
+#define SGJW_JPEG_EOI 0xD9
+#define SGJW_JPEG_SOS 0xDA
+#define SGJW_JPEG_TEM 0x01
+#define SGJW_JPEG_RST0 0xD0
+#define SGJW_JPEG_RST7 0xD7
+
+// Where the marker scanner is
+typedef enum
+{
+    // Expecting FF D8.
+    SCAN_SOI = 0,
+    SCAN_SOI_CODE,
+    // Expecting the FF of the next marker.
+    SCAN_MARKER,
+    // Expecting a marker code, FF fill bytes allowed.
+    SCAN_CODE,
+    // Segment length, big-endian, itself included.
+    SCAN_LENGTH_HIGH,
+    SCAN_LENGTH_LOW,
+    // Skipping segment_left bytes.
+    SCAN_SEGMENT,
+    // Entropy-coded data behind SOS, and an FF inside it.
+    SCAN_ENTROPY,
+    SCAN_ENTROPY_FF,
+    // EOI passed, everything from here on goes to the window.
+    SCAN_DONE,
+    // Not a JPEG as far as the scanner can tell, everything from here on goes to the window.
+    SCAN_FAILED
+} SCAN_STATE;
+
+/* ====================================================================================================== */
+/* ======================================== Helper Functions ============================================ */
+/* ====================================================================================================== */
+
+static void Stream_Reset(SGJWStream* stream)
+{
+    stream->used = 0;
+    stream->total = 0;
+    stream->jpeg_end = 0;
+    stream->segment_left = 0;
+    stream->scan_state = SCAN_SOI;
+    stream->scan_sos = 0;
+    stream->error = SGJW_SUCCESS;
+}
+
+static int8_t Stream_Sink(SGJWStream* stream, const uint8_t* data, size_t size)
+{
+    if (size == 0 || !stream->config.sink)
+        return SGJW_SUCCESS;
+    return stream->config.sink(data, size, stream->config.user) == 0 ? SGJW_SUCCESS : SGJW_ERROR_FILE_WRITE;
+}
+
+/**
+ * @brief Follow the JPEG markers over the next bytes.
+ *
+ * @return How many bytes of data are known to be JPEG: all of them, or up to EOI included, or up to the first one
+ *         that cannot be JPEG.
+ */
+static size_t Stream_Scan(SGJWStream* stream, const uint8_t* data, size_t size)
+{
+    size_t i = 0;
+
+    while (i < size)
+    {
+        uint8_t c = data[i];
+
+        switch (stream->scan_state)
+        {
+            case SCAN_SOI:
+                if (c != 0xFF)
+                    goto failed;
+                stream->scan_state = SCAN_SOI_CODE;
+                ++i;
+                break;
+
+            case SCAN_SOI_CODE:
+                if (c != SGJW_JPEG_SOI)
+                    goto failed;
+                stream->scan_state = SCAN_MARKER;
+                ++i;
+                break;
+
+            case SCAN_MARKER:
+                if (c != 0xFF)
+                    goto failed;
+                stream->scan_state = SCAN_CODE;
+                ++i;
+                break;
+
+            case SCAN_ENTROPY_FF:
+                // Stuffed zero or restart marker, the entropy-coded data goes on
+                if (c == 0x00 || (c >= SGJW_JPEG_RST0 && c <= SGJW_JPEG_RST7))
+                {
+                    stream->scan_state = SCAN_ENTROPY;
+                    ++i;
+                    break;
+                }
+                // fall through
+            case SCAN_CODE:
+                if (c == 0x00 || c == SGJW_JPEG_SOI)
+                    goto failed;
+                ++i;
+
+                if (c == 0xFF)
+                    break;
+                if (c == SGJW_JPEG_EOI)
+                {
+                    stream->scan_state = SCAN_DONE;
+                    return i;
+                }
+                if (c == SGJW_JPEG_TEM || (c >= SGJW_JPEG_RST0 && c <= SGJW_JPEG_RST7))
+                {
+                    stream->scan_state = SCAN_MARKER;
+                    break;
+                }
+                stream->scan_sos = c == SGJW_JPEG_SOS;
+                stream->scan_state = SCAN_LENGTH_HIGH;
+                break;
+
+            case SCAN_LENGTH_HIGH:
+                stream->segment_left = (uint32_t)c << 8;
+                stream->scan_state = SCAN_LENGTH_LOW;
+                ++i;
+                break;
+
+            case SCAN_LENGTH_LOW:
+                stream->segment_left |= c;
+                if (stream->segment_left < 2)
+                    goto failed;
+                stream->segment_left -= 2;
+                stream->scan_state = SCAN_SEGMENT;
+                ++i;
+                // An empty segment ends here
+                // fall through
+            case SCAN_SEGMENT:
+            {
+                size_t skip = size - i < stream->segment_left ? size - i : stream->segment_left;
+                i += skip;
+                stream->segment_left -= (uint32_t)skip;
+                if (stream->segment_left == 0)
+                    stream->scan_state = stream->scan_sos ? SCAN_ENTROPY : SCAN_MARKER;
+                break;
+            }
+
+            case SCAN_ENTROPY:
+            {
+                const uint8_t* ff = (const uint8_t*)memchr(data + i, 0xFF, size - i);
+                if (!ff)
+                    return size;
+                i = (size_t)(ff - data) + 1;
+                stream->scan_state = SCAN_ENTROPY_FF;
+                break;
+            }
+
+            default:
+                return i;
+        }
+    }
+    return size;
+
+failed:
+    stream->scan_state = SCAN_FAILED;
+    return i;
+}
+
+/**
+ * @brief Append bytes behind the JPEG to the window, passing on the oldest ones should it outgrow its bound.
+ */
+static int8_t Stream_Keep(SGJWStream* stream, const uint8_t* data, size_t size)
+{
+    size_t limit = stream->config.window;
+
+    // Rare: more than the largest trailer behind EOI, the oldest bytes cannot be part of a trailer that fits
+    if (size > limit - stream->used)
+    {
+        size_t excess = size - (limit - stream->used);
+        size_t old = excess < stream->used ? excess : stream->used;
+
+        int8_t retval = Stream_Sink(stream, stream->window, old);
+        if (retval != SGJW_SUCCESS)
+            return retval;
+        memmove(stream->window, stream->window + old, stream->used - old);
+        stream->used -= old;
+
+        retval = Stream_Sink(stream, data, excess - old);
+        if (retval != SGJW_SUCCESS)
+            return retval;
+        data += excess - old;
+        size -= excess - old;
+    }
+
+    if (stream->used + size > stream->capacity)
+    {
+        size_t capacity = stream->capacity ? stream->capacity * 2 : SGJW_STREAM_MIN_WINDOW;
+        capacity = capacity < stream->used + size ? stream->used + size : capacity;
+        capacity = capacity > limit ? limit : capacity;
+
+        uint8_t* window = (uint8_t*)SGJW_Malloc(capacity, SGJW_CACHE_LINE);
+        if (!window)
+            return SGJW_ERROR_MALLOC_FAILED;
+        if (stream->used)
+            memcpy(window, stream->window, stream->used);
+        SGJW_Free(stream->window);
+        stream->window = window;
+        stream->capacity = capacity;
+    }
+
+    if (size)
+        memcpy(stream->window + stream->used, data, size);
+    stream->used += size;
+    return SGJW_SUCCESS;
+}
+
+/**
+ * @brief Locate and check the trailer in the window, parse its fixed fields.
+ *
+ * @param offset Receives the stream offset of the trailer.
+ */
+static int8_t Stream_Locate(SGJWStream* stream, StateGridJPEGV2* obj, StateGridJPEGProbe* ranges, uint64_t* offset)
+{
+    uint8_t fixed[SGJW_FIXED_BYTES];
+    uint64_t base = stream->total - stream->used;
+    size_t matrix_size = 0;
+
+    /* ---------- Step 1 : Tail, the trailer must be in the window ---------- */
+
+    if (stream->used < SGJW_TAIL_BYTES)
+        return SGJW_ERROR_INVALID_EOF;
+
+    memcpy(fixed + SGJW_HEADER_BYTES + SGJW_FOOTER_BYTES, stream->window + stream->used - SGJW_TAIL_BYTES, SGJW_TAIL_BYTES);
+    int8_t retval = SGJW_Check_Tail(fixed, stream->total, offset);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    // Starting before EOI, part of it already went out as JPEG
+    if (*offset < stream->jpeg_end)
+        return SGJW_ERROR_INVALID_OFFSET;
+    if (*offset < base)
+        return SGJW_ERROR_BUFFER_TOO_SMALL;
+
+    /* ---------- Step 2 : Header, then the footer behind the matrix ---------- */
+
+    const uint8_t* trailer = stream->window + (*offset - base);
+    memcpy(fixed, trailer, SGJW_HEADER_BYTES);
+    retval = SGJW_Check_Header(fixed, stream->total, *offset, &matrix_size);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    memcpy(fixed + SGJW_HEADER_BYTES, trailer + SGJW_HEADER_BYTES + matrix_size, SGJW_FOOTER_BYTES);
+    return SGJW_Parse_Fixed(fixed, stream->total, *offset, obj, ranges);
+}
+
+/**
+ * @brief Locate the trailer, pass on the bytes in front of it, or the whole window when there is no valid trailer.
+ *
+ * @param stream The ended stream.
+ * @param obj Receives the fixed fields, its block is not touched.
+ * @param ranges Receives the byte ranges, as stream offsets.
+ * @return The error of the trailer if there is no valid one, otherwise an SGJW_ERROR code.
+ */
+static int8_t Stream_Trailer(SGJWStream* stream, StateGridJPEGV2* obj, StateGridJPEGProbe* ranges)
+{
+    uint64_t offset = 0;
+    int8_t retval = Stream_Locate(stream, obj, ranges, &offset);
+
+    // Without a trailer the window is just more of the stream, the sink still receives all of it
+    if (retval != SGJW_SUCCESS)
+    {
+        Stream_Sink(stream, stream->window, stream->used);
+        return retval;
+    }
+
+    // Whatever sits between EOI and the trailer belongs to the JPEG part
+    return Stream_Sink(stream, stream->window, (size_t)(offset - (stream->total - stream->used)));
+}
+
+/* ====================================================================================================== */
+/* ======================================== Main APIs =================================================== */
+/* ====================================================================================================== */
+
+int8_t State_Grid_JPEG_Stream_Init(SGJWStream* stream, const SGJWStreamConfig* config)
+{
+    if (!stream || (config && config->window && config->window < SGJW_FIXED_BYTES))
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    memset(stream, 0, sizeof(SGJWStream));
+    if (config)
+        stream->config = *config;
+    if (stream->config.window == 0)
+        stream->config.window = SGJW_STREAM_DEFAULT_WINDOW;
+
+    Stream_Reset(stream);
+    return SGJW_SUCCESS;
+}
+
+int8_t State_Grid_JPEG_Stream_Push(SGJWStream* stream, const uint8_t* data, size_t size)
+{
+    if (!stream || (!data && size))
+        return SGJW_ERROR_INVALID_PARAMS;
+    if (stream->error != SGJW_SUCCESS)
+        return stream->error;
+
+    stream->total += size;
+
+    // Bytes up to EOI leave at once, straight from data
+    size_t jpeg = stream->scan_state < SCAN_DONE ? Stream_Scan(stream, data, size) : 0;
+    stream->jpeg_end += jpeg;
+
+    int8_t retval = Stream_Sink(stream, data, jpeg);
+    if (retval == SGJW_SUCCESS)
+        retval = Stream_Keep(stream, data + jpeg, size - jpeg);
+
+    stream->error = retval;
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Stream_Finish(SGJWStream* stream, StateGridJPEGV2* obj)
+{
+    if (!stream || !obj)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    StateGridJPEGProbe ranges;
+    int8_t retval = stream->error;
+    if (retval == SGJW_SUCCESS)
+        retval = Stream_Trailer(stream, obj, &ranges);
+
+    // One allocation for matrix and appendix
+    if (retval == SGJW_SUCCESS)
+        retval = State_Grid_JPEG_V2_Resize(obj, obj->width, obj->height, obj->appendix_length);
+
+    if (retval == SGJW_SUCCESS)
+    {
+        uint64_t base = stream->total - stream->used;
+        State_Grid_JPEG_Matrix_Decode(stream->window + (ranges.matrix_offset - base), (size_t)obj->width * obj->height, obj->matrix);
+        if (obj->appendix_length > 0)
+            memcpy(obj->appendix, stream->window + (ranges.appendix_offset - base), obj->appendix_length);
+    }
+
+    Stream_Reset(stream);
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Stream_Finish_Matrix(SGJWStream* stream, float* matrix, size_t capacity, uint16_t* width, uint16_t* height)
+{
+    if (!stream || (!matrix && capacity) || !width || !height)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    // Only the fixed fields land here, it never gets a block
+    StateGridJPEGV2 header;
+    memset(&header, 0, sizeof(header));
+
+    StateGridJPEGProbe ranges;
+    int8_t retval = stream->error;
+    if (retval == SGJW_SUCCESS)
+        retval = Stream_Trailer(stream, &header, &ranges);
+
+    if (retval == SGJW_SUCCESS)
+    {
+        size_t count = (size_t)header.width * header.height;
+        *width = header.width;
+        *height = header.height;
+        if (count > capacity)
+            retval = SGJW_ERROR_BUFFER_TOO_SMALL;
+        else if (count > 0)
+            State_Grid_JPEG_Matrix_Decode(stream->window + (ranges.matrix_offset - (stream->total - stream->used)), count, matrix);
+    }
+
+    Stream_Reset(stream);
+    return retval;
+}
+
+void State_Grid_JPEG_Stream_Free(SGJWStream* stream)
+{
+    if (!stream)
+        return;
+
+    SGJW_Free(stream->window);
+    memset(stream, 0, sizeof(SGJWStream));
+}
+
+int8_t State_Grid_JPEG_Read_Fd(int fd, const SGJWStreamConfig* config, StateGridJPEGV2* obj)
+{
+    if (fd < 0 || !obj)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    SGJWStream stream;
+    int8_t retval = State_Grid_JPEG_Stream_Init(&stream, config);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    uint8_t chunk[SGJW_STREAM_CHUNK_BYTES];
+    for (;;)
+    {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            retval = SGJW_ERROR_READ_FAILED;
+            break;
+        }
+        if (n == 0)
+            break;
+
+        SGJW_Count_Bytes_Read((uint64_t)n);
+        retval = State_Grid_JPEG_Stream_Push(&stream, chunk, (size_t)n);
+        if (retval != SGJW_SUCCESS)
+            break;
+    }
+
+    if (retval == SGJW_SUCCESS)
+        retval = State_Grid_JPEG_Stream_Finish(&stream, obj);
+
+    State_Grid_JPEG_Stream_Free(&stream);
+    return retval;
+}
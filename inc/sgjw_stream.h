@@ -0,0 +1,137 @@
+#pragma once
+
+/**
+ * @file sgjw_stream.h
+ * @brief Push parser for captures arriving over a pipe, a socket or stdin, where nothing can be seeked.
+ *
+ * @note Typical usage:
+ * 1. Initialize an SGJWStream once with State_Grid_JPEG_Stream_Init, e.g. per connection.
+ * 2. Hand every chunk received to State_Grid_JPEG_Stream_Push, the JPEG bytes come out of the sink as they arrive.
+ * 3. At the end of the capture invoke State_Grid_JPEG_Stream_Finish (object) or State_Grid_JPEG_Stream_Finish_Matrix
+ *    (matrix only), the stream is then ready for the next capture.
+ * 4. Call State_Grid_JPEG_Stream_Free when done.
+ * State_Grid_JPEG_Read_Fd does all of this for a file descriptor read until its end.
+ *
+ * The trailer can only be located from the tail, i.e. once the stream has ended. Meanwhile the JPEG
+ * markers are followed (segments skipped by their length, entropy-coded data searched for 0xFF), so
+ * everything up to the EOI marker is known to be JPEG and leaves through the sink at once, zero-copy.
+ * Only the bytes behind EOI, the trailer in practice, are kept in a window bounded by
+ * SGJWStreamConfig::window; should they outgrow it, the oldest ones cannot belong to a trailer that fits
+ * and are passed on as JPEG too. At the end the tail gives the trailer offset, whatever precedes it in
+ * the window is passed on, and the trailer is parsed from the window with the same checks as a file.
+ * Without a valid trailer the whole window is passed on, so the sink always receives the stream minus its trailer.
+ */
+
+#include "sgjw.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Default bound of the window, the largest trailer accepted
+#define SGJW_STREAM_DEFAULT_WINDOW (16u << 20)
+
+/**
+ * @brief Receives the JPEG bytes, in order and unmodified.
+ *
+ * @param data The bytes, only valid during the call.
+ * @param size Number of bytes.
+ * @param user SGJWStreamConfig::user.
+ * @return 0 to continue, anything else fails the capture with SGJW_ERROR_FILE_WRITE.
+ */
+typedef int (*SGJWStreamSink)(const uint8_t* data, size_t size, void* user);
+
+typedef struct
+{
+    // Largest trailer accepted, 0 for SGJW_STREAM_DEFAULT_WINDOW. Grown on demand up to this bound, and kept across captures.
+    size_t window;
+    // Optional, the JPEG bytes are dropped without it.
+    SGJWStreamSink sink;
+    void* user;
+} SGJWStreamConfig;
+
+// Parser state, see State_Grid_JPEG_Stream_Init
+typedef struct
+{
+    // Private
+    SGJWStreamConfig config;
+    uint8_t* window;
+    size_t capacity;
+    size_t used;
+    uint64_t total;
+    uint64_t jpeg_end;
+    uint32_t segment_left;
+    uint8_t scan_state;
+    uint8_t scan_sos;
+    int8_t error;
+} SGJWStream;
+
+/**
+ * @brief Prepare a stream, no memory is allocated until the first byte behind the JPEG arrives.
+ *
+ * @param stream The stream.
+ * @param config Optional, NULL for the defaults and no sink.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Stream_Init(SGJWStream* stream, const SGJWStreamConfig* config);
+
+/**
+ * @brief Feed the next bytes of the capture.
+ *
+ * @note Once a push failed, the following ones return the same error until the capture is finished.
+ *
+ * @param stream The stream.
+ * @param data The bytes, not referenced after the call.
+ * @param size Number of bytes.
+ * @return SGJW_ERROR_FILE_WRITE if the sink failed, otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Stream_Push(SGJWStream* stream, const uint8_t* data, size_t size);
+
+/**
+ * @brief End the capture and decode its trailer into an object.
+ *
+ * @note Like State_Grid_JPEG_Read_Into, an existing block in obj is reused when it is large enough.
+ *       The stream is ready for the next capture afterwards, also on failure.
+ *
+ * @param stream The stream.
+ * @param obj A pointer to a zeroed or previously read StateGridJPEGV2 structure.
+ * @return SGJW_ERROR_BUFFER_TOO_SMALL if the trailer did not fit in the window, SGJW_ERROR_INVALID_OFFSET if it
+ *         starts before the EOI marker already passed on, otherwise an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Stream_Finish(SGJWStream* stream, StateGridJPEGV2* obj);
+
+/**
+ * @brief End the capture and decode only its matrix, into caller memory.
+ *
+ * @note The stream is ready for the next capture afterwards, also on failure.
+ *
+ * @param stream The stream.
+ * @param matrix Output, at least width * height floats.
+ * @param capacity Size of matrix in floats.
+ * @param width Receives the matrix width, also when capacity is too small.
+ * @param height Receives the matrix height, also when capacity is too small.
+ * @return SGJW_ERROR_BUFFER_TOO_SMALL if the trailer did not fit in the window or capacity is too small, otherwise
+ *         an SGJW_ERROR code.
+ */
+int8_t State_Grid_JPEG_Stream_Finish_Matrix(SGJWStream* stream, float* matrix, size_t capacity, uint16_t* width, uint16_t* height);
+
+/**
+ * @brief Release the window of a stream.
+ *
+ * @param stream The stream.
+ */
+void State_Grid_JPEG_Stream_Free(SGJWStream* stream);
+
+/**
+ * @brief Read one capture from a file descriptor until its end, e.g. STDIN_FILENO.
+ *
+ * @param fd The descriptor, not closed.
+ * @param config Optional, NULL for the defaults and no sink.
+ * @param obj A pointer to a zeroed or previously read StateGridJPEGV2 structure.
+ * @return SGJW_ERROR_READ_FAILED if reading failed, otherwise see State_Grid_JPEG_Stream_Finish.
+ */
+int8_t State_Grid_JPEG_Read_Fd(int fd, const SGJWStreamConfig* config, StateGridJPEGV2* obj);
+
+#ifdef __cplusplus
+}
+#endif
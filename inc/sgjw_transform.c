@@ -0,0 +1,440 @@
+#include "sgjw_transform.h"
+#include "sgjw_internal.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// Side of the tiles a transpose goes through, a source and a destination tile fit in L1 together
+#define SGJW_TRANSFORM_TILE 32
+
+// Floats of a row moved at once by a vertical flip
+#define SGJW_TRANSFORM_ROW_CHUNK 256
+
+/* ====================================================================================================== */
+/* ======================================== Kernels ===================================================== */
+/* ====================================================================================================== */
+
+// dst[c * dst_stride + r] = src[r * src_stride + c] for a rows x cols tile, strides may be negative
+typedef void (*Transpose_Kernel)(const float* src, ptrdiff_t src_stride, float* dst, ptrdiff_t dst_stride, size_t rows, size_t cols);
+
+// dst[i] = src[count - 1 - i], dst may be the same memory as src
+typedef void (*Reverse_Kernel)(const float* src, size_t count, float* dst);
+
+// Reference kernels, every SIMD kernel must give the same result
+static void Transpose_Scalar(const float* src, ptrdiff_t src_stride, float* dst, ptrdiff_t dst_stride, size_t rows, size_t cols)
+{
+    for (size_t r = 0; r < rows; ++r)
+    {
+        for (size_t c = 0; c < cols; ++c)
+            dst[(ptrdiff_t)c * dst_stride + (ptrdiff_t)r] = src[(ptrdiff_t)r * src_stride + (ptrdiff_t)c];
+    }
+}
+
+static void Reverse_Scalar(const float* src, size_t count, float* dst)
+{
+    // Swap from both ends, so in place works as well; an odd middle swaps with itself
+    for (size_t i = 0, j = count; i < j--; ++i)
+    {
+        float head = src[i];
+        float tail = src[j];
+        dst[i] = tail;
+        dst[j] = head;
+    }
+}
+
+/**
+ * @brief Transpose the part of a tile outside its SIMD blocks, i.e. the last rows % block and cols % block.
+ */
+static void Transpose_Edges(const float* src, ptrdiff_t src_stride, float* dst, ptrdiff_t dst_stride, size_t rows, size_t cols, size_t block)
+{
+    size_t full_rows = rows - rows % block;
+    size_t full_cols = cols - cols % block;
+
+    // Right strip, all rows
+    Transpose_Scalar(src + full_cols, src_stride, dst + (ptrdiff_t)full_cols * dst_stride, dst_stride, rows, cols - full_cols);
+    // Bottom strip, left of the right strip
+    Transpose_Scalar(src + (ptrdiff_t)full_rows * src_stride, src_stride, dst + full_rows, dst_stride, rows - full_rows, full_cols);
+}
+
+#if SGJW_HAVE_X86
+static void Transpose_SSE2(const float* src, ptrdiff_t src_stride, float* dst, ptrdiff_t dst_stride, size_t rows, size_t cols)
+{
+    for (size_t r = 0; r + 4 <= rows; r += 4)
+    {
+        const float* s = src + (ptrdiff_t)r * src_stride;
+        for (size_t c = 0; c + 4 <= cols; c += 4)
+        {
+            __m128 r0 = _mm_loadu_ps(s + c);
+            __m128 r1 = _mm_loadu_ps(s + src_stride + c);
+            __m128 r2 = _mm_loadu_ps(s + src_stride * 2 + c);
+            __m128 r3 = _mm_loadu_ps(s + src_stride * 3 + c);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+            float* d = dst + (ptrdiff_t)c * dst_stride + (ptrdiff_t)r;
+            _mm_storeu_ps(d, r0);
+            _mm_storeu_ps(d + dst_stride, r1);
+            _mm_storeu_ps(d + dst_stride * 2, r2);
+            _mm_storeu_ps(d + dst_stride * 3, r3);
+        }
+    }
+    Transpose_Edges(src, src_stride, dst, dst_stride, rows, cols, 4);
+}
+
+static void Reverse_SSE2(const float* src, size_t count, float* dst)
+{
+    size_t i = 0;
+    size_t j = count;
+    for (; j - i >= 8; i += 4, j -= 4)
+    {
+        __m128 head = _mm_loadu_ps(src + i);
+        __m128 tail = _mm_loadu_ps(src + j - 4);
+        _mm_storeu_ps(dst + i, _mm_shuffle_ps(tail, tail, 0x1B));
+        _mm_storeu_ps(dst + j - 4, _mm_shuffle_ps(head, head, 0x1B));
+    }
+    Reverse_Scalar(src + i, j - i, dst + i);
+}
+
+__attribute__((target("avx2"))) static void Transpose_AVX2(const float* src, ptrdiff_t src_stride, float* dst, ptrdiff_t dst_stride, size_t rows,
+                                                           size_t cols)
+{
+    for (size_t r = 0; r + 8 <= rows; r += 8)
+    {
+        const float* s = src + (ptrdiff_t)r * src_stride;
+        for (size_t c = 0; c + 8 <= cols; c += 8)
+        {
+            __m256 v[8];
+            for (int i = 0; i < 8; ++i)
+                v[i] = _mm256_loadu_ps(s + src_stride * i + c);
+
+            // Pairs of rows, then pairs of pairs, then the 128-bit halves
+            __m256 t0 = _mm256_unpacklo_ps(v[0], v[1]);
+            __m256 t1 = _mm256_unpackhi_ps(v[0], v[1]);
+            __m256 t2 = _mm256_unpacklo_ps(v[2], v[3]);
+            __m256 t3 = _mm256_unpackhi_ps(v[2], v[3]);
+            __m256 t4 = _mm256_unpacklo_ps(v[4], v[5]);
+            __m256 t5 = _mm256_unpackhi_ps(v[4], v[5]);
+            __m256 t6 = _mm256_unpacklo_ps(v[6], v[7]);
+            __m256 t7 = _mm256_unpackhi_ps(v[6], v[7]);
+            __m256 u0 = _mm256_shuffle_ps(t0, t2, 0x44);
+            __m256 u1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+            __m256 u2 = _mm256_shuffle_ps(t1, t3, 0x44);
+            __m256 u3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+            __m256 u4 = _mm256_shuffle_ps(t4, t6, 0x44);
+            __m256 u5 = _mm256_shuffle_ps(t4, t6, 0xEE);
+            __m256 u6 = _mm256_shuffle_ps(t5, t7, 0x44);
+            __m256 u7 = _mm256_shuffle_ps(t5, t7, 0xEE);
+            v[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+            v[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+            v[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+            v[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+            v[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+            v[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+            v[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+            v[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+
+            float* d = dst + (ptrdiff_t)c * dst_stride + (ptrdiff_t)r;
+            for (int i = 0; i < 8; ++i)
+                _mm256_storeu_ps(d + dst_stride * i, v[i]);
+        }
+    }
+
+    // The rest of the tile in 4x4 blocks, then scalar
+    size_t full_rows = rows & ~(size_t)7;
+    size_t full_cols = cols & ~(size_t)7;
+    Transpose_SSE2(src + full_cols, src_stride, dst + (ptrdiff_t)full_cols * dst_stride, dst_stride, rows, cols - full_cols);
+    Transpose_SSE2(src + (ptrdiff_t)full_rows * src_stride, src_stride, dst + full_rows, dst_stride, rows - full_rows, full_cols);
+}
+
+__attribute__((target("avx2"))) static void Reverse_AVX2(const float* src, size_t count, float* dst)
+{
+    const __m256i order = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+    size_t i = 0;
+    size_t j = count;
+    for (; j - i >= 16; i += 8, j -= 8)
+    {
+        __m256 head = _mm256_loadu_ps(src + i);
+        __m256 tail = _mm256_loadu_ps(src + j - 8);
+        _mm256_storeu_ps(dst + i, _mm256_permutevar8x32_ps(tail, order));
+        _mm256_storeu_ps(dst + j - 8, _mm256_permutevar8x32_ps(head, order));
+    }
+    Reverse_SSE2(src + i, j - i, dst + i);
+}
+#endif
+
+#if SGJW_HAVE_NEON
+static void Transpose_NEON(const float* src, ptrdiff_t src_stride, float* dst, ptrdiff_t dst_stride, size_t rows, size_t cols)
+{
+    for (size_t r = 0; r + 4 <= rows; r += 4)
+    {
+        const float* s = src + (ptrdiff_t)r * src_stride;
+        for (size_t c = 0; c + 4 <= cols; c += 4)
+        {
+            float32x4x2_t t01 = vtrnq_f32(vld1q_f32(s + c), vld1q_f32(s + src_stride + c));
+            float32x4x2_t t23 = vtrnq_f32(vld1q_f32(s + src_stride * 2 + c), vld1q_f32(s + src_stride * 3 + c));
+
+            float* d = dst + (ptrdiff_t)c * dst_stride + (ptrdiff_t)r;
+            vst1q_f32(d, vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])));
+            vst1q_f32(d + dst_stride, vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])));
+            vst1q_f32(d + dst_stride * 2, vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+            vst1q_f32(d + dst_stride * 3, vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])));
+        }
+    }
+    Transpose_Edges(src, src_stride, dst, dst_stride, rows, cols, 4);
+}
+
+static void Reverse_NEON(const float* src, size_t count, float* dst)
+{
+    size_t i = 0;
+    size_t j = count;
+    for (; j - i >= 8; i += 4, j -= 4)
+    {
+        float32x4_t head = vrev64q_f32(vld1q_f32(src + i));
+        float32x4_t tail = vrev64q_f32(vld1q_f32(src + j - 4));
+        // Swapping the halves completes the reversal
+        vst1q_f32(dst + i, vcombine_f32(vget_high_f32(tail), vget_low_f32(tail)));
+        vst1q_f32(dst + j - 4, vcombine_f32(vget_high_f32(head), vget_low_f32(head)));
+    }
+    Reverse_Scalar(src + i, j - i, dst + i);
+}
+#endif
+
+static int8_t Transform_Get_Kernels(SGJW_KERNEL kernel, Transpose_Kernel* transpose, Reverse_Kernel* reverse)
+{
+    switch (kernel)
+    {
+        case SGJW_KERNEL_AUTO:
+            return Transform_Get_Kernels(State_Grid_JPEG_Matrix_Kernel(), transpose, reverse);
+        case SGJW_KERNEL_SCALAR:
+            *transpose = Transpose_Scalar;
+            *reverse = Reverse_Scalar;
+            return SGJW_SUCCESS;
+#if SGJW_HAVE_X86
+        case SGJW_KERNEL_SSE2:
+            *transpose = Transpose_SSE2;
+            *reverse = Reverse_SSE2;
+            return SGJW_SUCCESS;
+        case SGJW_KERNEL_AVX2:
+            if (!__builtin_cpu_supports("avx2"))
+                return SGJW_ERROR_INVALID_PARAMS;
+            *transpose = Transpose_AVX2;
+            *reverse = Reverse_AVX2;
+            return SGJW_SUCCESS;
+#endif
+#if SGJW_HAVE_NEON
+        case SGJW_KERNEL_NEON:
+            *transpose = Transpose_NEON;
+            *reverse = Reverse_NEON;
+            return SGJW_SUCCESS;
+#endif
+        default:
+            return SGJW_ERROR_INVALID_PARAMS;
+    }
+}
+
+/* ====================================================================================================== */
+/* ======================================== Matrix Transforms =========================================== */
+/* ====================================================================================================== */
+
+/**
+ * @brief Transpose a rows x cols matrix tile by tile.
+ */
+static void Transpose_Blocked(Transpose_Kernel kernel, const float* src, ptrdiff_t src_stride, float* dst, ptrdiff_t dst_stride, size_t rows, size_t cols)
+{
+    for (size_t r = 0; r < rows; r += SGJW_TRANSFORM_TILE)
+    {
+        size_t tile_rows = rows - r < SGJW_TRANSFORM_TILE ? rows - r : SGJW_TRANSFORM_TILE;
+        for (size_t c = 0; c < cols; c += SGJW_TRANSFORM_TILE)
+        {
+            size_t tile_cols = cols - c < SGJW_TRANSFORM_TILE ? cols - c : SGJW_TRANSFORM_TILE;
+            kernel(src + (ptrdiff_t)r * src_stride + (ptrdiff_t)c, src_stride, dst + (ptrdiff_t)c * dst_stride + (ptrdiff_t)r, dst_stride, tile_rows,
+                   tile_cols);
+        }
+    }
+}
+
+/**
+ * @brief Mirror top and bottom, rows swap through a small buffer so dst may be src.
+ */
+static void Flip_Vertical(const float* src, size_t width, size_t height, float* dst)
+{
+    float chunk[SGJW_TRANSFORM_ROW_CHUNK];
+    for (size_t top = 0, bottom = height - 1; top <= bottom && bottom < height; ++top, --bottom)
+    {
+        for (size_t x = 0; x < width; x += SGJW_TRANSFORM_ROW_CHUNK)
+        {
+            size_t n = (width - x < SGJW_TRANSFORM_ROW_CHUNK ? width - x : SGJW_TRANSFORM_ROW_CHUNK) * sizeof(float);
+            memcpy(chunk, src + top * width + x, n);
+            memmove(dst + top * width + x, src + bottom * width + x, n);
+            memcpy(dst + bottom * width + x, chunk, n);
+        }
+    }
+}
+
+int8_t State_Grid_JPEG_Matrix_Transform(const float* src, uint16_t width, uint16_t height, SGJW_TRANSFORM transform, float* dst, SGJW_KERNEL kernel)
+{
+    Transpose_Kernel transpose = NULL;
+    Reverse_Kernel reverse = NULL;
+    size_t count = (size_t)width * height;
+
+    if ((count && (!src || !dst)) || Transform_Get_Kernels(kernel, &transpose, &reverse) != SGJW_SUCCESS)
+        return SGJW_ERROR_INVALID_PARAMS;
+    if (count == 0)
+        return SGJW_SUCCESS;
+
+    switch (transform)
+    {
+        case SGJW_ROTATE_90:
+        case SGJW_ROTATE_270:
+        case SGJW_TRANSPOSE:
+            if (src == dst)
+                return SGJW_ERROR_INVALID_PARAMS;
+            break;
+        default:
+            break;
+    }
+
+    switch (transform)
+    {
+        case SGJW_ROTATE_90:
+            // Transpose with the rows read bottom-up: dst[x][height - 1 - y] = src[y][x]
+            Transpose_Blocked(transpose, src + (size_t)(height - 1) * width, -(ptrdiff_t)width, dst, height, height, width);
+            return SGJW_SUCCESS;
+        case SGJW_ROTATE_270:
+            // Transpose with the rows written bottom-up: dst[width - 1 - x][y] = src[y][x]
+            Transpose_Blocked(transpose, src, width, dst + (size_t)(width - 1) * height, -(ptrdiff_t)height, height, width);
+            return SGJW_SUCCESS;
+        case SGJW_TRANSPOSE:
+            Transpose_Blocked(transpose, src, width, dst, height, height, width);
+            return SGJW_SUCCESS;
+        case SGJW_ROTATE_180:
+            reverse(src, count, dst);
+            return SGJW_SUCCESS;
+        case SGJW_FLIP_HORIZONTAL:
+            for (size_t y = 0; y < height; ++y)
+                reverse(src + y * width, width, dst + y * width);
+            return SGJW_SUCCESS;
+        case SGJW_FLIP_VERTICAL:
+            Flip_Vertical(src, width, height, dst);
+            return SGJW_SUCCESS;
+        default:
+            return SGJW_ERROR_INVALID_PARAMS;
+    }
+}
+
+/**
+ * @brief Keep a rectangle of a matrix, rows move towards the start so a forward copy never overwrites a source.
+ */
+static int8_t Crop_Matrix(float* matrix, uint16_t matrix_width, uint16_t matrix_height, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    if (!matrix || width == 0 || height == 0 || (uint32_t)x + width > matrix_width || (uint32_t)y + height > matrix_height)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    for (size_t r = 0; r < height; ++r)
+        memmove(matrix + r * width, matrix + (y + r) * (size_t)matrix_width + x, (size_t)width * sizeof(float));
+
+    return SGJW_SUCCESS;
+}
+
+static uint8_t Transform_Swaps_Axes(SGJW_TRANSFORM transform)
+{
+    return transform == SGJW_ROTATE_90 || transform == SGJW_ROTATE_270 || transform == SGJW_TRANSPOSE;
+}
+
+/* ====================================================================================================== */
+/* ======================================== Main APIs =================================================== */
+/* ====================================================================================================== */
+
+int8_t State_Grid_JPEG_V2_Transform(StateGridJPEGV2* obj, SGJW_TRANSFORM transform)
+{
+    if (!obj || (!obj->matrix && obj->width && obj->height))
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    if (!Transform_Swaps_Axes(transform))
+        return State_Grid_JPEG_Matrix_Transform(obj->matrix, obj->width, obj->height, transform, obj->matrix, SGJW_KERNEL_AUTO);
+
+    // Transform into a new block laid out like State_Grid_JPEG_V2_Resize, the appendix comes along
+    StateGridJPEGV2 target;
+    memset(&target, 0, sizeof(StateGridJPEGV2));
+
+    int8_t retval = State_Grid_JPEG_V2_Resize(&target, obj->height, obj->width, obj->appendix_length);
+    if (retval == SGJW_SUCCESS)
+        retval = State_Grid_JPEG_Matrix_Transform(obj->matrix, obj->width, obj->height, transform, target.matrix, SGJW_KERNEL_AUTO);
+    if (retval != SGJW_SUCCESS)
+    {
+        State_Grid_JPEG_V2_Delete_OBJ(&target);
+        return retval;
+    }
+
+    if (obj->appendix_length)
+        memcpy(target.appendix, obj->appendix, obj->appendix_length);
+
+    SGJW_Free(obj->block);
+    obj->block = target.block;
+    obj->block_capacity = target.block_capacity;
+    obj->matrix = target.matrix;
+    obj->appendix = target.appendix;
+    obj->width = target.width;
+    obj->height = target.height;
+    return SGJW_SUCCESS;
+}
+
+int8_t State_Grid_JPEG_V2_Crop(StateGridJPEGV2* obj, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    if (!obj)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    int8_t retval = Crop_Matrix(obj->matrix, obj->width, obj->height, x, y, width, height);
+    if (retval == SGJW_SUCCESS)
+    {
+        obj->width = width;
+        obj->height = height;
+    }
+    return retval;
+}
+
+int8_t State_Grid_JPEG_Transform(StateGridJPEG* obj, SGJW_TRANSFORM transform)
+{
+    if (!obj || !obj->width || !obj->height || (!obj->matrix && *obj->width && *obj->height))
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    uint16_t width = *obj->width;
+    uint16_t height = *obj->height;
+    if (!Transform_Swaps_Axes(transform))
+        return State_Grid_JPEG_Matrix_Transform(obj->matrix, width, height, transform, obj->matrix, SGJW_KERNEL_AUTO);
+
+    float* matrix = NULL;
+    if ((size_t)width * height > 0)
+    {
+        matrix = (float*)SGJW_Malloc((size_t)width * height * sizeof(float), SGJW_CACHE_LINE);
+        if (!matrix)
+            return SGJW_ERROR_MALLOC_FAILED;
+    }
+
+    int8_t retval = State_Grid_JPEG_Matrix_Transform(obj->matrix, width, height, transform, matrix, SGJW_KERNEL_AUTO);
+    if (retval != SGJW_SUCCESS)
+    {
+        SGJW_Free(matrix);
+        return retval;
+    }
+
+    SGJW_Free(obj->matrix);
+    obj->matrix = matrix;
+    *obj->width = height;
+    *obj->height = width;
+    return SGJW_SUCCESS;
+}
+
+int8_t State_Grid_JPEG_Crop(StateGridJPEG* obj, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    if (!obj || !obj->width || !obj->height)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    int8_t retval = Crop_Matrix(obj->matrix, *obj->width, *obj->height, x, y, width, height);
+    if (retval == SGJW_SUCCESS)
+    {
+        *obj->width = width;
+        *obj->height = height;
+    }
+    return retval;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+/**
+ * @file sgjw_transform.h
+ * @brief Rotation, flips and crop of the temperature matrix, keeping width and height consistent.
+ *
+ * @note Typical usage:
+ * 1. Read a file into an object, e.g. with State_Grid_JPEG_V2_Read.
+ * 2. Chain State_Grid_JPEG_V2_Transform / State_Grid_JPEG_V2_Crop as the camera mounting requires.
+ * 3. Write it once with State_Grid_JPEG_V2_Append or State_Grid_JPEG_Replace.
+ * The same calls exist for StateGridJPEG (v1).
+ *
+ * 180 degrees, flips and crop work in place. 90 / 270 degrees and transpose cannot for a non-square
+ * matrix, they write straight into a new allocation which replaces the old one, still a single pass
+ * over the matrix. Transposition goes through cache-sized tiles, transposed in registers 4x4 (SSE2,
+ * NEON) or 8x8 (AVX2), so neither side is walked column by column across the whole matrix.
+ */
+
+#include "sgjw.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Geometric transforms, rotations are clockwise
+typedef enum
+{
+    SGJW_ROTATE_90 = 0,
+    SGJW_ROTATE_180,
+    SGJW_ROTATE_270,
+    // Mirror left and right.
+    SGJW_FLIP_HORIZONTAL,
+    // Mirror top and bottom.
+    SGJW_FLIP_VERTICAL,
+    // Swap rows and columns.
+    SGJW_TRANSPOSE
+} SGJW_TRANSFORM;
+
+/**
+ * @brief Transform a matrix with a given kernel.
+ *
+ * @note SGJW_ROTATE_90, SGJW_ROTATE_270 and SGJW_TRANSPOSE swap width and height.
+ *
+ * @param src Host floats, width * height values.
+ * @param width Matrix width.
+ * @param height Matrix height.
+ * @param transform The transform.
+ * @param dst Output, width * height values. May be the same memory as src for 180 degrees and flips only.
+ * @param kernel The kernel to use, SGJW_KERNEL_AUTO picks the best one for the running CPU.
+ * @return SGJW_ERROR_INVALID_PARAMS if the kernel is not available on this CPU or dst aliases src for a rotation by
+ *         90 / 270 degrees or a transpose, otherwise SGJW_SUCCESS.
+ */
+int8_t State_Grid_JPEG_Matrix_Transform(const float* src, uint16_t width, uint16_t height, SGJW_TRANSFORM transform, float* dst, SGJW_KERNEL kernel);
+
+/**
+ * @brief Transform the matrix of a v2 object and update its width and height.
+ *
+ * @note A borrowed matrix is changed in place, or replaced by a block owned by obj for 90 / 270 degrees and transpose.
+ *
+ * @param obj The object.
+ * @param transform The transform.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_V2_Transform(StateGridJPEGV2* obj, SGJW_TRANSFORM transform);
+
+/**
+ * @brief Keep a rectangle of the matrix of a v2 object, in place.
+ *
+ * @param obj The object.
+ * @param x Left column of the rectangle.
+ * @param y Top row of the rectangle.
+ * @param width Number of columns, at least 1.
+ * @param height Number of rows, at least 1.
+ * @return SGJW_ERROR_INVALID_PARAMS if the rectangle is empty or leaves the matrix, otherwise SGJW_SUCCESS.
+ */
+int8_t State_Grid_JPEG_V2_Crop(StateGridJPEGV2* obj, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+
+/**
+ * @brief Transform the matrix of a v1 object and update its width and height, see State_Grid_JPEG_V2_Transform.
+ *
+ * @param obj The object, e.g. from State_Grid_JPEG_Read.
+ * @param transform The transform.
+ * @return An SGJW_ERROR code indicating the success or failure of the operation.
+ */
+int8_t State_Grid_JPEG_Transform(StateGridJPEG* obj, SGJW_TRANSFORM transform);
+
+/**
+ * @brief Keep a rectangle of the matrix of a v1 object, in place, see State_Grid_JPEG_V2_Crop.
+ *
+ * @param obj The object, e.g. from State_Grid_JPEG_Read.
+ * @param x Left column of the rectangle.
+ * @param y Top row of the rectangle.
+ * @param width Number of columns, at least 1.
+ * @param height Number of rows, at least 1.
+ * @return SGJW_ERROR_INVALID_PARAMS if the rectangle is empty or leaves the matrix, otherwise SGJW_SUCCESS.
+ */
+int8_t State_Grid_JPEG_Crop(StateGridJPEG* obj, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+
+#ifdef __cplusplus
+}
+#endif
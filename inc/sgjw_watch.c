@@ -0,0 +1,401 @@
+#include "sgjw_watch.h"
+#include "sgjw_internal.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+// Defaults of SGJWWatchConfig
+#define SGJW_WATCH_FLUSH_FILES 256
+#define SGJW_WATCH_FLUSH_MS 100
+#define SGJW_WATCH_COMPACT_MIN 4096
+
+// Room for many inotify events per read
+#define SGJW_WATCH_EVENT_BYTES 65536
+
+/* ====================================================================================================== */
+/* ======================================== Helper Structures =========================================== */
+/* ====================================================================================================== */
+
+// Hashes of the paths already in index or journal, open addressing, 0 marks a free slot
+typedef struct
+{
+    uint64_t* slots;
+    size_t capacity;
+    size_t used;
+} WatchPathSet;
+
+typedef struct
+{
+    const SGJWWatchConfig* config;
+    SGJWWatchReport report;
+    SGJWIndexJournal journal;
+    WatchPathSet seen;
+    // Hashes of the paths whose probe failed, left to their next close or move event
+    WatchPathSet failed;
+    int inotify_fd;
+    // Watch descriptor of each folder
+    int* watches;
+
+    // Captures waiting for the next flush, their paths are owned
+    SGJWIndexEntry* pending;
+    size_t pending_count;
+    size_t pending_capacity;
+    double pending_since;
+
+    // Captures in the index file itself, sizes the compaction threshold
+    uint32_t indexed;
+    uint32_t flush_files;
+    uint32_t flush_ms;
+    uint8_t stop;
+} Watcher;
+
+/* ====================================================================================================== */
+/* ======================================== Helper Functions ============================================ */
+/* ====================================================================================================== */
+
+// FNV-1a, 64 bits keep collisions out of reach for any archive size
+static uint64_t Watch_Path_Hash(const char* path)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const uint8_t* c = (const uint8_t*)path; *c; ++c)
+        hash = (hash ^ *c) * 1099511628211ull;
+    return hash ? hash : 1;
+}
+
+static uint8_t Watch_Path_Set_Contains(const WatchPathSet* set, uint64_t hash)
+{
+    if (set->capacity == 0)
+        return 0;
+
+    for (size_t i = hash & (set->capacity - 1); set->slots[i]; i = (i + 1) & (set->capacity - 1))
+    {
+        if (set->slots[i] == hash)
+            return 1;
+    }
+    return 0;
+}
+
+static int8_t Watch_Path_Set_Insert(WatchPathSet* set, uint64_t hash)
+{
+    /* ---------- Grow to keep the load at most one half ---------- */
+
+    if ((set->used + 1) * 2 > set->capacity)
+    {
+        size_t capacity = set->capacity ? set->capacity * 2 : 1024;
+        uint64_t* slots = (uint64_t*)SGJW_Malloc(capacity * sizeof(uint64_t), SGJW_CACHE_LINE);
+        if (!slots)
+            return SGJW_ERROR_MALLOC_FAILED;
+        memset(slots, 0, capacity * sizeof(uint64_t));
+
+        for (size_t i = 0; i < set->capacity; ++i)
+        {
+            if (!set->slots[i])
+                continue;
+            size_t j = set->slots[i] & (capacity - 1);
+            while (slots[j])
+                j = (j + 1) & (capacity - 1);
+            slots[j] = set->slots[i];
+        }
+
+        SGJW_Free(set->slots);
+        set->slots = slots;
+        set->capacity = capacity;
+    }
+
+    /* ---------- Insert ---------- */
+
+    size_t i = hash & (set->capacity - 1);
+    while (set->slots[i] && set->slots[i] != hash)
+        i = (i + 1) & (set->capacity - 1);
+    if (!set->slots[i])
+    {
+        set->slots[i] = hash;
+        set->used++;
+    }
+    return SGJW_SUCCESS;
+}
+
+/**
+ * @brief Append the pending captures to the journal, report them and fold the journal when it is due.
+ */
+static int8_t Watch_Flush(Watcher* watcher)
+{
+    const SGJWWatchConfig* config = watcher->config;
+    if (watcher->pending_count == 0)
+        return SGJW_SUCCESS;
+
+    int8_t retval = State_Grid_JPEG_Index_Journal_Append(&watcher->journal, watcher->pending, watcher->pending_count);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    watcher->report.flushes++;
+    watcher->report.ingested += watcher->pending_count;
+    for (size_t i = 0; i < watcher->pending_count; ++i)
+    {
+        if (config->callback && !watcher->stop && config->callback(watcher->pending[i].path, SGJW_SUCCESS, &watcher->pending[i], config->user) != 0)
+            watcher->stop = 1;
+        SGJW_Free((void*)watcher->pending[i].path);
+    }
+    watcher->pending_count = 0;
+
+    uint32_t threshold = config->compact_files;
+    if (threshold == 0)
+        threshold = watcher->indexed / 8 > SGJW_WATCH_COMPACT_MIN ? watcher->indexed / 8 : SGJW_WATCH_COMPACT_MIN;
+    if (watcher->journal.count < threshold)
+        return SGJW_SUCCESS;
+
+    uint32_t folded = watcher->journal.count;
+    retval = State_Grid_JPEG_Index_Compact(config->index_path, &watcher->journal);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    watcher->indexed += folded;
+    watcher->report.compactions++;
+    return SGJW_SUCCESS;
+}
+
+/**
+ * @brief Probe a file unless it is indexed already, and queue its capture.
+ *
+ * @param retry 1 for a close or move event, which probes again a file that failed before.
+ */
+static int8_t Watch_Ingest(Watcher* watcher, const char* filepath, uint8_t retry)
+{
+    const SGJWWatchConfig* config = watcher->config;
+    uint64_t hash = Watch_Path_Hash(filepath);
+    if (Watch_Path_Set_Contains(&watcher->seen, hash) || (!retry && Watch_Path_Set_Contains(&watcher->failed, hash)))
+        return SGJW_SUCCESS;
+
+    /* ---------- Step 1 : Trailer only ---------- */
+
+    StateGridJPEGProbe probe;
+    int8_t status = State_Grid_JPEG_Probe(filepath, &probe);
+    if (status != SGJW_SUCCESS)
+    {
+        // Not marked as seen, a camera may still append the trailer and close the file again
+        watcher->report.failed++;
+        if (config->callback && config->callback(filepath, status, NULL, config->user) != 0)
+            watcher->stop = 1;
+        return Watch_Path_Set_Insert(&watcher->failed, hash);
+    }
+
+    /* ---------- Step 2 : Queue the capture ---------- */
+
+    if (watcher->pending_count == watcher->pending_capacity)
+    {
+        size_t capacity = watcher->pending_capacity ? watcher->pending_capacity * 2 : 64;
+        SGJWIndexEntry* pending = (SGJWIndexEntry*)SGJW_Malloc(capacity * sizeof(SGJWIndexEntry), sizeof(void*));
+        if (!pending)
+            return SGJW_ERROR_MALLOC_FAILED;
+        if (watcher->pending_count)
+            memcpy(pending, watcher->pending, watcher->pending_count * sizeof(SGJWIndexEntry));
+        SGJW_Free(watcher->pending);
+        watcher->pending = pending;
+        watcher->pending_capacity = capacity;
+    }
+
+    size_t length = strlen(filepath) + 1;
+    char* path = (char*)SGJW_Malloc(length, sizeof(void*));
+    if (!path || Watch_Path_Set_Insert(&watcher->seen, hash) != SGJW_SUCCESS)
+    {
+        SGJW_Free(path);
+        return SGJW_ERROR_MALLOC_FAILED;
+    }
+    memcpy(path, filepath, length);
+
+    if (watcher->pending_count == 0)
+        watcher->pending_since = SGJW_Now_Ns() / 1e6;
+    State_Grid_JPEG_Index_Entry_From_Probe(path, &probe, &watcher->pending[watcher->pending_count++]);
+
+    return watcher->pending_count >= watcher->flush_files ? Watch_Flush(watcher) : SGJW_SUCCESS;
+}
+
+static int8_t Watch_Ingest_Name(Watcher* watcher, const char* dirpath, const char* name, uint8_t retry)
+{
+    char filepath[4096];
+    if (!SGJW_Is_JPEG_Name(name) || snprintf(filepath, sizeof(filepath), "%s/%s", dirpath, name) >= (int)sizeof(filepath))
+        return SGJW_SUCCESS;
+    return Watch_Ingest(watcher, filepath, retry);
+}
+
+/**
+ * @brief List every folder and ingest what is missing, names only for the files already indexed or already failed.
+ */
+static int8_t Watch_Rescan(Watcher* watcher)
+{
+    const SGJWWatchConfig* config = watcher->config;
+    int8_t retval = SGJW_SUCCESS;
+    watcher->report.rescans++;
+
+    for (size_t d = 0; d < config->directory_count && retval == SGJW_SUCCESS && !watcher->stop; ++d)
+    {
+        DIR* dir = opendir(config->directories[d]);
+        if (!dir)
+            return SGJW_ERROR_FILE_NOT_FOUND;
+
+        struct dirent* item;
+        while (retval == SGJW_SUCCESS && !watcher->stop && (item = readdir(dir)) != NULL)
+            retval = Watch_Ingest_Name(watcher, config->directories[d], item->d_name, 0);
+        closedir(dir);
+    }
+
+    return retval == SGJW_SUCCESS ? Watch_Flush(watcher) : retval;
+}
+
+/**
+ * @brief Drain the inotify queue.
+ */
+static int8_t Watch_Read_Events(Watcher* watcher)
+{
+    const SGJWWatchConfig* config = watcher->config;
+    uint8_t buffer[SGJW_WATCH_EVENT_BYTES] __attribute__((aligned(__alignof__(struct inotify_event))));
+    uint8_t overflow = 0;
+
+    for (;;)
+    {
+        ssize_t n = read(watcher->inotify_fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+
+        for (ssize_t offset = 0; offset < n;)
+        {
+            const struct inotify_event* event = (const struct inotify_event*)(buffer + offset);
+            offset += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                overflow = 1;
+                continue;
+            }
+            if (event->len == 0 || (event->mask & IN_ISDIR))
+                continue;
+
+            for (size_t d = 0; d < config->directory_count; ++d)
+            {
+                if (watcher->watches[d] != event->wd)
+                    continue;
+                int8_t retval = Watch_Ingest_Name(watcher, config->directories[d], event->name, 1);
+                if (retval != SGJW_SUCCESS)
+                    return retval;
+                break;
+            }
+        }
+    }
+
+    // Events were lost, only a listing can tell which files they were
+    return overflow ? Watch_Rescan(watcher) : SGJW_SUCCESS;
+}
+
+/* ====================================================================================================== */
+/* ========================================== Main APIs ================================================= */
+/* ====================================================================================================== */
+
+int8_t State_Grid_JPEG_Watch_Run(const SGJWWatchConfig* config, SGJWWatchReport* report)
+{
+    if (!config || !config->index_path || !config->directories || config->directory_count == 0)
+        return SGJW_ERROR_INVALID_PARAMS;
+
+    Watcher watcher;
+    memset(&watcher, 0, sizeof(Watcher));
+    watcher.config = config;
+    watcher.inotify_fd = -1;
+    watcher.journal.fd = -1;
+    watcher.flush_files = config->flush_files ? config->flush_files : SGJW_WATCH_FLUSH_FILES;
+    watcher.flush_ms = config->flush_ms ? config->flush_ms : SGJW_WATCH_FLUSH_MS;
+
+    /* ---------- Step 1 : Checkpoint, the paths of index and journal ---------- */
+
+    int8_t retval = State_Grid_JPEG_Index_Journal_Open(config->index_path, &watcher.journal);
+    if (retval != SGJW_SUCCESS)
+        return retval;
+
+    SGJWIndex index;
+    retval = State_Grid_JPEG_Index_Open(config->index_path, &index);
+    if (retval != SGJW_SUCCESS)
+        goto cleanup;
+
+    for (uint32_t r = 0; r < index.count && retval == SGJW_SUCCESS; ++r)
+    {
+        SGJWIndexEntry entry;
+        retval = State_Grid_JPEG_Index_Get(&index, r, &entry);
+        if (retval == SGJW_SUCCESS)
+            retval = Watch_Path_Set_Insert(&watcher.seen, Watch_Path_Hash(entry.path));
+    }
+    watcher.indexed = index.count - watcher.journal.count;
+    State_Grid_JPEG_Index_Close(&index);
+    if (retval != SGJW_SUCCESS)
+        goto cleanup;
+
+    /* ---------- Step 2 : Watch before listing, so no file falls between the two ---------- */
+
+    watcher.watches = (int*)SGJW_Malloc(config->directory_count * sizeof(int), sizeof(void*));
+    watcher.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (!watcher.watches || watcher.inotify_fd < 0)
+    {
+        retval = watcher.watches ? SGJW_ERROR_FILE_NOT_FOUND : SGJW_ERROR_MALLOC_FAILED;
+        goto cleanup;
+    }
+
+    for (size_t d = 0; d < config->directory_count; ++d)
+    {
+        watcher.watches[d] = inotify_add_watch(watcher.inotify_fd, config->directories[d], IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR);
+        if (watcher.watches[d] < 0)
+        {
+            retval = SGJW_ERROR_FILE_NOT_FOUND;
+            goto cleanup;
+        }
+    }
+
+    /* ---------- Step 3 : Catch up with files that arrived while not running ---------- */
+
+    retval = Watch_Rescan(&watcher);
+
+    /* ---------- Step 4 : Events, a batch is flushed when full or when its oldest capture waited flush_ms ---------- */
+
+    while (retval == SGJW_SUCCESS && !watcher.stop && !(config->stop && *config->stop))
+    {
+        int timeout = (int)watcher.flush_ms;
+        if (watcher.pending_count)
+        {
+            double remaining = watcher.pending_since + watcher.flush_ms - SGJW_Now_Ns() / 1e6;
+            timeout = remaining > 0 ? (int)remaining + 1 : 0;
+        }
+
+        struct pollfd pfd = {watcher.inotify_fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, timeout);
+        if (ready < 0 && errno != EINTR)
+        {
+            retval = SGJW_ERROR_READ_FAILED;
+            break;
+        }
+
+        if (ready > 0)
+            retval = Watch_Read_Events(&watcher);
+
+        if (retval == SGJW_SUCCESS && watcher.pending_count && SGJW_Now_Ns() / 1e6 - watcher.pending_since >= watcher.flush_ms)
+            retval = Watch_Flush(&watcher);
+    }
+
+    if (retval == SGJW_SUCCESS)
+        retval = Watch_Flush(&watcher);
+
+cleanup:
+    for (size_t i = 0; i < watcher.pending_count; ++i)
+        SGJW_Free((void*)watcher.pending[i].path);
+    SGJW_Free(watcher.pending);
+    SGJW_Free(watcher.seen.slots);
+    SGJW_Free(watcher.failed.slots);
+    SGJW_Free(watcher.watches);
+    if (watcher.inotify_fd >= 0)
+        close(watcher.inotify_fd);
+    State_Grid_JPEG_Index_Journal_Close(&watcher.journal);
+
+    if (report)
+        *report = watcher.report;
+    return retval;
+}
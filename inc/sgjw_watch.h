@@ -0,0 +1,85 @@
+#pragma once
+
+/**
+ * @file sgjw_watch.h
+ * @brief Incremental ingest of the folders cameras write into.
+ *
+ * @note Typical usage:
+ * 1. Fill an SGJWWatchConfig with the index file and the folders.
+ * 2. Invoke State_Grid_JPEG_Watch_Run, it returns once *stop is set (e.g. by a signal handler) or the callback asks to.
+ *
+ * The watcher listens to inotify for files closed after writing or moved into a folder, and probes only
+ * those: header, footer and tail, never a matrix. New captures are appended to the journal of the index
+ * in batches, flushed after flush_files captures or flush_ms of waiting, so a capture can be queried well
+ * under a second after its camera closed it. The journal is the checkpoint: on restart the folders are
+ * only listed, and just the files missing from index and journal are probed. Once the journal holds
+ * compact_files captures it is folded into the index, the amortized cost per capture stays constant
+ * whatever the size of the archive.
+ */
+
+#include "sgjw_index.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Receives one ingested file.
+ *
+ * @param filepath The path of the file.
+ * @param status SGJW_SUCCESS once the capture is in the journal, otherwise the SGJW_ERROR code of its probe.
+ * @param entry The indexed capture, NULL unless status is SGJW_SUCCESS.
+ * @param user SGJWWatchConfig::user.
+ * @return 0 to continue, anything else to stop watching.
+ */
+typedef int (*SGJWWatchCallback)(const char* filepath, int8_t status, const SGJWIndexEntry* entry, void* user);
+
+typedef struct
+{
+    // The index to update, created when missing.
+    const char* index_path;
+    // The folders to watch, not recursive.
+    const char* const* directories;
+    size_t directory_count;
+    // Flush the journal once this many captures are pending, 0 for 256.
+    uint32_t flush_files;
+    // Or once the oldest pending capture waited this long, 0 for 100 ms.
+    uint32_t flush_ms;
+    // Fold the journal into the index at this many captures, 0 for an eighth of the index but at least 4096.
+    uint32_t compact_files;
+    // Optional.
+    SGJWWatchCallback callback;
+    void* user;
+    // Optional, watching stops once it is non-zero. Checked at least every flush_ms.
+    const volatile int* stop;
+} SGJWWatchConfig;
+
+typedef struct
+{
+    // Captures appended to the journal.
+    uint64_t ingested;
+    // Probes that failed. A failed file is probed again when it is closed or moved in again, rescans skip it.
+    uint64_t failed;
+    // Journal writes.
+    uint64_t flushes;
+    // Journal folds into the index.
+    uint64_t compactions;
+    // Full folder listings, at start and when the inotify queue overflowed.
+    uint64_t rescans;
+} SGJWWatchReport;
+
+/**
+ * @brief Watch folders and keep an index up to date, until stopped.
+ *
+ * @note Files already in the index or its journal are not probed again, even if they were rewritten.
+ *
+ * @param config The watch configuration, index_path and directories are required.
+ * @param report Optional, receives the counters.
+ * @return SGJW_SUCCESS once stopped, otherwise an SGJW_ERROR code, e.g. SGJW_ERROR_FILE_NOT_FOUND for a folder that
+ *         cannot be watched or SGJW_ERROR_FILE_WRITE when the journal cannot be written.
+ */
+int8_t State_Grid_JPEG_Watch_Run(const SGJWWatchConfig* config, SGJWWatchReport* report);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,7 +1,1766 @@
 #include "../inc/sgjw.h"
+#include "../inc/sgjw_archive.h"
+#include "../inc/sgjw_batch.h"
+#include "../inc/sgjw_blob.h"
+#include "../inc/sgjw_index.h"
+#include "../inc/sgjw_pyramid.h"
+#include "../inc/sgjw_record.h"
+#include "../inc/sgjw_render.h"
+#include "../inc/sgjw_sequence.h"
+#include "../inc/sgjw_stream.h"
+#include "../inc/sgjw_transform.h"
+#include "../inc/sgjw_watch.h"
+
+#include <dirent.h>
+#include <math.h>
+#include <signal.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static double Now_Ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief Compare the whole-file read path against the trailer-only read path.
+ *
+ * @note Results go to stderr, build with -DSGJW_DEBUG=0 or redirect stdout to keep the debug log out of the timing.
+ */
+static int Bench_Read(const char* filepath, int iterations)
+{
+    // clang-format off
+    struct
+    {
+        uint32_t flags;
+        const char* name;
+    } modes[] = {
+        { SGJW_READ_DEFAULT, "whole file" },
+        { SGJW_READ_TRAILER_ONLY, "trailer only" }
+    };
+    // clang-format on
+
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m)
+    {
+        State_Grid_JPEG_Reset_Bytes_Read();
+        double start = Now_Ms();
+
+        for (int i = 0; i < iterations; ++i)
+        {
+            StateGridJPEG jpeg;
+            if (State_Grid_JPEG_Read_Ex(filepath, &jpeg, modes[m].flags) != SGJW_SUCCESS)
+            {
+                fprintf(stderr, "Read [%s] failed.\n", filepath);
+                return 1;
+            }
+            State_Grid_JPEG_Delete_OBJ(&jpeg);
+        }
+
+        double elapsed = Now_Ms() - start;
+        fprintf(stderr, "%-12s: %10llu bytes/read, %8.3f ms/read\n", modes[m].name, (unsigned long long)(State_Grid_JPEG_Get_Bytes_Read() / iterations),
+                elapsed / iterations);
+    }
+
+    // Trailer pages are faulted in by the map call itself, no decode copy on little-endian hosts
+    double start = Now_Ms();
+    for (int i = 0; i < iterations; ++i)
+    {
+        StateGridJPEGView view;
+        if (State_Grid_JPEG_Map(filepath, &view) != SGJW_SUCCESS)
+        {
+            fprintf(stderr, "Map [%s] failed.\n", filepath);
+            return 1;
+        }
+        State_Grid_JPEG_Unmap(&view);
+    }
+    fprintf(stderr, "%-12s: %10s bytes/read, %8.3f ms/read\n", "mmap view", "-", (Now_Ms() - start) / iterations);
+
+    return 0;
+}
+
+/**
+ * @brief Check every available byte-swap kernel bit-exact against the scalar reference, then time it.
+ */
+static int Check_Kernels(size_t count)
+{
+    // clang-format off
+    struct
+    {
+        SGJW_KERNEL kernel;
+        const char* name;
+    } kernels[] = {
+        { SGJW_KERNEL_SCALAR, "scalar" },
+        { SGJW_KERNEL_SSE2, "sse2" },
+        { SGJW_KERNEL_AVX2, "avx2" },
+        { SGJW_KERNEL_NEON, "neon" }
+    };
+    // clang-format on
+
+    // One extra word so unaligned sources can be tested as well
+    uint32_t* src = (uint32_t*)malloc((count + 1) * sizeof(uint32_t));
+    uint32_t* ref = (uint32_t*)malloc(count * sizeof(uint32_t));
+    uint32_t* out = (uint32_t*)malloc((count + 1) * sizeof(uint32_t));
+    if (!src || !ref || !out)
+        return 1;
+
+    srand(20241029);
+    for (size_t i = 0; i <= count; ++i)
+        src[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+
+    int failed = 0;
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+    {
+        if (State_Grid_JPEG_Matrix_Bswap32(src, 0, out, kernels[k].kernel) != SGJW_SUCCESS)
+        {
+            printf("%-8s: unavailable\n", kernels[k].name);
+            continue;
+        }
+
+        int exact = 1;
+        // Every length up to a few vectors exercises the scalar tails, the last one the full matrix
+        for (size_t n = 0; n <= count && exact; n = (n < 67) ? n + 1 : count + (n == count))
+        {
+            const uint8_t* unaligned = (const uint8_t*)src + 1;
+            State_Grid_JPEG_Matrix_Bswap32(unaligned, n, ref, SGJW_KERNEL_SCALAR);
+            State_Grid_JPEG_Matrix_Bswap32(unaligned, n, (uint8_t*)out + 1, kernels[k].kernel);
+            exact &= memcmp(ref, (uint8_t*)out + 1, n * sizeof(uint32_t)) == 0;
+
+            // In place
+            memcpy(out, src, n * sizeof(uint32_t));
+            State_Grid_JPEG_Matrix_Bswap32(out, n, out, kernels[k].kernel);
+            State_Grid_JPEG_Matrix_Bswap32(src, n, ref, SGJW_KERNEL_SCALAR);
+            exact &= memcmp(ref, out, n * sizeof(uint32_t)) == 0;
+        }
+
+        double start = Now_Ms();
+        for (int i = 0; i < 100; ++i)
+            State_Grid_JPEG_Matrix_Bswap32(src, count, out, kernels[k].kernel);
+        double elapsed = (Now_Ms() - start) / 100;
+
+        printf("%-8s: %s, %8.3f ms, %8.1f MB/s\n", kernels[k].name, exact ? "bit-exact" : "MISMATCH", elapsed, count * 4 / 1e3 / elapsed);
+        failed |= !exact;
+    }
+
+    // Statistics kernels must agree with the scalar reference on min / max / hottest pixel and histogram
+    float* values = (float*)malloc(count * sizeof(float));
+    for (size_t i = 0; i < count; ++i)
+        values[i] = 20.0f + (float)(rand() % 100000) / 1000.0f;
+    if (count > 7)
+        values[count - 7] = values[count / 3] = 1000.0f;
+
+    SGJWStats ref_stats = {.histogram_low = 0.0f, .histogram_high = 150.0f};
+    SGJWStats stats = {.histogram_low = 0.0f, .histogram_high = 150.0f};
+    State_Grid_JPEG_Matrix_Stats(values, 640, count / 640, &ref_stats, SGJW_KERNEL_SCALAR);
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+    {
+        if (State_Grid_JPEG_Matrix_Stats(values, 640, count / 640, &stats, kernels[k].kernel) != SGJW_SUCCESS)
+            continue;
+
+        int exact = stats.min == ref_stats.min && stats.max == ref_stats.max && stats.hottest_x == ref_stats.hottest_x &&
+                    stats.hottest_y == ref_stats.hottest_y && memcmp(stats.histogram, ref_stats.histogram, sizeof(stats.histogram)) == 0 &&
+                    fabs(stats.mean - ref_stats.mean) < 1e-9 && fabs(stats.stddev - ref_stats.stddev) < 1e-9;
+
+        double start = Now_Ms();
+        for (int i = 0; i < 100; ++i)
+            State_Grid_JPEG_Matrix_Stats(values, 640, count / 640, &stats, kernels[k].kernel);
+        double elapsed = (Now_Ms() - start) / 100;
+
+        printf("stats %-6s: %s, %8.3f ms, hottest [%u, %u]\n", kernels[k].name, exact ? "exact" : "MISMATCH", elapsed, stats.hottest_x, stats.hottest_y);
+        failed |= !exact;
+    }
+
+    // NaN pixels are skipped, wherever they land in a SIMD lane: before the extremes of the lane or behind them
+    float nan_values[16] = {NAN, 20.0f, 21.0f, 22.0f, 99.0f, 24.0f, 25.0f, 26.0f, -5.0f, 21.0f, 22.0f, 23.0f, NAN, 24.0f, 25.0f, NAN};
+    SGJWStats nan_ref = {.histogram_low = 0.0f, .histogram_high = 150.0f};
+    State_Grid_JPEG_Matrix_Stats(nan_values, 8, 2, &nan_ref, SGJW_KERNEL_SCALAR);
+
+    // Count, mean and stddev of the 13 pixels that are not NaN, computed directly
+    uint64_t nan_count = 0;
+    double nan_sum = 0.0, nan_squares = 0.0;
+    for (size_t i = 0; i < 16; ++i)
+    {
+        if (isnan(nan_values[i]))
+            continue;
+        nan_count++;
+        nan_sum += nan_values[i];
+    }
+    for (size_t i = 0; i < 16; ++i)
+    {
+        if (!isnan(nan_values[i]))
+            nan_squares += (nan_values[i] - nan_sum / nan_count) * (nan_values[i] - nan_sum / nan_count);
+    }
+
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+    {
+        SGJWStats nan_stats = {.histogram_low = 0.0f, .histogram_high = 150.0f};
+        if (State_Grid_JPEG_Matrix_Stats(nan_values, 8, 2, &nan_stats, kernels[k].kernel) != SGJW_SUCCESS)
+            continue;
+
+        uint64_t binned = 0;
+        for (size_t i = 0; i < SGJW_HISTOGRAM_BINS; ++i)
+            binned += nan_stats.histogram[i];
+
+        int exact = nan_stats.min == nan_ref.min && nan_stats.max == nan_ref.max && nan_stats.hottest_x == nan_ref.hottest_x &&
+                    nan_stats.hottest_y == nan_ref.hottest_y && memcmp(nan_stats.histogram, nan_ref.histogram, sizeof(nan_stats.histogram)) == 0 &&
+                    nan_stats.count == nan_count && binned == nan_count && fabs(nan_stats.mean - nan_sum / nan_count) < 1e-9 &&
+                    fabs(nan_stats.stddev - sqrt(nan_squares / nan_count)) < 1e-9;
+        printf("stats %-6s: %s with NaN, count %llu min %.1f max %.1f mean %.3f stddev %.3f hottest [%u, %u]\n", kernels[k].name, exact ? "exact" : "MISMATCH",
+               (unsigned long long)nan_stats.count, nan_stats.min, nan_stats.max, nan_stats.mean, nan_stats.stddev, nan_stats.hottest_x, nan_stats.hottest_y);
+        failed |= !exact;
+    }
+
+    // Radiometric kernels must match the scalar reference bit for bit, threaded or not
+    SGJWRadiometry from = {0.95f, 20.0f, 20.0f, 5, 50};
+    SGJWRadiometry to = {0.80f, 25.0f, 30.0f, 20, 80};
+    float* radiometry_ref = (float*)malloc(count * sizeof(float));
+    float* radiometry_out = (float*)malloc(count * sizeof(float));
+    State_Grid_JPEG_Matrix_Recompensate(values, radiometry_ref, count, &from, &to, 1, SGJW_KERNEL_SCALAR);
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+    {
+        if (State_Grid_JPEG_Matrix_Recompensate(values, radiometry_out, 0, &from, &to, 1, kernels[k].kernel) != SGJW_SUCCESS)
+            continue;
+
+        int exact = 1;
+        for (size_t n = 0; n <= count && exact; n = (n < 67) ? n + 1 : count + (n == count))
+        {
+            State_Grid_JPEG_Matrix_Recompensate(values, radiometry_out, n, &from, &to, 1, kernels[k].kernel);
+            exact &= memcmp(radiometry_ref, radiometry_out, n * sizeof(float)) == 0;
+        }
+
+        double start = Now_Ms();
+        for (int i = 0; i < 100; ++i)
+            State_Grid_JPEG_Matrix_Recompensate(values, radiometry_out, count, &from, &to, 0, kernels[k].kernel);
+        double elapsed = (Now_Ms() - start) / 100;
+        exact &= memcmp(radiometry_ref, radiometry_out, count * sizeof(float)) == 0;
+
+        printf("radio %-6s: %s, %8.3f ms, %.3f -> %.3f\n", kernels[k].name, exact ? "bit-exact" : "MISMATCH", elapsed, values[0], radiometry_out[0]);
+        failed |= !exact;
+    }
+    free(radiometry_ref);
+    free(radiometry_out);
+
+    // Render kernels must give the scalar image, with NaN, values outside the span and an isotherm. An odd width
+    // exercises the tails of every row.
+    uint16_t render_width = 997;
+    uint16_t render_height = count / render_width < 1000 ? count / render_width : 1000;
+    size_t render_bytes = (size_t)render_width * render_height * 3;
+    if (count > 11)
+        values[count / 2] = NAN, values[11] = -1000.0f, values[12] = 1000.0f;
+
+    SGJWRenderConfig render = {SGJW_PALETTE_IRON, SGJW_RENDER_RGB888, 30.0f, 100.0f, 1, 60.0f, 62.5f, {0, 255, 0}, 255, 1, SGJW_KERNEL_SCALAR};
+    uint8_t* image_ref = (uint8_t*)malloc(render_bytes * 2);
+    uint8_t* image_out = (uint8_t*)malloc(render_bytes * 2);
+    State_Grid_JPEG_Render(values, render_width, render_height, &render, image_ref, render_width * 3, NULL);
+    render.format = SGJW_RENDER_INDEXED8;
+    State_Grid_JPEG_Render(values, render_width, render_height, &render, image_ref + render_bytes, render_width, NULL);
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+    {
+        render.kernel = kernels[k].kernel;
+        render.format = SGJW_RENDER_RGB888;
+        render.threads = 0;
+        if (State_Grid_JPEG_Render(values, render_width, render_height, &render, image_out, render_width * 3, NULL) != SGJW_SUCCESS)
+            continue;
+
+        double start = Now_Ms();
+        for (int i = 0; i < 100; ++i)
+            State_Grid_JPEG_Render(values, render_width, render_height, &render, image_out, render_width * 3, NULL);
+        double elapsed = (Now_Ms() - start) / 100;
+
+        render.format = SGJW_RENDER_INDEXED8;
+        State_Grid_JPEG_Render(values, render_width, render_height, &render, image_out + render_bytes, render_width, NULL);
+        int exact = memcmp(image_ref, image_out, render_bytes + render_bytes / 3) == 0;
+
+        printf("render %-5s: %s, %8.3f ms\n", kernels[k].name, exact ? "bit-exact" : "MISMATCH", elapsed);
+        failed |= !exact;
+    }
+    free(image_ref);
+    free(image_out);
+
+    // Transform kernels must move every value where the scalar reference does, odd sizes exercise the tile edges
+    uint16_t shapes[][2] = {{render_width, render_height}, {37, 37}, {1, 13}, {640, count / 640}};
+    float* transform_ref = (float*)malloc(count * sizeof(float));
+    float* transform_out = (float*)malloc(count * sizeof(float));
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+    {
+        if (State_Grid_JPEG_Matrix_Transform(values, 0, 0, SGJW_ROTATE_90, transform_out, kernels[k].kernel) != SGJW_SUCCESS)
+            continue;
+
+        int exact = 1;
+        for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s)
+        {
+            size_t n = (size_t)shapes[s][0] * shapes[s][1];
+            for (int t = SGJW_ROTATE_90; t <= SGJW_TRANSPOSE && n <= count; ++t)
+            {
+                State_Grid_JPEG_Matrix_Transform(values, shapes[s][0], shapes[s][1], (SGJW_TRANSFORM)t, transform_ref, SGJW_KERNEL_SCALAR);
+                State_Grid_JPEG_Matrix_Transform(values, shapes[s][0], shapes[s][1], (SGJW_TRANSFORM)t, transform_out, kernels[k].kernel);
+                exact &= memcmp(transform_ref, transform_out, n * sizeof(float)) == 0;
+            }
+        }
+
+        double start = Now_Ms();
+        for (int i = 0; i < 100; ++i)
+            State_Grid_JPEG_Matrix_Transform(values, 640, count / 640, SGJW_ROTATE_90, transform_out, kernels[k].kernel);
+        double elapsed = (Now_Ms() - start) / 100;
+
+        // Four quarter turns are the identity
+        for (int i = 0; i < 4; ++i)
+        {
+            float* from = i % 2 ? transform_ref : transform_out;
+            float* to = i % 2 ? transform_out : transform_ref;
+            State_Grid_JPEG_Matrix_Transform(i ? from : values, i % 2 ? count / 640 : 640, i % 2 ? 640 : count / 640, SGJW_ROTATE_90, to,
+                                             kernels[k].kernel);
+        }
+        exact &= memcmp(values, transform_out, (count / 640) * 640 * sizeof(float)) == 0;
+
+        printf("rot90 %-6s: %s, %8.3f ms\n", kernels[k].name, exact ? "exact" : "MISMATCH", elapsed);
+        failed |= !exact;
+    }
+    free(transform_ref);
+    free(transform_out);
+    free(values);
+
+    // Decode and encode must round-trip on any host
+    float* decoded = (float*)malloc(count * sizeof(float));
+    State_Grid_JPEG_Matrix_Decode((const uint8_t*)src, count, decoded);
+    State_Grid_JPEG_Matrix_Encode(decoded, count, (uint8_t*)out);
+    int round_trip = memcmp(src, out, count * sizeof(uint32_t)) == 0;
+    printf("codec   : %s, auto kernel [%d]\n", round_trip ? "round-trip" : "MISMATCH", State_Grid_JPEG_Matrix_Kernel());
+    failed |= !round_trip;
+
+    free(decoded);
+    free(src);
+    free(ref);
+    free(out);
+    return failed;
+}
+
+static void* Counting_Alloc(size_t size, size_t align, void* user)
+{
+    ++*(size_t*)user;
+
+    void* ptr = NULL;
+    return posix_memalign(&ptr, align < sizeof(void*) ? sizeof(void*) : align, size) == 0 ? ptr : NULL;
+}
+
+static void Counting_Release(void* ptr, void* user)
+{
+    (void)user;
+    free(ptr);
+}
+
+/**
+ * @brief Read the same file repeatedly into one object and count library allocations per frame.
+ *
+ * @note Only the first frame may allocate, every later frame must reuse the block.
+ */
+static int Check_Allocs(const char* filepath, int frames)
+{
+    size_t allocs = 0;
+    SGJWAllocator allocator = {Counting_Alloc, Counting_Release, &allocs};
+    State_Grid_JPEG_Set_Allocator(&allocator);
+
+    StateGridJPEGV2 jpeg;
+    memset(&jpeg, 0, sizeof(jpeg));
+
+    size_t first_frame = 0;
+    double start = Now_Ms();
+    for (int i = 0; i < frames; ++i)
+    {
+        if (State_Grid_JPEG_Read_Into(filepath, &jpeg, SGJW_READ_TRAILER_ONLY) != SGJW_SUCCESS)
+        {
+            fprintf(stderr, "Read [%s] failed.\n", filepath);
+            return 1;
+        }
+        if (i == 0)
+            first_frame = allocs;
+    }
+    double elapsed = Now_Ms() - start;
+
+    State_Grid_JPEG_V2_Delete_OBJ(&jpeg);
+    State_Grid_JPEG_Set_Allocator(NULL);
+
+    size_t steady = allocs - first_frame;
+    printf("first frame: %zu allocs, next %d frames: %zu allocs, %.3f ms/frame\n", first_frame, frames - 1, steady, elapsed / frames);
+    return steady != 0;
+}
+
+/**
+ * @brief Print the fixed fields of many files, reading only a few hundred bytes of each.
+ */
+static int Probe_Files(int count, char** filepaths)
+{
+    int failed = 0;
+    State_Grid_JPEG_Reset_Bytes_Read();
+
+    for (int i = 0; i < count; ++i)
+    {
+        StateGridJPEGProbe probe;
+        if (State_Grid_JPEG_Probe(filepaths[i], &probe) != SGJW_SUCCESS)
+        {
+            fprintf(stderr, "Probe [%s] failed.\n", filepaths[i]);
+            failed = 1;
+            continue;
+        }
+
+        printf("%s: date [%s] sn [%s] %ux%u emissivity [%.2f] gps [%.6f, %.6f] matrix [%llu, +%llu)\n", filepaths[i], probe.header.date, probe.header.sn,
+               probe.header.width, probe.header.height, probe.header.emissivity, probe.header.longitude, probe.header.latitude,
+               (unsigned long long)probe.matrix_offset, (unsigned long long)probe.header.width * probe.header.height * sizeof(float));
+    }
+
+    printf("%llu bytes read for %d files\n", (unsigned long long)State_Grid_JPEG_Get_Bytes_Read(), count);
+    return failed;
+}
+
+/**
+ * @brief Write a capture of a zeroed width x height matrix behind a bare JPEG (SOI, EOI) in the temporary folder.
+ *
+ * @param path A mkstemp template, receives the file name.
+ */
+static int8_t Write_Capture(char* path, uint16_t width, uint16_t height)
+{
+    const uint8_t jpeg_bytes[4] = {0xFF, 0xD8, 0xFF, 0xD9};
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return SGJW_ERROR_FILE_WRITE;
+
+    int8_t retval = write(fd, jpeg_bytes, sizeof(jpeg_bytes)) == (ssize_t)sizeof(jpeg_bytes) ? SGJW_SUCCESS : SGJW_ERROR_FILE_WRITE;
+    close(fd);
+
+    StateGridJPEGV2 jpeg;
+    memset(&jpeg, 0, sizeof(jpeg));
+    if (retval == SGJW_SUCCESS)
+        retval = State_Grid_JPEG_V2_Resize(&jpeg, width, height, 0);
+    if (retval == SGJW_SUCCESS)
+    {
+        memset(jpeg.matrix, 0, (size_t)width * height * sizeof(float));
+        retval = State_Grid_JPEG_V2_Append(path, &jpeg);
+    }
+
+    State_Grid_JPEG_V2_Delete_OBJ(&jpeg);
+    return retval;
+}
+
+/**
+ * @brief Read regions of a capture without columns, a 0x4 frame.
+ */
+static int Check_Empty_Region(void)
+{
+    char path[] = "/tmp/sgjw_region_XXXXXX";
+    StateGridJPEGProbe probe;
+    float dst = 0.0f;
+    SGJWRegion region = {0, 1, 0, 3, &dst, 0};
+
+    int8_t retval = Write_Capture(path, 0, 4);
+    if (retval == SGJW_SUCCESS)
+        retval = State_Grid_JPEG_Probe(path, &probe);
+    if (retval == SGJW_SUCCESS)
+        retval = State_Grid_JPEG_Read_Regions(path, &probe, &region, 1);
+
+    printf("region [0, 1, 0x3] of 0x4: %s\n", retval == SGJW_SUCCESS ? "empty" : "FAILED");
+
+    unlink(path);
+    return retval != SGJW_SUCCESS;
+}
+
+/**
+ * @brief Decode a rectangle through the file and the mapped view, compare both against a full read.
+ */
+static int Check_Region(const char* filepath, SGJWRegion region)
+{
+    StateGridJPEGProbe probe;
+    StateGridJPEGV2 jpeg;
+    StateGridJPEGView view;
+    memset(&jpeg, 0, sizeof(jpeg));
+    if (State_Grid_JPEG_Probe(filepath, &probe) != SGJW_SUCCESS || State_Grid_JPEG_Read_Into(filepath, &jpeg, SGJW_READ_TRAILER_ONLY) != SGJW_SUCCESS ||
+        State_Grid_JPEG_Map(filepath, &view) != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Read [%s] failed.\n", filepath);
+        return 1;
+    }
+
+    // Padded stride so writes past the rectangle width would show up
+    region.stride = region.width + 3;
+    float* from_file = (float*)calloc((size_t)region.height * region.stride, sizeof(float));
+    float* from_view = (float*)calloc((size_t)region.height * region.stride, sizeof(float));
+
+    State_Grid_JPEG_Reset_Bytes_Read();
+    region.dst = from_file;
+    int8_t file_ret = State_Grid_JPEG_Read_Regions(filepath, &probe, &region, 1);
+    unsigned long long bytes = State_Grid_JPEG_Get_Bytes_Read();
+    region.dst = from_view;
+    int8_t view_ret = State_Grid_JPEG_View_Regions(&view, &region, 1);
+
+    int exact = file_ret == SGJW_SUCCESS && view_ret == SGJW_SUCCESS;
+    for (size_t r = 0; r < region.height && exact; ++r)
+    {
+        const float* ref = jpeg.matrix + (size_t)(region.y + r) * jpeg.width + region.x;
+        exact &= memcmp(ref, from_file + r * region.stride, region.width * sizeof(float)) == 0;
+        exact &= memcmp(ref, from_view + r * region.stride, region.width * sizeof(float)) == 0;
+        exact &= from_file[r * region.stride + region.width] == 0.0f;
+    }
+
+    printf("region [%u, %u, %ux%u] of %ux%u: %s, %llu of %llu matrix bytes read\n", region.x, region.y, region.width, region.height, jpeg.width, jpeg.height,
+           exact ? "exact" : "MISMATCH", bytes, (unsigned long long)jpeg.width * jpeg.height * sizeof(float));
+
+    free(from_file);
+    free(from_view);
+    State_Grid_JPEG_Unmap(&view);
+    State_Grid_JPEG_V2_Delete_OBJ(&jpeg);
+    return Check_Empty_Region() || !exact;
+}
+
+/**
+ * @brief Compare statistics gathered during the read against a second pass over the matrix, then time both.
+ */
+static int Check_Stats(const char* filepath, int iterations)
+{
+    StateGridJPEGV2 jpeg;
+    memset(&jpeg, 0, sizeof(jpeg));
+    SGJWStats two_pass = {.histogram_low = -20.0f, .histogram_high = 150.0f};
+    SGJWStats fused = {.histogram_low = -20.0f, .histogram_high = 150.0f};
+    SGJWStats stats_only = {.histogram_low = -20.0f, .histogram_high = 150.0f};
+
+    double start = Now_Ms();
+    for (int i = 0; i < iterations; ++i)
+    {
+        if (State_Grid_JPEG_Read_Into(filepath, &jpeg, SGJW_READ_TRAILER_ONLY) != SGJW_SUCCESS)
+        {
+            fprintf(stderr, "Read [%s] failed.\n", filepath);
+            return 1;
+        }
+        State_Grid_JPEG_Matrix_Stats(jpeg.matrix, jpeg.width, jpeg.height, &two_pass, SGJW_KERNEL_AUTO);
+    }
+    double two_pass_ms = (Now_Ms() - start) / iterations;
+
+    start = Now_Ms();
+    for (int i = 0; i < iterations; ++i)
+        State_Grid_JPEG_Read_Stats(filepath, &jpeg, SGJW_READ_TRAILER_ONLY, &fused);
+    double fused_ms = (Now_Ms() - start) / iterations;
+
+    StateGridJPEGV2 header;
+    memset(&header, 0, sizeof(header));
+    start = Now_Ms();
+    for (int i = 0; i < iterations; ++i)
+        State_Grid_JPEG_Read_Stats(filepath, &header, SGJW_READ_STATS_ONLY, &stats_only);
+    double stats_only_ms = (Now_Ms() - start) / iterations;
+
+    int exact = memcmp(&two_pass, &fused, sizeof(SGJWStats)) == 0 && memcmp(&two_pass, &stats_only, sizeof(SGJWStats)) == 0 && header.matrix == NULL &&
+                header.width == jpeg.width;
+
+    printf("min [%.2f] max [%.2f] at [%u, %u] mean [%.3f] stddev [%.3f]: %s\n", fused.min, fused.max, fused.hottest_x, fused.hottest_y, fused.mean,
+           fused.stddev, exact ? "exact" : "MISMATCH");
+    printf("read + pass: %.3f ms, fused: %.3f ms, stats only: %.3f ms\n", two_pass_ms, fused_ms, stats_only_ms);
+
+    State_Grid_JPEG_V2_Delete_OBJ(&jpeg);
+    State_Grid_JPEG_V2_Delete_OBJ(&header);
+    return !exact;
+}
+
+/**
+ * @brief Collect the .jpg / .jpeg files of a folder, or the lines of a file holding one path per line.
+ */
+static char** Load_File_List(const char* source, size_t* count)
+{
+    char** filepaths = (char**)malloc(sizeof(char*));
+    struct stat st;
+    *count = 0;
+
+    if (stat(source, &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        DIR* dir = opendir(source);
+        if (!dir)
+        {
+            free(filepaths);
+            return NULL;
+        }
+
+        struct dirent* item;
+        while ((item = readdir(dir)) != NULL)
+        {
+            const char* dot = strrchr(item->d_name, '.');
+            if (!dot || (strcasecmp(dot, ".jpg") != 0 && strcasecmp(dot, ".jpeg") != 0))
+                continue;
+            filepaths = (char**)realloc(filepaths, (*count + 1) * sizeof(char*));
+            filepaths[*count] = (char*)malloc(strlen(source) + strlen(item->d_name) + 2);
+            sprintf(filepaths[(*count)++], "%s/%s", source, item->d_name);
+        }
+        closedir(dir);
+        return filepaths;
+    }
+
+    FILE* list = fopen(source, "r");
+    if (!list)
+    {
+        free(filepaths);
+        return NULL;
+    }
+
+    char line[4096];
+    while (fgets(line, sizeof(line), list))
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0')
+            continue;
+        filepaths = (char**)realloc(filepaths, (*count + 1) * sizeof(char*));
+        filepaths[(*count)++] = strdup(line);
+    }
+    fclose(list);
+    return filepaths;
+}
+
+static void Free_File_List(char** filepaths, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        free(filepaths[i]);
+    free(filepaths);
+}
+
+typedef struct
+{
+    char hottest_file[4096];
+    float hottest;
+} BatchSummary;
+
+static int Batch_Callback(const char* filepath, int8_t status, const StateGridJPEGV2* obj, const SGJWStats* stats, void* user)
+{
+    (void)obj;
+    BatchSummary* summary = (BatchSummary*)user;
+    if (status != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Read [%s] failed: [%d].\n", filepath, status);
+        return 0;
+    }
+
+    // Neither path nor object outlive the batch
+    if (!summary->hottest_file[0] || stats->max > summary->hottest)
+    {
+        snprintf(summary->hottest_file, sizeof(summary->hottest_file), "%s", filepath);
+        summary->hottest = stats->max;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read a folder, or a file holding one path per line, on a thread pool and report the throughput.
+ */
+static int Batch_Files(const char* source, SGJW_BATCH_BACKEND backend, uint32_t threads, uint32_t max_in_flight)
+{
+    BatchSummary summary = {"", 0.0f};
+    SGJWBatchConfig config = {backend, threads, max_in_flight, SGJW_READ_STATS_ONLY, 1, 0.0f, 0.0f, Batch_Callback, &summary};
+    SGJWBatchReport report;
+    int8_t retval = SGJW_SUCCESS;
+    struct stat st;
+
+    if (stat(source, &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        retval = State_Grid_JPEG_Batch_Read_Dir(source, &config, &report);
+    }
+    else
+    {
+        size_t count = 0;
+        char** filepaths = Load_File_List(source, &count);
+        if (!filepaths)
+        {
+            fprintf(stderr, "Open [%s] failed.\n", source);
+            return 1;
+        }
+
+        retval = State_Grid_JPEG_Batch_Read((const char* const*)filepaths, count, &config, &report);
+        Free_File_List(filepaths, count);
+    }
+
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Batch [%s] failed: [%d].\n", source, retval);
+        return 1;
+    }
+
+    if (summary.hottest_file[0])
+        printf("hottest [%.2f] in [%s]\n", summary.hottest, summary.hottest_file);
+    printf("%llu files, %llu failed, %.3f s, %.1f files/s, %.1f MB/s\n", (unsigned long long)report.files, (unsigned long long)report.failed,
+           report.seconds, report.files / report.seconds, report.bytes / 1e6 / report.seconds);
+    return report.failed != 0;
+}
+
+/**
+ * @brief Probe a folder or file list into an index file.
+ */
+static int Index_Build(const char* index_path, const char* source)
+{
+    size_t count = 0;
+    char** filepaths = Load_File_List(source, &count);
+    if (!filepaths)
+    {
+        fprintf(stderr, "Open [%s] failed.\n", source);
+        return 1;
+    }
+
+    size_t indexed = 0;
+    double start = Now_Ms();
+    int8_t retval = State_Grid_JPEG_Index_Build(index_path, (const char* const*)filepaths, count, &indexed);
+    double elapsed = Now_Ms() - start;
+    Free_File_List(filepaths, count);
+
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Index [%s] failed: [%d].\n", index_path, retval);
+        return 1;
+    }
+
+    printf("%zu of %zu files indexed in %.3f ms\n", indexed, count, elapsed);
+    return 0;
+}
+
+/**
+ * @brief Query an index, "-" leaves a filter open, and print the matches.
+ */
+static int Index_Query(const char* index_path, int argc, char** argv)
+{
+    SGJWIndex index;
+    if (State_Grid_JPEG_Index_Open(index_path, &index) != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Open index [%s] failed.\n", index_path);
+        return 1;
+    }
+
+    SGJWIndexQuery query;
+    memset(&query, 0, sizeof(query));
+    if (argc >= 1 && strcmp(argv[0], "-") != 0)
+        query.date_from = argv[0];
+    if (argc >= 2 && strcmp(argv[1], "-") != 0)
+        query.date_to = argv[1];
+    if (argc >= 3 && strcmp(argv[2], "-") != 0)
+        query.sn = argv[2];
+    if (argc >= 7)
+    {
+        query.use_box = 1;
+        query.longitude_min = atof(argv[3]);
+        query.longitude_max = atof(argv[4]);
+        query.latitude_min = atof(argv[5]);
+        query.latitude_max = atof(argv[6]);
+    }
+
+    uint32_t* results = (uint32_t*)malloc((index.count ? index.count : 1) * sizeof(uint32_t));
+    double start = Now_Ms();
+    size_t matches = State_Grid_JPEG_Index_Query(&index, &query, results, index.count);
+    double elapsed = Now_Ms() - start;
+
+    for (size_t i = 0; i < matches && i < 20; ++i)
+    {
+        SGJWIndexEntry entry;
+        State_Grid_JPEG_Index_Get(&index, results[i], &entry);
+        printf("%s %s %.6f %.6f %ux%u [%s]\n", entry.date, entry.sn, entry.longitude, entry.latitude, entry.width, entry.height, entry.path);
+    }
+    printf("%zu of %u records matched in %.3f ms\n", matches, index.count, elapsed);
+
+    // A truncated query must store the earliest matches, whichever way the index is walked
+    int failed = 0;
+    size_t capacity = matches / 2;
+    uint32_t* truncated = (uint32_t*)malloc((capacity ? capacity : 1) * sizeof(uint32_t));
+    if (capacity > 0 && truncated)
+    {
+        size_t truncated_matches = State_Grid_JPEG_Index_Query(&index, &query, truncated, capacity);
+        failed = truncated_matches != matches || memcmp(truncated, results, capacity * sizeof(uint32_t)) != 0;
+        printf("first %zu matches: %s\n", capacity, failed ? "MISMATCH" : "consistent");
+    }
+
+    free(truncated);
+    free(results);
+    State_Grid_JPEG_Index_Close(&index);
+    return failed;
+}
+
+static volatile int watch_stop = 0;
+
+static void Watch_Signal(int signal_number)
+{
+    (void)signal_number;
+    watch_stop = 1;
+}
+
+static int Watch_Callback(const char* filepath, int8_t status, const SGJWIndexEntry* entry, void* user)
+{
+    (void)user;
+    if (status != SGJW_SUCCESS)
+        fprintf(stderr, "Probe [%s] failed: [%d].\n", filepath, status);
+    else
+        printf("%s %s [%s]\n", entry->date, entry->sn, filepath);
+    fflush(stdout);
+    return 0;
+}
+
+/**
+ * @brief Keep an index up to date with folders until interrupted.
+ */
+static int Watch_Folders(const char* index_path, int count, char** directories)
+{
+    SGJWWatchConfig config;
+    memset(&config, 0, sizeof(config));
+    config.index_path = index_path;
+    config.directories = (const char* const*)directories;
+    config.directory_count = count;
+    config.callback = Watch_Callback;
+    config.stop = &watch_stop;
+
+    signal(SIGINT, Watch_Signal);
+    signal(SIGTERM, Watch_Signal);
+
+    SGJWWatchReport report;
+    int8_t retval = State_Grid_JPEG_Watch_Run(&config, &report);
+    printf("%llu ingested, %llu failed, %llu flushes, %llu compactions, %llu rescans\n", (unsigned long long)report.ingested,
+           (unsigned long long)report.failed, (unsigned long long)report.flushes, (unsigned long long)report.compactions,
+           (unsigned long long)report.rescans);
+
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Watch failed: [%d].\n", retval);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Correct fixed-size fields in place, e.g. "emissivity=0.95 distance=5".
+ */
+static int Patch_File(const char* filepath, int count, char** assignments)
+{
+    StateGridJPEGV2 obj;
+    memset(&obj, 0, sizeof(obj));
+    uint32_t fields = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        char* value = strchr(assignments[i], '=');
+        if (!value)
+            goto invalid;
+        *value++ = '\0';
+
+        const char* name = assignments[i];
+        if (strcmp(name, "emissivity") == 0)
+            obj.emissivity = strtof(value, NULL), fields |= SGJW_PATCH_EMISSIVITY;
+        else if (strcmp(name, "ambient_temp") == 0)
+            obj.ambient_temp = strtof(value, NULL), fields |= SGJW_PATCH_AMBIENT_TEMP;
+        else if (strcmp(name, "fov") == 0)
+            obj.fov = (uint8_t)atoi(value), fields |= SGJW_PATCH_FOV;
+        else if (strcmp(name, "distance") == 0)
+            obj.distance = strtoul(value, NULL, 10), fields |= SGJW_PATCH_DISTANCE;
+        else if (strcmp(name, "humidity") == 0)
+            obj.humidity = (uint8_t)atoi(value), fields |= SGJW_PATCH_HUMIDITY;
+        else if (strcmp(name, "reflective_temp") == 0)
+            obj.reflective_temp = strtof(value, NULL), fields |= SGJW_PATCH_REFLECTIVE_TEMP;
+        else if (strcmp(name, "longitude") == 0)
+            obj.longitude = atof(value), fields |= SGJW_PATCH_LONGITUDE;
+        else if (strcmp(name, "latitude") == 0)
+            obj.latitude = atof(value), fields |= SGJW_PATCH_LATITUDE;
+        else if (strcmp(name, "altitude") == 0)
+            obj.altitude = strtoul(value, NULL, 10), fields |= SGJW_PATCH_ALTITUDE;
+        else if (strcmp(name, "date") == 0)
+            strncpy(obj.date, value, SGJW_DATE_LENGTH), fields |= SGJW_PATCH_DATE;
+        else if (strcmp(name, "manufacturer") == 0)
+            strncpy(obj.manufacturer, value, SGJW_TEXT_LENGTH), fields |= SGJW_PATCH_MANUFACTURER;
+        else if (strcmp(name, "product") == 0)
+            strncpy(obj.product, value, SGJW_TEXT_LENGTH), fields |= SGJW_PATCH_PRODUCT;
+        else if (strcmp(name, "sn") == 0)
+            strncpy(obj.sn, value, SGJW_TEXT_LENGTH), fields |= SGJW_PATCH_SN;
+        else
+            goto invalid;
+    }
+
+    int8_t retval = State_Grid_JPEG_Patch(filepath, &obj, fields);
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Patch [%s] failed: [%d].\n", filepath, retval);
+        return 1;
+    }
+    return 0;
+
+invalid:
+    fprintf(stderr, "Unknown assignment [%s].\n", assignments[0]);
+    return 1;
+}
+
+/**
+ * @brief Replace the trailer with one holding a new appendix, dropping stacked trailers.
+ */
+static int Replace_Appendix(const char* filepath, const char* appendix)
+{
+    StateGridJPEGV2 obj;
+    memset(&obj, 0, sizeof(obj));
+
+    int8_t retval = State_Grid_JPEG_Read_Into(filepath, &obj, SGJW_READ_TRAILER_ONLY);
+    if (retval == SGJW_SUCCESS)
+    {
+        // The appendix is borrowed, the block keeps the matrix
+        obj.appendix = (char*)appendix;
+        obj.appendix_length = strlen(appendix);
+        retval = State_Grid_JPEG_Replace(filepath, &obj);
+    }
+    State_Grid_JPEG_V2_Delete_OBJ(&obj);
+
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Replace [%s] failed: [%d].\n", filepath, retval);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Render the matrix of a file into a binary PPM, e.g. "render in.jpg out.ppm iron".
+ */
+static int Render_File(const char* filepath, const char* outpath, int count, char** options)
+{
+    StateGridJPEGV2 obj;
+    memset(&obj, 0, sizeof(obj));
+
+    SGJWRenderConfig config;
+    memset(&config, 0, sizeof(config));
+    if (count >= 1 && strcmp(options[0], "rainbow") == 0)
+        config.palette = SGJW_PALETTE_RAINBOW;
+    else if (count >= 1 && strcmp(options[0], "gray") == 0)
+        config.palette = SGJW_PALETTE_GRAY;
+    if (count >= 3)
+        config.span_low = strtof(options[1], NULL), config.span_high = strtof(options[2], NULL);
+
+    int8_t retval = State_Grid_JPEG_V2_Read(filepath, &obj, 0);
+    size_t stride = (size_t)obj.width * 3;
+    uint8_t* image = retval == SGJW_SUCCESS ? (uint8_t*)malloc(stride * obj.height + 1) : NULL;
+    float span[2] = {0.0f, 0.0f};
+
+    double start = Now_Ms();
+    if (retval == SGJW_SUCCESS)
+        retval = State_Grid_JPEG_Render(obj.matrix, obj.width, obj.height, &config, image, stride, span);
+    double elapsed = Now_Ms() - start;
+
+    if (retval == SGJW_SUCCESS)
+    {
+        FILE* file = fopen(outpath, "wb");
+        if (file)
+        {
+            fprintf(file, "P6\n%u %u\n255\n", obj.width, obj.height);
+            fwrite(image, 1, stride * obj.height, file);
+            fclose(file);
+        }
+        printf("%ux%u rendered in %.3f ms, span [%.2f, %.2f]\n", obj.width, obj.height, elapsed, span[0], span[1]);
+    }
+    else
+        fprintf(stderr, "Render [%s] failed: [%d].\n", filepath, retval);
+
+    free(image);
+    State_Grid_JPEG_V2_Delete_OBJ(&obj);
+    return retval != SGJW_SUCCESS;
+}
+
+/**
+ * @brief A 1x1 capture has no level, its sidecar must still be loaded instead of rebuilt.
+ */
+static int Check_Tiny_Pyramid(void)
+{
+    char path[] = "/tmp/sgjw_pyramid_XXXXXX";
+    char sidecar[64];
+    SGJWPyramid cached;
+    SGJWPyramid loaded;
+    struct stat st;
+    memset(&cached, 0, sizeof(cached));
+    memset(&loaded, 0, sizeof(loaded));
+
+    int8_t retval = Write_Capture(path, 1, 1);
+    snprintf(sidecar, sizeof(sidecar), "%s.pyr", path);
+    if (retval == SGJW_SUCCESS)
+        retval = State_Grid_JPEG_Pyramid_Cached(path, 0, &cached);
+    if (retval == SGJW_SUCCESS)
+        retval = State_Grid_JPEG_Pyramid_Load(sidecar, &loaded);
+
+    int exact = retval == SGJW_SUCCESS && stat(path, &st) == 0 && loaded.levels == 0 && loaded.width == 1 && loaded.height == 1 &&
+                loaded.source_size == (uint64_t)st.st_size && cached.source_size == loaded.source_size;
+    printf("1x1 pyramid sidecar: %s\n", exact ? "loaded" : "FAILED");
+
+    State_Grid_JPEG_Pyramid_Delete(&cached);
+    State_Grid_JPEG_Pyramid_Delete(&loaded);
+    unlink(sidecar);
+    unlink(path);
+    return !exact;
+}
+
+/**
+ * @brief Check the streamed pyramid of a file against the one built from its matrix, then its sidecar.
+ */
+static int Check_Pyramid(const char* filepath)
+{
+    StateGridJPEGV2 obj;
+    SGJWPyramid full;
+    SGJWPyramid streamed;
+    SGJWPyramid cached;
+    memset(&obj, 0, sizeof(obj));
+    memset(&full, 0, sizeof(full));
+    memset(&streamed, 0, sizeof(streamed));
+    memset(&cached, 0, sizeof(cached));
+
+    int8_t retval = State_Grid_JPEG_V2_Read(filepath, &obj, 0);
+    if (retval == SGJW_SUCCESS)
+        retval = State_Grid_JPEG_Pyramid_Build(obj.matrix, obj.width, obj.height, 0, &full);
+
+    double start = Now_Ms();
+    if (retval == SGJW_SUCCESS)
+        retval = State_Grid_JPEG_Read_Pyramid(filepath, 0, &streamed);
+    double streamed_ms = Now_Ms() - start;
+
+    // Twice, the first call may have to write the sidecar
+    if (retval == SGJW_SUCCESS)
+        retval = State_Grid_JPEG_Pyramid_Cached(filepath, 0, &cached);
+    State_Grid_JPEG_Pyramid_Delete(&cached);
+    start = Now_Ms();
+    if (retval == SGJW_SUCCESS)
+        retval = State_Grid_JPEG_Pyramid_Cached(filepath, 0, &cached);
+    double cached_ms = Now_Ms() - start;
+
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Pyramid [%s] failed: [%d].\n", filepath, retval);
+        State_Grid_JPEG_V2_Delete_OBJ(&obj);
+        return 1;
+    }
+
+    int exact = full.levels == streamed.levels && full.levels == cached.levels;
+    for (uint8_t l = 0; l < full.levels && exact; ++l)
+    {
+        size_t bytes = (size_t)full.level[l].width * full.level[l].height * sizeof(float);
+        const SGJWPyramidLevel* levels[2] = {&streamed.level[l], &cached.level[l]};
+        for (int i = 0; i < 2; ++i)
+            exact &= memcmp(full.level[l].min, levels[i]->min, bytes) == 0 && memcmp(full.level[l].max, levels[i]->max, bytes) == 0 &&
+                     memcmp(full.level[l].mean, levels[i]->mean, bytes) == 0;
+    }
+
+    // The coarsest cell keeps the extremes of the whole matrix
+    SGJWStats stats;
+    memset(&stats, 0, sizeof(stats));
+    State_Grid_JPEG_Matrix_Stats(obj.matrix, obj.width, obj.height, &stats, SGJW_KERNEL_AUTO);
+    const SGJWPyramidLevel* top = &full.level[full.levels - 1];
+    exact &= top->min[0] == stats.min && top->max[0] == stats.max && fabs(top->mean[0] - stats.mean) < 1e-3;
+
+    uint8_t thumb = State_Grid_JPEG_Pyramid_Level_For(&cached, 64, 64);
+    printf("%u levels, %s, streamed %.3f ms, cached %.3f ms, 64x64 thumbnail level %u (%ux%u), max %.2f\n", full.levels,
+           exact ? "exact" : "MISMATCH", streamed_ms, cached_ms, thumb, cached.level[thumb].width, cached.level[thumb].height, top->max[0]);
+
+    State_Grid_JPEG_Pyramid_Delete(&full);
+    State_Grid_JPEG_Pyramid_Delete(&streamed);
+    State_Grid_JPEG_Pyramid_Delete(&cached);
+    State_Grid_JPEG_V2_Delete_OBJ(&obj);
+    return Check_Tiny_Pyramid() || !exact;
+}
+
+/**
+ * @brief Rotate, flip or crop the matrix of a file and rewrite its trailer once, e.g. "rotate90 crop 0 0 100 100".
+ */
+static int Transform_File(const char* filepath, int count, char** operations)
+{
+    // clang-format off
+    struct
+    {
+        const char* name;
+        SGJW_TRANSFORM transform;
+    } names[] = {
+        { "rotate90", SGJW_ROTATE_90 },
+        { "rotate180", SGJW_ROTATE_180 },
+        { "rotate270", SGJW_ROTATE_270 },
+        { "flip-h", SGJW_FLIP_HORIZONTAL },
+        { "flip-v", SGJW_FLIP_VERTICAL },
+        { "transpose", SGJW_TRANSPOSE }
+    };
+    // clang-format on
+
+    StateGridJPEGV2 obj;
+    memset(&obj, 0, sizeof(obj));
+
+    int8_t retval = State_Grid_JPEG_V2_Read(filepath, &obj, 0);
+    for (int i = 0; i < count && retval == SGJW_SUCCESS; ++i)
+    {
+        if (strcmp(operations[i], "crop") == 0 && i + 4 < count)
+        {
+            retval = State_Grid_JPEG_V2_Crop(&obj, (uint16_t)atoi(operations[i + 1]), (uint16_t)atoi(operations[i + 2]), (uint16_t)atoi(operations[i + 3]),
+                                             (uint16_t)atoi(operations[i + 4]));
+            i += 4;
+            continue;
+        }
+
+        retval = SGJW_ERROR_INVALID_PARAMS;
+        for (size_t n = 0; n < sizeof(names) / sizeof(names[0]); ++n)
+        {
+            if (strcmp(operations[i], names[n].name) == 0)
+                retval = State_Grid_JPEG_V2_Transform(&obj, names[n].transform);
+        }
+    }
+
+    if (retval == SGJW_SUCCESS)
+        retval = State_Grid_JPEG_Replace(filepath, &obj);
+
+    if (retval != SGJW_SUCCESS)
+        fprintf(stderr, "Transform [%s] failed: [%d].\n", filepath, retval);
+    else
+        printf("%ux%u written\n", obj.width, obj.height);
+
+    State_Grid_JPEG_V2_Delete_OBJ(&obj);
+    return retval != SGJW_SUCCESS;
+}
+
+/**
+ * @brief Recompensate a file in place for corrected measurement parameters.
+ */
+static int Recompensate_File(const char* filepath, int count, char** values)
+{
+    StateGridJPEGProbe probe;
+
+    // Parameters not given keep their stored values
+    int8_t retval = State_Grid_JPEG_Probe(filepath, &probe);
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Probe [%s] failed: [%d].\n", filepath, retval);
+        return 1;
+    }
+
+    SGJWRadiometry to;
+    State_Grid_JPEG_Radiometry_Of(&probe.header, &to);
+    to.emissivity = strtof(values[0], NULL);
+    to.reflective_temp = strtof(values[1], NULL);
+    if (count >= 5)
+    {
+        to.ambient_temp = strtof(values[2], NULL);
+        to.distance = strtoul(values[3], NULL, 10);
+        to.humidity = (uint8_t)atoi(values[4]);
+    }
+
+    double start = Now_Ms();
+    retval = State_Grid_JPEG_Recompensate_File(filepath, &to, 0);
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Recompensate [%s] failed: [%d].\n", filepath, retval);
+        return 1;
+    }
+    printf("%ux%u recompensated in %.3f ms\n", probe.header.width, probe.header.height, Now_Ms() - start);
+    return 0;
+}
+
+/**
+ * @brief Reference labeling by flood fill, blob b gets the pixels labeled b + 1.
+ */
+static size_t Flood_Blobs(const float* matrix, uint16_t width, uint16_t height, float threshold, int connectivity, uint32_t* marks, SGJWBlob* blobs)
+{
+    size_t total = (size_t)width * height;
+    size_t* stack = (size_t*)malloc(total * sizeof(size_t));
+    size_t count = 0;
+    memset(marks, 0, total * sizeof(uint32_t));
+
+    for (size_t seed = 0; seed < total; ++seed)
+    {
+        if (marks[seed] || !(matrix[seed] >= threshold))
+            continue;
+
+        SGJWBlob* blob = &blobs[count++];
+        double sum = 0.0, sum_x = 0.0, sum_y = 0.0;
+        memset(blob, 0, sizeof(SGJWBlob));
+        blob->left = blob->right = seed % width;
+        blob->top = blob->bottom = seed / width;
+        blob->peak = matrix[seed];
+        blob->peak_x = seed % width;
+        blob->peak_y = seed / width;
+
+        size_t depth = 0;
+        stack[depth++] = seed;
+        marks[seed] = (uint32_t)count;
+        while (depth)
+        {
+            size_t i = stack[--depth];
+            int x = (int)(i % width), y = (int)(i / width);
+            blob->area++;
+            sum += matrix[i];
+            sum_x += x;
+            sum_y += y;
+            if (matrix[i] > blob->peak || (matrix[i] == blob->peak && i < (size_t)blob->peak_y * width + blob->peak_x))
+            {
+                blob->peak = matrix[i];
+                blob->peak_x = x;
+                blob->peak_y = y;
+            }
+            blob->left = x < blob->left ? x : blob->left;
+            blob->right = x > blob->right ? x : blob->right;
+            blob->top = y < blob->top ? y : blob->top;
+            blob->bottom = y > blob->bottom ? y : blob->bottom;
+
+            for (int dy = -1; dy <= 1; ++dy)
+            {
+                for (int dx = -1; dx <= 1; ++dx)
+                {
+                    int nx = x + dx, ny = y + dy;
+                    if ((dx == 0 && dy == 0) || (connectivity == 4 && dx != 0 && dy != 0) || nx < 0 || ny < 0 || nx >= width || ny >= height)
+                        continue;
+                    size_t n = (size_t)ny * width + nx;
+                    if (!marks[n] && matrix[n] >= threshold)
+                    {
+                        marks[n] = (uint32_t)count;
+                        stack[depth++] = n;
+                    }
+                }
+            }
+        }
+        blob->mean = (float)(sum / blob->area);
+        blob->centroid_x = (float)(sum_x / blob->area);
+        blob->centroid_y = (float)(sum_y / blob->area);
+    }
+
+    free(stack);
+    return count;
+}
+
+static int Compare_Blob_Peaks(const void* a, const void* b)
+{
+    const SGJWBlob* x = (const SGJWBlob*)a;
+    const SGJWBlob* y = (const SGJWBlob*)b;
+    if (x->peak_y != y->peak_y)
+        return x->peak_y < y->peak_y ? -1 : 1;
+    return (x->peak_x > y->peak_x) - (x->peak_x < y->peak_x);
+}
+
+/**
+ * @brief Find the hot spots of a file with every kernel, checked against a flood fill.
+ */
+static int Check_Blobs(const char* filepath, float threshold, int connectivity, int iterations)
+{
+    StateGridJPEGV2 obj;
+    memset(&obj, 0, sizeof(obj));
+    int8_t retval = State_Grid_JPEG_V2_Read(filepath, &obj, 0);
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Read [%s] failed: [%d].\n", filepath, retval);
+        return 1;
+    }
+
+    size_t total = (size_t)obj.width * obj.height;
+    uint32_t* marks = (uint32_t*)malloc(total * sizeof(uint32_t));
+    SGJWBlob* expected = (SGJWBlob*)malloc(total * sizeof(SGJWBlob));
+    SGJWBlob* blobs = (SGJWBlob*)malloc(total * sizeof(SGJWBlob));
+    size_t expected_count = Flood_Blobs(obj.matrix, obj.width, obj.height, threshold, connectivity, marks, expected);
+    qsort(expected, expected_count, sizeof(SGJWBlob), Compare_Blob_Peaks);
+
+    SGJWBlobWorkspace workspace;
+    memset(&workspace, 0, sizeof(workspace));
+    SGJWBlobConfig config;
+    memset(&config, 0, sizeof(config));
+    config.threshold = threshold;
+    config.connectivity = (uint8_t)connectivity;
+
+    const char* names[] = {"scalar", "sse2", "avx2", "neon"};
+    int failed = 0;
+    for (int k = SGJW_KERNEL_SCALAR; k <= SGJW_KERNEL_NEON; ++k)
+    {
+        config.kernel = (SGJW_KERNEL)k;
+        size_t found = 0;
+        if (State_Grid_JPEG_Find_Blobs(obj.matrix, obj.width, obj.height, &config, &workspace, blobs, total, &found) != SGJW_SUCCESS)
+            continue;
+
+        double start = Now_Ms();
+        for (int i = 0; i < iterations; ++i)
+            State_Grid_JPEG_Find_Blobs(obj.matrix, obj.width, obj.height, &config, &workspace, blobs, total, &found);
+        double ms = (Now_Ms() - start) / iterations;
+
+        qsort(blobs, found, sizeof(SGJWBlob), Compare_Blob_Peaks);
+        int exact = found == expected_count;
+        for (size_t i = 0; i < found && exact; ++i)
+            exact = blobs[i].area == expected[i].area && blobs[i].peak == expected[i].peak && blobs[i].peak_x == expected[i].peak_x &&
+                    blobs[i].left == expected[i].left && blobs[i].top == expected[i].top && blobs[i].right == expected[i].right &&
+                    blobs[i].bottom == expected[i].bottom && fabsf(blobs[i].mean - expected[i].mean) < 1e-3f &&
+                    fabsf(blobs[i].centroid_x - expected[i].centroid_x) < 1e-3f && fabsf(blobs[i].centroid_y - expected[i].centroid_y) < 1e-3f;
+        failed |= !exact;
+        printf("blobs %-6s %zu found, %s, %.3f ms\n", names[k - SGJW_KERNEL_SCALAR], found, exact ? "exact" : "MISMATCH", ms);
+    }
+
+    for (size_t i = 0; i < expected_count && i < 5; ++i)
+        printf("  area %u, peak %.2f at (%u, %u), mean %.2f, box (%u, %u)-(%u, %u)\n", expected[i].area, expected[i].peak, expected[i].peak_x,
+               expected[i].peak_y, expected[i].mean, expected[i].left, expected[i].top, expected[i].right, expected[i].bottom);
+
+    State_Grid_JPEG_Blob_Workspace_Free(&workspace);
+    free(blobs);
+    free(expected);
+    free(marks);
+    State_Grid_JPEG_V2_Delete_OBJ(&obj);
+    return failed;
+}
+
+/**
+ * @brief Record a capture as a burst of frames through the write-behind recorder, then read one back.
+ */
+static int Record_Frames(const char* filepath, const char* directory, int frames, SGJW_RECORD_POLICY policy)
+{
+    StateGridJPEGProbe probe;
+    StateGridJPEGV2 obj;
+    memset(&obj, 0, sizeof(obj));
+
+    int8_t retval = State_Grid_JPEG_Probe(filepath, &probe);
+    if (retval == SGJW_SUCCESS)
+        retval = State_Grid_JPEG_V2_Read(filepath, &obj, SGJW_READ_TRAILER_ONLY);
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Read [%s] failed: [%d].\n", filepath, retval);
+        return 1;
+    }
+
+    // The JPEG part, in front of the trailer
+    size_t jpeg_size = probe.trailer_offset;
+    uint8_t* jpeg = (uint8_t*)malloc(jpeg_size);
+    FILE* fp = fopen(filepath, "rb");
+    if (!jpeg || !fp || fread(jpeg, 1, jpeg_size, fp) != jpeg_size)
+    {
+        fprintf(stderr, "Read [%s] failed.\n", filepath);
+        if (fp)
+            fclose(fp);
+        free(jpeg);
+        State_Grid_JPEG_V2_Delete_OBJ(&obj);
+        return 1;
+    }
+    fclose(fp);
+
+    SGJWRecorderConfig config;
+    memset(&config, 0, sizeof(config));
+    config.directory = directory;
+    config.max_jpeg_size = jpeg_size;
+    config.max_width = obj.width;
+    config.max_height = obj.height;
+    config.max_appendix_length = obj.appendix_length;
+    config.policy = policy;
+
+    SGJWRecorder* recorder = NULL;
+    retval = State_Grid_JPEG_Recorder_Open(&config, &recorder);
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Open recorder [%s] failed: [%d].\n", directory, retval);
+        free(jpeg);
+        State_Grid_JPEG_V2_Delete_OBJ(&obj);
+        return 1;
+    }
+
+    // As fast as possible, so the policy shows
+    double start = Now_Ms();
+    double submit_max = 0.0;
+    for (int i = 0; i < frames && retval == SGJW_SUCCESS; ++i)
+    {
+        char name[SGJW_RECORD_NAME_LENGTH + 1];
+        snprintf(name, sizeof(name), "frame_%06d.jpg", i);
+        double submit = Now_Ms();
+        retval = State_Grid_JPEG_Recorder_Submit(recorder, name, jpeg, jpeg_size, &obj);
+        submit = Now_Ms() - submit;
+        submit_max = submit > submit_max ? submit : submit_max;
+    }
+    double submit_ms = Now_Ms() - start;
+
+    SGJWRecorderStats stats;
+    State_Grid_JPEG_Recorder_Close(recorder, &stats);
+    double total_ms = Now_Ms() - start;
+
+    printf("%d frames submitted in %.1f ms (longest %.3f ms), recorded in %.1f ms\n", frames, submit_ms, submit_max, total_ms);
+    printf("written %llu, synced %llu, dropped %llu, failed %llu, syncs %llu, max depth %u\n", (unsigned long long)stats.written,
+           (unsigned long long)stats.synced, (unsigned long long)stats.dropped, (unsigned long long)stats.failed, (unsigned long long)stats.syncs,
+           stats.max_depth);
+    printf("latency mean %.0f us, max %llu us, longest sync %llu us, blocked %llu us\n", stats.latency_us_mean, (unsigned long long)stats.latency_us_max,
+           (unsigned long long)stats.sync_us_max, (unsigned long long)stats.blocked_us);
+
+    // The last frame is never dropped
+    char last[4096];
+    StateGridJPEGV2 back;
+    memset(&back, 0, sizeof(back));
+    snprintf(last, sizeof(last), "%s/frame_%06d.jpg", directory, frames - 1);
+    int exact = retval == SGJW_SUCCESS && State_Grid_JPEG_V2_Read(last, &back, 0) == SGJW_SUCCESS && back.width == obj.width &&
+                back.height == obj.height && memcmp(back.matrix, obj.matrix, (size_t)obj.width * obj.height * sizeof(float)) == 0;
+    printf("%s read back %s\n", last, exact ? "exact" : "MISMATCH");
+
+    State_Grid_JPEG_V2_Delete_OBJ(&back);
+    free(jpeg);
+    State_Grid_JPEG_V2_Delete_OBJ(&obj);
+    return !exact;
+}
+
+static int Stream_Write(const uint8_t* data, size_t size, void* user)
+{
+    return fwrite(data, 1, size, (FILE*)user) == size ? 0 : -1;
+}
+
+/**
+ * @brief Parse a capture piped into stdin, optionally writing its JPEG bytes out, e.g. "cat in.jpg | sgjw stream out.jpg".
+ */
+static int Stream_Stdin(const char* jpeg_path)
+{
+    SGJWStreamConfig config;
+    memset(&config, 0, sizeof(config));
+    if (jpeg_path)
+    {
+        config.sink = Stream_Write;
+        config.user = fopen(jpeg_path, "wb");
+        if (!config.user)
+        {
+            fprintf(stderr, "Open [%s] failed.\n", jpeg_path);
+            return 1;
+        }
+    }
+
+    StateGridJPEGV2 obj;
+    memset(&obj, 0, sizeof(obj));
+
+    double start = Now_Ms();
+    int8_t retval = State_Grid_JPEG_Read_Fd(STDIN_FILENO, &config, &obj);
+    double ms = Now_Ms() - start;
+    if (config.user && fclose((FILE*)config.user) != 0 && retval == SGJW_SUCCESS)
+        retval = SGJW_ERROR_FILE_WRITE;
+
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Stream failed: [%d].\n", retval);
+        State_Grid_JPEG_V2_Delete_OBJ(&obj);
+        return 1;
+    }
+
+    SGJWStats stats;
+    State_Grid_JPEG_Matrix_Stats(obj.matrix, obj.width, obj.height, &stats, SGJW_KERNEL_AUTO);
+    printf("%ux%u, %s, min %.2f, max %.2f, appendix %u bytes, %.3f ms\n", obj.width, obj.height, obj.date, stats.min, stats.max, obj.appendix_length, ms);
+    State_Grid_JPEG_V2_Delete_OBJ(&obj);
+    return 0;
+}
+
+/**
+ * @brief Pack a folder or file list into an archive.
+ */
+static int Archive_Pack(const char* archive_path, const char* source)
+{
+    size_t count = 0;
+    char** filepaths = Load_File_List(source, &count);
+    if (!filepaths)
+    {
+        fprintf(stderr, "Open [%s] failed.\n", source);
+        return 1;
+    }
+
+    size_t packed = 0;
+    double start = Now_Ms();
+    int8_t retval = State_Grid_JPEG_Archive_Pack(archive_path, (const char* const*)filepaths, count, &packed);
+    double elapsed = Now_Ms() - start;
+    Free_File_List(filepaths, count);
+
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Pack [%s] failed: [%d].\n", archive_path, retval);
+        return 1;
+    }
+
+    printf("%zu of %zu files packed in %.3f ms\n", packed, count, elapsed);
+    return 0;
+}
+
+/**
+ * @brief Write the files of an archive back into a folder.
+ */
+static int Archive_Unpack(const char* archive_path, const char* directory)
+{
+    size_t unpacked = 0;
+    double start = Now_Ms();
+    int8_t retval = State_Grid_JPEG_Archive_Unpack(archive_path, directory, &unpacked);
+    double elapsed = Now_Ms() - start;
+
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Unpack [%s] failed: [%d].\n", archive_path, retval);
+        return 1;
+    }
+
+    printf("%zu files unpacked in %.3f ms\n", unpacked, elapsed);
+    return 0;
+}
+
+/**
+ * @brief List the frames of a date range, "-" leaves an end open, viewing each one in place.
+ */
+static int Archive_List(const char* archive_path, int argc, char** argv)
+{
+    SGJWArchive archive;
+    if (State_Grid_JPEG_Archive_Open(archive_path, &archive) != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Open archive [%s] failed.\n", archive_path);
+        return 1;
+    }
+
+    uint32_t first = 0;
+    uint32_t end = 0;
+    State_Grid_JPEG_Archive_Find(&archive, argc >= 1 && strcmp(argv[0], "-") != 0 ? argv[0] : NULL,
+                                 argc >= 2 && strcmp(argv[1], "-") != 0 ? argv[1] : NULL, &first, &end);
+
+    int failed = 0;
+    uint32_t copied = 0;
+    double view_ms = 0.0;
+    for (uint32_t i = first; i < end; ++i)
+    {
+        SGJWArchiveEntry entry;
+        StateGridJPEGView view;
+        State_Grid_JPEG_Archive_Get(&archive, i, &entry);
+
+        double start = Now_Ms();
+        int8_t retval = State_Grid_JPEG_Archive_View(&archive, i, &view);
+        view_ms += Now_Ms() - start;
+        if (retval != SGJW_SUCCESS)
+        {
+            fprintf(stderr, "View [%s] failed: [%d].\n", entry.name, retval);
+            failed = 1;
+            continue;
+        }
+
+        copied += view.matrix_copy != NULL;
+        if (i - first < 20)
+        {
+            SGJWStats stats;
+            State_Grid_JPEG_Matrix_Stats(view.matrix, view.width, view.height, &stats, SGJW_KERNEL_AUTO);
+            printf("%s %s %ux%u min %.2f max %.2f, %llu bytes, matrix %s [%s]\n", entry.date, entry.sn, entry.width, entry.height, stats.min,
+                   stats.max, (unsigned long long)entry.size, ((uintptr_t)view.matrix & 63) == 0 ? "aligned" : "unaligned", entry.name);
+        }
+        State_Grid_JPEG_Unmap(&view);
+    }
+    printf("%u of %u frames in range, %u matrices copied, viewed in %.3f ms\n", end - first, archive.count, copied, view_ms);
+
+    State_Grid_JPEG_Archive_Close(&archive);
+    return failed;
+}
+
+static int Compare_Paths(const void* a, const void* b)
+{
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/**
+ * @brief Encode a folder, in name order, or a file list, in its order, into a sequence.
+ */
+static int Sequence_Encode(const char* sequence_path, const char* source, uint32_t keyframe_interval, uint32_t threads)
+{
+    size_t count = 0;
+    char** filepaths = Load_File_List(source, &count);
+    if (!filepaths)
+    {
+        fprintf(stderr, "Open [%s] failed.\n", source);
+        return 1;
+    }
+
+    // Capture order, folders are listed in no particular order
+    struct stat st;
+    if (stat(source, &st) == 0 && S_ISDIR(st.st_mode))
+        qsort(filepaths, count, sizeof(char*), Compare_Paths);
+
+    SGJWSequenceConfig config;
+    memset(&config, 0, sizeof(config));
+    config.keyframe_interval = keyframe_interval;
+    config.threads = threads;
+
+    SGJWSequenceReport report;
+    int8_t retval = State_Grid_JPEG_Sequence_Encode(sequence_path, (const char* const*)filepaths, count, &config, &report);
+    Free_File_List(filepaths, count);
+
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Encode [%s] failed: [%d].\n", sequence_path, retval);
+        return 1;
+    }
+
+    double size = stat(sequence_path, &st) == 0 ? (double)st.st_size : 0.0;
+    printf("%llu frames (%llu keyframes, %llu failed) encoded in %.3f s\n", (unsigned long long)report.frames, (unsigned long long)report.keyframes,
+           (unsigned long long)report.failed, report.seconds);
+    printf("matrices %.2f MB -> %.2f MB (%.2fx), sequence %.2f MB\n", report.matrix_bytes / 1e6, report.packed_bytes / 1e6,
+           report.packed_bytes ? (double)report.matrix_bytes / report.packed_bytes : 0.0, size / 1e6);
+    return 0;
+}
+
+/**
+ * @brief Decode a sequence back into its files.
+ */
+static int Sequence_Decode(const char* sequence_path, const char* directory)
+{
+    size_t unpacked = 0;
+    double start = Now_Ms();
+    int8_t retval = State_Grid_JPEG_Sequence_Unpack(sequence_path, directory, &unpacked);
+    double elapsed = Now_Ms() - start;
+
+    if (retval != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Decode [%s] failed: [%d].\n", sequence_path, retval);
+        return 1;
+    }
+
+    printf("%zu files decoded in %.3f ms\n", unpacked, elapsed);
+    return 0;
+}
+
+/**
+ * @brief Decode every matrix of a sequence in order with each kernel, compare them to the scalar kernel and time them.
+ */
+static int Sequence_Bench(const char* sequence_path)
+{
+    const SGJW_KERNEL kernels[] = {SGJW_KERNEL_SCALAR, SGJW_KERNEL_SSE2, SGJW_KERNEL_AVX2, SGJW_KERNEL_NEON};
+    const char* kernel_names[] = {"scalar", "sse2", "avx2", "neon"};
+
+    SGJWSequence reference;
+    if (State_Grid_JPEG_Sequence_Open(sequence_path, &reference, SGJW_KERNEL_SCALAR) != SGJW_SUCCESS)
+    {
+        fprintf(stderr, "Open sequence [%s] failed.\n", sequence_path);
+        return 1;
+    }
+
+    int failed = 0;
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+    {
+        SGJWSequence sequence;
+        if (State_Grid_JPEG_Sequence_Open(sequence_path, &sequence, kernels[k]) != SGJW_SUCCESS)
+            continue;
+
+        int exact = 1;
+        double elapsed = 0.0;
+        for (uint32_t i = 0; i < sequence.count && exact; ++i)
+        {
+            const float* matrix = NULL;
+            const float* expected = NULL;
+            SGJWSequenceEntry entry;
+            State_Grid_JPEG_Sequence_Get(&sequence, i, &entry);
+
+            double start = Now_Ms();
+            int8_t retval = State_Grid_JPEG_Sequence_Matrix(&sequence, i, &matrix);
+            elapsed += Now_Ms() - start;
+
+            exact = retval == SGJW_SUCCESS && State_Grid_JPEG_Sequence_Matrix(&reference, i, &expected) == SGJW_SUCCESS &&
+                    memcmp(matrix, expected, (size_t)entry.width * entry.height * sizeof(float)) == 0;
+        }
+        printf("%-6s: %u frames, %.3f ms per frame, %s\n", kernel_names[k], sequence.count, sequence.count ? elapsed / sequence.count : 0.0,
+               exact ? "exact" : "MISMATCH");
+        failed |= !exact;
+        State_Grid_JPEG_Sequence_Close(&sequence);
+    }
+
+    State_Grid_JPEG_Sequence_Close(&reference);
+    return failed;
+}
 
 int main(int argc, char** argv)
 {
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <in.jpg> [out.jpg]\n", argv[0]);
+        fprintf(stderr, "       %s bench <in.jpg> [iterations]\n", argv[0]);
+        fprintf(stderr, "       %s kernels [count]\n", argv[0]);
+        fprintf(stderr, "       %s allocs <in.jpg> [frames]\n", argv[0]);
+        fprintf(stderr, "       %s probe <in.jpg>...\n", argv[0]);
+        fprintf(stderr, "       %s batch <folder | list.txt> [auto | threads | uring] [threads] [in-flight]\n", argv[0]);
+        fprintf(stderr, "       %s stats <in.jpg> [iterations]\n", argv[0]);
+        fprintf(stderr, "       %s region <in.jpg> <x> <y> <width> <height>\n", argv[0]);
+        fprintf(stderr, "       %s index build <index> <folder | list.txt>\n", argv[0]);
+        fprintf(stderr, "       %s index query <index> [from | -] [to | -] [sn | -] [lon_min lon_max lat_min lat_max]\n", argv[0]);
+        fprintf(stderr, "       %s watch <index> <folder>...\n", argv[0]);
+        fprintf(stderr, "       %s patch <in.jpg> <field=value>...\n", argv[0]);
+        fprintf(stderr, "       %s replace <in.jpg> <appendix>\n", argv[0]);
+        fprintf(stderr, "       %s recompensate <in.jpg> <emissivity> <reflective_temp> [ambient_temp distance humidity]\n", argv[0]);
+        fprintf(stderr, "       %s render <in.jpg> <out.ppm> [iron | rainbow | gray] [low high]\n", argv[0]);
+        fprintf(stderr, "       %s pyramid <in.jpg>\n", argv[0]);
+        fprintf(stderr, "       %s transform <in.jpg> <rotate90 | rotate180 | rotate270 | flip-h | flip-v | transpose | crop x y w h>...\n", argv[0]);
+        fprintf(stderr, "       %s blobs <in.jpg> <threshold> [4 | 8] [iterations]\n", argv[0]);
+        fprintf(stderr, "       %s stream [out.jpg] < in.jpg\n", argv[0]);
+        fprintf(stderr, "       %s record <in.jpg> <folder> [frames] [block | drop]\n", argv[0]);
+        fprintf(stderr, "       %s archive pack <archive> <folder | list.txt>\n", argv[0]);
+        fprintf(stderr, "       %s archive unpack <archive> <folder>\n", argv[0]);
+        fprintf(stderr, "       %s archive list <archive> [from | -] [to | -]\n", argv[0]);
+        fprintf(stderr, "       %s sequence encode <sequence> <folder | list.txt> [keyframe_interval] [threads]\n", argv[0]);
+        fprintf(stderr, "       %s sequence decode <sequence> <folder>\n", argv[0]);
+        fprintf(stderr, "       %s sequence bench <sequence>\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "bench") == 0 && argc >= 3)
+        return Bench_Read(argv[2], argc >= 4 ? atoi(argv[3]) : 100);
+
+    if (strcmp(argv[1], "allocs") == 0 && argc >= 3)
+        return Check_Allocs(argv[2], argc >= 4 ? atoi(argv[3]) : 50);
+
+    if (strcmp(argv[1], "probe") == 0 && argc >= 3)
+        return Probe_Files(argc - 2, argv + 2);
+
+    if (strcmp(argv[1], "batch") == 0 && argc >= 3)
+    {
+        SGJW_BATCH_BACKEND backend = SGJW_BATCH_AUTO;
+        if (argc >= 4 && strcmp(argv[3], "threads") == 0)
+            backend = SGJW_BATCH_THREADS;
+        else if (argc >= 4 && strcmp(argv[3], "uring") == 0)
+            backend = SGJW_BATCH_URING;
+        return Batch_Files(argv[2], backend, argc >= 5 ? atoi(argv[4]) : 0, argc >= 6 ? atoi(argv[5]) : 0);
+    }
+
+    if (strcmp(argv[1], "stats") == 0 && argc >= 3)
+        return Check_Stats(argv[2], argc >= 4 ? atoi(argv[3]) : 100);
+
+    if (strcmp(argv[1], "region") == 0 && argc >= 7)
+    {
+        SGJWRegion region = {(uint16_t)atoi(argv[3]), (uint16_t)atoi(argv[4]), (uint16_t)atoi(argv[5]), (uint16_t)atoi(argv[6]), NULL, 0};
+        return Check_Region(argv[2], region);
+    }
+
+    if (strcmp(argv[1], "index") == 0 && argc >= 5 && strcmp(argv[2], "build") == 0)
+        return Index_Build(argv[3], argv[4]);
+
+    if (strcmp(argv[1], "index") == 0 && argc >= 4 && strcmp(argv[2], "query") == 0)
+        return Index_Query(argv[3], argc - 4, argv + 4);
+
+    if (strcmp(argv[1], "watch") == 0 && argc >= 4)
+        return Watch_Folders(argv[2], argc - 3, argv + 3);
+
+    if (strcmp(argv[1], "patch") == 0 && argc >= 4)
+        return Patch_File(argv[2], argc - 3, argv + 3);
+
+    if (strcmp(argv[1], "replace") == 0 && argc >= 4)
+        return Replace_Appendix(argv[2], argv[3]);
+
+    if (strcmp(argv[1], "recompensate") == 0 && argc >= 5)
+        return Recompensate_File(argv[2], argc - 3, argv + 3);
+
+    if (strcmp(argv[1], "render") == 0 && argc >= 4)
+        return Render_File(argv[2], argv[3], argc - 4, argv + 4);
+
+    if (strcmp(argv[1], "pyramid") == 0 && argc >= 3)
+        return Check_Pyramid(argv[2]);
+
+    if (strcmp(argv[1], "transform") == 0 && argc >= 4)
+        return Transform_File(argv[2], argc - 3, argv + 3);
+
+    if (strcmp(argv[1], "blobs") == 0 && argc >= 4)
+        return Check_Blobs(argv[2], strtof(argv[3], NULL), argc >= 5 ? atoi(argv[4]) : 8, argc >= 6 ? atoi(argv[5]) : 100);
+
+    if (strcmp(argv[1], "stream") == 0)
+        return Stream_Stdin(argc >= 3 ? argv[2] : NULL);
+
+    if (strcmp(argv[1], "record") == 0 && argc >= 4)
+        return Record_Frames(argv[2], argv[3], argc >= 5 ? atoi(argv[4]) : 100,
+                             argc >= 6 && strcmp(argv[5], "drop") == 0 ? SGJW_RECORD_DROP_OLDEST : SGJW_RECORD_BLOCK);
+
+    if (strcmp(argv[1], "archive") == 0 && argc >= 5 && strcmp(argv[2], "pack") == 0)
+        return Archive_Pack(argv[3], argv[4]);
+
+    if (strcmp(argv[1], "archive") == 0 && argc >= 5 && strcmp(argv[2], "unpack") == 0)
+        return Archive_Unpack(argv[3], argv[4]);
+
+    if (strcmp(argv[1], "archive") == 0 && argc >= 4 && strcmp(argv[2], "list") == 0)
+        return Archive_List(argv[3], argc - 4, argv + 4);
+
+    if (strcmp(argv[1], "sequence") == 0 && argc >= 5 && strcmp(argv[2], "encode") == 0)
+        return Sequence_Encode(argv[3], argv[4], argc >= 6 ? (uint32_t)atoi(argv[5]) : 0, argc >= 7 ? (uint32_t)atoi(argv[6]) : 0);
+
+    if (strcmp(argv[1], "sequence") == 0 && argc >= 5 && strcmp(argv[2], "decode") == 0)
+        return Sequence_Decode(argv[3], argv[4]);
+
+    if (strcmp(argv[1], "sequence") == 0 && argc >= 4 && strcmp(argv[2], "bench") == 0)
+        return Sequence_Bench(argv[3]);
+
+    if (strcmp(argv[1], "kernels") == 0)
+        return Check_Kernels(argc >= 3 ? strtoul(argv[2], NULL, 10) : 640 * 512);
+
     StateGridJPEG jpeg;
     State_Grid_JPEG_Read(argv[1], &jpeg);
 
@@ -10,4 +1769,4 @@ int main(int argc, char** argv)
 
     State_Grid_JPEG_Delete_OBJ(&jpeg);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,154 @@
+/**
+ * @file main.cpp
+ * @brief Self-check of the C++ wrapper inc/sgjw.hpp: create, append, read, move, copy and read_into.
+ *
+ * @note Builds its own capture in the temporary folder, so it needs no input. Returns 0 when every check passes.
+ */
+
+#include "../inc/sgjw.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+static_assert(!std::is_copy_constructible_v<sgjw::Frame> && !std::is_copy_assignable_v<sgjw::Frame>, "frames are move-only");
+static_assert(std::is_nothrow_move_constructible_v<sgjw::Frame> && std::is_nothrow_move_assignable_v<sgjw::Frame>, "moves never throw");
+
+static int failed = 0;
+
+static void Check(bool passed, const char* name)
+{
+    printf("%-28s: %s\n", name, passed ? "ok" : "FAILED");
+    failed |= !passed;
+}
+
+// Allocations and releases of the library
+static size_t counts[2];
+
+static void* Counting_Alloc(size_t size, size_t align, void* user)
+{
+    ++static_cast<size_t*>(user)[0];
+
+    void* ptr = nullptr;
+    return posix_memalign(&ptr, align < sizeof(void*) ? sizeof(void*) : align, size) == 0 ? ptr : nullptr;
+}
+
+static void Counting_Release(void* ptr, void* user)
+{
+    ++static_cast<size_t*>(user)[1];
+    free(ptr);
+}
+
+static bool Same_Frame(const sgjw::Frame& a, const sgjw::Frame& b)
+{
+    if (a.width() != b.width() || a.height() != b.height() || a.date() != b.date() || a.sn() != b.sn() || a.appendix() != b.appendix() ||
+        a.emissivity() != b.emissivity() || a.matrix().size() != b.matrix().size())
+        return false;
+
+    for (size_t i = 0; i < a.matrix().size(); ++i)
+    {
+        if (a.matrix()[i] != b.matrix()[i])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief A frame to write: a 5x3 gradient, texts and a short appendix.
+ */
+static sgjw::Expected<sgjw::Frame> Make_Frame()
+{
+    auto frame = sgjw::Frame::create(5, 3, 5);
+    if (!frame)
+        return frame.error();
+
+    StateGridJPEGV2& obj = frame->native();
+    obj.version = 0x0100;
+    obj.emissivity = 0.95f;
+    snprintf(obj.date, sizeof(obj.date), "20241029120000");
+    snprintf(obj.sn, sizeof(obj.sn), "SN-HPP");
+    memcpy(obj.appendix, "hello", 5);
+
+    auto matrix = frame->matrix_2d();
+    for (size_t row = 0; row < matrix.extent(0); ++row)
+        for (size_t column = 0; column < matrix.extent(1); ++column)
+            matrix(row, column) = 20.0f + row * 10.0f + column * 0.5f;
+    return frame;
+}
+
+int main()
+{
+    SGJWAllocator allocator = {Counting_Alloc, Counting_Release, counts};
+    State_Grid_JPEG_Set_Allocator(&allocator);
+
+    // A bare JPEG (SOI, EOI) to append to
+    char path[] = "/tmp/sgjw_hpp_XXXXXX.jpg";
+    int fd = mkstemps(path, 4);
+    const uint8_t jpeg[4] = {0xFF, 0xD8, 0xFF, 0xD9};
+    if (fd < 0 || write(fd, jpeg, sizeof(jpeg)) != (ssize_t)sizeof(jpeg))
+    {
+        fprintf(stderr, "Create [%s] failed.\n", path);
+        return 1;
+    }
+    close(fd);
+
+    {
+        /* ---------- Step 1 : Create, append, read back ---------- */
+
+        auto source = Make_Frame();
+        Check(source && source->matrix().size() == 15 && source->matrix_2d()(2, 4) == 42.0f, "create");
+        Check(source && source->append(path).has_value(), "append");
+
+        auto frame = sgjw::Frame::read(path);
+        Check(frame && source && Same_Frame(*frame, *source) && frame->appendix() == "hello", "read");
+
+        // Only the trailer-only read opens the file first, see the note on Frame::read
+        auto missing = sgjw::Frame::read("/nonexistent/sgjw.jpg");
+        auto missing_trailer = sgjw::Frame::read("/nonexistent/sgjw.jpg", SGJW_READ_TRAILER_ONLY);
+        Check(!missing && missing.error() == SGJW_ERROR_READ_FAILED && !missing_trailer && missing_trailer.error() == SGJW_ERROR_FILE_NOT_FOUND, "read error");
+
+        /* ---------- Step 2 : Moves hand the block over, copy() duplicates it ---------- */
+
+        const float* data = frame->matrix().data();
+        sgjw::Frame moved = std::move(*frame);
+        Check(frame->empty() && frame->matrix().empty() && moved.matrix().data() == data, "move");
+
+        std::vector<sgjw::Frame> stages;
+        stages.push_back(std::move(moved));
+        Check(moved.empty() && stages[0].matrix().data() == data, "move into container");
+
+        auto copy = stages[0].copy();
+        Check(copy && Same_Frame(*copy, stages[0]) && copy->matrix().data() != data, "copy");
+
+        /* ---------- Step 3 : read_into keeps the block, a failure leaves it empty ---------- */
+
+        sgjw::Frame& reused = stages[0];
+        sgjw::Expected<void> failure = reused.read_into("/nonexistent/sgjw.jpg");
+        Check(!failure && failure.error() == SGJW_ERROR_FILE_NOT_FOUND && reused.empty() && reused.matrix().empty(), "read_into error");
+
+        size_t before = counts[0];
+        sgjw::Expected<void> again = reused.read_into(path, SGJW_READ_TRAILER_ONLY);
+        Check(again && Same_Frame(reused, *copy) && reused.matrix().data() == data && counts[0] == before, "read_into reuses the block");
+
+        /* ---------- Step 4 : Parse from memory ---------- */
+
+        std::vector<uint8_t> bytes;
+        FILE* file = fopen(path, "rb");
+        for (int c; file && (c = fgetc(file)) != EOF;)
+            bytes.push_back(static_cast<uint8_t>(c));
+        if (file)
+            fclose(file);
+
+        auto parsed = sgjw::Frame::read(std::span<const uint8_t>(bytes));
+        Check(parsed && Same_Frame(*parsed, *copy), "read from memory");
+        Check(parsed && parsed->matrix_2d().row(1).size() == 5 && parsed->matrix_2d().row(1)[0] == 30.0f, "row view");
+    }
+
+    unlink(path);
+    State_Grid_JPEG_Set_Allocator(nullptr);
+    Check(counts[0] > 0 && counts[0] == counts[1], "every block released");
+    return failed;
+}